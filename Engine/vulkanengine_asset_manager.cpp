@@ -0,0 +1,275 @@
+#include "vulkanengine_asset_manager.hpp"
+
+#include "vulkanengine_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+namespace vulkanengine
+{
+	VulkanEngineAssetManager::VulkanEngineAssetManager(VulkanEngineDevice& device, const Config& config)
+		: vulkanengine_device_{ device }, config_{ config }
+	{
+		stats_.gpu_budget_bytes = config_.gpu_budget_bytes;
+
+		uint32_t worker_count = config_.worker_count;
+		if (worker_count == 0)
+		{
+			worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+		for (uint32_t i = 0; i < worker_count; i++)
+		{
+			workers_.emplace_back(&VulkanEngineAssetManager::WorkerLoop, this);
+		}
+	}
+
+	VulkanEngineAssetManager::~VulkanEngineAssetManager()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ queue_mutex_ };
+			stopping_ = true;
+		}
+		queue_condition_.notify_all();
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+	}
+
+	ModelHandle VulkanEngineAssetManager::RequestModel(const std::string& filepath, const VulkanEngineModel::LoadOptions& options)
+	{
+		++stats_.request_count;
+		auto it = handles_by_path_.find(filepath);
+		if (it != handles_by_path_.end())
+		{
+			++stats_.deduplicated_request_count;
+			return it->second;
+		}
+
+		ModelHandle handle = static_cast<ModelHandle>(slots_.size());
+		Slot slot{};
+		slot.filepath = filepath;
+		slot.options = options;
+		slots_.push_back(std::move(slot));
+		handles_by_path_.emplace(filepath, handle);
+
+		Enqueue(handle);
+		return handle;
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineAssetManager::GetModel(ModelHandle handle)
+	{
+		assert(handle < slots_.size() && "Invalid model handle");
+		Slot& slot = slots_[handle];
+		slot.last_used_frame = frame_;
+
+		switch (slot.state)
+		{
+		case SlotState::kResident:
+			return slot.model;
+		case SlotState::kEvicted:
+			Enqueue(handle);
+			return placeholder_;
+		case SlotState::kFailed:
+			return nullptr;
+		default:
+			return placeholder_;
+		}
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineAssetManager::PeekModel(ModelHandle handle) const
+	{
+		assert(handle < slots_.size() && "Invalid model handle");
+		return slots_[handle].state == SlotState::kResident ? slots_[handle].model : nullptr;
+	}
+
+	bool VulkanEngineAssetManager::IsResident(ModelHandle handle) const
+	{
+		assert(handle < slots_.size() && "Invalid model handle");
+		return slots_[handle].state == SlotState::kResident;
+	}
+
+	std::vector<ModelHandle> VulkanEngineAssetManager::Update()
+	{
+		++frame_;
+
+		{
+			std::lock_guard<std::mutex> lock{ queue_mutex_ };
+			while (!completed_.empty())
+			{
+				uploads_.push_back(std::move(completed_.front()));
+				completed_.pop_front();
+			}
+		}
+
+		std::vector<ModelHandle> resident{};
+		while (!uploads_.empty() && resident.size() < config_.max_uploads_per_update)
+		{
+			LoadResult result = std::move(uploads_.front());
+			uploads_.pop_front();
+			Upload(result);
+			if (slots_[result.handle].state == SlotState::kResident)
+			{
+				resident.push_back(result.handle);
+			}
+		}
+
+		EvictOverBudget();
+		return resident;
+	}
+
+	void VulkanEngineAssetManager::WaitIdle()
+	{
+		while (stats_.pending_count > 0)
+		{
+			if (uploads_.empty())
+			{
+				std::unique_lock<std::mutex> lock{ queue_mutex_ };
+				completed_condition_.wait(lock, [this]() { return !completed_.empty(); });
+				while (!completed_.empty())
+				{
+					uploads_.push_back(std::move(completed_.front()));
+					completed_.pop_front();
+				}
+			}
+
+			while (!uploads_.empty())
+			{
+				LoadResult result = std::move(uploads_.front());
+				uploads_.pop_front();
+				Upload(result);
+			}
+		}
+	}
+
+	void VulkanEngineAssetManager::Enqueue(ModelHandle handle)
+	{
+		Slot& slot = slots_[handle];
+		slot.state = SlotState::kQueued;
+		++stats_.pending_count;
+
+		{
+			std::lock_guard<std::mutex> lock{ queue_mutex_ };
+			queue_.push_back({ handle, slot.filepath, slot.options });
+		}
+		queue_condition_.notify_one();
+	}
+
+	void VulkanEngineAssetManager::Upload(LoadResult& result)
+	{
+		VULKANENGINE_PROFILE_SCOPE("upload model");
+		Slot& slot = slots_[result.handle];
+		--stats_.pending_count;
+
+		if (!result.builder)
+		{
+			slot.state = SlotState::kFailed;
+			++stats_.failed_count;
+			std::cerr << "asset manager: failed to load " << slot.filepath << ": " << result.error << std::endl;
+			return;
+		}
+
+		if (config_.registry != nullptr)
+		{
+			slot.model = config_.registry->CreateFromBuilder(slot.filepath, slot.options, *result.builder);
+		}
+		else
+		{
+			slot.model = std::make_shared<VulkanEngineModel>(vulkanengine_device_, *result.builder);
+		}
+		slot.gpu_bytes = slot.model->GetMemoryStats().GetTotalBytes();
+		slot.state = SlotState::kResident;
+
+		if (resident_model_slots_[slot.model.get()]++ == 0)
+		{
+			stats_.resident_bytes += slot.gpu_bytes;
+		}
+		++stats_.resident_count;
+		++stats_.load_count;
+		stats_.total_load_milliseconds += result.milliseconds;
+	}
+
+	void VulkanEngineAssetManager::EvictOverBudget()
+	{
+		while (stats_.resident_bytes > config_.gpu_budget_bytes)
+		{
+			// Linear search: evictions are rare and the slot count is modest. Nothing used in the last
+			// kEvictionDelayFrames frames qualifies, so the budget may be exceeded while everything is in view
+			Slot* oldest = nullptr;
+			for (auto& slot : slots_)
+			{
+				if (slot.state == SlotState::kResident &&
+					slot.last_used_frame + kEvictionDelayFrames <= frame_ &&
+					(oldest == nullptr || slot.last_used_frame < oldest->last_used_frame))
+				{
+					oldest = &slot;
+				}
+			}
+			if (oldest == nullptr)
+			{
+				return;
+			}
+
+			Release(*oldest);
+			++stats_.eviction_count;
+		}
+	}
+
+	void VulkanEngineAssetManager::Release(Slot& slot)
+	{
+		auto it = resident_model_slots_.find(slot.model.get());
+		if (--it->second == 0)
+		{
+			resident_model_slots_.erase(it);
+			stats_.resident_bytes -= slot.gpu_bytes;
+		}
+
+		slot.model.reset();
+		slot.state = SlotState::kEvicted;
+		--stats_.resident_count;
+	}
+
+	void VulkanEngineAssetManager::WorkerLoop()
+	{
+		VULKANENGINE_PROFILE_THREAD("asset worker");
+		while (true)
+		{
+			LoadJob job{};
+			{
+				std::unique_lock<std::mutex> lock{ queue_mutex_ };
+				queue_condition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+				if (stopping_)
+				{
+					return;
+				}
+				job = std::move(queue_.front());
+				queue_.pop_front();
+			}
+
+			LoadResult result{};
+			result.handle = job.handle;
+			auto start_time = std::chrono::high_resolution_clock::now();
+			try
+			{
+				VULKANENGINE_PROFILE_SCOPE("load model");
+				result.builder = std::make_unique<VulkanEngineModel::Builder>(
+					VulkanEngineModel::LoadBuilderFromFile(job.filepath, job.options));
+			}
+			catch (const std::exception& e)
+			{
+				result.error = e.what();
+			}
+			result.milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - start_time).count();
+
+			{
+				std::lock_guard<std::mutex> lock{ queue_mutex_ };
+				completed_.push_back(std::move(result));
+			}
+			completed_condition_.notify_one();
+		}
+	}
+}  // namespace vulkanengine
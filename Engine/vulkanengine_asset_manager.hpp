@@ -0,0 +1,149 @@
+#pragma once
+
+#include "vulkanengine_device.hpp"
+#include "vulkanengine_model.hpp"
+#include "vulkanengine_model_registry.hpp"
+#include "vulkanengine_swap_chain.hpp"
+
+// std
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Index of a model slot in the asset manager; stays valid for the manager's lifetime, across evictions
+	using ModelHandle = uint32_t;
+	static constexpr ModelHandle kInvalidModelHandle = ~0u;
+
+	// Streams models in the background. RequestModel returns a handle right away and queues the file;
+	// worker threads parse and process it (VulkanEngineModel::LoadBuilderFromFile), and Update uploads the
+	// finished builders on the main thread. Until then GetModel hands out the placeholder.
+	// Requests for a path that is already known return the existing handle.
+	// Once the resident models exceed the GPU budget, Update evicts the ones seen least recently. An evicted
+	// model is queued again the next time it is asked for
+	class VulkanEngineAssetManager
+	{
+	public:
+		struct Config
+		{
+			uint32_t worker_count = 0;						// 0 picks hardware_concurrency - 1 (at least one)
+			VkDeviceSize gpu_budget_bytes = 256ull << 20;	// vertex and index memory of resident models
+			uint32_t max_uploads_per_update = 2;			// uploads wait for the transfer, so they are spread over frames
+			VulkanEngineModelRegistry* registry = nullptr;	// optional, shares models with identical content (or loaded directly)
+		};
+
+		struct Stats
+		{
+			uint32_t request_count = 0;
+			uint32_t deduplicated_request_count = 0;	// requests answered with an existing handle
+			uint32_t resident_count = 0;
+			uint32_t pending_count = 0;					// queued, loading or waiting for upload
+			uint32_t failed_count = 0;
+			uint32_t load_count = 0;					// completed uploads, reloads after eviction included
+			uint32_t eviction_count = 0;
+			VkDeviceSize resident_bytes = 0;
+			VkDeviceSize gpu_budget_bytes = 0;
+			float total_load_milliseconds = 0.f;		// worker time spent parsing and processing
+		};
+
+		// Models still referenced by frames in flight are never evicted
+		static constexpr uint64_t kEvictionDelayFrames = VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+		VulkanEngineAssetManager(VulkanEngineDevice& device, const Config& config);
+		~VulkanEngineAssetManager();
+
+		VulkanEngineAssetManager(const VulkanEngineAssetManager&) = delete;
+		VulkanEngineAssetManager& operator=(const VulkanEngineAssetManager&) = delete;
+
+		// The options of the first request for a path are the ones used
+		ModelHandle RequestModel(const std::string& filepath, const VulkanEngineModel::LoadOptions& options);
+
+		// Drawn in place of models that are not resident yet; may be null to skip them
+		void SetPlaceholder(std::shared_ptr<VulkanEngineModel> placeholder) { placeholder_ = std::move(placeholder); }
+
+		// The resident model, or the placeholder while it is loading (null if it failed). Counts as a use in
+		// the current frame for eviction, so only call it for objects that are actually drawn
+		std::shared_ptr<VulkanEngineModel> GetModel(ModelHandle handle);
+		// The resident model or null, without counting as a use (e.g. to cull against its bounds first)
+		std::shared_ptr<VulkanEngineModel> PeekModel(ModelHandle handle) const;
+		bool IsResident(ModelHandle handle) const;
+		const std::string& GetFilepath(ModelHandle handle) const { return slots_[handle].filepath; }
+
+		// Call once per frame on the main thread, after the frame's fence has been waited on. Uploads finished
+		// loads and evicts over budget. Returns the handles that became resident
+		std::vector<ModelHandle> Update();
+
+		// Blocks until nothing is pending, uploading everything as it arrives
+		void WaitIdle();
+
+		const Stats& GetStats() const { return stats_; }
+
+	private:
+		enum class SlotState
+		{
+			kQueued,	// with the workers, or waiting in completed_
+			kResident,
+			kEvicted,
+			kFailed,
+		};
+
+		struct Slot
+		{
+			std::string filepath;
+			VulkanEngineModel::LoadOptions options;
+			SlotState state = SlotState::kQueued;
+			std::shared_ptr<VulkanEngineModel> model;
+			VkDeviceSize gpu_bytes = 0;
+			uint64_t last_used_frame = 0;
+		};
+
+		struct LoadJob
+		{
+			ModelHandle handle;
+			std::string filepath;
+			VulkanEngineModel::LoadOptions options;
+		};
+
+		struct LoadResult
+		{
+			ModelHandle handle;
+			std::unique_ptr<VulkanEngineModel::Builder> builder;	// null on failure
+			std::string error;
+			float milliseconds = 0.f;
+		};
+
+		void Enqueue(ModelHandle handle);
+		void Upload(LoadResult& result);
+		void EvictOverBudget();
+		void Release(Slot& slot);
+		void WorkerLoop();
+
+		VulkanEngineDevice& vulkanengine_device_;
+		Config config_;
+
+		// main thread only
+		std::vector<Slot> slots_;
+		std::unordered_map<std::string, ModelHandle> handles_by_path_;
+		std::shared_ptr<VulkanEngineModel> placeholder_;
+		uint64_t frame_ = kEvictionDelayFrames;	// starts past the delay so never used models can go right away
+		Stats stats_{};
+		std::deque<LoadResult> uploads_;		// taken from completed_, waiting for an upload slot
+		// Slots per resident model: with a registry, several paths can end up with the same model, whose
+		// memory only counts once against the budget
+		std::unordered_map<const VulkanEngineModel*, uint32_t> resident_model_slots_;
+
+		std::mutex queue_mutex_;
+		std::condition_variable queue_condition_;
+		std::deque<LoadJob> queue_;
+		std::deque<LoadResult> completed_;
+		std::condition_variable completed_condition_;
+		bool stopping_ = false;
+		std::vector<std::thread> workers_;
+	};
+}  // namespace vulkanengine
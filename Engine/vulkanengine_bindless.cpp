@@ -0,0 +1,177 @@
+#include "vulkanengine_bindless.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	VulkanEngineBindlessSet::VulkanEngineBindlessSet(
+		VulkanEngineDevice& device,
+		uint32_t max_storage_buffers,
+		uint32_t max_images,
+		uint32_t frame_count)
+		: vulkanengine_device_{ device }
+	{
+		assert(device.SupportsBindless() && "Bindless set created on a device without descriptor indexing");
+		assert(frame_count > 0 && "Bindless set needs at least one frame");
+
+		// The bindings are visible to every stage, so the per stage limits apply as well as the per set ones.
+		// Per stage limits count every set of a pipeline layout, and combined image samplers count as both
+		// a sampled image and a sampler
+		const auto& limits = device.descriptor_indexing_properties_;
+		auto per_stage = [](uint32_t limit) { return limit > kReservedPerStageDescriptors ? limit - kReservedPerStageDescriptors : 0u; };
+		storage_buffers_.capacity = std::min({
+			max_storage_buffers,
+			limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			per_stage(limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers) });
+		images_.capacity = std::min({
+			max_images,
+			limits.maxDescriptorSetUpdateAfterBindSampledImages,
+			limits.maxDescriptorSetUpdateAfterBindSamplers,
+			per_stage(limits.maxPerStageDescriptorUpdateAfterBindSampledImages),
+			per_stage(limits.maxPerStageDescriptorUpdateAfterBindSamplers) });
+
+		// both arrays share the per stage resource and the all pools budgets, split evenly when they don't fit
+		uint32_t shared_limit = std::min(
+			per_stage(limits.maxPerStageUpdateAfterBindResources),
+			limits.maxUpdateAfterBindDescriptorsInAllPools);
+		storage_buffers_.capacity = std::min(storage_buffers_.capacity, shared_limit);
+		images_.capacity = std::min(images_.capacity, shared_limit);
+		if (static_cast<uint64_t>(storage_buffers_.capacity) + images_.capacity > shared_limit)
+		{
+			// both are <= shared_limit now, so neither subtraction wraps
+			uint32_t half = shared_limit / 2;
+			storage_buffers_.capacity = std::min(storage_buffers_.capacity, std::max(half, shared_limit - images_.capacity));
+			images_.capacity = std::min(images_.capacity, shared_limit - storage_buffers_.capacity);
+		}
+		assert(static_cast<uint64_t>(storage_buffers_.capacity) + images_.capacity <= shared_limit && "Bindless arrays exceed the shared descriptor budget");
+		if (storage_buffers_.capacity == 0 || images_.capacity == 0)
+		{
+			throw std::runtime_error("bindless descriptor limits too low!");
+		}
+		storage_buffers_.pending_release.resize(frame_count);
+		images_.pending_release.resize(frame_count);
+
+		// Slots may be empty (partially bound) and may be rewritten while other slots are in use by the GPU
+		const VkDescriptorBindingFlags binding_flags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+		set_layout_ = VulkanEngineDescriptorSetLayout::Builder(vulkanengine_device_)
+			.AddBinding(kStorageBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL, storage_buffers_.capacity)
+			.AddBinding(kImageBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_ALL, images_.capacity)
+			.SetBindingFlags(kStorageBufferBinding, binding_flags)
+			.SetBindingFlags(kImageBinding, binding_flags)
+			.SetLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT)
+			.Build();
+
+		pool_ = VulkanEngineDescriptorPool::Builder(vulkanengine_device_)
+			.SetMaxSets(1)
+			.SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storage_buffers_.capacity)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, images_.capacity)
+			.Build();
+
+		if (!pool_->AllocateDescriptorSet(set_layout_->GetDescriptorSetLayout(), descriptor_set_))
+		{
+			throw std::runtime_error("failed to allocate bindless descriptor set!");
+		}
+	}
+
+	VulkanEngineBindlessSet::~VulkanEngineBindlessSet() {}
+
+	// Must only be called once the fence for frame_index has been waited on
+	void VulkanEngineBindlessSet::BeginFrame(int frame_index)
+	{
+		assert(frame_index >= 0 && static_cast<size_t>(frame_index) < images_.pending_release.size() && "Frame index out of range");
+		current_frame_ = frame_index;
+
+		for (SlotArray* slots : { &storage_buffers_, &images_ })
+		{
+			auto& released = slots->pending_release[current_frame_];
+			slots->free_slots.insert(slots->free_slots.end(), released.begin(), released.end());
+			released.clear();
+		}
+	}
+
+	uint32_t VulkanEngineBindlessSet::RegisterStorageBuffer(const VkDescriptorBufferInfo& buffer_info)
+	{
+		uint32_t index = AcquireSlot(storage_buffers_);
+		WriteDescriptor(kStorageBufferBinding, index, &buffer_info, nullptr);
+		return index;
+	}
+
+	uint32_t VulkanEngineBindlessSet::RegisterImage(const VkDescriptorImageInfo& image_info)
+	{
+		uint32_t index = AcquireSlot(images_);
+		WriteDescriptor(kImageBinding, index, nullptr, &image_info);
+		return index;
+	}
+
+	// Only safe for slots that no command buffer in flight reads from
+	void VulkanEngineBindlessSet::UpdateStorageBuffer(uint32_t index, const VkDescriptorBufferInfo& buffer_info)
+	{
+		assert(index < storage_buffers_.next_unused && "Storage buffer index was never registered");
+		WriteDescriptor(kStorageBufferBinding, index, &buffer_info, nullptr);
+	}
+
+	void VulkanEngineBindlessSet::UpdateImage(uint32_t index, const VkDescriptorImageInfo& image_info)
+	{
+		assert(index < images_.next_unused && "Image index was never registered");
+		WriteDescriptor(kImageBinding, index, nullptr, &image_info);
+	}
+
+	void VulkanEngineBindlessSet::ReleaseStorageBuffer(uint32_t index) { ReleaseSlot(storage_buffers_, index); }
+
+	void VulkanEngineBindlessSet::ReleaseImage(uint32_t index) { ReleaseSlot(images_, index); }
+
+	uint32_t VulkanEngineBindlessSet::AcquireSlot(SlotArray& slots)
+	{
+		uint32_t index;
+		if (!slots.free_slots.empty())
+		{
+			index = slots.free_slots.back();
+			slots.free_slots.pop_back();
+		}
+		else if (slots.next_unused < slots.capacity)
+		{
+			index = slots.next_unused++;
+		}
+		else
+		{
+			throw std::runtime_error("bindless descriptor array exhausted!");
+		}
+		slots.live_count++;
+		return index;
+	}
+
+	void VulkanEngineBindlessSet::ReleaseSlot(SlotArray& slots, uint32_t index)
+	{
+		assert(index < slots.next_unused && "Releasing an index that was never registered");
+		assert(slots.live_count > 0 && "Releasing more slots than were registered");
+		slots.pending_release[current_frame_].push_back(index);
+		slots.live_count--;
+	}
+
+	void VulkanEngineBindlessSet::WriteDescriptor(
+		uint32_t binding,
+		uint32_t index,
+		const VkDescriptorBufferInfo* buffer_info,
+		const VkDescriptorImageInfo* image_info)
+	{
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptor_set_;
+		write.dstBinding = binding;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = binding == kStorageBufferBinding ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pBufferInfo = buffer_info;
+		write.pImageInfo = image_info;
+
+		vkUpdateDescriptorSets(vulkanengine_device_.Device(), 1, &write, 0, nullptr);
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "vulkanengine_descriptors.hpp"
+#include "vulkanengine_device.hpp"
+#include "Shaders/shader_shared.h"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace vulkanengine
+{
+	// One update-after-bind descriptor set holding every storage buffer and sampled image the renderer
+	// registers. It is bound once per frame, and shaders reach a resource through the index returned by
+	// Register*, passed in push constants or instance data instead of binding a set per draw.
+	// Requires VulkanEngineDevice::SupportsBindless()
+	//
+	// GLSL side, in the shader variants compile.bat builds with -DBINDLESS (see object_data.glsl):
+	//     layout(set = BINDLESS_SET, binding = BINDLESS_STORAGE_BUFFER_BINDING) readonly buffer Buffers { ... } buffers[];
+	//     layout(set = BINDLESS_SET, binding = BINDLESS_IMAGE_BINDING) uniform sampler2D images[];
+	class VulkanEngineBindlessSet
+	{
+	public:
+		static constexpr uint32_t kInvalidIndex = ~0u;
+		static constexpr uint32_t kSet = BINDLESS_SET;	// pipeline layouts place the set here
+		static constexpr uint32_t kStorageBufferBinding = BINDLESS_STORAGE_BUFFER_BINDING;
+		static constexpr uint32_t kImageBinding = BINDLESS_IMAGE_BINDING;
+		// Per stage descriptors of each type left for the other sets of a pipeline layout
+		static constexpr uint32_t kReservedPerStageDescriptors = 16;
+
+		VulkanEngineBindlessSet(
+			VulkanEngineDevice& device,
+			uint32_t max_storage_buffers,
+			uint32_t max_images,
+			uint32_t frame_count);
+		~VulkanEngineBindlessSet();
+
+		VulkanEngineBindlessSet(const VulkanEngineBindlessSet&) = delete;
+		VulkanEngineBindlessSet& operator=(const VulkanEngineBindlessSet&) = delete;
+
+		void BeginFrame(int frame_index);
+
+		uint32_t RegisterStorageBuffer(const VkDescriptorBufferInfo& buffer_info);
+		uint32_t RegisterImage(const VkDescriptorImageInfo& image_info);
+		void UpdateStorageBuffer(uint32_t index, const VkDescriptorBufferInfo& buffer_info);
+		void UpdateImage(uint32_t index, const VkDescriptorImageInfo& image_info);
+		void ReleaseStorageBuffer(uint32_t index);
+		void ReleaseImage(uint32_t index);
+
+		VkDescriptorSetLayout GetDescriptorSetLayout() const { return set_layout_->GetDescriptorSetLayout(); }
+		VkDescriptorSet GetDescriptorSet() const { return descriptor_set_; }
+		uint32_t GetStorageBufferCount() const { return storage_buffers_.live_count; }
+		uint32_t GetImageCount() const { return images_.live_count; }
+
+	private:
+		// Released slots wait in the list of the frame that released them until that frame index comes
+		// around again, at which point no command buffer in flight can still be reading them
+		struct SlotArray
+		{
+			uint32_t capacity = 0;
+			uint32_t next_unused = 0;
+			uint32_t live_count = 0;
+			std::vector<uint32_t> free_slots;
+			std::vector<std::vector<uint32_t>> pending_release;
+		};
+
+		uint32_t AcquireSlot(SlotArray& slots);
+		void ReleaseSlot(SlotArray& slots, uint32_t index);
+		void WriteDescriptor(
+			uint32_t binding,
+			uint32_t index,
+			const VkDescriptorBufferInfo* buffer_info,
+			const VkDescriptorImageInfo* image_info);
+
+		VulkanEngineDevice& vulkanengine_device_;
+		std::unique_ptr<VulkanEngineDescriptorSetLayout> set_layout_;
+		std::unique_ptr<VulkanEngineDescriptorPool> pool_;
+		VkDescriptorSet descriptor_set_;
+
+		SlotArray storage_buffers_;
+		SlotArray images_;
+		int current_frame_ = 0;
+	};
+}  // namespace vulkanengine
@@ -37,7 +37,7 @@ namespace vulkanengine
         void* GetMappedMemory() const { return mapped_; }
         uint32_t GetInstanceCount() const { return instance_count_; }
         VkDeviceSize GetInstanceSize() const { return instance_size_; }
-        VkDeviceSize GetAlignmentSize() const { return instance_size_; }
+        VkDeviceSize GetAlignmentSize() const { return alignment_size_; }
         VkBufferUsageFlags GetUsageFlags() const { return usage_flags_; }
         VkMemoryPropertyFlags GetMemoryPropertyFlags() const { return memory_property_flags_; }
         VkDeviceSize GetBufferSize() const { return buffer_size_; }
@@ -30,6 +30,52 @@ namespace vulkanengine
         projection_matrix_[3][2] = -(far * near) / (far - near);
     }
 
+    float VulkanEngineCamera::GetProjectedScale(const glm::vec3& world_position) const
+    {
+        // NDC spans 2 units of viewport height
+        float scale = glm::abs(projection_matrix_[1][1]) * .5f;
+
+        // perspective projections divide by view space depth (w = z)
+        if (projection_matrix_[2][3] != 0.f)
+        {
+            float depth = (view_matrix_ * glm::vec4(world_position, 1.f)).z;
+            scale /= glm::max(depth, std::numeric_limits<float>::epsilon());
+        }
+        return scale;
+    }
+
+    std::array<glm::vec4, 6> VulkanEngineCamera::GetFrustumPlanes() const
+    {
+        // Gribb & Hartmann: each plane is a sum or difference of rows of the view projection matrix.
+        // Depth runs from 0 to 1, so the near plane is the third row alone
+        glm::mat4 m = glm::transpose(projection_matrix_ * view_matrix_);
+        std::array<glm::vec4, 6> planes{
+            m[3] + m[0],    // left
+            m[3] - m[0],    // right
+            m[3] + m[1],    // top (y points down)
+            m[3] - m[1],    // bottom
+            m[2],           // near
+            m[3] - m[2]     // far
+        };
+        for (auto& plane : planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return planes;
+    }
+
+    bool VulkanEngineCamera::IsSphereOutsideFrustum(const std::array<glm::vec4, 6>& frustum_planes, const glm::vec3& center, float radius)
+    {
+        for (const auto& plane : frustum_planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void VulkanEngineCamera::SetViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up)
     {
         assert(glm::dot(direction, direction) > std::numeric_limits<float>::epsilon() && "Direction cannot be of length 0");
@@ -5,6 +5,9 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+// std
+#include <array>
+
 namespace vulkanengine
 {
 	class VulkanEngineCamera
@@ -22,6 +25,13 @@ namespace vulkanengine
 		const glm::mat4& GetInverseView() const { return inverse_view_matrix_; }
 		const glm::vec3 GetPosition() const { return glm::vec3(inverse_view_matrix_[3]); };
 
+		// Fraction of the viewport height covered by one world unit at [world_position]; used for LOD selection
+		float GetProjectedScale(const glm::vec3& world_position) const;
+		// World space planes (xyz normal pointing inwards, w distance), normalized so a sphere is outside
+		// when dot(normal, center) + w < -radius
+		std::array<glm::vec4, 6> GetFrustumPlanes() const;
+		static bool IsSphereOutsideFrustum(const std::array<glm::vec4, 6>& frustum_planes, const glm::vec3& center, float radius);
+
 	private:
 		glm::mat4 projection_matrix_{ 1.f };
 		glm::mat4 view_matrix_{ 1.f };
@@ -0,0 +1,537 @@
+#include "vulkanengine_command_capture.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	using Op = VulkanEngineCommandCapture::Op;
+
+	namespace
+	{
+		template <typename T>
+		void WriteValue(std::ofstream& file, const T& value)
+		{
+			file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void WriteBlock(std::ofstream& file, const std::vector<uint8_t>& bytes)
+		{
+			WriteValue(file, static_cast<uint64_t>(bytes.size()));
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		}
+
+		// Bounds checked reads from a loaded capture
+		class CaptureReader
+		{
+		public:
+			CaptureReader(const uint8_t* data, size_t size) : data_{ data }, size_{ size } {}
+
+			template <typename T>
+			T Read()
+			{
+				T value;
+				ReadBytes(&value, sizeof(T));
+				return value;
+			}
+
+			void ReadBytes(void* destination, size_t size)
+			{
+				if (size > size_ - position_)
+				{
+					throw std::runtime_error("capture file is truncated!");
+				}
+				memcpy(destination, data_ + position_, size);
+				position_ += size;
+			}
+
+			std::vector<uint8_t> ReadBlock()
+			{
+				uint64_t size = Read<uint64_t>();
+				if (size > size_ - position_)
+				{
+					throw std::runtime_error("capture file is truncated!");
+				}
+				std::vector<uint8_t> bytes(static_cast<size_t>(size));
+				ReadBytes(bytes.data(), bytes.size());
+				return bytes;
+			}
+
+			void Skip(size_t size)
+			{
+				if (size > size_ - position_)
+				{
+					throw std::runtime_error("capture file is truncated!");
+				}
+				position_ += size;
+			}
+
+			bool AtEnd() const { return position_ == size_; }
+
+		private:
+			const uint8_t* data_;
+			size_t size_;
+			size_t position_ = 0;
+		};
+	}  // namespace
+
+	VulkanEngineCommandCapture::VulkanEngineCommandCapture(VulkanEngineDevice& device)
+		: vulkanengine_device_{ device }
+	{
+	}
+
+	void VulkanEngineCommandCapture::SetGlobalUniforms(const void* data, uint32_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		global_uniforms_.assign(bytes, bytes + size);
+	}
+
+	void VulkanEngineCommandCapture::BindPipeline(PipelineSource source, const std::vector<uint8_t>& description)
+	{
+		uint32_t index = 0;
+		while (index < pipelines_.size() && (pipelines_[index].source != source || pipelines_[index].description != description))
+		{
+			++index;
+		}
+		if (index == pipelines_.size())
+		{
+			pipelines_.push_back({ source, description });
+		}
+
+		BeginOp(Op::kBindPipeline);
+		Write(index);
+	}
+
+	void VulkanEngineCommandCapture::BindGlobalSet()
+	{
+		BeginOp(Op::kBindGlobalSet);
+	}
+
+	void VulkanEngineCommandCapture::PushConstants(VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data)
+	{
+		BeginOp(Op::kPushConstants);
+		Write(static_cast<uint32_t>(stages));
+		Write(offset);
+		Write(size);
+		WriteBytes(data, size);
+	}
+
+	void VulkanEngineCommandCapture::BindGeometry(const VulkanEngineModel& model)
+	{
+		auto it = geometry_indices_.find(&model);
+		if (it == geometry_indices_.end())
+		{
+			VulkanEngineModel::GeometryBuffers buffers = model.GetGeometryBuffers();
+			Geometry geometry{};
+			geometry.positions = ReadBack(*buffers.position);
+			geometry.attributes = ReadBack(*buffers.attribute);
+			if (buffers.index != nullptr)
+			{
+				geometry.indices = ReadBack(*buffers.index);
+			}
+			geometry.index_type = buffers.index_type;
+			geometries_.push_back(std::move(geometry));
+			it = geometry_indices_.emplace(&model, static_cast<uint32_t>(geometries_.size() - 1)).first;
+		}
+
+		BeginOp(Op::kBindGeometry);
+		Write(it->second);
+	}
+
+	void VulkanEngineCommandCapture::DrawModel(const VulkanEngineModel& model, uint32_t lod)
+	{
+		VulkanEngineModel::GeometryBuffers buffers = model.GetGeometryBuffers();
+		if (buffers.index == nullptr)
+		{
+			Draw(buffers.vertex_count, 1, 0, 0);
+			return;
+		}
+
+		const VulkanEngineModel::Lod& range = model.GetLod(lod);
+		VkDrawIndexedIndirectCommand command{ range.index_count, 1, range.first_index, 0, 0 };
+		BeginOp(Op::kDrawIndexed);
+		Write(command);
+	}
+
+	void VulkanEngineCommandCapture::Draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
+	{
+		VkDrawIndirectCommand command{ vertex_count, instance_count, first_vertex, first_instance };
+		BeginOp(Op::kDraw);
+		Write(command);
+	}
+
+	void VulkanEngineCommandCapture::DrawIndexedIndirect(VulkanEngineRingBuffer& ring_buffer, VkDeviceSize offset, uint32_t count)
+	{
+		BeginOp(Op::kDrawIndexedIndirect);
+		Write(count);
+		pending_indirect_.push_back({ &ring_buffer, offset, count, commands_.size() });
+		commands_.resize(commands_.size() + sizeof(VkDrawIndexedIndirectCommand) * count);
+	}
+
+	bool VulkanEngineCommandCapture::Save(const std::string& filepath)
+	{
+		if (!pending_indirect_.empty())
+		{
+			vkDeviceWaitIdle(vulkanengine_device_.Device());
+			for (const PendingIndirect& pending : pending_indirect_)
+			{
+				VkDeviceSize size = sizeof(VkDrawIndexedIndirectCommand) * pending.count;
+				memcpy(commands_.data() + pending.position, pending.ring_buffer->Read(pending.offset, size), static_cast<size_t>(size));
+			}
+			pending_indirect_.clear();
+		}
+
+		std::ofstream file{ filepath, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			return false;
+		}
+
+		WriteValue(file, kMagic);
+		WriteValue(file, kVersion);
+
+		WriteValue(file, static_cast<uint32_t>(pipelines_.size()));
+		for (const auto& pipeline : pipelines_)
+		{
+			WriteValue(file, pipeline.source);
+			WriteBlock(file, pipeline.description);
+		}
+
+		WriteValue(file, static_cast<uint32_t>(geometries_.size()));
+		for (const auto& geometry : geometries_)
+		{
+			WriteValue(file, static_cast<uint32_t>(geometry.index_type));
+			WriteBlock(file, geometry.positions);
+			WriteBlock(file, geometry.attributes);
+			WriteBlock(file, geometry.indices);
+		}
+
+		WriteBlock(file, global_uniforms_);
+		WriteValue(file, command_count_);
+		WriteBlock(file, commands_);
+		return static_cast<bool>(file);
+	}
+
+	void VulkanEngineCommandCapture::WriteBytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		commands_.insert(commands_.end(), bytes, bytes + size);
+	}
+
+	void VulkanEngineCommandCapture::BeginOp(Op op)
+	{
+		Write(op);
+		++command_count_;
+	}
+
+	std::vector<uint8_t> VulkanEngineCommandCapture::ReadBack(const VulkanEngineBuffer& buffer)
+	{
+		VulkanEngineBuffer readback_buffer{
+			vulkanengine_device_,
+			buffer.GetBufferSize(),
+			1,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		vulkanengine_device_.CopyBuffer(buffer.GetBuffer(), readback_buffer.GetBuffer(), buffer.GetBufferSize());
+
+		readback_buffer.Map();
+		const uint8_t* mapped = static_cast<const uint8_t*>(readback_buffer.GetMappedMemory());
+		return std::vector<uint8_t>(mapped, mapped + buffer.GetBufferSize());
+	}
+
+	VulkanEngineCommandReplay::VulkanEngineCommandReplay(VulkanEngineDevice& device, const std::string& filepath)
+		: vulkanengine_device_{ device }
+	{
+		std::ifstream file{ filepath, std::ios::binary };
+		if (!file)
+		{
+			throw std::runtime_error("failed to open capture file: " + filepath);
+		}
+		std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		CaptureReader reader{ contents.data(), contents.size() };
+
+		if (reader.Read<uint32_t>() != VulkanEngineCommandCapture::kMagic)
+		{
+			throw std::runtime_error("not a command capture: " + filepath);
+		}
+		if (reader.Read<uint32_t>() != VulkanEngineCommandCapture::kVersion)
+		{
+			throw std::runtime_error("unsupported command capture version: " + filepath);
+		}
+
+		uint32_t pipeline_count = reader.Read<uint32_t>();
+		for (uint32_t i = 0; i < pipeline_count; ++i)
+		{
+			pipeline_sources_.push_back(reader.Read<VulkanEngineCommandCapture::PipelineSource>());
+			pipeline_descriptions_.push_back(reader.ReadBlock());
+		}
+
+		uint32_t geometry_count = reader.Read<uint32_t>();
+		for (uint32_t i = 0; i < geometry_count; ++i)
+		{
+			Geometry geometry{};
+			geometry.index_type = static_cast<VkIndexType>(reader.Read<uint32_t>());
+			geometry.position_buffer = CreateDeviceLocalBuffer(reader.ReadBlock(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			geometry.attribute_buffer = CreateDeviceLocalBuffer(reader.ReadBlock(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			std::vector<uint8_t> indices = reader.ReadBlock();
+			if (!indices.empty())
+			{
+				geometry.index_buffer = CreateDeviceLocalBuffer(indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+			}
+			geometries_.push_back(std::move(geometry));
+		}
+
+		global_uniforms_ = reader.ReadBlock();
+		command_count_ = reader.Read<uint32_t>();
+		commands_ = reader.ReadBlock();
+		if (!reader.AtEnd())
+		{
+			throw std::runtime_error("capture file has trailing data: " + filepath);
+		}
+
+		ParseCommands();
+	}
+
+	void VulkanEngineCommandReplay::ResolvePipelines(const PipelineResolver& resolver)
+	{
+		pipelines_.clear();
+		for (size_t i = 0; i < pipeline_sources_.size(); ++i)
+		{
+			pipelines_.push_back(resolver(pipeline_sources_[i], pipeline_descriptions_[i]));
+		}
+	}
+
+	void VulkanEngineCommandReplay::Record(VkCommandBuffer command_buffer, VkDescriptorSet global_descriptor_set, uint32_t global_ubo_offset) const
+	{
+		assert(pipelines_.size() == pipeline_sources_.size() && "ResolvePipelines has to be called before Record");
+
+		CaptureReader reader{ commands_.data(), commands_.size() };
+		VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+		// systems may bind the global set before their first pipeline; every layout shares set 0, so the
+		// bind is deferred until a layout is known
+		bool global_set_pending = false;
+		VkDeviceSize indirect_offset = 0;
+		constexpr uint32_t kIndirectStride = sizeof(VkDrawIndexedIndirectCommand);
+
+		while (!reader.AtEnd())
+		{
+			switch (reader.Read<Op>())
+			{
+			case Op::kBindPipeline:
+			{
+				const ReplayPipeline& pipeline = pipelines_[reader.Read<uint32_t>()];
+				pipeline.pipeline->Bind(command_buffer);
+				pipeline_layout = pipeline.pipeline_layout;
+				if (!global_set_pending)
+				{
+					break;
+				}
+				global_set_pending = false;
+			}
+				[[fallthrough]];
+			case Op::kBindGlobalSet:
+				if (pipeline_layout == VK_NULL_HANDLE)
+				{
+					global_set_pending = true;
+					break;
+				}
+				vkCmdBindDescriptorSets(
+					command_buffer,
+					VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipeline_layout,
+					0,
+					1,
+					&global_descriptor_set,
+					1,
+					&global_ubo_offset);
+				break;
+			case Op::kPushConstants:
+			{
+				VkShaderStageFlags stages = reader.Read<uint32_t>();
+				uint32_t offset = reader.Read<uint32_t>();
+				uint32_t size = reader.Read<uint32_t>();
+				uint8_t data[256];
+				reader.ReadBytes(data, size);
+				vkCmdPushConstants(command_buffer, pipeline_layout, stages, offset, size, data);
+				break;
+			}
+			case Op::kBindGeometry:
+			{
+				const Geometry& geometry = geometries_[reader.Read<uint32_t>()];
+				VkBuffer buffers[] = { geometry.position_buffer->GetBuffer(), geometry.attribute_buffer->GetBuffer() };
+				VkDeviceSize offsets[] = { 0, 0 };
+				vkCmdBindVertexBuffers(command_buffer, VertexFormat::kPositionBinding, 2, buffers, offsets);
+				if (geometry.index_buffer)
+				{
+					vkCmdBindIndexBuffer(command_buffer, geometry.index_buffer->GetBuffer(), 0, geometry.index_type);
+				}
+				break;
+			}
+			case Op::kDraw:
+			{
+				auto command = reader.Read<VkDrawIndirectCommand>();
+				vkCmdDraw(command_buffer, command.vertexCount, command.instanceCount, command.firstVertex, command.firstInstance);
+				break;
+			}
+			case Op::kDrawIndexed:
+			{
+				auto command = reader.Read<VkDrawIndexedIndirectCommand>();
+				vkCmdDrawIndexed(command_buffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+				break;
+			}
+			case Op::kDrawIndexedIndirect:
+			{
+				// the commands themselves were copied to the indirect buffer by ParseCommands
+				uint32_t count = reader.Read<uint32_t>();
+				reader.Skip(static_cast<size_t>(kIndirectStride) * count);
+				if (vulkanengine_device_.SupportsMultiDrawIndirect())
+				{
+					vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer_->GetBuffer(), indirect_offset, count, kIndirectStride);
+				}
+				else
+				{
+					for (uint32_t i = 0; i < count; ++i)
+					{
+						vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer_->GetBuffer(), indirect_offset + kIndirectStride * i, 1, kIndirectStride);
+					}
+				}
+				indirect_offset += static_cast<VkDeviceSize>(kIndirectStride) * count;
+				break;
+			}
+			}
+		}
+	}
+
+	std::unique_ptr<VulkanEngineBuffer> VulkanEngineCommandReplay::CreateDeviceLocalBuffer(const std::vector<uint8_t>& data, VkBufferUsageFlags usage)
+	{
+		if (data.empty())
+		{
+			throw std::runtime_error("capture file has an empty geometry buffer!");
+		}
+
+		VulkanEngineBuffer staging_buffer{
+			vulkanengine_device_,
+			data.size(),
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		staging_buffer.Map();
+		staging_buffer.WriteToBuffer(const_cast<uint8_t*>(data.data()));
+
+		auto buffer = std::make_unique<VulkanEngineBuffer>(
+			vulkanengine_device_,
+			data.size(),
+			1,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		vulkanengine_device_.CopyBuffer(staging_buffer.GetBuffer(), buffer->GetBuffer(), data.size());
+		return buffer;
+	}
+
+	void VulkanEngineCommandReplay::ParseCommands()
+	{
+		std::vector<VkDrawIndexedIndirectCommand> indirect_commands{};
+		CaptureReader reader{ commands_.data(), commands_.size() };
+		bool pipeline_bound = false;
+		bool geometry_bound = false;
+		bool indexed = false;
+		uint32_t command_count = 0;
+
+		while (!reader.AtEnd())
+		{
+			++command_count;
+			Op op = reader.Read<Op>();
+			switch (op)
+			{
+			case Op::kBindPipeline:
+				if (reader.Read<uint32_t>() >= pipeline_sources_.size())
+				{
+					throw std::runtime_error("capture binds an unknown pipeline!");
+				}
+				pipeline_bound = true;
+				break;
+			case Op::kBindGlobalSet:
+				break;
+			case Op::kPushConstants:
+			{
+				reader.Read<uint32_t>();
+				reader.Read<uint32_t>();
+				uint32_t size = reader.Read<uint32_t>();
+				// Vulkan guarantees at least 128 bytes, no device offers more than 256
+				if (size > 256)
+				{
+					throw std::runtime_error("capture pushes more constants than any device supports!");
+				}
+				reader.Skip(size);
+				break;
+			}
+			case Op::kBindGeometry:
+			{
+				uint32_t geometry = reader.Read<uint32_t>();
+				if (geometry >= geometries_.size())
+				{
+					throw std::runtime_error("capture binds unknown geometry!");
+				}
+				geometry_bound = true;
+				indexed = geometries_[geometry].index_buffer != nullptr;
+				break;
+			}
+			case Op::kDraw:
+				reader.Skip(sizeof(VkDrawIndirectCommand));
+				++draw_count_;
+				break;
+			case Op::kDrawIndexed:
+				if (!geometry_bound || !indexed)
+				{
+					throw std::runtime_error("capture draws indexed without an index buffer!");
+				}
+				reader.Skip(sizeof(VkDrawIndexedIndirectCommand));
+				++draw_count_;
+				break;
+			case Op::kDrawIndexedIndirect:
+			{
+				if (!geometry_bound || !indexed)
+				{
+					throw std::runtime_error("capture draws indexed without an index buffer!");
+				}
+				uint32_t count = reader.Read<uint32_t>();
+				size_t first = indirect_commands.size();
+				indirect_commands.resize(first + count);
+				reader.ReadBytes(indirect_commands.data() + first, sizeof(VkDrawIndexedIndirectCommand) * count);
+				draw_count_ += count;
+				break;
+			}
+			default:
+				throw std::runtime_error("capture contains an unknown command!");
+			}
+
+			bool needs_pipeline = op == Op::kPushConstants || op == Op::kDraw || op == Op::kDrawIndexed || op == Op::kDrawIndexedIndirect;
+			if (needs_pipeline && !pipeline_bound)
+			{
+				throw std::runtime_error("capture records draws before binding a pipeline!");
+			}
+		}
+
+		if (command_count != command_count_)
+		{
+			throw std::runtime_error("capture command count does not match its stream!");
+		}
+
+		if (!indirect_commands.empty())
+		{
+			indirect_buffer_ = std::make_unique<VulkanEngineBuffer>(
+				vulkanengine_device_,
+				sizeof(VkDrawIndexedIndirectCommand),
+				static_cast<uint32_t>(indirect_commands.size()),
+				VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			indirect_buffer_->Map();
+			indirect_buffer_->WriteToBuffer(indirect_commands.data());
+			indirect_buffer_->Unmap();
+		}
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "vulkanengine_buffer.hpp"
+#include "vulkanengine_device.hpp"
+#include "vulkanengine_model.hpp"
+#include "vulkanengine_pipeline.hpp"
+#include "vulkanengine_ring_buffer.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Records what the render systems put into one frame's command buffer (pipeline binds, push constant
+	// payloads, geometry binds and draw parameters) next to the real vkCmd* calls, and saves it as a compact
+	// binary stream. The geometry each draw uses is copied back from the GPU, and the frame's GlobalUbo is
+	// kept too, so VulkanEngineCommandReplay can re-issue the frame without the app's assets or state.
+	// Pipelines are stored as a description their system can rebuild them from, not as Vulkan state
+	class VulkanEngineCommandCapture
+	{
+	public:
+		static constexpr uint32_t kMagic = 0x43434556;		// "VECC"
+		static constexpr uint32_t kVersion = 3;	// 3: SimpleRenderSystem pushes to the vertex stage only
+
+		// The systems a captured pipeline description belongs to
+		enum class PipelineSource : uint8_t
+		{
+			kSimpleRenderSystem = 0,
+			kPointLightSystem = 1,
+		};
+
+		enum class Op : uint8_t
+		{
+			kBindPipeline = 0,			// uint32 pipeline
+			kBindGlobalSet = 1,			// the replay binds its own set holding the captured GlobalUbo
+			kPushConstants = 2,			// uint32 stages, offset, size, then the bytes
+			kBindGeometry = 3,			// uint32 geometry
+			kDraw = 4,					// VkDrawIndirectCommand
+			kDrawIndexed = 5,			// VkDrawIndexedIndirectCommand
+			kDrawIndexedIndirect = 6,	// uint32 count, then count VkDrawIndexedIndirectCommands
+		};
+
+		explicit VulkanEngineCommandCapture(VulkanEngineDevice& device);
+
+		VulkanEngineCommandCapture(const VulkanEngineCommandCapture&) = delete;
+		VulkanEngineCommandCapture& operator=(const VulkanEngineCommandCapture&) = delete;
+
+		void SetGlobalUniforms(const void* data, uint32_t size);
+		// [description] is whatever the system needs to build the same pipeline again; equal descriptions share an index
+		void BindPipeline(PipelineSource source, const std::vector<uint8_t>& description);
+		void BindGlobalSet();
+		void PushConstants(VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+		// Copies the model's buffers back the first time the model is bound, which waits for the device
+		void BindGeometry(const VulkanEngineModel& model);
+		// Mirrors VulkanEngineModel::Draw
+		void DrawModel(const VulkanEngineModel& model, uint32_t lod);
+		void Draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+		// The commands are read back from [ring_buffer] by Save rather than copied here, so draws whose
+		// parameters the device writes during the frame, like the occlusion culler's, are captured as drawn
+		void DrawIndexedIndirect(VulkanEngineRingBuffer& ring_buffer, VkDeviceSize offset, uint32_t count);
+
+		uint32_t GetCommandCount() const { return command_count_; }
+		// Call after the captured frame was submitted and before its ring buffer partition is begun again;
+		// waits for the device when there are indirect draws to read back. Returns false if the file could not be written
+		bool Save(const std::string& filepath);
+
+	private:
+		struct Pipeline
+		{
+			PipelineSource source;
+			std::vector<uint8_t> description;
+		};
+
+		// Indirect commands still on the device, and where in commands_ they go
+		struct PendingIndirect
+		{
+			VulkanEngineRingBuffer* ring_buffer;
+			VkDeviceSize offset;
+			uint32_t count;
+			size_t position;
+		};
+
+		struct Geometry
+		{
+			std::vector<uint8_t> positions;
+			std::vector<uint8_t> attributes;
+			std::vector<uint8_t> indices;	// empty for non-indexed models
+			VkIndexType index_type;
+		};
+
+		template <typename T>
+		void Write(const T& value) { WriteBytes(&value, sizeof(T)); }
+		void WriteBytes(const void* data, size_t size);
+		void BeginOp(Op op);
+		std::vector<uint8_t> ReadBack(const VulkanEngineBuffer& buffer);
+
+		VulkanEngineDevice& vulkanengine_device_;
+		std::vector<Pipeline> pipelines_;
+		std::vector<Geometry> geometries_;
+		std::unordered_map<const VulkanEngineModel*, uint32_t> geometry_indices_;
+		std::vector<uint8_t> global_uniforms_;
+		std::vector<uint8_t> commands_;
+		std::vector<PendingIndirect> pending_indirect_;
+		uint32_t command_count_ = 0;
+	};
+
+	// Loads a capture, uploads its geometry and re-records its command stream into any command buffer,
+	// as often as needed. Pipelines are rebuilt through a resolver, usually the systems that captured them
+	class VulkanEngineCommandReplay
+	{
+	public:
+		struct ReplayPipeline
+		{
+			std::shared_ptr<VulkanEnginePipeline> pipeline;
+			VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+		};
+		using PipelineResolver = std::function<ReplayPipeline(VulkanEngineCommandCapture::PipelineSource, const std::vector<uint8_t>&)>;
+
+		// Throws std::runtime_error if the file is missing, truncated or from another capture version
+		VulkanEngineCommandReplay(VulkanEngineDevice& device, const std::string& filepath);
+
+		VulkanEngineCommandReplay(const VulkanEngineCommandReplay&) = delete;
+		VulkanEngineCommandReplay& operator=(const VulkanEngineCommandReplay&) = delete;
+
+		// Before the first Record
+		void ResolvePipelines(const PipelineResolver& resolver);
+		// To be written to the buffer behind the global set every frame
+		const std::vector<uint8_t>& GetGlobalUniforms() const { return global_uniforms_; }
+		uint32_t GetCommandCount() const { return command_count_; }
+		uint32_t GetDrawCount() const { return draw_count_; }
+
+		// Inside a render pass compatible with the captured pipelines
+		void Record(VkCommandBuffer command_buffer, VkDescriptorSet global_descriptor_set, uint32_t global_ubo_offset) const;
+
+	private:
+		struct Geometry
+		{
+			std::unique_ptr<VulkanEngineBuffer> position_buffer;
+			std::unique_ptr<VulkanEngineBuffer> attribute_buffer;
+			std::unique_ptr<VulkanEngineBuffer> index_buffer;	// null for non-indexed models
+			VkIndexType index_type;
+		};
+
+		std::unique_ptr<VulkanEngineBuffer> CreateDeviceLocalBuffer(const std::vector<uint8_t>& data, VkBufferUsageFlags usage);
+		// Checks every op and its indices once, so Record can trust the stream, and gathers the indirect draws
+		void ParseCommands();
+
+		VulkanEngineDevice& vulkanengine_device_;
+		std::vector<VulkanEngineCommandCapture::PipelineSource> pipeline_sources_;
+		std::vector<std::vector<uint8_t>> pipeline_descriptions_;
+		std::vector<ReplayPipeline> pipelines_;
+		std::vector<Geometry> geometries_;
+		std::vector<uint8_t> global_uniforms_;
+		std::vector<uint8_t> commands_;
+		uint32_t command_count_ = 0;
+		uint32_t draw_count_ = 0;
+
+		// the indirect draws of the whole stream, in stream order
+		std::unique_ptr<VulkanEngineBuffer> indirect_buffer_;
+	};
+}  // namespace vulkanengine
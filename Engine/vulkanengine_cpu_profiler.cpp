@@ -0,0 +1,157 @@
+#include "vulkanengine_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vulkanengine
+{
+	namespace
+	{
+		struct Event
+		{
+			const char* name;
+			uint64_t begin;
+			uint64_t end;
+		};
+
+		struct ThreadBuffer
+		{
+			std::mutex mutex;
+			std::vector<Event> events;
+			size_t next = 0;
+			size_t count = 0;
+			uint32_t thread_id = 0;
+			std::string thread_name;
+		};
+
+		// Buffers outlive their threads, so zones of finished workers still make it into the trace
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+			std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		};
+
+		Registry& GetRegistry()
+		{
+			static Registry registry{};
+			return registry;
+		}
+
+		ThreadBuffer& GetThreadBuffer()
+		{
+			thread_local ThreadBuffer* buffer = nullptr;
+			if (buffer == nullptr)
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock{ registry.mutex };
+				auto new_buffer = std::make_unique<ThreadBuffer>();
+				new_buffer->events.resize(VulkanEngineCpuProfiler::kEventsPerThread);
+				new_buffer->thread_id = static_cast<uint32_t>(registry.buffers.size());
+				new_buffer->thread_name = "thread " + std::to_string(new_buffer->thread_id);
+				buffer = new_buffer.get();
+				registry.buffers.push_back(std::move(new_buffer));
+			}
+			return *buffer;
+		}
+
+		void WriteEscaped(std::ofstream& file, const std::string& text)
+		{
+			for (char c : text)
+			{
+				if (c == '"' || c == '\\')
+				{
+					file << '\\';
+				}
+				file << c;
+			}
+		}
+
+		// Trace timestamps are microseconds; written as fixed point so nothing is lost to float formatting
+		void WriteMicroseconds(std::ofstream& file, uint64_t nanoseconds)
+		{
+			file << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000;
+		}
+	}  // namespace
+
+	uint64_t VulkanEngineCpuProfiler::Now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - GetRegistry().epoch).count());
+	}
+
+	void VulkanEngineCpuProfiler::Record(const char* name, uint64_t begin_nanoseconds, uint64_t end_nanoseconds)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock{ buffer.mutex };
+		buffer.events[buffer.next] = { name, begin_nanoseconds, end_nanoseconds };
+		buffer.next = (buffer.next + 1) % kEventsPerThread;
+		buffer.count = std::min(buffer.count + 1, kEventsPerThread);
+	}
+
+	void VulkanEngineCpuProfiler::SetThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock{ buffer.mutex };
+		buffer.thread_name = name;
+	}
+
+	bool VulkanEngineCpuProfiler::WriteChromeTrace(const std::string& filepath)
+	{
+		std::ofstream file{ filepath, std::ios::trunc };
+		if (!file)
+		{
+			return false;
+		}
+
+		// "X" events carry their own duration, so nesting follows from the timestamps; times are in microseconds
+		file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> registry_lock{ registry.mutex };
+		for (const auto& buffer : registry.buffers)
+		{
+			std::lock_guard<std::mutex> lock{ buffer->mutex };
+
+			file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+				<< ",\"args\":{\"name\":\"";
+			WriteEscaped(file, buffer->thread_name);
+			file << "\"}}";
+			first = false;
+
+			size_t oldest = (buffer->next + kEventsPerThread - buffer->count) % kEventsPerThread;
+			for (size_t i = 0; i < buffer->count; ++i)
+			{
+				const Event& event = buffer->events[(oldest + i) % kEventsPerThread];
+				file << ",\n{\"name\":\"";
+				WriteEscaped(file, event.name);
+				file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+					<< ",\"ts\":";
+				WriteMicroseconds(file, event.begin);
+				file << ",\"dur\":";
+				WriteMicroseconds(file, event.end - event.begin);
+				file << "}";
+			}
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+	void VulkanEngineCpuProfiler::Clear()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> registry_lock{ registry.mutex };
+		for (const auto& buffer : registry.buffers)
+		{
+			std::lock_guard<std::mutex> lock{ buffer->mutex };
+			buffer->next = 0;
+			buffer->count = 0;
+		}
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,66 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones, recorded only with VULKANENGINE_ENABLE_PROFILING defined; otherwise the macros expand
+// to nothing and the zones cost nothing. [name] has to be a string literal (or otherwise live forever)
+#ifdef VULKANENGINE_ENABLE_PROFILING
+#define VULKANENGINE_PROFILE_CONCAT_INNER(a, b) a##b
+#define VULKANENGINE_PROFILE_CONCAT(a, b) VULKANENGINE_PROFILE_CONCAT_INNER(a, b)
+#define VULKANENGINE_PROFILE_SCOPE(name) \
+	::vulkanengine::VulkanEngineCpuProfiler::Zone VULKANENGINE_PROFILE_CONCAT(profile_zone_, __LINE__){ name }
+#define VULKANENGINE_PROFILE_FUNCTION() VULKANENGINE_PROFILE_SCOPE(__FUNCTION__)
+#define VULKANENGINE_PROFILE_THREAD(name) ::vulkanengine::VulkanEngineCpuProfiler::SetThreadName(name)
+#else
+#define VULKANENGINE_PROFILE_SCOPE(name) ((void)0)
+#define VULKANENGINE_PROFILE_FUNCTION() ((void)0)
+#define VULKANENGINE_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace vulkanengine
+{
+	// Every thread that records a zone gets its own ring of the last kEventsPerThread zones, so recording
+	// never contends with other threads; the rings are only locked (uncontended) per event and by the export.
+	// Nanosecond timestamps from steady_clock, relative to the first use of the profiler
+	class VulkanEngineCpuProfiler
+	{
+	public:
+		static constexpr size_t kEventsPerThread = 1 << 16;
+
+		class Zone
+		{
+		public:
+			explicit Zone(const char* name) : name_{ name }, begin_{ Now() } {}
+			~Zone() { Record(name_, begin_, Now()); }
+
+			Zone(const Zone&) = delete;
+			Zone& operator=(const Zone&) = delete;
+
+		private:
+			const char* name_;
+			uint64_t begin_;
+		};
+
+		static constexpr bool IsEnabled()
+		{
+#ifdef VULKANENGINE_ENABLE_PROFILING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static uint64_t Now();
+		static void Record(const char* name, uint64_t begin_nanoseconds, uint64_t end_nanoseconds);
+		// Shown as the thread's name in the trace viewer
+		static void SetThreadName(const std::string& name);
+
+		// Writes the zones still in the rings as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+		// Returns false if the file could not be written
+		static bool WriteChromeTrace(const std::string& filepath);
+		// Drops everything recorded so far, e.g. to keep a trace to the frames around a spike
+		static void Clear();
+	};
+}  // namespace vulkanengine
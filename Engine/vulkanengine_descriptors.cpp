@@ -1,11 +1,24 @@
 #include "vulkanengine_descriptors.hpp"
+#include "vulkanengine_utils.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 
 namespace vulkanengine
 {
+    size_t DescriptorSignatureHash::operator()(const DescriptorSignature& signature) const
+    {
+        size_t seed = signature.size();
+        for (uint64_t word : signature)
+        {
+            HashCombine(seed, word);
+        }
+        return seed;
+    }
+
     // *************** Descriptor Set Layout Builder *********************
 
     VulkanEngineDescriptorSetLayout::Builder& VulkanEngineDescriptorSetLayout::Builder::AddBinding(
@@ -24,28 +37,69 @@ namespace vulkanengine
         return *this;
     }
 
+    // Per-binding VkDescriptorBindingFlags (descriptor indexing), e.g. PARTIALLY_BOUND | UPDATE_AFTER_BIND
+    VulkanEngineDescriptorSetLayout::Builder& VulkanEngineDescriptorSetLayout::Builder::SetBindingFlags(
+        uint32_t binding, VkDescriptorBindingFlags flags)
+    {
+        assert(bindings_.count(binding) == 1 && "Binding flags set for a binding that was never added");
+        binding_flags_[binding] = flags;
+        return *this;
+    }
+
+    VulkanEngineDescriptorSetLayout::Builder& VulkanEngineDescriptorSetLayout::Builder::SetLayoutFlags(
+        VkDescriptorSetLayoutCreateFlags flags)
+    {
+        layout_flags_ = flags;
+        return *this;
+    }
+
     std::unique_ptr<VulkanEngineDescriptorSetLayout> VulkanEngineDescriptorSetLayout::Builder::Build() const
     {
-        return std::make_unique<VulkanEngineDescriptorSetLayout>(vulkanengine_device_, bindings_);
+        return std::make_unique<VulkanEngineDescriptorSetLayout>(vulkanengine_device_, bindings_, layout_flags_, binding_flags_);
+    }
+
+    std::shared_ptr<VulkanEngineDescriptorSetLayout> VulkanEngineDescriptorSetLayout::Builder::Build(
+        VulkanEngineDescriptorLayoutCache& cache) const
+    {
+        assert(layout_flags_ == 0 && binding_flags_.empty() && "Layouts with create or binding flags are not cached");
+        return cache.GetOrCreate(bindings_);
     }
 
     // *************** Descriptor Set Layout *********************
 
     VulkanEngineDescriptorSetLayout::VulkanEngineDescriptorSetLayout(
-        VulkanEngineDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+        VulkanEngineDevice& device,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        VkDescriptorSetLayoutCreateFlags layout_flags,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& binding_flags)
         : vulkanengine_device_{ device }, descriptor_set_layout_{}, bindings_{ bindings }
     {
         std::vector<VkDescriptorSetLayoutBinding> set_layout_bindings{};
+        std::vector<VkDescriptorBindingFlags> set_layout_binding_flags{};
         for (auto& kv : bindings)
         {
             set_layout_bindings.push_back(kv.second);
+
+            auto flags = binding_flags.find(kv.first);
+            set_layout_binding_flags.push_back(flags != binding_flags.end() ? flags->second : 0);
         }
 
         VkDescriptorSetLayoutCreateInfo descriptor_set_layout_info{};
         descriptor_set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptor_set_layout_info.flags = layout_flags;
         descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(set_layout_bindings.size());
         descriptor_set_layout_info.pBindings = set_layout_bindings.data();
 
+        // pBindingFlags is parallel to pBindings
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info{};
+        if (!binding_flags.empty())
+        {
+            binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+            binding_flags_info.bindingCount = static_cast<uint32_t>(set_layout_binding_flags.size());
+            binding_flags_info.pBindingFlags = set_layout_binding_flags.data();
+            descriptor_set_layout_info.pNext = &binding_flags_info;
+        }
+
         if (vkCreateDescriptorSetLayout(
             vulkanengine_device_.Device(),
             &descriptor_set_layout_info,
@@ -61,6 +115,51 @@ namespace vulkanengine
         vkDestroyDescriptorSetLayout(vulkanengine_device_.Device(), descriptor_set_layout_, nullptr);
     }
 
+    // *************** Descriptor Set Layout Cache *********************
+
+    std::shared_ptr<VulkanEngineDescriptorSetLayout> VulkanEngineDescriptorLayoutCache::GetOrCreate(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings)
+    {
+        // unordered_map iteration order is unspecified, so sort by binding index before flattening
+        std::vector<VkDescriptorSetLayoutBinding> sorted_bindings{};
+        for (auto& kv : bindings)
+        {
+            sorted_bindings.push_back(kv.second);
+        }
+        std::sort(sorted_bindings.begin(), sorted_bindings.end(),
+            [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+        DescriptorSignature signature{};
+        signature.reserve(sorted_bindings.size() * 4);
+        for (auto& binding : sorted_bindings)
+        {
+            signature.push_back(binding.binding);
+            signature.push_back(binding.descriptorType);
+            signature.push_back(binding.descriptorCount);
+            signature.push_back(binding.stageFlags);
+            // immutable samplers are baked into the layout, so the same binding with other samplers is another layout
+            signature.push_back(binding.pImmutableSamplers != nullptr);
+            if (binding.pImmutableSamplers != nullptr)
+            {
+                for (uint32_t i = 0; i < binding.descriptorCount; ++i)
+                {
+                    signature.push_back(reinterpret_cast<uint64_t>(binding.pImmutableSamplers[i]));
+                }
+            }
+        }
+
+        auto it = layouts_.find(signature);
+        if (it != layouts_.end())
+        {
+            hit_count_++;
+            return it->second;
+        }
+
+        auto layout = std::make_shared<VulkanEngineDescriptorSetLayout>(vulkanengine_device_, bindings);
+        layouts_.emplace(std::move(signature), layout);
+        return layout;
+    }
+
     // *************** Descriptor Pool Builder *********************
 
     // Adds [count]x descriptors of descriptor_type in the pool to be used later
@@ -126,8 +225,8 @@ namespace vulkanengine
         alloc_info.pSetLayouts = &descriptor_set_layout;
         alloc_info.descriptorSetCount = 1;
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
+        // Fixed-size pool, so running out is a failure here. VulkanEngineDescriptorAllocator chains
+        // pools for callers that cannot size their pool up front
         if (vkAllocateDescriptorSets(vulkanengine_device_.Device(), &alloc_info, &descriptor) != VK_SUCCESS)
         {
             return false;
@@ -149,10 +248,163 @@ namespace vulkanengine
         vkResetDescriptorPool(vulkanengine_device_.Device(), descriptor_pool_, 0);
     }
 
+    // *************** Descriptor Allocator Builder *********************
+
+    // Each pool created by the allocator holds [descriptors_per_set * sets_per_pool] descriptors of this type
+    VulkanEngineDescriptorAllocator::Builder& VulkanEngineDescriptorAllocator::Builder::AddPoolSizeRatio(
+        VkDescriptorType descriptor_type, float descriptors_per_set)
+    {
+        pool_size_ratios_.push_back({ descriptor_type, descriptors_per_set });
+        return *this;
+    }
+
+    VulkanEngineDescriptorAllocator::Builder& VulkanEngineDescriptorAllocator::Builder::SetInitialSetsPerPool(uint32_t count)
+    {
+        initial_sets_per_pool_ = count;
+        return *this;
+    }
+
+    // One independent pool chain per frame in flight
+    VulkanEngineDescriptorAllocator::Builder& VulkanEngineDescriptorAllocator::Builder::SetFrameCount(uint32_t count)
+    {
+        frame_count_ = count;
+        return *this;
+    }
+
+    std::unique_ptr<VulkanEngineDescriptorAllocator> VulkanEngineDescriptorAllocator::Builder::Build() const
+    {
+        return std::make_unique<VulkanEngineDescriptorAllocator>(
+            vulkanengine_device_, frame_count_, initial_sets_per_pool_, pool_size_ratios_);
+    }
+
+    // *************** Descriptor Allocator *********************
+
+    VulkanEngineDescriptorAllocator::VulkanEngineDescriptorAllocator(
+        VulkanEngineDevice& device,
+        uint32_t frame_count,
+        uint32_t initial_sets_per_pool,
+        const std::vector<std::pair<VkDescriptorType, float>>& pool_size_ratios)
+        : vulkanengine_device_{ device }, pool_size_ratios_{ pool_size_ratios }, frames_(frame_count)
+    {
+        assert(frame_count > 0 && "Descriptor allocator needs at least one frame");
+        assert(!pool_size_ratios.empty() && "Descriptor allocator needs at least one pool size ratio");
+
+        for (auto& frame : frames_)
+        {
+            frame.sets_per_pool = std::min(std::max(initial_sets_per_pool, 1u), kMaxSetsPerPool);
+            frame.ready_pools.push_back(CreatePool(frame.sets_per_pool));
+        }
+    }
+
+    VulkanEngineDescriptorAllocator::~VulkanEngineDescriptorAllocator() {}
+
+    // Must only be called once the fence for frame_index has been waited on, since every set handed out
+    // for that frame becomes invalid
+    void VulkanEngineDescriptorAllocator::BeginFrame(int frame_index)
+    {
+        assert(frame_index >= 0 && static_cast<size_t>(frame_index) < frames_.size() && "Frame index out of range");
+        current_frame_ = frame_index;
+
+        FramePools& frame = frames_[current_frame_];
+        for (auto& pool : frame.ready_pools)
+        {
+            pool->ResetPool();
+        }
+        for (auto& pool : frame.full_pools)
+        {
+            pool->ResetPool();
+            frame.ready_pools.push_back(std::move(pool));
+        }
+        frame.full_pools.clear();
+        frame.set_cache.clear();
+    }
+
+    bool VulkanEngineDescriptorAllocator::AllocateDescriptorSet(
+        const VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet& descriptor)
+    {
+        FramePools& frame = frames_[current_frame_];
+
+        if (GetReadyPool(frame).AllocateDescriptorSet(descriptor_set_layout, descriptor))
+        {
+            return true;
+        }
+
+        // Pool is out of sets or descriptors (or too fragmented), retire it and retry once on a new pool:
+        // the next ready one may be a recycled pool just as full
+        frame.full_pools.push_back(std::move(frame.ready_pools.back()));
+        frame.ready_pools.pop_back();
+
+        return GrowPool(frame).AllocateDescriptorSet(descriptor_set_layout, descriptor);
+    }
+
+    bool VulkanEngineDescriptorAllocator::FindCachedSet(const DescriptorSignature& signature, VkDescriptorSet& descriptor)
+    {
+        auto& set_cache = frames_[current_frame_].set_cache;
+        auto it = set_cache.find(signature);
+        if (it == set_cache.end())
+        {
+            return false;
+        }
+        cache_hit_count_++;
+        descriptor = it->second;
+        return true;
+    }
+
+    void VulkanEngineDescriptorAllocator::CacheSet(const DescriptorSignature& signature, VkDescriptorSet descriptor)
+    {
+        frames_[current_frame_].set_cache[signature] = descriptor;
+    }
+
+    size_t VulkanEngineDescriptorAllocator::GetPoolCount() const
+    {
+        size_t count = 0;
+        for (auto& frame : frames_)
+        {
+            count += frame.ready_pools.size() + frame.full_pools.size();
+        }
+        return count;
+    }
+
+    std::unique_ptr<VulkanEngineDescriptorPool> VulkanEngineDescriptorAllocator::CreatePool(uint32_t max_sets) const
+    {
+        VulkanEngineDescriptorPool::Builder builder{ vulkanengine_device_ };
+        builder.SetMaxSets(max_sets);
+        for (auto& ratio : pool_size_ratios_)
+        {
+            uint32_t count = static_cast<uint32_t>(std::ceil(ratio.second * max_sets));
+            builder.AddPoolSize(ratio.first, std::max(count, 1u));
+        }
+        return builder.Build();
+    }
+
+    // Returns the pool to allocate from, growing the chain with a larger pool when nothing is left
+    VulkanEngineDescriptorPool& VulkanEngineDescriptorAllocator::GetReadyPool(FramePools& frame)
+    {
+        if (frame.ready_pools.empty())
+        {
+            return GrowPool(frame);
+        }
+        return *frame.ready_pools.back();
+    }
+
+    // Creates a larger pool and makes it the one allocated from; older ready pools are used once it fills up
+    VulkanEngineDescriptorPool& VulkanEngineDescriptorAllocator::GrowPool(FramePools& frame)
+    {
+        frame.sets_per_pool = std::min(frame.sets_per_pool * 2, kMaxSetsPerPool);
+        frame.ready_pools.push_back(CreatePool(frame.sets_per_pool));
+        return *frame.ready_pools.back();
+    }
+
     // *************** Descriptor Writer *********************
 
     VulkanEngineDescriptorWriter::VulkanEngineDescriptorWriter(VulkanEngineDescriptorSetLayout& set_layout, VulkanEngineDescriptorPool& pool)
-        : set_layout_{ set_layout }, pool_{ pool }
+        : set_layout_{ set_layout }, pool_{ &pool }
+    {}
+
+    // Sets built through the allocator are deduplicated: identical writes against the same layout
+    // within a frame return the set that was already built
+    VulkanEngineDescriptorWriter::VulkanEngineDescriptorWriter(VulkanEngineDescriptorSetLayout& set_layout, VulkanEngineDescriptorAllocator& allocator)
+        : set_layout_{ set_layout }, allocator_{ &allocator }
     {}
 
     VulkanEngineDescriptorWriter& VulkanEngineDescriptorWriter::WriteBuffer(
@@ -201,12 +453,28 @@ namespace vulkanengine
 
     bool VulkanEngineDescriptorWriter::Build(VkDescriptorSet& set)
     {
-        bool success = pool_.AllocateDescriptorSet(set_layout_.GetDescriptorSetLayout(), set);
-        if (!success)
+        if (pool_ != nullptr)
+        {
+            bool success = pool_->AllocateDescriptorSet(set_layout_.GetDescriptorSetLayout(), set);
+            if (!success)
+            {
+                return false;
+            }
+            Overwrite(set);
+            return true;
+        }
+
+        DescriptorSignature signature = BuildSignature();
+        if (allocator_->FindCachedSet(signature, set))
+        {
+            return true;
+        }
+        if (!allocator_->AllocateDescriptorSet(set_layout_.GetDescriptorSetLayout(), set))
         {
             return false;
         }
         Overwrite(set);
+        allocator_->CacheSet(signature, set);
         return true;
     }
 
@@ -216,6 +484,36 @@ namespace vulkanengine
         {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(pool_.vulkanengine_device_.Device(), writes_.size(), writes_.data(), 0, nullptr);
+        vkUpdateDescriptorSets(
+            set_layout_.vulkanengine_device_.Device(),
+            static_cast<uint32_t>(writes_.size()),
+            writes_.data(),
+            0,
+            nullptr);
+    }
+
+    // Layout handle followed by every write's target and the resources it points at
+    DescriptorSignature VulkanEngineDescriptorWriter::BuildSignature() const
+    {
+        DescriptorSignature signature{};
+        signature.push_back(reinterpret_cast<uint64_t>(set_layout_.GetDescriptorSetLayout()));
+        for (auto& write : writes_)
+        {
+            signature.push_back(write.dstBinding);
+            signature.push_back(write.descriptorType);
+            if (write.pBufferInfo != nullptr)
+            {
+                signature.push_back(reinterpret_cast<uint64_t>(write.pBufferInfo->buffer));
+                signature.push_back(write.pBufferInfo->offset);
+                signature.push_back(write.pBufferInfo->range);
+            }
+            if (write.pImageInfo != nullptr)
+            {
+                signature.push_back(reinterpret_cast<uint64_t>(write.pImageInfo->sampler));
+                signature.push_back(reinterpret_cast<uint64_t>(write.pImageInfo->imageView));
+                signature.push_back(write.pImageInfo->imageLayout);
+            }
+        }
+        return signature;
     }
 } // namespace vulkanengine
\ No newline at end of file
@@ -9,6 +9,16 @@
 
 namespace vulkanengine
 {
+    class VulkanEngineDescriptorLayoutCache;
+
+    // Flattened description of a layout or a set of writes, used as a key by the descriptor caches
+    using DescriptorSignature = std::vector<uint64_t>;
+
+    struct DescriptorSignatureHash
+    {
+        size_t operator()(const DescriptorSignature& signature) const;
+    };
+
     class VulkanEngineDescriptorSetLayout
     {
     public:
@@ -22,14 +32,23 @@ namespace vulkanengine
                 VkDescriptorType descriptor_type,
                 VkShaderStageFlags stage_flags,
                 uint32_t count = 1);
+            Builder& SetBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
+            Builder& SetLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<VulkanEngineDescriptorSetLayout> Build() const;
+            std::shared_ptr<VulkanEngineDescriptorSetLayout> Build(VulkanEngineDescriptorLayoutCache& cache) const;
 
         private:
             VulkanEngineDevice& vulkanengine_device_;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings_{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> binding_flags_{};
+            VkDescriptorSetLayoutCreateFlags layout_flags_ = 0;
         };
 
-        VulkanEngineDescriptorSetLayout(VulkanEngineDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+        VulkanEngineDescriptorSetLayout(
+            VulkanEngineDevice& device,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            VkDescriptorSetLayoutCreateFlags layout_flags = 0,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& binding_flags = {});
         ~VulkanEngineDescriptorSetLayout();
         VulkanEngineDescriptorSetLayout(const VulkanEngineDescriptorSetLayout&) = delete;
         VulkanEngineDescriptorSetLayout& operator=(const VulkanEngineDescriptorSetLayout&) = delete;
@@ -44,6 +63,28 @@ namespace vulkanengine
         friend class VulkanEngineDescriptorWriter;
     };
 
+    // Hands out a shared layout for every distinct binding signature, so systems asking for the
+    // same bindings end up with the same VkDescriptorSetLayout
+    class VulkanEngineDescriptorLayoutCache
+    {
+    public:
+        VulkanEngineDescriptorLayoutCache(VulkanEngineDevice& device) : vulkanengine_device_{ device } {}
+
+        VulkanEngineDescriptorLayoutCache(const VulkanEngineDescriptorLayoutCache&) = delete;
+        VulkanEngineDescriptorLayoutCache& operator=(const VulkanEngineDescriptorLayoutCache&) = delete;
+
+        std::shared_ptr<VulkanEngineDescriptorSetLayout> GetOrCreate(
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings);
+
+        size_t GetLayoutCount() const { return layouts_.size(); }
+        uint32_t GetHitCount() const { return hit_count_; }
+
+    private:
+        VulkanEngineDevice& vulkanengine_device_;
+        std::unordered_map<DescriptorSignature, std::shared_ptr<VulkanEngineDescriptorSetLayout>, DescriptorSignatureHash> layouts_;
+        uint32_t hit_count_ = 0;
+    };
+
 
     class VulkanEngineDescriptorPool
     {
@@ -87,10 +128,75 @@ namespace vulkanengine
         friend class VulkanEngineDescriptorWriter;
     };
 
+    // Growable allocator: keeps a chain of pools per frame and adds a new, larger pool whenever the current
+    // one runs out. BeginFrame resets every pool of that frame wholesale, and identical writes within a
+    // frame are served from a per-frame set cache instead of allocating again.
+    // Use a frame count of 1 and never call BeginFrame for long-lived sets.
+    class VulkanEngineDescriptorAllocator
+    {
+    public:
+        class Builder
+        {
+        public:
+            Builder(VulkanEngineDevice& device) : vulkanengine_device_{ device } {}
+
+            Builder& AddPoolSizeRatio(VkDescriptorType descriptor_type, float descriptors_per_set);
+            Builder& SetInitialSetsPerPool(uint32_t count);
+            Builder& SetFrameCount(uint32_t count);
+            std::unique_ptr<VulkanEngineDescriptorAllocator> Build() const;
+
+        private:
+            VulkanEngineDevice& vulkanengine_device_;
+            std::vector<std::pair<VkDescriptorType, float>> pool_size_ratios_{};
+            uint32_t initial_sets_per_pool_ = 64;
+            uint32_t frame_count_ = 1;
+        };
+
+        static constexpr uint32_t kMaxSetsPerPool = 4096;
+
+        VulkanEngineDescriptorAllocator(
+            VulkanEngineDevice& device,
+            uint32_t frame_count,
+            uint32_t initial_sets_per_pool,
+            const std::vector<std::pair<VkDescriptorType, float>>& pool_size_ratios);
+        ~VulkanEngineDescriptorAllocator();
+        VulkanEngineDescriptorAllocator(const VulkanEngineDescriptorAllocator&) = delete;
+        VulkanEngineDescriptorAllocator& operator=(const VulkanEngineDescriptorAllocator&) = delete;
+
+        void BeginFrame(int frame_index);
+        bool AllocateDescriptorSet(const VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet& descriptor);
+
+        bool FindCachedSet(const DescriptorSignature& signature, VkDescriptorSet& descriptor);
+        void CacheSet(const DescriptorSignature& signature, VkDescriptorSet descriptor);
+
+        size_t GetPoolCount() const;
+        uint32_t GetCacheHitCount() const { return cache_hit_count_; }
+
+    private:
+        struct FramePools
+        {
+            std::vector<std::unique_ptr<VulkanEngineDescriptorPool>> ready_pools;
+            std::vector<std::unique_ptr<VulkanEngineDescriptorPool>> full_pools;
+            std::unordered_map<DescriptorSignature, VkDescriptorSet, DescriptorSignatureHash> set_cache;
+            uint32_t sets_per_pool;
+        };
+
+        std::unique_ptr<VulkanEngineDescriptorPool> CreatePool(uint32_t max_sets) const;
+        VulkanEngineDescriptorPool& GetReadyPool(FramePools& frame);
+        VulkanEngineDescriptorPool& GrowPool(FramePools& frame);
+
+        VulkanEngineDevice& vulkanengine_device_;
+        std::vector<std::pair<VkDescriptorType, float>> pool_size_ratios_;
+        std::vector<FramePools> frames_;
+        int current_frame_ = 0;
+        uint32_t cache_hit_count_ = 0;
+    };
+
     class VulkanEngineDescriptorWriter
     {
     public:
         VulkanEngineDescriptorWriter(VulkanEngineDescriptorSetLayout& set_layout, VulkanEngineDescriptorPool& pool);
+        VulkanEngineDescriptorWriter(VulkanEngineDescriptorSetLayout& set_layout, VulkanEngineDescriptorAllocator& allocator);
 
         VulkanEngineDescriptorWriter& WriteBuffer(uint32_t binding, VkDescriptorBufferInfo* buffer_info);
         VulkanEngineDescriptorWriter& WriteImage(uint32_t binding, VkDescriptorImageInfo* image_info);
@@ -99,8 +205,11 @@ namespace vulkanengine
         void Overwrite(VkDescriptorSet& set);
 
     private:
+        DescriptorSignature BuildSignature() const;
+
         VulkanEngineDescriptorSetLayout& set_layout_;
-        VulkanEngineDescriptorPool& pool_;
+        VulkanEngineDescriptorPool* pool_ = nullptr;
+        VulkanEngineDescriptorAllocator* allocator_ = nullptr;
         std::vector<VkWriteDescriptorSet> writes_;
     };
 } // namespace vulkanengine
\ No newline at end of file
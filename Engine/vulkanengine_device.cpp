@@ -3,7 +3,10 @@
 #include "vulkan/vulkan.h"
 
 // std headers
+#include <cassert>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -66,10 +69,13 @@ namespace vulkanengine
 		PickPhysicalDevice();
 		CreateLogicalDevice();
 		CreateCommandPool();
+		CreatePipelineCache();
 	}
 
 	VulkanEngineDevice::~VulkanEngineDevice()
 	{
+		SavePipelineCache();
+		vkDestroyPipelineCache(device_, pipeline_cache_, nullptr);
 		vkDestroyCommandPool(device_, command_pool_, nullptr);
 		vkDestroyDevice(device_, nullptr);
 
@@ -78,7 +84,10 @@ namespace vulkanengine
 			DestroyDebugUtilsMessengerEXT(instance_, debug_messenger_, nullptr);
 		}
 
-		vkDestroySurfaceKHR(instance_, surface_, nullptr);
+		if (surface_ != VK_NULL_HANDLE)
+		{
+			vkDestroySurfaceKHR(instance_, surface_, nullptr);
+		}
 		vkDestroyInstance(instance_, nullptr);
 	}
 
@@ -95,7 +104,7 @@ namespace vulkanengine
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = QueryInstanceApiVersion();
 
 		VkInstanceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -156,6 +165,154 @@ namespace vulkanengine
 
 		vkGetPhysicalDeviceProperties(physical_device_, &properties_);
 		std::cout << "physical device: " << properties_.deviceName << std::endl;
+
+		vkGetPhysicalDeviceFeatures(physical_device_, &supported_features_);
+		QueryDescriptorIndexingSupport();
+		QueryDynamicRenderingSupport();
+		QueryDirectUploadSupport();
+
+		uint32_t queue_family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &queue_family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &queue_family_count, queue_families.data());
+		timestamp_valid_bits_ = queue_families[FindQueueFamilies(physical_device_).graphicsFamily].timestampValidBits;
+	}
+
+	// vkGetPhysicalDeviceFeatures2 / Properties2 need Vulkan 1.1, on the instance and on the device. A 1.0
+	// loader has no vkEnumerateInstanceVersion and rejects any other apiVersion, so ask for 1.0 then
+	uint32_t VulkanEngineDevice::QueryInstanceApiVersion()
+	{
+		instance_api_version_ = VK_API_VERSION_1_0;
+		auto enumerate_instance_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+			vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+		uint32_t loader_version = VK_API_VERSION_1_0;
+		if (enumerate_instance_version != nullptr && enumerate_instance_version(&loader_version) == VK_SUCCESS &&
+			loader_version >= VK_API_VERSION_1_1)
+		{
+			instance_api_version_ = VK_API_VERSION_1_1;
+		}
+		return instance_api_version_;
+	}
+
+	bool VulkanEngineDevice::SupportsFeatures2() const
+	{
+		return instance_api_version_ >= VK_API_VERSION_1_1 && properties_.apiVersion >= VK_API_VERSION_1_1;
+	}
+
+	// Without resizable BAR, discrete GPUs still expose a 256 MB host visible window of VRAM; the driver
+	// and other allocations compete for it, so it is not worth using for geometry
+	void VulkanEngineDevice::QueryDirectUploadSupport()
+	{
+		constexpr VkDeviceSize kLegacyBarSize = 256ull << 20;
+		constexpr VkMemoryPropertyFlags kDirectFlags =
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		VkPhysicalDeviceMemoryProperties memory_properties;
+		vkGetPhysicalDeviceMemoryProperties(physical_device_, &memory_properties);
+
+		bool integrated = properties_.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+		for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+		{
+			const VkMemoryType& type = memory_properties.memoryTypes[i];
+			if ((type.propertyFlags & kDirectFlags) == kDirectFlags &&
+				(integrated || memory_properties.memoryHeaps[type.heapIndex].size > kLegacyBarSize))
+			{
+				direct_upload_supported_ = true;
+				break;
+			}
+		}
+
+		std::cout << "geometry upload: " << (direct_upload_supported_ ? "direct (host visible device memory)" : "staged") << std::endl;
+	}
+
+	// Descriptor indexing is optional: when any of the features bindless relies on is missing we
+	// simply keep running with classic per-set descriptors
+	void VulkanEngineDevice::QueryDescriptorIndexingSupport()
+	{
+		if (!SupportsFeatures2() || !IsDeviceExtensionAvailable(physical_device_, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+		{
+			std::cout << "descriptor indexing: unavailable" << std::endl;
+			return;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supported;
+		vkGetPhysicalDeviceFeatures2(physical_device_, &features2);
+
+		descriptor_indexing_supported_ =
+			supported.runtimeDescriptorArray &&
+			supported.descriptorBindingPartiallyBound &&
+			supported.descriptorBindingUpdateUnusedWhilePending &&
+			supported.descriptorBindingStorageBufferUpdateAfterBind &&
+			supported.descriptorBindingSampledImageUpdateAfterBind &&
+			supported.shaderStorageBufferArrayNonUniformIndexing &&
+			supported.shaderSampledImageArrayNonUniformIndexing;
+
+		if (descriptor_indexing_supported_)
+		{
+			// only enable what we use
+			descriptor_indexing_features_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+			descriptor_indexing_features_.runtimeDescriptorArray = VK_TRUE;
+			descriptor_indexing_features_.descriptorBindingPartiallyBound = VK_TRUE;
+			descriptor_indexing_features_.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			descriptor_indexing_features_.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+			descriptor_indexing_features_.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			descriptor_indexing_features_.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+			descriptor_indexing_features_.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+			descriptor_indexing_properties_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &descriptor_indexing_properties_;
+			vkGetPhysicalDeviceProperties2(physical_device_, &properties2);
+		}
+
+		std::cout << "descriptor indexing: " << (descriptor_indexing_supported_ ? "enabled" : "missing features") << std::endl;
+	}
+
+	// Dynamic rendering is optional too: without it the swap chain and the render graph keep creating
+	// render passes and framebuffers. Its dependencies are core in Vulkan 1.1 apart from these two
+	void VulkanEngineDevice::QueryDynamicRenderingSupport()
+	{
+		if (!SupportsFeatures2() ||
+			!IsDeviceExtensionAvailable(physical_device_, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) ||
+			!IsDeviceExtensionAvailable(physical_device_, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) ||
+			!IsDeviceExtensionAvailable(physical_device_, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME))
+		{
+			std::cout << "dynamic rendering: unavailable" << std::endl;
+			return;
+		}
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supported;
+		vkGetPhysicalDeviceFeatures2(physical_device_, &features2);
+
+		dynamic_rendering_supported_ = supported.dynamicRendering == VK_TRUE;
+		if (dynamic_rendering_supported_)
+		{
+			dynamic_rendering_features_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+			dynamic_rendering_features_.dynamicRendering = VK_TRUE;
+		}
+
+		std::cout << "dynamic rendering: " << (dynamic_rendering_supported_ ? "available" : "missing features") << std::endl;
+	}
+
+	void VulkanEngineDevice::CmdBeginRendering(VkCommandBuffer command_buffer, const VkRenderingInfoKHR& rendering_info)
+	{
+		assert(cmd_begin_rendering_ != nullptr && "dynamic rendering is not enabled on this device");
+		cmd_begin_rendering_(command_buffer, &rendering_info);
+	}
+
+	void VulkanEngineDevice::CmdEndRendering(VkCommandBuffer command_buffer)
+	{
+		assert(cmd_end_rendering_ != nullptr && "dynamic rendering is not enabled on this device");
+		cmd_end_rendering_(command_buffer);
 	}
 
 	void VulkanEngineDevice::CreateLogicalDevice()
@@ -178,6 +335,10 @@ namespace vulkanengine
 
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		// optional, meshlet draws fall back to one indirect call per command without it
+		deviceFeatures.multiDrawIndirect = supported_features_.multiDrawIndirect;
+		// optional, VulkanEngineGpuProfiler then only measures time
+		deviceFeatures.pipelineStatisticsQuery = supported_features_.pipelineStatisticsQuery;
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -185,9 +346,32 @@ namespace vulkanengine
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+		std::vector<const char*> enabledExtensions{};
+		if (!IsHeadless())
+		{
+			enabledExtensions = deviceExtensions;
+		}
+		// optional features are chained in front of each other
+		const void* features_chain = nullptr;
+		if (descriptor_indexing_supported_)
+		{
+			enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			descriptor_indexing_features_.pNext = const_cast<void*>(features_chain);
+			features_chain = &descriptor_indexing_features_;
+		}
+		if (dynamic_rendering_supported_)
+		{
+			enabledExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+			enabledExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+			enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			dynamic_rendering_features_.pNext = const_cast<void*>(features_chain);
+			features_chain = &dynamic_rendering_features_;
+		}
+		createInfo.pNext = features_chain;
+
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		// might not really be necessary anymore because device specific validation layers
 		// have been deprecated
@@ -208,6 +392,16 @@ namespace vulkanengine
 
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphics_queue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &present_queue_);
+
+		if (dynamic_rendering_supported_)
+		{
+			cmd_begin_rendering_ = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device_, "vkCmdBeginRenderingKHR"));
+			cmd_end_rendering_ = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device_, "vkCmdEndRenderingKHR"));
+			if (cmd_begin_rendering_ == nullptr || cmd_end_rendering_ == nullptr)
+			{
+				throw std::runtime_error("failed to load the dynamic rendering commands!");
+			}
+		}
 	}
 
 	void VulkanEngineDevice::CreateCommandPool()
@@ -226,7 +420,167 @@ namespace vulkanengine
 		}
 	}
 
-	void VulkanEngineDevice::CreateSurface() { window_.CreateWindowSurface(instance_, &surface_); }
+	// Header we prepend to the driver's cache blob on disk. The driver validates its own header too,
+	// but checking ours first lets us drop stale caches after a GPU or driver change without handing
+	// the driver data it might not reject cleanly
+	struct PipelineCacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendor_id;
+		uint32_t device_id;
+		uint32_t driver_version;
+		uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+		uint64_t data_size;
+		uint64_t data_hash;
+	};
+
+	static constexpr uint32_t kPipelineCacheMagic = 0x43505645; // "EVPC"
+	static constexpr uint32_t kPipelineCacheVersion = 1;
+
+	// FNV-1a, only used to catch truncated or corrupted cache files
+	static uint64_t HashPipelineCacheData(const char* data, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<uint8_t>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void VulkanEngineDevice::CreatePipelineCache()
+	{
+		std::vector<char> initial_data{};
+
+		std::ifstream file{ pipeline_cache_filepath_, std::ios::binary | std::ios::ate };
+		if (file.is_open())
+		{
+			size_t file_size = static_cast<size_t>(file.tellg());
+			file.seekg(0);
+
+			PipelineCacheFileHeader header{};
+			bool valid = file_size >= sizeof(header) && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+				header.magic == kPipelineCacheMagic &&
+				header.version == kPipelineCacheVersion &&
+				header.vendor_id == properties_.vendorID &&
+				header.device_id == properties_.deviceID &&
+				header.driver_version == properties_.driverVersion &&
+				memcmp(header.pipeline_cache_uuid, properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+				header.data_size == file_size - sizeof(header);
+
+			if (valid)
+			{
+				initial_data.resize(static_cast<size_t>(header.data_size));
+				valid = file.read(initial_data.data(), initial_data.size()) &&
+					HashPipelineCacheData(initial_data.data(), initial_data.size()) == header.data_hash;
+			}
+
+			// Cross-check the driver's own header (VkPipelineCacheHeaderVersionOne) against the device as well
+			if (valid)
+			{
+				VkPipelineCacheHeaderVersionOne vulkan_header{};
+				valid = initial_data.size() >= sizeof(vulkan_header);
+				if (valid)
+				{
+					memcpy(&vulkan_header, initial_data.data(), sizeof(vulkan_header));
+					valid = vulkan_header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+						vulkan_header.vendorID == properties_.vendorID &&
+						vulkan_header.deviceID == properties_.deviceID &&
+						memcmp(vulkan_header.pipelineCacheUUID, properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+				}
+			}
+
+			if (!valid)
+			{
+				std::cout << "pipeline cache: discarding stale or corrupt " << pipeline_cache_filepath_ << std::endl;
+				initial_data.clear();
+			}
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo = {};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = initial_data.size();
+		cacheInfo.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+
+		if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipeline_cache_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+
+		pipeline_cache_warm_ = !initial_data.empty();
+		std::cout << "pipeline cache: " << (pipeline_cache_warm_ ? "warm, " : "cold, ")
+			<< initial_data.size() << " bytes loaded" << std::endl;
+	}
+
+	// Writes to a temporary file and renames it over the old cache, so a crash mid-write never
+	// leaves a truncated cache behind
+	void VulkanEngineDevice::SavePipelineCache()
+	{
+		if (pipeline_creation_count_ > 0)
+		{
+			std::cout << "pipeline cache: " << pipeline_creation_count_ << " pipelines created in "
+				<< pipeline_creation_milliseconds_ << " ms (" << (pipeline_cache_warm_ ? "warm" : "cold") << " cache)" << std::endl;
+		}
+
+		size_t data_size = 0;
+		if (vkGetPipelineCacheData(device_, pipeline_cache_, &data_size, nullptr) != VK_SUCCESS || data_size == 0)
+		{
+			return;
+		}
+		std::vector<char> data(data_size);
+		if (vkGetPipelineCacheData(device_, pipeline_cache_, &data_size, data.data()) != VK_SUCCESS)
+		{
+			return;
+		}
+		data.resize(data_size);
+
+		PipelineCacheFileHeader header{};
+		header.magic = kPipelineCacheMagic;
+		header.version = kPipelineCacheVersion;
+		header.vendor_id = properties_.vendorID;
+		header.device_id = properties_.deviceID;
+		header.driver_version = properties_.driverVersion;
+		memcpy(header.pipeline_cache_uuid, properties_.pipelineCacheUUID, VK_UUID_SIZE);
+		header.data_size = data.size();
+		header.data_hash = HashPipelineCacheData(data.data(), data.size());
+
+		const std::string temp_filepath = pipeline_cache_filepath_ + ".tmp";
+		{
+			std::ofstream file{ temp_filepath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open() ||
+				!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+				!file.write(data.data(), data.size()))
+			{
+				std::cerr << "pipeline cache: failed to write " << temp_filepath << std::endl;
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temp_filepath, pipeline_cache_filepath_, error);
+		if (error)
+		{
+			std::cerr << "pipeline cache: failed to replace " << pipeline_cache_filepath_ << ": " << error.message() << std::endl;
+			std::filesystem::remove(temp_filepath, error);
+		}
+	}
+
+	void VulkanEngineDevice::RecordPipelineCreation(double milliseconds)
+	{
+		std::lock_guard<std::mutex> lock{ pipeline_stats_mutex_ };
+		pipeline_creation_count_++;
+		pipeline_creation_milliseconds_ += milliseconds;
+	}
+
+	void VulkanEngineDevice::CreateSurface()
+	{
+		if (!IsHeadless())
+		{
+			window_.CreateWindowSurface(instance_, &surface_);
+		}
+	}
 
 	bool VulkanEngineDevice::IsDeviceSuitable(VkPhysicalDevice device)
 	{
@@ -234,8 +588,8 @@ namespace vulkanengine
 
 		bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-		bool swapChainAdequate = false;
-		if (extensionsSupported)
+		bool swapChainAdequate = IsHeadless();
+		if (extensionsSupported && !IsHeadless())
 		{
 			SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -305,11 +659,14 @@ namespace vulkanengine
 
 	std::vector<const char*> VulkanEngineDevice::GetRequiredExtensions()
 	{
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		std::vector<const char*> extensions{};
+		if (!IsHeadless())
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (enable_validation_layers_)
 		{
@@ -348,6 +705,12 @@ namespace vulkanengine
 
 	bool VulkanEngineDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 	{
+		// deviceExtensions is only the swap chain, which headless rendering does without
+		if (IsHeadless())
+		{
+			return true;
+		}
+
 		uint32_t extensionCount;
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
@@ -368,6 +731,28 @@ namespace vulkanengine
 		return requiredExtensions.empty();
 	}
 
+	bool VulkanEngineDevice::IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extension_name)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(
+			device,
+			nullptr,
+			&extensionCount,
+			availableExtensions.data());
+
+		for (const auto& extension : availableExtensions)
+		{
+			if (strcmp(extension.extensionName, extension_name) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	QueueFamilyIndices VulkanEngineDevice::FindQueueFamilies(VkPhysicalDevice device)
 	{
 		QueueFamilyIndices indices;
@@ -386,8 +771,16 @@ namespace vulkanengine
 				indices.graphicsFamily = i;
 				indices.graphicsFamilyHasValue = true;
 			}
+			// headless, nothing is presented and the graphics queue stands in
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+			if (IsHeadless())
+			{
+				presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == static_cast<uint32_t>(i);
+			}
+			else
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+			}
 			if (queueFamily.queueCount > 0 && presentSupport)
 			{
 				indices.presentFamily = i;
@@ -438,15 +831,7 @@ namespace vulkanengine
 	{
 		for (VkFormat format : candidates)
 		{
-			VkFormatProperties props;
-			vkGetPhysicalDeviceFormatProperties(physical_device_, format, &props);
-
-			if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features)
-			{
-				return format;
-			}
-			else if (
-				tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features)
+			if (SupportsFormatFeatures(format, tiling, features))
 			{
 				return format;
 			}
@@ -454,6 +839,18 @@ namespace vulkanengine
 		throw std::runtime_error("failed to find supported format!");
 	}
 
+	bool VulkanEngineDevice::SupportsFormatFeatures(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features)
+	{
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physical_device_, format, &props);
+
+		if (tiling == VK_IMAGE_TILING_LINEAR)
+		{
+			return (props.linearTilingFeatures & features) == features;
+		}
+		return tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features;
+	}
+
 	uint32_t VulkanEngineDevice::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 	{
 		VkPhysicalDeviceMemoryProperties memProperties;
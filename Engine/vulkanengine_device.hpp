@@ -3,6 +3,7 @@
 #include "vulkanengine_window.hpp"
 
 // std lib headers
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -46,14 +47,20 @@ namespace vulkanengine
 		VkCommandPool GetCommandPool() { return command_pool_; }
 		VkDevice Device() { return device_; }
 		VkSurfaceKHR Surface() { return surface_; }
+		// Without a surface: no VK_KHR_swapchain, and the swap chain renders into images of its own
+		bool IsHeadless() const { return window_.IsHeadless(); }
 		VkQueue GraphicsQueue() { return graphics_queue_; }
 		VkQueue PresentQueue() { return present_queue_; }
+		VkPipelineCache PipelineCache() { return pipeline_cache_; }
+		bool IsPipelineCacheWarm() const { return pipeline_cache_warm_; }
+		void RecordPipelineCreation(double milliseconds);
 
 		SwapChainSupportDetails GetSwapChainSupport() { return QuerySwapChainSupport(physical_device_); }
 		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 		QueueFamilyIndices FindPhysicalQueueFamilies() { return FindQueueFamilies(physical_device_); }
 		VkFormat FindSupportedFormat(
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+		bool SupportsFormatFeatures(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
 
 		// Buffer Helper Functions
 		void CreateBuffer(
@@ -74,15 +81,36 @@ namespace vulkanengine
 			VkImage& image,
 			VkDeviceMemory& imageMemory);
 
+		// Bindless mode needs Vulkan 1.1 and VK_EXT_descriptor_indexing with update-after-bind and partially bound arrays
+		bool SupportsBindless() const { return descriptor_indexing_supported_; }
+		// drawCount > 1 in vkCmdDrawIndexedIndirect
+		bool SupportsMultiDrawIndirect() const { return supported_features_.multiDrawIndirect == VK_TRUE; }
+		// Device local memory the CPU can map without a size cap worth worrying about: integrated GPUs (UMA)
+		// and discrete ones with resizable BAR. Static buffers can then be written in place instead of staged
+		bool SupportsDirectUpload() const { return direct_upload_supported_; }
+		// Valid bits of graphics queue timestamps, 0 when the queue cannot write them
+		uint32_t GetTimestampValidBits() const { return timestamp_valid_bits_; }
+		bool SupportsPipelineStatistics() const { return supported_features_.pipelineStatisticsQuery == VK_TRUE; }
+		// VK_KHR_dynamic_rendering: render pass instances begun from image views, with no VkRenderPass or VkFramebuffer
+		bool SupportsDynamicRendering() const { return dynamic_rendering_supported_; }
+		// vkCmdBeginRenderingKHR/vkCmdEndRenderingKHR, only when SupportsDynamicRendering
+		void CmdBeginRendering(VkCommandBuffer command_buffer, const VkRenderingInfoKHR& rendering_info);
+		void CmdEndRendering(VkCommandBuffer command_buffer);
+
 		VkPhysicalDeviceProperties properties_;
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing_properties_{};
 
 	private:
 		void CreateInstance();
+		// The apiVersion to create the instance with, 1.1 when the loader has it
+		uint32_t QueryInstanceApiVersion();
 		void SetupDebugMessenger();
 		void CreateSurface();
 		void PickPhysicalDevice();
 		void CreateLogicalDevice();
 		void CreateCommandPool();
+		void CreatePipelineCache();
+		void SavePipelineCache();
 
 		// helper functions
 		bool IsDeviceSuitable(VkPhysicalDevice device);
@@ -93,6 +121,12 @@ namespace vulkanengine
 		void HasGlfwRequiredInstanceExtensions();
 		bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
 		SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
+		bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extension_name);
+		// The optional features below are queried through vkGetPhysicalDeviceFeatures2, and are off without it
+		bool SupportsFeatures2() const;
+		void QueryDescriptorIndexingSupport();
+		void QueryDynamicRenderingSupport();
+		void QueryDirectUploadSupport();
 
 		VkInstance instance_;
 		VkDebugUtilsMessengerEXT debug_messenger_;
@@ -101,10 +135,28 @@ namespace vulkanengine
 		VkCommandPool command_pool_;
 
 		VkDevice device_;
-		VkSurfaceKHR surface_;
+		VkSurfaceKHR surface_ = VK_NULL_HANDLE;
 		VkQueue graphics_queue_;
 		VkQueue present_queue_;
 
+		VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
+		bool pipeline_cache_warm_ = false;
+		std::mutex pipeline_stats_mutex_;	// pipelines may be compiled on worker threads
+		uint32_t pipeline_creation_count_ = 0;
+		double pipeline_creation_milliseconds_ = 0.0;
+
+		uint32_t instance_api_version_ = VK_API_VERSION_1_0;
+		VkPhysicalDeviceFeatures supported_features_{};
+		bool direct_upload_supported_ = false;
+		uint32_t timestamp_valid_bits_ = 0;
+		bool descriptor_indexing_supported_ = false;
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features_{};
+		bool dynamic_rendering_supported_ = false;
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features_{};
+		PFN_vkCmdBeginRenderingKHR cmd_begin_rendering_ = nullptr;
+		PFN_vkCmdEndRenderingKHR cmd_end_rendering_ = nullptr;
+
+		const std::string pipeline_cache_filepath_ = "pipeline_cache.bin";
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 	};
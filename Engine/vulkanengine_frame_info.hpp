@@ -1,15 +1,25 @@
 #pragma once
 
+#include "vulkanengine_asset_manager.hpp"
+#include "vulkanengine_bindless.hpp"
 #include "vulkanengine_camera.hpp"
+#include "vulkanengine_command_capture.hpp"
 #include "vulkanengine_game_object.hpp"
+#include "vulkanengine_gpu_profiler.hpp"
+#include "vulkanengine_metrics.hpp"
+#include "vulkanengine_ring_buffer.hpp"
+#include "Shaders/shader_shared.h"
 
 // lib
 #include <vulkan/vulkan.h>
 
+// std
+#include <cstddef>
+
 namespace vulkanengine
 {
-#define MAX_LIGHTS 10
-
+	// Mirrors of the blocks in Shaders/global_ubo.glsl. The asserts catch layout drift at compile time,
+	// the full per-member check against the compiled SPIR-V runs at startup (VulkanEngineShaderReflection::VerifyBlock)
 	struct PointLight
 	{
 		glm::vec4 position{};
@@ -27,6 +37,12 @@ namespace vulkanengine
 		int num_lights;
 	};
 
+	static_assert(sizeof(PointLight) == 32, "PointLight must match the std140 layout in global_ubo.glsl");
+	static_assert(offsetof(GlobalUbo, point_lights) % 16 == 0, "std140 arrays of structs start on a 16 byte boundary");
+	static_assert(
+		offsetof(GlobalUbo, num_lights) == offsetof(GlobalUbo, point_lights) + sizeof(PointLight) * MAX_LIGHTS,
+		"num_lights must directly follow the point light array");
+
 	struct FrameInfo
 	{
 		int frame_index;
@@ -34,6 +50,13 @@ namespace vulkanengine
 		VkCommandBuffer command_buffer;
 		VulkanEngineCamera& camera;
 		VkDescriptorSet global_descriptor_set;
+		uint32_t global_ubo_offset;		// dynamic offset of this frame's GlobalUbo in the ring buffer
 		VulkanEngineGameObject::Map& game_objects;
+		VulkanEngineRingBuffer& ring_buffer;
+		VulkanEngineBindlessSet* bindless_set;	// null when the device has no descriptor indexing support
+		VulkanEngineAssetManager* asset_manager;	// resolves VulkanEngineGameObject::model_handle_, may be null
+		VulkanEngineGpuProfiler* gpu_profiler;		// for VulkanEngineGpuProfiler::Scope, may be null
+		VulkanEngineMetrics* metrics;				// systems add their per frame counts, may be null
+		VulkanEngineCommandCapture* command_capture;	// systems record what they draw for replay, null unless capturing
 	};
 } // namespace vulkanengine
\ No newline at end of file
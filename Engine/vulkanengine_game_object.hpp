@@ -1,5 +1,6 @@
 #pragma once
 
+#include "vulkanengine_asset_manager.hpp"
 #include "vulkanengine_model.hpp"
 
 // libs
@@ -54,6 +55,7 @@ namespace vulkanengine
 		TransformComponent transform_{};
 
 		std::shared_ptr<VulkanEngineModel> model_{};
+		ModelHandle model_handle_ = kInvalidModelHandle;	// streamed model, takes precedence over model_ when set
 		std::unique_ptr<PointLightComponent> point_light_ = nullptr;
 
 	private:
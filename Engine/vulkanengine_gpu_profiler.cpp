@@ -0,0 +1,338 @@
+#include "vulkanengine_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	static constexpr VkQueryPipelineStatisticFlags kPipelineStatistics =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+	static constexpr uint32_t kPipelineStatisticCount = sizeof(GpuPipelineStatistics) / sizeof(uint64_t);
+
+	float VulkanEngineGpuProfiler::ScopeHistory::GetLatest() const
+	{
+		return count > 0 ? milliseconds[(next + kHistoryLength - 1) % kHistoryLength] : 0.f;
+	}
+
+	float VulkanEngineGpuProfiler::ScopeHistory::GetRecent(uint32_t age) const
+	{
+		return age < count ? milliseconds[(next + kHistoryLength - 1 - age) % kHistoryLength] : 0.f;
+	}
+
+	float VulkanEngineGpuProfiler::ScopeHistory::GetAverage() const
+	{
+		float sum = 0.f;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			sum += milliseconds[i];
+		}
+		return count > 0 ? sum / count : 0.f;
+	}
+
+	float VulkanEngineGpuProfiler::ScopeHistory::GetMax() const
+	{
+		return count > 0 ? *std::max_element(milliseconds.begin(), milliseconds.begin() + count) : 0.f;
+	}
+
+	VulkanEngineGpuProfiler::Scope::Scope(VulkanEngineGpuProfiler* profiler, VkCommandBuffer command_buffer, const char* name, bool statistics)
+		: profiler_{ profiler }, command_buffer_{ command_buffer }, scope_{ kNoScope }
+	{
+		if (profiler_)
+		{
+			scope_ = profiler_->BeginScope(command_buffer_, name, statistics);
+		}
+	}
+
+	VulkanEngineGpuProfiler::Scope::~Scope()
+	{
+		if (profiler_)
+		{
+			profiler_->EndScope(command_buffer_, scope_);
+		}
+	}
+
+	VulkanEngineGpuProfiler::VulkanEngineGpuProfiler(VulkanEngineDevice& device, uint32_t frame_count)
+		: vulkanengine_device_{ device }
+	{
+		uint32_t valid_bits = device.GetTimestampValidBits();
+		timestamps_supported_ = valid_bits > 0;
+		statistics_supported_ = timestamps_supported_ && device.SupportsPipelineStatistics();
+		std::cout << "gpu profiler: " << (timestamps_supported_ ? "timestamps" : "unavailable")
+			<< (statistics_supported_ ? ", pipeline statistics" : "") << std::endl;
+		if (!timestamps_supported_)
+		{
+			return;
+		}
+
+		nanoseconds_per_tick_ = device.properties_.limits.timestampPeriod;
+		timestamp_mask_ = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+		frames_.resize(frame_count);
+		for (auto& frame : frames_)
+		{
+			VkQueryPoolCreateInfo pool_info{};
+			pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			pool_info.queryCount = kMaxScopesPerFrame * 2;
+			if (vkCreateQueryPool(device.Device(), &pool_info, nullptr, &frame.timestamp_pool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create timestamp query pool!");
+			}
+
+			if (statistics_supported_)
+			{
+				pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+				pool_info.queryCount = kMaxScopesPerFrame;
+				pool_info.pipelineStatistics = kPipelineStatistics;
+				if (vkCreateQueryPool(device.Device(), &pool_info, nullptr, &frame.statistics_pool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create pipeline statistics query pool!");
+				}
+			}
+			frame.scopes.reserve(kMaxScopesPerFrame);
+		}
+	}
+
+	VulkanEngineGpuProfiler::~VulkanEngineGpuProfiler()
+	{
+		for (auto& frame : frames_)
+		{
+			vkDestroyQueryPool(vulkanengine_device_.Device(), frame.timestamp_pool, nullptr);
+			if (frame.statistics_pool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(vulkanengine_device_.Device(), frame.statistics_pool, nullptr);
+			}
+		}
+	}
+
+	void VulkanEngineGpuProfiler::BeginFrame(VkCommandBuffer command_buffer, int frame_index)
+	{
+		if (!timestamps_supported_)
+		{
+			return;
+		}
+		assert(current_frame_ == nullptr && "EndFrame was not called for the previous frame");
+		assert(frame_index >= 0 && static_cast<size_t>(frame_index) < frames_.size() && "Frame index out of range");
+
+		current_frame_ = &frames_[frame_index];
+		CollectResults(*current_frame_);
+		current_frame_->frame_number = frame_number_++;
+
+		vkCmdResetQueryPool(command_buffer, current_frame_->timestamp_pool, 0, kMaxScopesPerFrame * 2);
+		if (statistics_supported_)
+		{
+			vkCmdResetQueryPool(command_buffer, current_frame_->statistics_pool, 0, kMaxScopesPerFrame);
+		}
+
+		frame_scope_ = BeginScope(command_buffer, kFrameScopeName);
+	}
+
+	void VulkanEngineGpuProfiler::EndFrame(VkCommandBuffer command_buffer)
+	{
+		if (!timestamps_supported_)
+		{
+			return;
+		}
+		assert(open_statistics_scope_ == kNoScope && "A profiler scope is still open at the end of the frame");
+
+		EndScope(command_buffer, frame_scope_);
+		frame_scope_ = kNoScope;
+		current_frame_ = nullptr;
+	}
+
+	void VulkanEngineGpuProfiler::CollectPending()
+	{
+		assert(current_frame_ == nullptr && "CollectPending called while a frame is being recorded");
+
+		std::vector<FrameQueries*> pending{};
+		for (auto& frame : frames_)
+		{
+			if (!frame.scopes.empty())
+			{
+				pending.push_back(&frame);
+			}
+		}
+		std::sort(pending.begin(), pending.end(), [](const FrameQueries* a, const FrameQueries* b) {
+			return a->frame_number < b->frame_number;
+		});
+		for (FrameQueries* frame : pending)
+		{
+			CollectResults(*frame);
+		}
+	}
+
+	uint32_t VulkanEngineGpuProfiler::BeginScope(VkCommandBuffer command_buffer, const char* name, bool statistics)
+	{
+		if (current_frame_ == nullptr || current_frame_->scopes.size() >= kMaxScopesPerFrame)
+		{
+			return kNoScope;
+		}
+
+		uint32_t scope = static_cast<uint32_t>(current_frame_->scopes.size());
+		RecordedScope recorded{ name, scope * 2, kNoScope };
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current_frame_->timestamp_pool, recorded.timestamp_query);
+
+		// the frame scope spans everything, a statistics query there would keep the passes from having their own
+		if (statistics && statistics_supported_ && open_statistics_scope_ == kNoScope && frame_scope_ != kNoScope)
+		{
+			recorded.statistics_query = current_frame_->statistics_count++;
+			vkCmdBeginQuery(command_buffer, current_frame_->statistics_pool, recorded.statistics_query, 0);
+			open_statistics_scope_ = scope;
+		}
+
+		current_frame_->scopes.push_back(recorded);
+		return scope;
+	}
+
+	void VulkanEngineGpuProfiler::EndScope(VkCommandBuffer command_buffer, uint32_t scope)
+	{
+		if (current_frame_ == nullptr || scope == kNoScope)
+		{
+			return;
+		}
+
+		const RecordedScope& recorded = current_frame_->scopes[scope];
+		if (open_statistics_scope_ == scope)
+		{
+			vkCmdEndQuery(command_buffer, current_frame_->statistics_pool, recorded.statistics_query);
+			open_statistics_scope_ = kNoScope;
+		}
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current_frame_->timestamp_pool, recorded.timestamp_query + 1);
+	}
+
+	const VulkanEngineGpuProfiler::ScopeHistory* VulkanEngineGpuProfiler::FindHistory(const std::string& name) const
+	{
+		auto it = history_indices_.find(name);
+		return it != history_indices_.end() ? &histories_[it->second] : nullptr;
+	}
+
+	// Without VK_QUERY_RESULT_WAIT_BIT: anything not available (which should not happen after the fence) is skipped
+	void VulkanEngineGpuProfiler::CollectResults(FrameQueries& frame)
+	{
+		if (frame.scopes.empty())
+		{
+			return;
+		}
+
+		uint32_t timestamp_count = static_cast<uint32_t>(frame.scopes.size()) * 2;
+		std::vector<uint64_t> timestamps(timestamp_count * 2);	// value, availability
+		VkResult result = vkGetQueryPoolResults(
+			vulkanengine_device_.Device(),
+			frame.timestamp_pool,
+			0,
+			timestamp_count,
+			timestamps.size() * sizeof(uint64_t),
+			timestamps.data(),
+			2 * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		std::vector<uint64_t> statistics{};
+		if (frame.statistics_count > 0)
+		{
+			constexpr uint32_t kStride = kPipelineStatisticCount + 1;
+			statistics.resize(static_cast<size_t>(frame.statistics_count) * kStride);
+			vkGetQueryPoolResults(
+				vulkanengine_device_.Device(),
+				frame.statistics_pool,
+				0,
+				frame.statistics_count,
+				statistics.size() * sizeof(uint64_t),
+				statistics.data(),
+				kStride * sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		}
+
+		if (result == VK_SUCCESS || result == VK_NOT_READY)
+		{
+			// resolve names first, the history vector may grow
+			std::vector<size_t> indices(frame.scopes.size());
+			for (size_t i = 0; i < frame.scopes.size(); ++i)
+			{
+				indices[i] = GetHistoryIndex(frame.scopes[i].name);
+			}
+
+			std::vector<float> totals(histories_.size(), -1.f);
+			std::vector<GpuPipelineStatistics> statistics_totals(histories_.size());
+			std::vector<bool> has_statistics(histories_.size(), false);
+			for (size_t i = 0; i < frame.scopes.size(); ++i)
+			{
+				const uint64_t* begin = &timestamps[i * 4];
+				const uint64_t* end = &timestamps[i * 4 + 2];
+				if (begin[1] == 0 || end[1] == 0)
+				{
+					continue;
+				}
+
+				uint64_t ticks = (end[0] - begin[0]) & timestamp_mask_;
+				float milliseconds = static_cast<float>(ticks * nanoseconds_per_tick_ * 1e-6);
+				totals[indices[i]] = std::max(totals[indices[i]], 0.f) + milliseconds;
+
+				uint32_t statistics_query = frame.scopes[i].statistics_query;
+				if (statistics_query != kNoScope && !statistics.empty())
+				{
+					const uint64_t* counters = &statistics[static_cast<size_t>(statistics_query) * (kPipelineStatisticCount + 1)];
+					if (counters[kPipelineStatisticCount] != 0)
+					{
+						GpuPipelineStatistics& total = statistics_totals[indices[i]];
+						total.input_assembly_vertices += counters[0];
+						total.input_assembly_primitives += counters[1];
+						total.vertex_shader_invocations += counters[2];
+						total.clipping_invocations += counters[3];
+						total.clipping_primitives += counters[4];
+						total.fragment_shader_invocations += counters[5];
+						has_statistics[indices[i]] = true;
+					}
+				}
+			}
+
+			for (size_t i = 0; i < histories_.size(); ++i)
+			{
+				if (has_statistics[i])
+				{
+					histories_[i].statistics = statistics_totals[i];
+					histories_[i].has_statistics = true;
+				}
+			}
+
+			for (size_t i = 0; i < totals.size(); ++i)
+			{
+				if (totals[i] < 0.f)
+				{
+					continue;
+				}
+				ScopeHistory& history = histories_[i];
+				history.milliseconds[history.next] = totals[i];
+				history.next = (history.next + 1) % kHistoryLength;
+				history.count = std::min(history.count + 1, kHistoryLength);
+				++history.total_count;
+			}
+		}
+
+		frame.scopes.clear();
+		frame.statistics_count = 0;
+	}
+
+	size_t VulkanEngineGpuProfiler::GetHistoryIndex(const char* name)
+	{
+		auto it = history_indices_.find(name);
+		if (it != history_indices_.end())
+		{
+			return it->second;
+		}
+
+		ScopeHistory history{};
+		history.name = name;
+		history.milliseconds.resize(kHistoryLength, 0.f);
+		histories_.push_back(std::move(history));
+		history_indices_.emplace(name, histories_.size() - 1);
+		return histories_.size() - 1;
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "vulkanengine_device.hpp"
+
+// std
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Counters of one pipeline statistics query, in the order of their VkQueryPipelineStatisticFlagBits
+	struct GpuPipelineStatistics
+	{
+		uint64_t input_assembly_vertices = 0;
+		uint64_t input_assembly_primitives = 0;
+		uint64_t vertex_shader_invocations = 0;
+		uint64_t clipping_invocations = 0;
+		uint64_t clipping_primitives = 0;
+		uint64_t fragment_shader_invocations = 0;
+	};
+
+	// Measures the GPU time of named command buffer sections with timestamp queries. The outermost section
+	// other than the frame that asks for it also gets a pipeline statistics query (they cannot nest), when the
+	// device supports them; wrappers such as render graph passes opt out so the draws inside can have theirs.
+	// Every frame in flight has its own query pools, read back when its slot comes around again: the frame's
+	// fence has been waited on by then, so the results are complete and reading them never stalls.
+	// Sections with the same name are summed per frame, statistics included, and kept in a rolling history
+	class VulkanEngineGpuProfiler
+	{
+	public:
+		static constexpr uint32_t kMaxScopesPerFrame = 64;
+		static constexpr uint32_t kHistoryLength = 120;
+		static constexpr const char* kFrameScopeName = "frame";
+
+		struct ScopeHistory
+		{
+			std::string name;
+			std::vector<float> milliseconds;	// ring of the last kHistoryLength frames the scope ran in
+			uint32_t next = 0;
+			uint32_t count = 0;
+			uint64_t total_count = 0;			// every frame ever recorded, unlike count it does not saturate
+			GpuPipelineStatistics statistics{};	// of the latest frame
+			bool has_statistics = false;
+
+			float GetLatest() const;
+			// [age] frames before the latest; 0 past the history
+			float GetRecent(uint32_t age) const;
+			float GetAverage() const;
+			float GetMax() const;
+		};
+
+		// Wraps a section of [command_buffer]; [profiler] may be null, which makes this a no-op.
+		// Without [statistics] the section is only timed, and leaves the statistics query to nested sections
+		class Scope
+		{
+		public:
+			Scope(VulkanEngineGpuProfiler* profiler, VkCommandBuffer command_buffer, const char* name, bool statistics = true);
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			VulkanEngineGpuProfiler* profiler_;
+			VkCommandBuffer command_buffer_;
+			uint32_t scope_;
+		};
+
+		VulkanEngineGpuProfiler(VulkanEngineDevice& device, uint32_t frame_count);
+		~VulkanEngineGpuProfiler();
+
+		VulkanEngineGpuProfiler(const VulkanEngineGpuProfiler&) = delete;
+		VulkanEngineGpuProfiler& operator=(const VulkanEngineGpuProfiler&) = delete;
+
+		// False when the graphics queue has no timestamps; every call is a no-op then
+		bool IsEnabled() const { return timestamps_supported_; }
+		bool HasPipelineStatistics() const { return statistics_supported_; }
+
+		// Right after vkBeginCommandBuffer, outside a render pass: collects what this frame slot recorded last
+		// time, resets its pools and opens the frame scope
+		void BeginFrame(VkCommandBuffer command_buffer, int frame_index);
+		// Closes the frame scope; call before vkEndCommandBuffer
+		void EndFrame(VkCommandBuffer command_buffer);
+		// After vkDeviceWaitIdle: collects the frames still waiting for their slot to come around, oldest first,
+		// so the histories end with the last frame submitted
+		void CollectPending();
+
+		// Scopes must nest and may not cross a render pass boundary; prefer Scope over calling these directly.
+		// [name] has to outlive the frame, string literals are the intended use
+		uint32_t BeginScope(VkCommandBuffer command_buffer, const char* name, bool statistics = true);
+		void EndScope(VkCommandBuffer command_buffer, uint32_t scope);
+
+		// In order of first appearance, so the frame scope comes first
+		const std::vector<ScopeHistory>& GetHistories() const { return histories_; }
+		const ScopeHistory* FindHistory(const std::string& name) const;
+
+	private:
+		static constexpr uint32_t kNoScope = ~0u;
+
+		struct RecordedScope
+		{
+			const char* name;
+			uint32_t timestamp_query;	// of the begin timestamp, the end one follows it
+			uint32_t statistics_query;	// kNoScope without statistics
+		};
+
+		struct FrameQueries
+		{
+			VkQueryPool timestamp_pool = VK_NULL_HANDLE;
+			VkQueryPool statistics_pool = VK_NULL_HANDLE;
+			std::vector<RecordedScope> scopes;
+			uint32_t statistics_count = 0;
+			uint64_t frame_number = 0;
+		};
+
+		void CollectResults(FrameQueries& frame);
+		size_t GetHistoryIndex(const char* name);
+
+		VulkanEngineDevice& vulkanengine_device_;
+		bool timestamps_supported_ = false;
+		bool statistics_supported_ = false;
+		double nanoseconds_per_tick_ = 1.0;
+		uint64_t timestamp_mask_ = ~0ull;
+
+		std::vector<FrameQueries> frames_;
+		FrameQueries* current_frame_ = nullptr;
+		uint32_t frame_scope_ = kNoScope;
+		uint64_t frame_number_ = 0;
+		uint32_t open_statistics_scope_ = kNoScope;		// owner of the active statistics query
+
+		std::vector<ScopeHistory> histories_;
+		std::unordered_map<std::string, size_t> history_indices_;
+	};
+}  // namespace vulkanengine
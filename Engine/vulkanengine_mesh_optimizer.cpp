@@ -0,0 +1,335 @@
+#include "vulkanengine_mesh_optimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace vulkanengine
+{
+	// Tuning constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	static constexpr int kForsythCacheSize = 32;
+	static constexpr float kForsythCacheDecayPower = 1.5f;
+	static constexpr float kForsythLastTriangleScore = .75f;
+	static constexpr float kForsythValenceBoostScale = 2.f;
+	static constexpr float kForsythValenceBoostPower = .5f;
+
+	static float ForsythVertexScore(int cache_position, uint32_t remaining_triangles)
+	{
+		if (remaining_triangles == 0)
+		{
+			return -1.f;
+		}
+
+		float score = 0.f;
+		if (cache_position >= 0)
+		{
+			// the three vertices of the last triangle get a fixed score so the next one doesn't just reuse them
+			if (cache_position < 3)
+			{
+				score = kForsythLastTriangleScore;
+			}
+			else
+			{
+				float scaler = 1.f / (kForsythCacheSize - 3);
+				score = std::pow(1.f - (cache_position - 3) * scaler, kForsythCacheDecayPower);
+			}
+		}
+
+		// boost vertices with few triangles left, so lone triangles don't get stranded
+		score += kForsythValenceBoostScale * std::pow(static_cast<float>(remaining_triangles), -kForsythValenceBoostPower);
+		return score;
+	}
+
+	VertexCacheStatistics VulkanEngineMeshOptimizer::AnalyzeVertexCache(
+		const std::vector<uint32_t>& indices,
+		uint32_t vertex_count,
+		uint32_t cache_size)
+	{
+		assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+
+		VertexCacheStatistics statistics{};
+		if (indices.empty())
+		{
+			return statistics;
+		}
+
+		// a vertex is in the FIFO if it was inserted less than cache_size misses ago
+		std::vector<uint32_t> insertion_time(vertex_count, 0);
+		std::vector<bool> referenced(vertex_count, false);
+		uint32_t misses = 0;
+		for (uint32_t index : indices)
+		{
+			assert(index < vertex_count && "Index out of range");
+			referenced[index] = true;
+			if (insertion_time[index] == 0 || misses + 1 - insertion_time[index] > cache_size)
+			{
+				++misses;
+				insertion_time[index] = misses;
+			}
+		}
+
+		uint32_t unique_vertices = static_cast<uint32_t>(std::count(referenced.begin(), referenced.end(), true));
+		statistics.acmr = static_cast<float>(misses) / (indices.size() / 3);
+		statistics.atvr = static_cast<float>(misses) / unique_vertices;
+		return statistics;
+	}
+
+	void VulkanEngineMeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+	{
+		assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+		size_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0)
+		{
+			return;
+		}
+
+		// vertex -> triangles adjacency, packed into one array
+		std::vector<uint32_t> remaining_triangles(vertex_count, 0);
+		for (uint32_t index : indices)
+		{
+			++remaining_triangles[index];
+		}
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+		{
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining_triangles[v];
+		}
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<int> cache_position(vertex_count, -1);
+		std::vector<float> vertex_score(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+		{
+			vertex_score[v] = ForsythVertexScore(-1, remaining_triangles[v]);
+		}
+
+		std::vector<float> triangle_score(triangle_count);
+		std::vector<bool> emitted(triangle_count, false);
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			triangle_score[t] = vertex_score[indices[3 * t]] + vertex_score[indices[3 * t + 1]] + vertex_score[indices[3 * t + 2]];
+		}
+
+		std::vector<uint32_t> cache{};
+		std::vector<uint32_t> new_cache{};
+		cache.reserve(kForsythCacheSize + 3);
+		new_cache.reserve(kForsythCacheSize + 3);
+
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+
+		size_t next_unemitted = 0;
+		int64_t best_triangle = -1;
+		for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+		{
+			// nothing adjacent to the cache is left: restart from the first triangle not yet emitted
+			if (best_triangle < 0)
+			{
+				while (emitted[next_unemitted])
+				{
+					++next_unemitted;
+				}
+				best_triangle = static_cast<int64_t>(next_unemitted);
+			}
+
+			const uint32_t* triangle = &indices[3 * best_triangle];
+			emitted[best_triangle] = true;
+			result.insert(result.end(), triangle, triangle + 3);
+
+			// the emitted triangle moves to the front of the LRU cache, everything else shifts back
+			new_cache.assign(triangle, triangle + 3);
+			for (uint32_t v : cache)
+			{
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				{
+					new_cache.push_back(v);
+				}
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				uint32_t v = triangle[i];
+				--remaining_triangles[v];
+
+				// take the triangle out of the vertex's adjacency so scoring only sees live triangles
+				uint32_t* begin = &adjacency[adjacency_offsets[v]];
+				uint32_t* end = begin + remaining_triangles[v] + 1;
+				*std::find(begin, end, static_cast<uint32_t>(best_triangle)) = *(end - 1);
+			}
+
+			// vertices pushed out of the cache still need their scores lowered
+			std::swap(cache, new_cache);
+			for (size_t i = 0; i < cache.size(); ++i)
+			{
+				cache_position[cache[i]] = i < kForsythCacheSize ? static_cast<int>(i) : -1;
+			}
+
+			for (uint32_t v : cache)
+			{
+				float new_score = ForsythVertexScore(cache_position[v], remaining_triangles[v]);
+				float delta = new_score - vertex_score[v];
+				vertex_score[v] = new_score;
+				for (uint32_t a = adjacency_offsets[v]; a < adjacency_offsets[v] + remaining_triangles[v]; ++a)
+				{
+					triangle_score[adjacency[a]] += delta;
+				}
+			}
+
+			// only triangles touching the cache can have changed, so the best candidate is among them
+			best_triangle = -1;
+			float best_score = -1.f;
+			for (uint32_t v : cache)
+			{
+				for (uint32_t a = adjacency_offsets[v]; a < adjacency_offsets[v] + remaining_triangles[v]; ++a)
+				{
+					uint32_t t = adjacency[a];
+					if (triangle_score[t] > best_score)
+					{
+						best_score = triangle_score[t];
+						best_triangle = t;
+					}
+				}
+			}
+
+			if (cache.size() > kForsythCacheSize)
+			{
+				cache.resize(kForsythCacheSize);
+			}
+		}
+
+		indices = std::move(result);
+	}
+
+	bool VulkanEngineMeshOptimizer::OptimizeOverdraw(
+		std::vector<uint32_t>& indices,
+		const std::vector<glm::vec3>& positions,
+		float threshold)
+	{
+		size_t triangle_count = indices.size() / 3;
+		uint32_t vertex_count = static_cast<uint32_t>(positions.size());
+		if (triangle_count == 0)
+		{
+			return false;
+		}
+
+		// Cluster boundaries are placed where the cache optimized order already breaks locality (a triangle
+		// with three cache misses), so moving whole clusters around barely changes the ACMR
+		std::vector<size_t> cluster_starts{ 0 };
+		{
+			std::vector<uint32_t> insertion_time(vertex_count, 0);
+			uint32_t misses = 0;
+			for (size_t t = 0; t < triangle_count; ++t)
+			{
+				uint32_t triangle_misses = 0;
+				for (int i = 0; i < 3; ++i)
+				{
+					uint32_t v = indices[3 * t + i];
+					if (insertion_time[v] == 0 || misses + 1 - insertion_time[v] > kSimulatedCacheSize)
+					{
+						++misses;
+						++triangle_misses;
+						insertion_time[v] = misses;
+					}
+				}
+				if (triangle_misses == 3 && t != cluster_starts.back())
+				{
+					cluster_starts.push_back(t);
+				}
+			}
+		}
+		cluster_starts.push_back(triangle_count);
+		size_t cluster_count = cluster_starts.size() - 1;
+		if (cluster_count < 2)
+		{
+			return false;
+		}
+
+		// Area weighted centroid of the whole mesh
+		glm::vec3 mesh_centroid{ 0.f };
+		float mesh_area = 0.f;
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			const glm::vec3& p0 = positions[indices[3 * t]];
+			const glm::vec3& p1 = positions[indices[3 * t + 1]];
+			const glm::vec3& p2 = positions[indices[3 * t + 2]];
+			float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+			mesh_centroid += (p0 + p1 + p2) * (area / 3.f);
+			mesh_area += area;
+		}
+		if (mesh_area > 0.f)
+		{
+			mesh_centroid /= mesh_area;
+		}
+
+		// Clusters facing away from the mesh centre and lying far out are likely to be in front of the rest
+		std::vector<float> cluster_sort_key(cluster_count);
+		for (size_t c = 0; c < cluster_count; ++c)
+		{
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f };
+			float area_sum = 0.f;
+			for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t)
+			{
+				const glm::vec3& p0 = positions[indices[3 * t]];
+				const glm::vec3& p1 = positions[indices[3 * t + 1]];
+				const glm::vec3& p2 = positions[indices[3 * t + 2]];
+				glm::vec3 area_normal = glm::cross(p1 - p0, p2 - p0);
+				float area = glm::length(area_normal);
+				centroid += (p0 + p1 + p2) * (area / 3.f);
+				normal += area_normal;
+				area_sum += area;
+			}
+			if (area_sum > 0.f)
+			{
+				centroid /= area_sum;
+			}
+			float normal_length = glm::length(normal);
+			cluster_sort_key[c] = normal_length > 0.f ? glm::dot(centroid - mesh_centroid, normal / normal_length) : 0.f;
+		}
+
+		std::vector<size_t> cluster_order(cluster_count);
+		std::iota(cluster_order.begin(), cluster_order.end(), 0);
+		std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](size_t a, size_t b)
+			{
+				return cluster_sort_key[a] > cluster_sort_key[b];
+			});
+
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+		for (size_t c : cluster_order)
+		{
+			result.insert(result.end(), indices.begin() + 3 * cluster_starts[c], indices.begin() + 3 * cluster_starts[c + 1]);
+		}
+
+		float acmr_before = AnalyzeVertexCache(indices, vertex_count).acmr;
+		float acmr_after = AnalyzeVertexCache(result, vertex_count).acmr;
+		if (acmr_after > acmr_before * threshold)
+		{
+			return false;
+		}
+
+		indices = std::move(result);
+		return true;
+	}
+
+	std::vector<uint32_t> VulkanEngineMeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertex_count)
+	{
+		std::vector<uint32_t> remap(vertex_count, ~0u);
+		uint32_t next_vertex = 0;
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == ~0u)
+			{
+				remap[index] = next_vertex++;
+			}
+			index = remap[index];
+		}
+		return remap;
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,76 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Post-transform vertex cache efficiency of an index buffer, measured with a FIFO cache simulation
+	struct VertexCacheStatistics
+	{
+		float acmr = 0.f;	// average cache miss ratio: shaded vertices per triangle, 0.5 at best, 3 at worst
+		float atvr = 0.f;	// average transformed vertex ratio: shaded vertices per unique vertex, 1 at best
+	};
+
+	struct MeshOptimizationReport
+	{
+		VertexCacheStatistics before{};
+		VertexCacheStatistics after{};
+		bool overdraw_order_applied = false;
+	};
+
+	// Triangle reordering and vertex remapping for a freshly loaded indexed triangle list.
+	// All of it runs on the CPU at load time and leaves the rendered result unchanged
+	class VulkanEngineMeshOptimizer
+	{
+	public:
+		// Hardware FIFO sizes vary between vendors; 16 is a conservative stand-in for the statistics
+		static constexpr uint32_t kSimulatedCacheSize = 16;
+
+		static VertexCacheStatistics AnalyzeVertexCache(
+			const std::vector<uint32_t>& indices,
+			uint32_t vertex_count,
+			uint32_t cache_size = kSimulatedCacheSize);
+
+		// Forsyth's linear-speed vertex cache optimization: greedily emits the triangle whose vertices score
+		// highest given an LRU cache model, favouring vertices with few remaining triangles
+		static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+		// Reorders the clusters of a cache-optimized index buffer front to back from the mesh's point of view,
+		// so outward facing parts are drawn first and occlude the rest. Reverts if the ACMR would grow by more
+		// than [threshold] (e.g. 1.05 allows 5 %). Returns whether the new order was kept
+		static bool OptimizeOverdraw(
+			std::vector<uint32_t>& indices,
+			const std::vector<glm::vec3>& positions,
+			float threshold);
+
+		// Renumbers vertices in order of first use, so the vertex shader walks memory linearly.
+		// Returns the remap table (old index -> new index, ~0u for vertices no triangle references);
+		// apply it to the vertex data with RemapVertices
+		static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+		template <typename T>
+		static void RemapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap)
+		{
+			std::vector<T> remapped{};
+			remapped.resize(vertices.size());
+			size_t used = 0;
+			for (size_t i = 0; i < vertices.size(); ++i)
+			{
+				if (remap[i] != ~0u)
+				{
+					remapped[remap[i]] = vertices[i];
+					++used;
+				}
+			}
+			remapped.resize(used);
+			vertices = std::move(remapped);
+		}
+	};
+}  // namespace vulkanengine
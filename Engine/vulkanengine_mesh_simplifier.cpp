@@ -0,0 +1,396 @@
+#include "vulkanengine_mesh_simplifier.hpp"
+
+#include "vulkanengine_utils.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace vulkanengine
+{
+	// Symmetric 4x4 matrix of the plane equations summed so far, stored as its upper triangle,
+	// plus the total weight so the error can be normalized back to a squared distance
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+		double weight = 0;
+
+		static Quadric FromPlane(const glm::dvec3& normal, double distance, double weight)
+		{
+			Quadric q{};
+			q.a00 = weight * normal.x * normal.x;
+			q.a01 = weight * normal.x * normal.y;
+			q.a02 = weight * normal.x * normal.z;
+			q.a03 = weight * normal.x * distance;
+			q.a11 = weight * normal.y * normal.y;
+			q.a12 = weight * normal.y * normal.z;
+			q.a13 = weight * normal.y * distance;
+			q.a22 = weight * normal.z * normal.z;
+			q.a23 = weight * normal.z * distance;
+			q.a33 = weight * distance * distance;
+			q.weight = weight;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+			a11 += other.a11; a12 += other.a12; a13 += other.a13;
+			a22 += other.a22; a23 += other.a23;
+			a33 += other.a33;
+			weight += other.weight;
+			return *this;
+		}
+
+		// Weighted mean of the squared distances from [p] to all planes
+		double Evaluate(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double error =
+				a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+				a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+				a22 * z * z + 2 * a23 * z +
+				a33;
+			return weight > 0 ? std::max(error, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t from_version;
+		uint32_t to_version;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			size_t seed = 0;
+			HashCombine(seed, p.x, p.y, p.z);
+			return seed;
+		}
+	};
+
+	float VulkanEngineMeshSimplifier::GetMeshExtent(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions)
+	{
+		glm::vec3 bounds_min{ std::numeric_limits<float>::max() };
+		glm::vec3 bounds_max{ std::numeric_limits<float>::lowest() };
+		for (uint32_t index : indices)
+		{
+			bounds_min = glm::min(bounds_min, positions[index]);
+			bounds_max = glm::max(bounds_max, positions[index]);
+		}
+		glm::vec3 size = bounds_max - bounds_min;
+		return indices.empty() ? 0.f : std::max({ size.x, size.y, size.z });
+	}
+
+	VulkanEngineMeshSimplifier::Result VulkanEngineMeshSimplifier::Simplify(
+		const std::vector<uint32_t>& indices,
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec3>& normals,
+		const std::vector<glm::vec2>& uvs,
+		size_t target_index_count,
+		float target_error)
+	{
+		assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+		assert(normals.size() == positions.size() && uvs.size() == positions.size() && "Attribute counts must match");
+
+		Result result{};
+		float extent = GetMeshExtent(indices, positions);
+		if (indices.size() <= target_index_count || extent <= 0.f)
+		{
+			result.indices = indices;
+			return result;
+		}
+
+		// Weld vertices sharing a position; the topology is built on the welded ids
+		std::vector<uint32_t> weld(positions.size(), ~0u);
+		std::vector<uint32_t> welded_vertex{};		// welded id -> one of its original vertices
+		std::vector<std::vector<uint32_t>> copies{};	// welded id -> every original vertex at that position
+		{
+			std::unordered_map<glm::vec3, uint32_t, PositionHash> position_ids{};
+			for (uint32_t index : indices)
+			{
+				if (weld[index] != ~0u)
+				{
+					continue;
+				}
+				auto inserted = position_ids.emplace(positions[index], static_cast<uint32_t>(welded_vertex.size()));
+				if (inserted.second)
+				{
+					welded_vertex.push_back(index);
+					copies.emplace_back();
+				}
+				weld[index] = inserted.first->second;
+				copies[weld[index]].push_back(index);
+			}
+		}
+		uint32_t welded_count = static_cast<uint32_t>(welded_vertex.size());
+		auto position_of = [&](uint32_t welded_id) -> const glm::vec3& { return positions[welded_vertex[welded_id]]; };
+
+		size_t triangle_count = indices.size() / 3;
+		std::vector<std::array<uint32_t, 3>> triangles(triangle_count);
+		std::vector<bool> triangle_alive(triangle_count, true);
+		std::vector<std::vector<uint32_t>> vertex_triangles(welded_count);
+		std::vector<Quadric> quadrics(welded_count);
+		size_t alive_count = triangle_count;
+
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				triangles[t][i] = weld[indices[3 * t + i]];
+			}
+			if (triangles[t][0] == triangles[t][1] || triangles[t][1] == triangles[t][2] || triangles[t][0] == triangles[t][2])
+			{
+				triangle_alive[t] = false;
+				--alive_count;
+				continue;
+			}
+
+			glm::dvec3 p0{ position_of(triangles[t][0]) };
+			glm::dvec3 p1{ position_of(triangles[t][1]) };
+			glm::dvec3 p2{ position_of(triangles[t][2]) };
+			glm::dvec3 area_normal = glm::cross(p1 - p0, p2 - p0);
+			double area = glm::length(area_normal);
+			if (area > 0.0)
+			{
+				glm::dvec3 normal = area_normal / area;
+				Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, p0), area);
+				for (int i = 0; i < 3; ++i)
+				{
+					quadrics[triangles[t][i]] += plane;
+				}
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				vertex_triangles[triangles[t][i]].push_back(static_cast<uint32_t>(t));
+			}
+		}
+
+		// Edges used by a single triangle lie on an open boundary; a plane through the edge, perpendicular
+		// to the face, keeps collapses from eating into the boundary
+		{
+			std::unordered_map<uint64_t, int> edge_use{};
+			auto edge_key = [](uint32_t a, uint32_t b) { return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b); };
+			for (size_t t = 0; t < triangle_count; ++t)
+			{
+				if (!triangle_alive[t])
+				{
+					continue;
+				}
+				for (int i = 0; i < 3; ++i)
+				{
+					++edge_use[edge_key(triangles[t][i], triangles[t][(i + 1) % 3])];
+				}
+			}
+			for (size_t t = 0; t < triangle_count; ++t)
+			{
+				if (!triangle_alive[t])
+				{
+					continue;
+				}
+				glm::dvec3 p0{ position_of(triangles[t][0]) };
+				glm::dvec3 p1{ position_of(triangles[t][1]) };
+				glm::dvec3 p2{ position_of(triangles[t][2]) };
+				glm::dvec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+				for (int i = 0; i < 3; ++i)
+				{
+					uint32_t a = triangles[t][i];
+					uint32_t b = triangles[t][(i + 1) % 3];
+					if (edge_use[edge_key(a, b)] != 1)
+					{
+						continue;
+					}
+					glm::dvec3 pa{ position_of(a) };
+					glm::dvec3 edge = glm::dvec3{ position_of(b) } - pa;
+					glm::dvec3 plane_normal = glm::cross(edge, face_normal);
+					double length = glm::length(plane_normal);
+					if (length <= 0.0)
+					{
+						continue;
+					}
+					plane_normal /= length;
+					Quadric plane = Quadric::FromPlane(plane_normal, -glm::dot(plane_normal, pa), kBorderWeight * glm::dot(edge, edge));
+					quadrics[a] += plane;
+					quadrics[b] += plane;
+				}
+			}
+		}
+
+		std::vector<uint32_t> versions(welded_count, 0);
+		std::vector<uint32_t> collapsed_into(welded_count);
+		for (uint32_t v = 0; v < welded_count; ++v)
+		{
+			collapsed_into[v] = v;
+		}
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue{};
+		auto push_collapse = [&](uint32_t from, uint32_t to)
+			{
+				Quadric q = quadrics[from];
+				q += quadrics[to];
+				queue.push({ q.Evaluate(position_of(to)), from, to, versions[from], versions[to] });
+			};
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			if (!triangle_alive[t])
+			{
+				continue;
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				push_collapse(triangles[t][i], triangles[t][(i + 1) % 3]);
+				push_collapse(triangles[t][(i + 1) % 3], triangles[t][i]);
+			}
+		}
+
+		double max_cost = static_cast<double>(target_error) * extent;
+		max_cost *= max_cost;
+		double applied_cost = 0.0;
+		size_t target_triangle_count = target_index_count / 3;
+
+		while (alive_count > target_triangle_count && !queue.empty())
+		{
+			Collapse collapse = queue.top();
+			queue.pop();
+			if (collapse.from_version != versions[collapse.from] || collapse.to_version != versions[collapse.to]
+				|| collapsed_into[collapse.from] != collapse.from || collapsed_into[collapse.to] != collapse.to)
+			{
+				continue;
+			}
+			if (collapse.cost > max_cost)
+			{
+				break;
+			}
+
+			// Reject collapses that would flip a remaining triangle
+			const glm::vec3& target_position = position_of(collapse.to);
+			bool flips = false;
+			for (uint32_t t : vertex_triangles[collapse.from])
+			{
+				const auto& triangle = triangles[t];
+				if (!triangle_alive[t] || triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					continue;
+				}
+				glm::vec3 before[3], after[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					before[i] = position_of(triangle[i]);
+					after[i] = triangle[i] == collapse.from ? target_position : before[i];
+				}
+				glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normal_before, normal_after) <= 0.f)
+				{
+					flips = true;
+					break;
+				}
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			collapsed_into[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			applied_cost = std::max(applied_cost, collapse.cost);
+			++versions[collapse.from];
+			++versions[collapse.to];
+
+			for (uint32_t t : vertex_triangles[collapse.from])
+			{
+				if (!triangle_alive[t])
+				{
+					continue;
+				}
+				auto& triangle = triangles[t];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					triangle_alive[t] = false;
+					--alive_count;
+					continue;
+				}
+				for (auto& v : triangle)
+				{
+					if (v == collapse.from)
+					{
+						v = collapse.to;
+					}
+				}
+				vertex_triangles[collapse.to].push_back(t);
+			}
+			vertex_triangles[collapse.from].clear();
+
+			// drop dead triangles so the adjacency of busy vertices doesn't keep growing
+			auto& target_triangles = vertex_triangles[collapse.to];
+			target_triangles.erase(
+				std::remove_if(target_triangles.begin(), target_triangles.end(), [&](uint32_t t) { return !triangle_alive[t]; }),
+				target_triangles.end());
+
+			// only collapses involving the target changed cost, and its version bump invalidated the queued ones
+			for (uint32_t t : target_triangles)
+			{
+				for (uint32_t v : triangles[t])
+				{
+					if (v != collapse.to)
+					{
+						push_collapse(v, collapse.to);
+						push_collapse(collapse.to, v);
+					}
+				}
+			}
+		}
+
+		// Map every surviving corner to the copy of its (possibly new) vertex closest in normal and uv
+		result.indices.reserve(alive_count * 3);
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			if (!triangle_alive[t])
+			{
+				continue;
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				uint32_t original = indices[3 * t + i];
+				uint32_t welded_id = triangles[t][i];
+				if (weld[original] == welded_id)
+				{
+					result.indices.push_back(original);
+					continue;
+				}
+
+				uint32_t best = copies[welded_id][0];
+				float best_score = std::numeric_limits<float>::lowest();
+				for (uint32_t candidate : copies[welded_id])
+				{
+					float score = glm::dot(normals[original], normals[candidate]) - glm::length(uvs[original] - uvs[candidate]);
+					if (score > best_score)
+					{
+						best_score = score;
+						best = candidate;
+					}
+				}
+				result.indices.push_back(best);
+			}
+		}
+
+		result.error = static_cast<float>(std::sqrt(applied_cost)) / extent;
+		return result;
+	}
+}  // namespace vulkanengine
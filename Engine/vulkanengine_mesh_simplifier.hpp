@@ -0,0 +1,44 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Quadric error metric edge collapse (Garland & Heckbert). Vertices are only ever collapsed onto one of
+	// their neighbours, so the simplified index buffer keeps referencing the original vertices and every
+	// LOD of a model can share one vertex buffer.
+	// Vertices split along normal/uv seams are welded by position for the topology, and each corner of a
+	// surviving triangle then picks the copy of its new vertex whose normal and uv match the old one best
+	class VulkanEngineMeshSimplifier
+	{
+	public:
+		// Open boundaries (like the rim of a vase) are weighted this much more than surface deviation
+		static constexpr float kBorderWeight = 10.f;
+
+		struct Result
+		{
+			std::vector<uint32_t> indices;
+			float error = 0.f;	// largest deviation introduced, relative to the mesh extent
+		};
+
+		// Collapses edges in order of increasing error until at most [target_index_count] indices remain,
+		// or the next collapse would deviate more than [target_error] (relative to the mesh extent)
+		static Result Simplify(
+			const std::vector<uint32_t>& indices,
+			const std::vector<glm::vec3>& positions,
+			const std::vector<glm::vec3>& normals,
+			const std::vector<glm::vec2>& uvs,
+			size_t target_index_count,
+			float target_error);
+
+		// Largest dimension of the bounding box of the referenced vertices, the unit errors are expressed in
+		static float GetMeshExtent(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions);
+	};
+}  // namespace vulkanengine
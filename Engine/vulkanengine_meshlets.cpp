@@ -0,0 +1,306 @@
+#include "vulkanengine_meshlets.hpp"
+
+#include "vulkanengine_camera.hpp"
+#include "vulkanengine_utils.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace vulkanengine
+{
+	// A cone whose normals spread further than this (about 84 degrees) would only cull from very few
+	// directions, so it is not worth testing
+	static constexpr float kMinConeSpread = .1f;
+
+	struct MeshletFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t source_hash;
+		uint32_t meshlet_count;
+		uint32_t vertex_count;
+		uint32_t triangle_count;
+		uint32_t reserved;
+	};
+
+	// File layout: header, Meshlet[meshlet_count], MeshletBounds[meshlet_count],
+	// uint32_t[vertex_count], uint8_t[3 * triangle_count], all in native byte order
+	static constexpr uint32_t kMeshletFileMagic = 0x4C4D5645; // "EVML"
+	static constexpr uint32_t kMeshletFileVersion = 1;
+
+	static MeshletBounds ComputeBounds(
+		const Meshlet& meshlet,
+		const std::vector<uint32_t>& vertices,
+		const std::vector<uint8_t>& triangles,
+		const std::vector<glm::vec3>& positions)
+	{
+		MeshletBounds bounds{};
+
+		glm::vec3 bounds_min{ std::numeric_limits<float>::max() };
+		glm::vec3 bounds_max{ std::numeric_limits<float>::lowest() };
+		for (uint32_t i = 0; i < meshlet.vertex_count; ++i)
+		{
+			const glm::vec3& position = positions[vertices[meshlet.vertex_offset + i]];
+			bounds_min = glm::min(bounds_min, position);
+			bounds_max = glm::max(bounds_max, position);
+		}
+		bounds.center = (bounds_min + bounds_max) * .5f;
+		for (uint32_t i = 0; i < meshlet.vertex_count; ++i)
+		{
+			bounds.radius = std::max(bounds.radius, glm::length(positions[vertices[meshlet.vertex_offset + i]] - bounds.center));
+		}
+
+		std::vector<glm::vec3> normals{};
+		normals.reserve(meshlet.triangle_count);
+		glm::vec3 normal_sum{ 0.f };
+		for (uint32_t t = 0; t < meshlet.triangle_count; ++t)
+		{
+			const uint8_t* triangle = &triangles[3 * (static_cast<size_t>(meshlet.triangle_offset) + t)];
+			const glm::vec3& p0 = positions[vertices[meshlet.vertex_offset + triangle[0]]];
+			const glm::vec3& p1 = positions[vertices[meshlet.vertex_offset + triangle[1]]];
+			const glm::vec3& p2 = positions[vertices[meshlet.vertex_offset + triangle[2]]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length > 0.f)
+			{
+				normals.push_back(normal / length);
+				normal_sum += normals.back();
+			}
+		}
+
+		// degenerate meshlets and ones whose normals cancel out keep the never culled default
+		float sum_length = glm::length(normal_sum);
+		if (normals.empty() || sum_length <= 0.f)
+		{
+			return bounds;
+		}
+
+		glm::vec3 axis = normal_sum / sum_length;
+		float min_dot = 1.f;
+		for (const glm::vec3& normal : normals)
+		{
+			min_dot = std::min(min_dot, glm::dot(axis, normal));
+		}
+		if (min_dot <= kMinConeSpread)
+		{
+			return bounds;
+		}
+
+		// sine of the cone half angle: the view direction has to be within 90 degrees minus the half angle of the axis
+		bounds.cone_axis = axis;
+		bounds.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+		return bounds;
+	}
+
+	VulkanEngineMeshlets VulkanEngineMeshlets::Build(
+		const std::vector<uint32_t>& indices,
+		uint32_t index_count,
+		const std::vector<glm::vec3>& positions)
+	{
+		assert(index_count % 3 == 0 && index_count <= indices.size() && "Index count must be a multiple of 3 within the index buffer");
+
+		VulkanEngineMeshlets result{};
+
+		// meshlet local index of every mesh vertex, 0xFF while the vertex is not part of the current meshlet
+		std::vector<uint8_t> local_index(positions.size(), 0xFF);
+		Meshlet current{};
+
+		auto finish_meshlet = [&]()
+		{
+			if (current.triangle_count == 0)
+			{
+				return;
+			}
+			for (uint32_t i = 0; i < current.vertex_count; ++i)
+			{
+				local_index[result.vertices_[current.vertex_offset + i]] = 0xFF;
+			}
+			result.meshlets_.push_back(current);
+			result.bounds_.push_back(ComputeBounds(current, result.vertices_, result.triangles_, positions));
+
+			current.vertex_offset += current.vertex_count;
+			current.triangle_offset += current.triangle_count;
+			current.vertex_count = 0;
+			current.triangle_count = 0;
+		};
+
+		for (uint32_t t = 0; t < index_count / 3; ++t)
+		{
+			const uint32_t* triangle = &indices[3 * static_cast<size_t>(t)];
+
+			uint32_t new_vertices = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				bool repeated = i > 0 && (triangle[i] == triangle[0] || (i == 2 && triangle[2] == triangle[1]));
+				if (local_index[triangle[i]] == 0xFF && !repeated)
+				{
+					++new_vertices;
+				}
+			}
+			if (current.vertex_count + new_vertices > kMaxVertices || current.triangle_count + 1 > kMaxTriangles)
+			{
+				finish_meshlet();
+			}
+
+			for (int i = 0; i < 3; ++i)
+			{
+				uint32_t vertex = triangle[i];
+				if (local_index[vertex] == 0xFF)
+				{
+					local_index[vertex] = static_cast<uint8_t>(current.vertex_count++);
+					result.vertices_.push_back(vertex);
+				}
+				result.triangles_.push_back(local_index[vertex]);
+			}
+			++current.triangle_count;
+		}
+		finish_meshlet();
+
+		return result;
+	}
+
+	uint64_t VulkanEngineMeshlets::ComputeSourceHash(
+		const std::vector<uint32_t>& indices,
+		uint32_t index_count,
+		const std::vector<glm::vec3>& positions)
+	{
+		uint64_t hash = HashBytes(&kMaxVertices, sizeof(kMaxVertices));
+		hash = HashBytes(&kMaxTriangles, sizeof(kMaxTriangles), hash);
+		hash = HashBytes(indices.data(), sizeof(uint32_t) * static_cast<size_t>(index_count), hash);
+		return HashBytes(positions.data(), sizeof(glm::vec3) * positions.size(), hash);
+	}
+
+	bool VulkanEngineMeshlets::Save(const std::string& filepath, uint64_t source_hash) const
+	{
+		MeshletFileHeader header{};
+		header.magic = kMeshletFileMagic;
+		header.version = kMeshletFileVersion;
+		header.source_hash = source_hash;
+		header.meshlet_count = static_cast<uint32_t>(meshlets_.size());
+		header.vertex_count = static_cast<uint32_t>(vertices_.size());
+		header.triangle_count = static_cast<uint32_t>(triangles_.size() / 3);
+
+		std::ofstream file{ filepath, std::ios::binary | std::ios::trunc };
+		return file.is_open() &&
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+			file.write(reinterpret_cast<const char*>(meshlets_.data()), sizeof(Meshlet) * meshlets_.size()) &&
+			file.write(reinterpret_cast<const char*>(bounds_.data()), sizeof(MeshletBounds) * bounds_.size()) &&
+			file.write(reinterpret_cast<const char*>(vertices_.data()), sizeof(uint32_t) * vertices_.size()) &&
+			file.write(reinterpret_cast<const char*>(triangles_.data()), triangles_.size());
+	}
+
+	bool VulkanEngineMeshlets::Load(const std::string& filepath, uint64_t source_hash, VulkanEngineMeshlets& meshlets)
+	{
+		std::ifstream file{ filepath, std::ios::binary | std::ios::ate };
+		if (!file.is_open())
+		{
+			return false;
+		}
+		size_t file_size = static_cast<size_t>(file.tellg());
+		file.seekg(0);
+
+		MeshletFileHeader header{};
+		bool valid = file_size >= sizeof(header) && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+			header.magic == kMeshletFileMagic &&
+			header.version == kMeshletFileVersion &&
+			header.source_hash == source_hash &&
+			file_size == sizeof(header) +
+				(sizeof(Meshlet) + sizeof(MeshletBounds)) * static_cast<size_t>(header.meshlet_count) +
+				sizeof(uint32_t) * static_cast<size_t>(header.vertex_count) +
+				3 * static_cast<size_t>(header.triangle_count);
+		if (!valid)
+		{
+			return false;
+		}
+
+		VulkanEngineMeshlets loaded{};
+		loaded.meshlets_.resize(header.meshlet_count);
+		loaded.bounds_.resize(header.meshlet_count);
+		loaded.vertices_.resize(header.vertex_count);
+		loaded.triangles_.resize(3 * static_cast<size_t>(header.triangle_count));
+		if (!file.read(reinterpret_cast<char*>(loaded.meshlets_.data()), sizeof(Meshlet) * loaded.meshlets_.size()) ||
+			!file.read(reinterpret_cast<char*>(loaded.bounds_.data()), sizeof(MeshletBounds) * loaded.bounds_.size()) ||
+			!file.read(reinterpret_cast<char*>(loaded.vertices_.data()), sizeof(uint32_t) * loaded.vertices_.size()) ||
+			!file.read(reinterpret_cast<char*>(loaded.triangles_.data()), loaded.triangles_.size()))
+		{
+			return false;
+		}
+
+		meshlets = std::move(loaded);
+		return true;
+	}
+
+	void VulkanEngineMeshlets::Cull(
+		const glm::mat4& model_matrix,
+		const glm::vec3& camera_position,
+		const std::array<glm::vec4, 6>& frustum_planes,
+		bool cone_culling,
+		std::vector<VkDrawIndexedIndirectCommand>& commands,
+		MeshletCullingStats& stats) const
+	{
+		// spheres grow with the largest axis scale, which keeps the frustum test conservative under non uniform scale
+		float max_scale = std::sqrt(std::max({
+			glm::dot(glm::vec3(model_matrix[0]), glm::vec3(model_matrix[0])),
+			glm::dot(glm::vec3(model_matrix[1]), glm::vec3(model_matrix[1])),
+			glm::dot(glm::vec3(model_matrix[2]), glm::vec3(model_matrix[2])) }));
+
+		// index of the command the previous meshlet was appended to, if it was visible
+		size_t open_command = std::numeric_limits<size_t>::max();
+		for (size_t m = 0; m < meshlets_.size(); ++m)
+		{
+			const Meshlet& meshlet = meshlets_[m];
+			const MeshletBounds& bounds = bounds_[m];
+			++stats.meshlet_count;
+
+			glm::vec3 world_center = glm::vec3(model_matrix * glm::vec4(bounds.center, 1.f));
+			if (VulkanEngineCamera::IsSphereOutsideFrustum(frustum_planes, world_center, bounds.radius * max_scale))
+			{
+				++stats.frustum_culled;
+				open_command = std::numeric_limits<size_t>::max();
+				continue;
+			}
+
+			// Object space, where the cone was built: whether a triangle faces the camera does not change
+			// under the (affine) model transform, while angles would under non uniform scale
+			if (cone_culling && bounds.cone_cutoff < 1.f)
+			{
+				glm::vec3 to_center = bounds.center - camera_position;
+				if (glm::dot(to_center, bounds.cone_axis) >= bounds.cone_cutoff * glm::length(to_center) + bounds.radius)
+				{
+					++stats.cone_culled;
+					open_command = std::numeric_limits<size_t>::max();
+					continue;
+				}
+			}
+
+			stats.triangle_count += meshlet.triangle_count;
+			if (open_command != std::numeric_limits<size_t>::max())
+			{
+				commands[open_command].indexCount += 3 * meshlet.triangle_count;
+				continue;
+			}
+
+			VkDrawIndexedIndirectCommand command{};
+			command.indexCount = 3 * meshlet.triangle_count;
+			command.instanceCount = 1;
+			command.firstIndex = 3 * meshlet.triangle_offset;
+			open_command = commands.size();
+			commands.push_back(command);
+			++stats.draw_count;
+		}
+	}
+
+	float VulkanEngineMeshlets::GetAverageVertexCount() const
+	{
+		return meshlets_.empty() ? 0.f : static_cast<float>(vertices_.size()) / meshlets_.size();
+	}
+
+	float VulkanEngineMeshlets::GetAverageTriangleCount() const
+	{
+		return meshlets_.empty() ? 0.f : static_cast<float>(triangles_.size() / 3) / meshlets_.size();
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,100 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkanengine
+{
+	struct Meshlet
+	{
+		uint32_t vertex_offset = 0;		// into GetVertices()
+		uint32_t triangle_offset = 0;	// into GetTriangles(), and the first triangle of the meshlet in the source index buffer
+		uint32_t vertex_count = 0;
+		uint32_t triangle_count = 0;
+	};
+
+	// Object space culling data of a meshlet. The normal cone holds every triangle normal within
+	// acos(sqrt(1 - cone_cutoff^2)) of cone_axis; a cutoff of 1 means the cone is too wide to ever cull
+	struct MeshletBounds
+	{
+		glm::vec3 center{ 0.f };
+		float radius = 0.f;
+		glm::vec3 cone_axis{ 0.f, 0.f, 1.f };
+		float cone_cutoff = 1.f;
+	};
+
+	// Accumulated by VulkanEngineMeshlets::Cull
+	struct MeshletCullingStats
+	{
+		uint32_t meshlet_count = 0;		// meshlets tested
+		uint32_t frustum_culled = 0;
+		uint32_t cone_culled = 0;
+		uint32_t draw_count = 0;		// indirect commands, adjacent visible meshlets share one
+		uint64_t triangle_count = 0;	// triangles left after culling
+	};
+
+	// Partition of an indexed triangle list into small clusters (meshlets) with bounds for per-cluster
+	// frustum and backface culling.
+	// Meshlets are cut from the index buffer in order, so each one is a contiguous range of it and can be
+	// drawn with the existing index buffer through vkCmdDrawIndexedIndirect. The order is left exactly as the
+	// vertex cache optimization produced it. The local vertex list and 8 bit triangle indices use the usual
+	// mesh shader layout, so a task/mesh shader path can use the same data
+	class VulkanEngineMeshlets
+	{
+	public:
+		static constexpr uint32_t kMaxVertices = 64;
+		static constexpr uint32_t kMaxTriangles = 124;
+
+		// Meshlets for the first [index_count] indices of [indices]
+		static VulkanEngineMeshlets Build(
+			const std::vector<uint32_t>& indices,
+			uint32_t index_count,
+			const std::vector<glm::vec3>& positions);
+
+		// Identifies the geometry meshlets were built from, so a saved file can be checked against the mesh it belongs to
+		static uint64_t ComputeSourceHash(
+			const std::vector<uint32_t>& indices,
+			uint32_t index_count,
+			const std::vector<glm::vec3>& positions);
+
+		// Binary file, see the .cpp for the layout. Load fails (returns false) on any version or hash mismatch
+		bool Save(const std::string& filepath, uint64_t source_hash) const;
+		static bool Load(const std::string& filepath, uint64_t source_hash, VulkanEngineMeshlets& meshlets);
+
+		// Appends one draw command per run of visible meshlets to [commands]. [camera_position] is in object space,
+		// [frustum_planes] in world space (see VulkanEngineCamera::GetFrustumPlanes). Cone culling is only
+		// correct for pipelines that cull back faces
+		void Cull(
+			const glm::mat4& model_matrix,
+			const glm::vec3& camera_position,
+			const std::array<glm::vec4, 6>& frustum_planes,
+			bool cone_culling,
+			std::vector<VkDrawIndexedIndirectCommand>& commands,
+			MeshletCullingStats& stats) const;
+
+		bool IsEmpty() const { return meshlets_.empty(); }
+		uint32_t GetMeshletCount() const { return static_cast<uint32_t>(meshlets_.size()); }
+		const std::vector<Meshlet>& GetMeshlets() const { return meshlets_; }
+		const std::vector<MeshletBounds>& GetBounds() const { return bounds_; }
+		const std::vector<uint32_t>& GetVertices() const { return vertices_; }
+		const std::vector<uint8_t>& GetTriangles() const { return triangles_; }
+
+		float GetAverageVertexCount() const;
+		float GetAverageTriangleCount() const;
+
+	private:
+		std::vector<Meshlet> meshlets_;
+		std::vector<MeshletBounds> bounds_;
+		std::vector<uint32_t> vertices_;	// mesh vertex indices, vertex_count per meshlet
+		std::vector<uint8_t> triangles_;	// 3 meshlet local indices per triangle
+	};
+}  // namespace vulkanengine
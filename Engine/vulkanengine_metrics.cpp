@@ -0,0 +1,240 @@
+#include "vulkanengine_metrics.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace vulkanengine
+{
+	static constexpr double kCsvPercentiles[] = { 50.0, 95.0, 99.0 };
+
+	VulkanEngineMetrics::Histogram::Histogram(size_t window)
+		: samples_(window, 0.0)
+	{
+		assert(window > 0 && "Histogram window must hold at least one sample");
+	}
+
+	void VulkanEngineMetrics::Histogram::Record(double sample)
+	{
+		samples_[next_] = sample;
+		next_ = (next_ + 1) % samples_.size();
+		count_ = std::min(count_ + 1, samples_.size());
+	}
+
+	double VulkanEngineMetrics::Histogram::GetPercentile(double percentile) const
+	{
+		if (count_ == 0)
+		{
+			return 0.0;
+		}
+
+		sorted_.assign(samples_.begin(), samples_.begin() + count_);
+		size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * count_));
+		size_t index = std::min(rank > 0 ? rank - 1 : 0, count_ - 1);
+		std::nth_element(sorted_.begin(), sorted_.begin() + index, sorted_.end());
+		return sorted_[index];
+	}
+
+	double VulkanEngineMetrics::Histogram::GetMean() const
+	{
+		double sum = 0.0;
+		for (size_t i = 0; i < count_; ++i)
+		{
+			sum += samples_[i];
+		}
+		return count_ > 0 ? sum / count_ : 0.0;
+	}
+
+	double VulkanEngineMetrics::Histogram::GetMax() const
+	{
+		return count_ > 0 ? *std::max_element(samples_.begin(), samples_.begin() + count_) : 0.0;
+	}
+
+	VulkanEngineMetrics::VulkanEngineMetrics()
+		: VulkanEngineMetrics(Config{})
+	{
+	}
+
+	VulkanEngineMetrics::VulkanEngineMetrics(const Config& config)
+		: config_{ config }
+	{
+		if (!config_.csv_filepath.empty())
+		{
+			csv_file_.open(config_.csv_filepath, std::ios::trunc);
+			if (!csv_file_)
+			{
+				std::cerr << "metrics: failed to open " << config_.csv_filepath << std::endl;
+			}
+		}
+	}
+
+	VulkanEngineMetrics::Histogram& VulkanEngineMetrics::GetHistogram(const std::string& name)
+	{
+		auto it = histograms_.find(name);
+		if (it == histograms_.end())
+		{
+			it = histograms_.emplace(name, Histogram{ config_.histogram_window }).first;
+		}
+		return it->second;
+	}
+
+	const VulkanEngineMetrics::Counter* VulkanEngineMetrics::FindCounter(const std::string& name) const
+	{
+		auto it = counters_.find(name);
+		return it != counters_.end() ? &it->second : nullptr;
+	}
+
+	const VulkanEngineMetrics::Gauge* VulkanEngineMetrics::FindGauge(const std::string& name) const
+	{
+		auto it = gauges_.find(name);
+		return it != gauges_.end() ? &it->second : nullptr;
+	}
+
+	const VulkanEngineMetrics::Histogram* VulkanEngineMetrics::FindHistogram(const std::string& name) const
+	{
+		auto it = histograms_.find(name);
+		return it != histograms_.end() ? &it->second : nullptr;
+	}
+
+	void VulkanEngineMetrics::EndFrame(float frame_seconds)
+	{
+		for (auto& kv : counters_)
+		{
+			Counter& counter = kv.second;
+			counter.last_frame = counter.frame_value;
+			counter.total += counter.frame_value;
+			counter.interval += counter.frame_value;
+			counter.frame_value = 0;
+		}
+
+		++frame_count_;
+		++interval_frame_count_;
+		elapsed_seconds_ += frame_seconds;
+		interval_seconds_ += frame_seconds;
+		if (config_.log_interval_seconds <= 0.f || interval_seconds_ < config_.log_interval_seconds)
+		{
+			return;
+		}
+
+		if (config_.log_to_console)
+		{
+			std::cout << "metrics: " << FormatSummary() << std::endl;
+		}
+		if (csv_file_)
+		{
+			WriteCsvRow();
+		}
+
+		for (auto& kv : counters_)
+		{
+			kv.second.interval = 0;
+		}
+		interval_frame_count_ = 0;
+		interval_seconds_ = 0.0;
+	}
+
+	std::string VulkanEngineMetrics::FormatSummary() const
+	{
+		std::ostringstream summary;
+		summary << std::fixed << std::setprecision(2);
+
+		const Histogram* frame_time = FindHistogram(metric::kFrameTime);
+		if (frame_time != nullptr)
+		{
+			summary << frame_time->GetPercentile(50.0) << " ms (p99 " << frame_time->GetPercentile(99.0) << ")";
+		}
+		for (const auto& kv : counters_)
+		{
+			summary << (summary.tellp() > 0 ? ", " : "") << kv.first << " " << kv.second.last_frame;
+		}
+		for (const auto& kv : gauges_)
+		{
+			summary << (summary.tellp() > 0 ? ", " : "") << kv.first << " " << kv.second.value;
+		}
+		return summary.str();
+	}
+
+	// Counters as per frame averages over the interval, gauges as they are now, histograms as percentiles
+	void VulkanEngineMetrics::WriteCsvRow()
+	{
+		std::vector<std::string> columns{ "time_s", "frames" };
+		std::vector<double> row{ elapsed_seconds_, static_cast<double>(interval_frame_count_) };
+		for (const auto& kv : counters_)
+		{
+			columns.push_back(kv.first);
+			row.push_back(static_cast<double>(kv.second.interval) / std::max<uint64_t>(interval_frame_count_, 1));
+		}
+		for (const auto& kv : gauges_)
+		{
+			columns.push_back(kv.first);
+			row.push_back(kv.second.value);
+		}
+		for (const auto& kv : histograms_)
+		{
+			for (double percentile : kCsvPercentiles)
+			{
+				std::ostringstream column;
+				column << kv.first << "_p" << percentile;
+				columns.push_back(column.str());
+				row.push_back(kv.second.GetPercentile(percentile));
+			}
+		}
+
+		if (columns != csv_columns_)
+		{
+			// metrics are never removed, so every old column is still there, just maybe further right
+			for (auto& old_row : csv_rows_)
+			{
+				std::vector<double> realigned(columns.size(), std::numeric_limits<double>::quiet_NaN());
+				for (size_t i = 0; i < csv_columns_.size(); ++i)
+				{
+					size_t column = std::find(columns.begin(), columns.end(), csv_columns_[i]) - columns.begin();
+					assert(column < columns.size() && "Metric columns are only ever added");
+					realigned[column] = old_row[i];
+				}
+				old_row = std::move(realigned);
+			}
+			csv_columns_ = std::move(columns);
+
+			csv_file_.close();
+			csv_file_.open(config_.csv_filepath, std::ios::trunc);
+			if (!csv_file_)
+			{
+				std::cerr << "metrics: failed to open " << config_.csv_filepath << std::endl;
+				return;
+			}
+			for (size_t i = 0; i < csv_columns_.size(); ++i)
+			{
+				csv_file_ << (i > 0 ? "," : "") << csv_columns_[i];
+			}
+			csv_file_ << '\n';
+			for (const auto& old_row : csv_rows_)
+			{
+				WriteCsvValues(old_row);
+			}
+		}
+
+		WriteCsvValues(row);
+		csv_file_.flush();
+		csv_rows_.push_back(std::move(row));
+	}
+
+	// NaN marks a metric that did not exist yet, left empty
+	void VulkanEngineMetrics::WriteCsvValues(const std::vector<double>& values)
+	{
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			csv_file_ << (i > 0 ? "," : "");
+			if (!std::isnan(values[i]))
+			{
+				csv_file_ << values[i];
+			}
+		}
+		csv_file_ << '\n';
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,128 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Names of the metrics the engine itself reports; they double as CSV column names
+	namespace metric
+	{
+		// counters, per frame
+		static constexpr const char* kDrawCalls = "draw_calls";
+		static constexpr const char* kTriangles = "triangles";
+		static constexpr const char* kCulledObjects = "culled_objects";
+		static constexpr const char* kOccludedObjects = "occluded_objects";	// reported a few frames late, see VulkanEngineOcclusionCuller
+		static constexpr const char* kPipelineBinds = "pipeline_binds";
+		static constexpr const char* kDescriptorBinds = "descriptor_binds";
+		static constexpr const char* kPushConstantBytes = "push_constant_bytes";
+		static constexpr const char* kBufferUploads = "buffer_uploads";
+		static constexpr const char* kBufferUploadBytes = "buffer_upload_bytes";
+		// gauges
+		static constexpr const char* kRingBufferBytes = "ring_buffer_bytes";
+		static constexpr const char* kResidentModelBytes = "resident_model_bytes";
+		// histograms, milliseconds
+		static constexpr const char* kFrameTime = "frame_ms";
+		static constexpr const char* kFenceWait = "fence_wait_ms";
+	}  // namespace metric
+
+	// Engine wide counters, gauges and histograms. Systems add to them while recording a frame, EndFrame
+	// closes the frame and every log interval prints a summary and appends a CSV row.
+	// Metrics are created on first use and never removed, so references to them stay valid. Main thread only
+	class VulkanEngineMetrics
+	{
+	public:
+		// Summed over a frame; the per frame value is kept until the next EndFrame
+		struct Counter
+		{
+			uint64_t frame_value = 0;	// of the frame being recorded
+			uint64_t last_frame = 0;
+			uint64_t total = 0;
+			uint64_t interval = 0;		// since the last log, for per frame averages
+
+			void Add(uint64_t amount = 1) { frame_value += amount; }
+		};
+
+		struct Gauge
+		{
+			double value = 0.0;
+
+			void Set(double new_value) { value = new_value; }
+		};
+
+		// Keeps the last [window] samples for percentiles
+		class Histogram
+		{
+		public:
+			explicit Histogram(size_t window);
+
+			void Record(double sample);
+			// Nearest rank, [percentile] in 0..100; 0 without samples
+			double GetPercentile(double percentile) const;
+			double GetMean() const;
+			double GetMax() const;
+			size_t GetSampleCount() const { return count_; }
+
+		private:
+			std::vector<double> samples_;
+			size_t next_ = 0;
+			size_t count_ = 0;
+			mutable std::vector<double> sorted_;
+		};
+
+		struct Config
+		{
+			float log_interval_seconds = 5.f;	// 0 disables the periodic summary and CSV rows
+			bool log_to_console = true;
+			std::string csv_filepath{};			// empty: no CSV
+			size_t histogram_window = 1000;
+		};
+
+		VulkanEngineMetrics();
+		explicit VulkanEngineMetrics(const Config& config);
+
+		VulkanEngineMetrics(const VulkanEngineMetrics&) = delete;
+		VulkanEngineMetrics& operator=(const VulkanEngineMetrics&) = delete;
+
+		Counter& GetCounter(const std::string& name) { return counters_[name]; }
+		Gauge& GetGauge(const std::string& name) { return gauges_[name]; }
+		Histogram& GetHistogram(const std::string& name);
+
+		// Null if nothing was reported under [name] yet
+		const Counter* FindCounter(const std::string& name) const;
+		const Gauge* FindGauge(const std::string& name) const;
+		const Histogram* FindHistogram(const std::string& name) const;
+
+		// Closes the frame: counters move their frame value to last_frame. [frame_seconds] drives the log interval
+		void EndFrame(float frame_seconds);
+		uint64_t GetFrameCount() const { return frame_count_; }
+
+		// Per frame counters of the last frame, gauges and frame time percentiles on one line
+		std::string FormatSummary() const;
+
+	private:
+		void WriteCsvRow();
+		void WriteCsvValues(const std::vector<double>& values);
+
+		Config config_;
+		// ordered, so the CSV columns and the summary stay stable
+		std::map<std::string, Counter> counters_;
+		std::map<std::string, Gauge> gauges_;
+		std::map<std::string, Histogram> histograms_;
+
+		uint64_t frame_count_ = 0;
+		uint64_t interval_frame_count_ = 0;
+		double elapsed_seconds_ = 0.0;
+		double interval_seconds_ = 0.0;
+
+		std::ofstream csv_file_;
+		// Every row so far, aligned with csv_columns_. A metric created after the first row adds a column,
+		// and the file is written again from these with the earlier rows left blank there
+		std::vector<std::string> csv_columns_;
+		std::vector<std::vector<double>> csv_rows_;
+	};
+}  // namespace vulkanengine
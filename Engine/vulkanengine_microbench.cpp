@@ -0,0 +1,85 @@
+#include "vulkanengine_microbench.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace vulkanengine
+{
+	void VulkanEngineMicrobench::Add(const std::string& name, Function function)
+	{
+		benchmarks_.push_back({ name, std::move(function) });
+	}
+
+	std::vector<VulkanEngineMicrobench::Result> VulkanEngineMicrobench::Run(const std::string& filter) const
+	{
+		std::vector<Result> results{};
+		std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14) << "ns/iter"
+			<< std::setw(14) << "min" << std::setw(14) << "max" << std::setw(12) << "iterations" << std::endl;
+
+		for (const auto& benchmark : benchmarks_)
+		{
+			if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+			{
+				continue;
+			}
+
+			// grow the batch until the clock resolution and loop overhead no longer matter
+			uint64_t iterations = 1;
+			double seconds = TimeBatch(benchmark.function, iterations);
+			while (seconds < kMinBatchSeconds)
+			{
+				double scale = seconds > 0.0 ? kMinBatchSeconds / seconds * 1.2 : 10.0;
+				iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 2.0), 10.0));
+				seconds = TimeBatch(benchmark.function, iterations);
+			}
+
+			std::vector<double> nanoseconds(kRepetitions);
+			for (auto& repetition : nanoseconds)
+			{
+				repetition = TimeBatch(benchmark.function, iterations) * 1e9 / iterations;
+			}
+			std::sort(nanoseconds.begin(), nanoseconds.end());
+
+			Result result{};
+			result.name = benchmark.name;
+			result.iterations = iterations;
+			result.median_nanoseconds = nanoseconds[kRepetitions / 2];
+			result.min_nanoseconds = nanoseconds.front();
+			result.max_nanoseconds = nanoseconds.back();
+			results.push_back(result);
+
+			std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(14) << result.median_nanoseconds << std::setw(14) << result.min_nanoseconds
+				<< std::setw(14) << result.max_nanoseconds << std::setw(12) << result.iterations << std::endl;
+		}
+		return results;
+	}
+
+	bool VulkanEngineMicrobench::WriteCsv(const std::string& filepath, const std::vector<Result>& results)
+	{
+		std::ofstream file{ filepath, std::ios::trunc };
+		if (!file)
+		{
+			return false;
+		}
+
+		file << "name,median_ns,min_ns,max_ns,iterations\n";
+		for (const auto& result : results)
+		{
+			file << result.name << ',' << result.median_nanoseconds << ',' << result.min_nanoseconds << ','
+				<< result.max_nanoseconds << ',' << result.iterations << '\n';
+		}
+		return static_cast<bool>(file);
+	}
+
+	double VulkanEngineMicrobench::TimeBatch(const Function& function, uint64_t iterations)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function(iterations);
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,68 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace vulkanengine
+{
+	// Keeps the compiler from optimizing away a result the benchmark never reads
+	template <typename T>
+	inline void DoNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		// the volatile store keeps the address escaping, the barrier keeps the computation ahead of it
+		static const volatile void* volatile sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#endif
+	}
+
+	// A minimal Google Benchmark style runner for CPU hot paths; needs no Vulkan device.
+	// Each benchmark is timed in batches whose iteration count grows until a batch takes kMinBatchSeconds,
+	// then kRepetitions batches of that size are run and the median time per iteration is reported
+	class VulkanEngineMicrobench
+	{
+	public:
+		static constexpr double kMinBatchSeconds = .05;
+		static constexpr uint32_t kRepetitions = 5;
+
+		// Runs the measured code [iterations] times
+		using Function = std::function<void(uint64_t iterations)>;
+
+		struct Result
+		{
+			std::string name;
+			uint64_t iterations = 0;			// per batch
+			double median_nanoseconds = 0.0;	// per iteration
+			double min_nanoseconds = 0.0;
+			double max_nanoseconds = 0.0;
+		};
+
+		void Add(const std::string& name, Function function);
+
+		// Runs the benchmarks whose name contains [filter] (all if empty) and prints a line per result
+		std::vector<Result> Run(const std::string& filter) const;
+		// One row per result, for comparing against a baseline; returns false if the file could not be written
+		static bool WriteCsv(const std::string& filepath, const std::vector<Result>& results);
+
+	private:
+		struct Benchmark
+		{
+			std::string name;
+			Function function;
+		};
+
+		static double TimeBatch(const Function& function, uint64_t iterations);
+
+		std::vector<Benchmark> benchmarks_;
+	};
+}  // namespace vulkanengine
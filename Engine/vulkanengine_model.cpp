@@ -1,5 +1,6 @@
 #include "vulkanengine_model.hpp"
 
+#include "vulkanengine_mesh_simplifier.hpp"
 #include "vulkanengine_utils.hpp"
 
 // libs
@@ -9,123 +10,386 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <iostream>
+#include <limits>
 #include <unordered_map>
 
 namespace std
 {
-	template <>
-	struct hash<vulkanengine::VulkanEngineModel::Vertex>
+	size_t hash<vulkanengine::VulkanEngineModel::Vertex>::operator()(const vulkanengine::VulkanEngineModel::Vertex& vertex) const
 	{
-		size_t operator()(const vulkanengine::VulkanEngineModel::Vertex& vertex) const
-		{
-			size_t seed = 0;
-			vulkanengine::HashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
+		size_t seed = 0;
+		vulkanengine::HashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+		return seed;
+	}
 } // namespace std
 
 namespace vulkanengine
 {
-	VulkanEngineModel::VulkanEngineModel(VulkanEngineDevice& device, const VulkanEngineModel::Builder& builder) : vulkanengine_device_(device)
+	VulkanEngineModel::VulkanEngineModel(VulkanEngineDevice& device, const VulkanEngineModel::Builder& builder)
+		: vulkanengine_device_(device),
+		vertex_format_{ builder.vertex_format },
+		lods_{ builder.lods },
+		lod_build_milliseconds_{ builder.lod_build_milliseconds },
+		meshlets_{ builder.meshlets },
+		meshlets_from_cache_{ builder.meshlets_from_cache },
+		optimization_report_{ builder.optimization_report }
 	{
-		CreateVertexBuffers(builder.vertices);
-		CreateIndexBuffers(builder.indices);
+		std::vector<GeometryUpload> uploads{};
+		CreateVertexBuffers(builder.vertices, uploads);
+		CreateIndexBuffers(builder.indices, uploads);
+		FinishUploads(uploads);
+		if (lods_.empty())
+		{
+			lods_.push_back({ 0, index_count_, 0.f });
+		}
 	}
 
 	VulkanEngineModel::~VulkanEngineModel() {}
 
 	std::unique_ptr<VulkanEngineModel> VulkanEngineModel::CreateModelFromFile(VulkanEngineDevice& device, const std::string& filepath)
+	{
+		return CreateModelFromFile(device, filepath, LoadOptions{});
+	}
+
+	std::unique_ptr<VulkanEngineModel> VulkanEngineModel::CreateModelFromFile(
+		VulkanEngineDevice& device,
+		const std::string& filepath,
+		const LoadOptions& options)
+	{
+		Builder builder = LoadBuilderFromFile(filepath, options);
+		return std::make_unique<VulkanEngineModel>(device, builder);
+	}
+
+	VulkanEngineModel::Builder VulkanEngineModel::LoadBuilderFromFile(const std::string& filepath, const LoadOptions& options)
 	{
 		Builder builder{};
 		builder.LoadModel(filepath);
+		if (options.lod_count > 1)
+		{
+			builder.GenerateLods(options.lod_count, options.lod_max_error);
+		}
+		if (options.optimize)
+		{
+			builder.Optimize(options.overdraw_threshold);
+		}
+		if (options.build_meshlets)
+		{
+			builder.BuildMeshlets(filepath + ".meshlets");
+		}
+		builder.vertex_format = options.vertex_format;
+		return builder;
+	}
 
-		return std::make_unique<VulkanEngineModel>(device, builder);
+	void VulkanEngineModel::ComputeBounds(const std::vector<Vertex>& vertices, glm::vec3& bounds_min, glm::vec3& bounds_max)
+	{
+		bounds_min = glm::vec3{ std::numeric_limits<float>::max() };
+		bounds_max = glm::vec3{ std::numeric_limits<float>::lowest() };
+		for (const auto& vertex : vertices)
+		{
+			bounds_min = glm::min(bounds_min, vertex.position);
+			bounds_max = glm::max(bounds_max, vertex.position);
+		}
 	}
 
-	void VulkanEngineModel::CreateVertexBuffers(const std::vector<Vertex>& vertices)
+	void VulkanEngineModel::CreateVertexBuffers(const std::vector<Vertex>& vertices, std::vector<GeometryUpload>& uploads)
 	{
 		vertex_count_ = static_cast<uint32_t>(vertices.size());
 		assert(vertex_count_ >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize buffer_size = sizeof(vertices[0]) * vertex_count_;
 
-		uint32_t vertex_size = sizeof(vertices[0]);
-		VulkanEngineBuffer staging_buffer{
-			vulkanengine_device_,
-			vertex_size,
-			vertex_count_,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
+		glm::vec3 bounds_min, bounds_max;
+		ComputeBounds(vertices, bounds_min, bounds_max);
+		position_dequantization_ = vertex_format_.GetPositionDequantization(bounds_min, bounds_max);
 
-		staging_buffer.Map();
-		staging_buffer.WriteToBuffer((void*)vertices.data());
+		bounding_sphere_center_ = (bounds_min + bounds_max) * .5f;
+		bounding_sphere_radius_ = 0.f;
+		for (const auto& vertex : vertices)
+		{
+			bounding_sphere_radius_ = std::max(bounding_sphere_radius_, glm::length(vertex.position - bounding_sphere_center_));
+		}
 
-		vertex_buffer_ = std::make_unique<VulkanEngineBuffer>(
-			vulkanengine_device_,
-			vertex_size,
-			vertex_count_,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
+		uint32_t position_stride = vertex_format_.GetPositionStride();
+		uint32_t attribute_stride = vertex_format_.GetAttributeStride();
+		auto* positions = static_cast<uint8_t*>(
+			BeginUpload(position_buffer_, position_stride, vertex_count_, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, uploads));
+		auto* attributes = static_cast<uint8_t*>(
+			BeginUpload(attribute_buffer_, attribute_stride, vertex_count_, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, uploads));
+
+		// Encode, then decode again to see what the shaders will actually get. Each vertex goes through a local
+		// copy, as the mapped memory may be write combined and is slow to read back
+		quantization_report_ = {};
+		double position_error_sum = 0.0;
+		for (uint32_t i = 0; i < vertex_count_; ++i)
+		{
+			const Vertex& vertex = vertices[i];
+			uint8_t position[VertexFormat::kMaxPositionStride];
+			uint8_t attribute[VertexFormat::kMaxAttributeStride];
+			vertex_format_.EncodePosition(vertex.position, bounds_min, bounds_max, position);
+			vertex_format_.EncodeAttributes(vertex.color, vertex.normal, vertex.uv, attribute);
+			memcpy(positions + static_cast<size_t>(position_stride) * i, position, position_stride);
+			memcpy(attributes + static_cast<size_t>(attribute_stride) * i, attribute, attribute_stride);
+
+			glm::vec3 decoded_color, decoded_normal;
+			glm::vec2 decoded_uv;
+			glm::vec3 decoded_position = vertex_format_.DecodePosition(position, bounds_min, bounds_max);
+			vertex_format_.DecodeAttributes(attribute, decoded_color, decoded_normal, decoded_uv);
+
+			float position_error = glm::length(decoded_position - vertex.position);
+			position_error_sum += position_error;
+			quantization_report_.max_position_error = std::max(quantization_report_.max_position_error, position_error);
+
+			glm::vec3 color_error = glm::abs(decoded_color - vertex.color);
+			quantization_report_.max_color_error = std::max({ quantization_report_.max_color_error, color_error.x, color_error.y, color_error.z });
+
+			glm::vec2 uv_error = glm::abs(decoded_uv - vertex.uv);
+			quantization_report_.max_uv_error = std::max({ quantization_report_.max_uv_error, uv_error.x, uv_error.y });
+
+			// models without normals carry zero vectors, which have no direction to lose
+			if (glm::length(vertex.normal) > 0.f)
+			{
+				float cos_angle = glm::clamp(glm::dot(glm::normalize(decoded_normal), glm::normalize(vertex.normal)), -1.f, 1.f);
+				quantization_report_.max_normal_error_degrees = std::max(quantization_report_.max_normal_error_degrees, glm::degrees(std::acos(cos_angle)));
+			}
+		}
+		quantization_report_.mean_position_error = static_cast<float>(position_error_sum / vertex_count_);
 
-		vulkanengine_device_.CopyBuffer(staging_buffer.GetBuffer(), vertex_buffer_->GetBuffer(), buffer_size);
+		memory_stats_.vertex_count = vertex_count_;
+		memory_stats_.position_bytes = static_cast<VkDeviceSize>(position_stride) * vertex_count_;
+		memory_stats_.attribute_bytes = static_cast<VkDeviceSize>(attribute_stride) * vertex_count_;
+		memory_stats_.uncompressed_vertex_bytes = static_cast<VkDeviceSize>(sizeof(Vertex)) * vertex_count_;
 	}
 
-	void VulkanEngineModel::CreateIndexBuffers(const std::vector<uint32_t>& indices)
+	void VulkanEngineModel::CreateIndexBuffers(const std::vector<uint32_t>& indices, std::vector<GeometryUpload>& uploads)
 	{
 		index_count_ = static_cast<uint32_t>(indices.size());
 		has_index_buffer_ = index_count_ > 0;
 
+		memory_stats_.index_count = index_count_;
+
 		if (!has_index_buffer_)
 		{
 			return;
 		}
 
-		VkDeviceSize buffer_size = sizeof(indices[0]) * index_count_;
+		// 0xFFFF stays free, it is the primitive restart value for 16 bit indices
+		if (vertex_count_ < std::numeric_limits<uint16_t>::max())
+		{
+			index_type_ = VK_INDEX_TYPE_UINT16;
+			memory_stats_.index_bytes = sizeof(uint16_t) * static_cast<VkDeviceSize>(index_count_);
+			auto* short_indices = static_cast<uint16_t*>(
+				BeginUpload(index_buffer_, sizeof(uint16_t), index_count_, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, uploads));
+			std::copy(indices.begin(), indices.end(), short_indices);
+			return;
+		}
+
+		index_type_ = VK_INDEX_TYPE_UINT32;
+		memory_stats_.index_bytes = sizeof(uint32_t) * static_cast<VkDeviceSize>(index_count_);
+		void* mapped = BeginUpload(index_buffer_, sizeof(indices[0]), index_count_, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, uploads);
+		memcpy(mapped, indices.data(), memory_stats_.index_bytes);
+	}
 
-		uint32_t index_size = sizeof(indices[0]);
-		VulkanEngineBuffer staging_buffer{
+	void* VulkanEngineModel::BeginUpload(
+		std::unique_ptr<VulkanEngineBuffer>& buffer,
+		uint32_t element_size,
+		uint32_t element_count,
+		VkBufferUsageFlags usage_flags,
+		std::vector<GeometryUpload>& uploads)
+	{
+		// geometry can be copied out again, for frame captures
+		usage_flags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		if (vulkanengine_device_.SupportsDirectUpload())
+		{
+			buffer = std::make_unique<VulkanEngineBuffer>(
+				vulkanengine_device_,
+				element_size,
+				element_count,
+				usage_flags,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+			buffer->Map();
+			uploads.push_back({ nullptr, buffer.get() });
+			return buffer->GetMappedMemory();
+		}
+
+		auto staging_buffer = std::make_unique<VulkanEngineBuffer>(
 			vulkanengine_device_,
-			index_size,
-			index_count_,
+			element_size,
+			element_count,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
-
-		staging_buffer.Map();
-		staging_buffer.WriteToBuffer((void*)indices.data());
+		);
+		staging_buffer->Map();
+		memory_stats_.staging_bytes += staging_buffer->GetBufferSize();
 
-		index_buffer_ = std::make_unique<VulkanEngineBuffer>(
+		buffer = std::make_unique<VulkanEngineBuffer>(
 			vulkanengine_device_,
-			index_size,
-			index_count_,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			element_size,
+			element_count,
+			usage_flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
 
-		vulkanengine_device_.CopyBuffer(staging_buffer.GetBuffer(), index_buffer_->GetBuffer(), buffer_size);
+		void* mapped = staging_buffer->GetMappedMemory();
+		uploads.push_back({ std::move(staging_buffer), buffer.get() });
+		return mapped;
+	}
+
+	void VulkanEngineModel::FinishUploads(std::vector<GeometryUpload>& uploads)
+	{
+		bool staged = std::any_of(uploads.begin(), uploads.end(), [](const GeometryUpload& upload) { return upload.staging != nullptr; });
+		if (staged)
+		{
+			VkCommandBuffer command_buffer = vulkanengine_device_.BeginSingleTimeCommands();
+			for (const auto& upload : uploads)
+			{
+				if (upload.staging)
+				{
+					VkBufferCopy copy_region{};
+					copy_region.size = upload.staging->GetBufferSize();
+					vkCmdCopyBuffer(command_buffer, upload.staging->GetBuffer(), upload.destination->GetBuffer(), 1, &copy_region);
+				}
+			}
+			vulkanengine_device_.EndSingleTimeCommands(command_buffer);
+		}
+
+		// coherent memory, so unmapping is all that is left for buffers written in place
+		for (auto& upload : uploads)
+		{
+			if (!upload.staging)
+			{
+				upload.destination->Unmap();
+			}
+		}
+		uploads.clear();
 	}
 
 	void VulkanEngineModel::Bind(VkCommandBuffer command_buffer)
 	{
-		VkBuffer buffers[] = { vertex_buffer_->GetBuffer() };
+		VkBuffer buffers[] = { position_buffer_->GetBuffer(), attribute_buffer_->GetBuffer() };
+		VkDeviceSize offsets[] = { 0, 0 };
+		vkCmdBindVertexBuffers(command_buffer, VertexFormat::kPositionBinding, 2, buffers, offsets);
+
+		if (has_index_buffer_)
+		{
+			vkCmdBindIndexBuffer(command_buffer, index_buffer_->GetBuffer(), 0, index_type_);
+		}
+	}
+
+	VulkanEngineModel::GeometryBuffers VulkanEngineModel::GetGeometryBuffers() const
+	{
+		GeometryBuffers buffers{};
+		buffers.position = position_buffer_.get();
+		buffers.attribute = attribute_buffer_.get();
+		buffers.index = has_index_buffer_ ? index_buffer_.get() : nullptr;
+		buffers.index_type = index_type_;
+		buffers.vertex_count = vertex_count_;
+		return buffers;
+	}
+
+	bool VulkanEngineModel::HasSameGeometry(const Builder& builder) const
+	{
+		std::vector<Lod> lods = builder.lods;
+		if (lods.empty())
+		{
+			lods.push_back({ 0, static_cast<uint32_t>(builder.indices.size()), 0.f });
+		}
+		bool same_lods = lods.size() == lods_.size() && std::equal(lods.begin(), lods.end(), lods_.begin(),
+			[](const Lod& a, const Lod& b) { return a.first_index == b.first_index && a.index_count == b.index_count && a.error == b.error; });
+		if (!(builder.vertex_format == vertex_format_) ||
+			builder.vertices.size() != vertex_count_ ||
+			builder.indices.size() != index_count_ ||
+			builder.meshlets.IsEmpty() != meshlets_.IsEmpty() ||
+			!same_lods)
+		{
+			return false;
+		}
+
+		// Vertices are compared as uploaded, after encoding
+		glm::vec3 bounds_min, bounds_max;
+		ComputeBounds(builder.vertices, bounds_min, bounds_max);
+		uint32_t position_stride = vertex_format_.GetPositionStride();
+		uint32_t attribute_stride = vertex_format_.GetAttributeStride();
+		std::vector<uint8_t> positions = ReadBack(*position_buffer_);
+		std::vector<uint8_t> attributes = ReadBack(*attribute_buffer_);
+		for (uint32_t i = 0; i < vertex_count_; ++i)
+		{
+			const Vertex& vertex = builder.vertices[i];
+			uint8_t position[VertexFormat::kMaxPositionStride];
+			uint8_t attribute[VertexFormat::kMaxAttributeStride];
+			vertex_format_.EncodePosition(vertex.position, bounds_min, bounds_max, position);
+			vertex_format_.EncodeAttributes(vertex.color, vertex.normal, vertex.uv, attribute);
+			if (memcmp(positions.data() + static_cast<size_t>(position_stride) * i, position, position_stride) != 0 ||
+				memcmp(attributes.data() + static_cast<size_t>(attribute_stride) * i, attribute, attribute_stride) != 0)
+			{
+				return false;
+			}
+		}
+
+		if (!has_index_buffer_)
+		{
+			return true;
+		}
+		std::vector<uint8_t> indices = ReadBack(*index_buffer_);
+		for (uint32_t i = 0; i < index_count_; ++i)
+		{
+			uint32_t index;
+			if (index_type_ == VK_INDEX_TYPE_UINT16)
+			{
+				uint16_t short_index;
+				memcpy(&short_index, indices.data() + sizeof(uint16_t) * i, sizeof(uint16_t));
+				index = short_index;
+			}
+			else
+			{
+				memcpy(&index, indices.data() + sizeof(uint32_t) * i, sizeof(uint32_t));
+			}
+			if (index != builder.indices[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The buffers were created with TRANSFER_SRC usage, see BeginUpload
+	std::vector<uint8_t> VulkanEngineModel::ReadBack(const VulkanEngineBuffer& buffer) const
+	{
+		VulkanEngineBuffer readback_buffer{
+			vulkanengine_device_,
+			buffer.GetBufferSize(),
+			1,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		vulkanengine_device_.CopyBuffer(buffer.GetBuffer(), readback_buffer.GetBuffer(), buffer.GetBufferSize());
+
+		readback_buffer.Map();
+		const uint8_t* mapped = static_cast<const uint8_t*>(readback_buffer.GetMappedMemory());
+		return std::vector<uint8_t>(mapped, mapped + buffer.GetBufferSize());
+	}
+
+	void VulkanEngineModel::BindPositions(VkCommandBuffer command_buffer)
+	{
+		VkBuffer buffers[] = { position_buffer_->GetBuffer() };
 		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+		vkCmdBindVertexBuffers(command_buffer, VertexFormat::kPositionBinding, 1, buffers, offsets);
 
 		if (has_index_buffer_)
 		{
-			vkCmdBindIndexBuffer(command_buffer, index_buffer_->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(command_buffer, index_buffer_->GetBuffer(), 0, index_type_);
 		}
 	}
 
-	void VulkanEngineModel::Draw(VkCommandBuffer command_buffer)
+	void VulkanEngineModel::Draw(VkCommandBuffer command_buffer, uint32_t lod)
 	{
 		if (has_index_buffer_)
 		{
-			vkCmdDrawIndexed(command_buffer, index_count_, 1, 0, 0, 0);
+			assert(lod < lods_.size() && "LOD out of range");
+			vkCmdDrawIndexed(command_buffer, lods_[lod].index_count, 1, lods_[lod].first_index, 0, 0);
 		}
 		else
 		{
@@ -133,25 +397,46 @@ namespace vulkanengine
 		}
 	}
 
-	std::vector<VkVertexInputBindingDescription> VulkanEngineModel::Vertex::GetBindingDescriptions()
+	void VulkanEngineModel::DrawIndirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, uint32_t draw_count)
+	{
+		assert(has_index_buffer_ && "Indirect draws go through the index buffer");
+		constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		if (vulkanengine_device_.SupportsMultiDrawIndirect())
+		{
+			vkCmdDrawIndexedIndirect(command_buffer, buffer, offset, draw_count, stride);
+			return;
+		}
+		for (uint32_t i = 0; i < draw_count; ++i)
+		{
+			vkCmdDrawIndexedIndirect(command_buffer, buffer, offset + static_cast<VkDeviceSize>(stride) * i, 1, stride);
+		}
+	}
+
+	uint32_t VulkanEngineModel::GetTriangleCount(uint32_t lod) const
 	{
-		std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
-		binding_descriptions[0].binding = 0;
-		binding_descriptions[0].stride = sizeof(Vertex);
-		binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return binding_descriptions;
+		return has_index_buffer_ ? lods_[lod].index_count / 3 : vertex_count_ / 3;
 	}
 
-	std::vector<VkVertexInputAttributeDescription> VulkanEngineModel::Vertex::GetAttributeDescriptions()
+	uint32_t VulkanEngineModel::SelectLod(float screen_scale, float max_screen_error) const
 	{
-		std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
+		for (uint32_t lod = static_cast<uint32_t>(lods_.size()) - 1; lod > 0; --lod)
+		{
+			if (lods_[lod].error * screen_scale <= max_screen_error)
+			{
+				return lod;
+			}
+		}
+		return 0;
+	}
 
-		attribute_descriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
-		attribute_descriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
-		attribute_descriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
-		attribute_descriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
+	std::vector<VkVertexInputBindingDescription> VulkanEngineModel::Vertex::GetBindingDescriptions()
+	{
+		return VertexFormat::Full().GetBindingDescriptions();
+	}
 
-		return attribute_descriptions;
+	std::vector<VkVertexInputAttributeDescription> VulkanEngineModel::Vertex::GetAttributeDescriptions()
+	{
+		return VertexFormat::Full().GetAttributeDescriptions();
 	}
 
 	void VulkanEngineModel::Builder::LoadModel(const std::string& filepath)
@@ -218,4 +503,108 @@ namespace vulkanengine
 		}
 	}
 
+	void VulkanEngineModel::Builder::GenerateLods(uint32_t max_lod_count, float max_error)
+	{
+		assert(lods.empty() && "LODs have already been generated");
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		std::vector<glm::vec3> positions(vertices.size());
+		std::vector<glm::vec3> normals(vertices.size());
+		std::vector<glm::vec2> uvs(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			positions[i] = vertices[i].position;
+			normals[i] = vertices[i].normal;
+			uvs[i] = vertices[i].uv;
+		}
+		float extent = VulkanEngineMeshSimplifier::GetMeshExtent(indices, positions);
+
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+		std::vector<uint32_t> previous = indices;
+		float previous_error = 0.f;
+		while (lods.size() < max_lod_count)
+		{
+			// each LOD is simplified from the previous one, which is much cheaper than starting over;
+			// the errors are added up to stay conservative
+			size_t target_index_count = previous.size() / 6 * 3;
+			auto result = VulkanEngineMeshSimplifier::Simplify(previous, positions, normals, uvs, target_index_count, max_error - previous_error);
+
+			// not worth a LOD if the error budget stopped the simplifier early
+			if (result.indices.empty() || result.indices.size() > previous.size() * 9 / 10)
+			{
+				break;
+			}
+
+			previous_error += result.error;
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(result.indices.size()), previous_error * extent });
+			indices.insert(indices.end(), result.indices.begin(), result.indices.end());
+			previous = std::move(result.indices);
+		}
+
+		lod_build_milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - start_time).count();
+	}
+
+	void VulkanEngineModel::Builder::Optimize(float overdraw_threshold)
+	{
+		uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+		std::vector<Lod> ranges = lods.empty() ? std::vector<Lod>{ { 0, static_cast<uint32_t>(indices.size()), 0.f } } : lods;
+
+		std::vector<glm::vec3> positions{};
+		if (overdraw_threshold > 0.f)
+		{
+			positions.resize(vertices.size());
+			std::transform(vertices.begin(), vertices.end(), positions.begin(), [](const Vertex& vertex) { return vertex.position; });
+		}
+
+		optimization_report = {};
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			auto begin = indices.begin() + ranges[i].first_index;
+			std::vector<uint32_t> lod_indices(begin, begin + ranges[i].index_count);
+			if (i == 0)
+			{
+				optimization_report.before = VulkanEngineMeshOptimizer::AnalyzeVertexCache(lod_indices, vertex_count);
+			}
+
+			VulkanEngineMeshOptimizer::OptimizeVertexCache(lod_indices, vertex_count);
+			if (overdraw_threshold > 0.f)
+			{
+				bool applied = VulkanEngineMeshOptimizer::OptimizeOverdraw(lod_indices, positions, overdraw_threshold);
+				if (i == 0)
+				{
+					optimization_report.overdraw_order_applied = applied;
+				}
+			}
+			std::copy(lod_indices.begin(), lod_indices.end(), begin);
+		}
+
+		// LOD 0 comes first in the index buffer, so the fetch order follows the full mesh
+		std::vector<uint32_t> remap = VulkanEngineMeshOptimizer::OptimizeVertexFetch(indices, vertex_count);
+		VulkanEngineMeshOptimizer::RemapVertices(vertices, remap);
+
+		std::vector<uint32_t> lod0_indices(indices.begin(), indices.begin() + ranges[0].index_count);
+		optimization_report.after = VulkanEngineMeshOptimizer::AnalyzeVertexCache(lod0_indices, static_cast<uint32_t>(vertices.size()));
+	}
+
+	void VulkanEngineModel::Builder::BuildMeshlets(const std::string& cache_filepath)
+	{
+		uint32_t lod0_index_count = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].index_count;
+		std::vector<glm::vec3> positions(vertices.size());
+		std::transform(vertices.begin(), vertices.end(), positions.begin(), [](const Vertex& vertex) { return vertex.position; });
+
+		uint64_t source_hash = VulkanEngineMeshlets::ComputeSourceHash(indices, lod0_index_count, positions);
+		meshlets_from_cache = !cache_filepath.empty() && VulkanEngineMeshlets::Load(cache_filepath, source_hash, meshlets);
+		if (meshlets_from_cache)
+		{
+			return;
+		}
+
+		meshlets = VulkanEngineMeshlets::Build(indices, lod0_index_count, positions);
+		if (!cache_filepath.empty() && !meshlets.Save(cache_filepath, source_hash))
+		{
+			std::cerr << "meshlets: failed to write " << cache_filepath << std::endl;
+		}
+	}
+
 } // namespace vulkanengine
\ No newline at end of file
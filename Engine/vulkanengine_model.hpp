@@ -2,6 +2,9 @@
 
 #include "vulkanengine_buffer.hpp"
 #include "vulkanengine_device.hpp"
+#include "vulkanengine_mesh_optimizer.hpp"
+#include "vulkanengine_meshlets.hpp"
+#include "vulkanengine_vertex_format.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -9,6 +12,7 @@
 #include <glm/glm.hpp>
 
 // std
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -18,7 +22,8 @@ namespace vulkanengine
 	{
 	public:
 
-		// Make sure to change attribute descriptions when making changes to this struct!
+		// CPU side vertex as loaded; the GPU layout is decided by the model's VertexFormat.
+		// Make sure to update VertexFormat when making changes to this struct!
 		struct Vertex
 		{
 			glm::vec3 position;
@@ -39,12 +44,46 @@ namespace vulkanengine
 			}
 		};
 
+		// A range of the shared index buffer; every LOD draws from the same vertices
+		struct Lod
+		{
+			uint32_t first_index = 0;
+			uint32_t index_count = 0;
+			float error = 0.f;	// largest deviation from the full mesh, object space units
+		};
+
 		struct Builder
 		{
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
+			std::vector<Lod> lods{};	// empty: a single LOD covering all indices
+			VulkanEngineMeshlets meshlets{};	// of LOD 0, empty unless BuildMeshlets was called
+			bool meshlets_from_cache = false;
+			VertexFormat vertex_format{};
+			MeshOptimizationReport optimization_report{};
+			float lod_build_milliseconds = 0.f;
 
 			void LoadModel(const std::string& filepath);
+			// Appends up to [max_lod_count] - 1 simplified LODs to the indices, halving the triangle count each
+			// time, and stops early once a LOD would deviate by more than [max_error] of the mesh extent
+			void GenerateLods(uint32_t max_lod_count, float max_error);
+			// Reorders the triangles of every LOD for the vertex cache, then (if [overdraw_threshold] > 0) for
+			// overdraw, then renumbers vertices in fetch order. Fills optimization_report from LOD 0
+			void Optimize(float overdraw_threshold);
+			// Partitions LOD 0 into meshlets; call after Optimize, as meshlets follow the final index order.
+			// Reuses [cache_filepath] when it was saved for the same geometry, otherwise rebuilds and writes it
+			// (an empty path skips the cache)
+			void BuildMeshlets(const std::string& cache_filepath);
+		};
+
+		struct LoadOptions
+		{
+			VertexFormat vertex_format{};
+			bool optimize = true;
+			float overdraw_threshold = 1.05f;	// accepted ACMR growth for the overdraw order, 0 skips it
+			uint32_t lod_count = 1;				// including the full mesh
+			float lod_max_error = .02f;			// relative to the mesh extent
+			bool build_meshlets = false;		// cached next to the model as <filepath>.meshlets
 		};
 
 		VulkanEngineModel(VulkanEngineDevice& device, const VulkanEngineModel::Builder& builder);
@@ -54,21 +93,118 @@ namespace vulkanengine
 		VulkanEngineModel& operator=(const VulkanEngineModel&) = delete;
 
 		static std::unique_ptr<VulkanEngineModel> CreateModelFromFile(VulkanEngineDevice& device, const std::string& filepath);
+		static std::unique_ptr<VulkanEngineModel> CreateModelFromFile(
+			VulkanEngineDevice& device,
+			const std::string& filepath,
+			const LoadOptions& options);
+		// The CPU half of CreateModelFromFile (parsing, LODs, optimization, meshlets). Touches no Vulkan
+		// object, so it can run on any thread; the model is then created from the builder
+		static Builder LoadBuilderFromFile(const std::string& filepath, const LoadOptions& options);
 
 		void Bind(VkCommandBuffer command_buffer);
-		void Draw(VkCommandBuffer command_buffer);
+		// Binds only the position stream, for depth-only pipelines built from GetPositionAttributeDescriptions()
+		void BindPositions(VkCommandBuffer command_buffer);
+		void Draw(VkCommandBuffer command_buffer, uint32_t lod = 0);
+		// Draws [draw_count] VkDrawIndexedIndirectCommands from [buffer], e.g. the visible meshlet ranges
+		// from VulkanEngineMeshlets::Cull. Issues one call per command when multiDrawIndirect is missing
+		void DrawIndirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, uint32_t draw_count);
+		// Only indexed models can be drawn indirectly
+		bool HasIndexBuffer() const { return has_index_buffer_; }
+
+		uint32_t GetLodCount() const { return static_cast<uint32_t>(lods_.size()); }
+		const Lod& GetLod(uint32_t lod) const { return lods_[lod]; }
+		uint32_t GetTriangleCount(uint32_t lod = 0) const;
+		// Coarsest LOD whose error stays below [max_screen_error] once scaled by [screen_scale]
+		// (screen fraction per object space unit, see VulkanEngineCamera::GetProjectedScale)
+		uint32_t SelectLod(float screen_scale, float max_screen_error) const;
+		float GetLodBuildMilliseconds() const { return lod_build_milliseconds_; }
+
+		bool HasMeshlets() const { return !meshlets_.IsEmpty(); }
+		const VulkanEngineMeshlets& GetMeshlets() const { return meshlets_; }
+		bool AreMeshletsFromCache() const { return meshlets_from_cache_; }
+
+		// Object space bounding sphere of the full mesh
+		const glm::vec3& GetBoundingSphereCenter() const { return bounding_sphere_center_; }
+		float GetBoundingSphereRadius() const { return bounding_sphere_radius_; }
+
+		const VertexFormat& GetVertexFormat() const { return vertex_format_; }
+		// Has to be applied on top of the model matrix, as snorm16 positions are stored relative to the mesh bounds
+		const glm::mat4& GetPositionDequantization() const { return position_dequantization_; }
+		const VertexMemoryStats& GetMemoryStats() const { return memory_stats_; }
+		const QuantizationReport& GetQuantizationReport() const { return quantization_report_; }
+		const MeshOptimizationReport& GetOptimizationReport() const { return optimization_report_; }
+
+		// The buffers Bind() binds, for tools that copy the geometry out (VulkanEngineCommandCapture).
+		// [index] is null for models drawn without an index buffer
+		struct GeometryBuffers
+		{
+			const VulkanEngineBuffer* position = nullptr;
+			const VulkanEngineBuffer* attribute = nullptr;
+			const VulkanEngineBuffer* index = nullptr;
+			VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+			uint32_t vertex_count = 0;
+		};
+		GeometryBuffers GetGeometryBuffers() const;
+
+		// True when a model built from [builder] would upload exactly this model's buffers and LODs. Reads the
+		// buffers back and waits for the copy, so keep it for rare checks such as confirming a hash match
+		bool HasSameGeometry(const Builder& builder) const;
 
 	private:
-		void CreateVertexBuffers(const std::vector<Vertex>& vertices);
-		void CreateIndexBuffers(const std::vector<uint32_t>& indices);
+		// A device local buffer whose contents are being written. [staging] is null when the buffer itself
+		// is host visible (see VulkanEngineDevice::SupportsDirectUpload)
+		struct GeometryUpload
+		{
+			std::unique_ptr<VulkanEngineBuffer> staging;
+			VulkanEngineBuffer* destination = nullptr;
+		};
+
+		static void ComputeBounds(const std::vector<Vertex>& vertices, glm::vec3& bounds_min, glm::vec3& bounds_max);
+		std::vector<uint8_t> ReadBack(const VulkanEngineBuffer& buffer) const;
+		void CreateVertexBuffers(const std::vector<Vertex>& vertices, std::vector<GeometryUpload>& uploads);
+		void CreateIndexBuffers(const std::vector<uint32_t>& indices, std::vector<GeometryUpload>& uploads);
+		// Creates [buffer] and returns mapped memory to write its contents to, either the buffer's own or
+		// that of a staging buffer; nothing reaches the GPU before FinishUploads
+		void* BeginUpload(
+			std::unique_ptr<VulkanEngineBuffer>& buffer,
+			uint32_t element_size,
+			uint32_t element_count,
+			VkBufferUsageFlags usage_flags,
+			std::vector<GeometryUpload>& uploads);
+		// Records all staged copies into one command buffer and waits for it once
+		void FinishUploads(std::vector<GeometryUpload>& uploads);
 
 		VulkanEngineDevice& vulkanengine_device_;
 
-		std::unique_ptr<VulkanEngineBuffer> vertex_buffer_;
+		VertexFormat vertex_format_;
+		glm::mat4 position_dequantization_{ 1.f };
+		glm::vec3 bounding_sphere_center_{ 0.f };
+		float bounding_sphere_radius_ = 0.f;
+		std::unique_ptr<VulkanEngineBuffer> position_buffer_;
+		std::unique_ptr<VulkanEngineBuffer> attribute_buffer_;
 		uint32_t vertex_count_;
 
 		bool has_index_buffer_ = false;
 		std::unique_ptr<VulkanEngineBuffer> index_buffer_;
 		uint32_t index_count_;
+		VkIndexType index_type_ = VK_INDEX_TYPE_UINT32;	// UINT16 whenever the vertex count allows
+		std::vector<Lod> lods_;
+		float lod_build_milliseconds_ = 0.f;
+		VulkanEngineMeshlets meshlets_;
+		bool meshlets_from_cache_ = false;
+
+		VertexMemoryStats memory_stats_{};
+		QuantizationReport quantization_report_{};
+		MeshOptimizationReport optimization_report_{};
+	};
+} // namespace vulkanengine
+
+namespace std
+{
+	// Welds identical vertices while loading; exposed for the micro-benchmarks
+	template <>
+	struct hash<vulkanengine::VulkanEngineModel::Vertex>
+	{
+		size_t operator()(const vulkanengine::VulkanEngineModel::Vertex& vertex) const;
 	};
-} // namespace vulkanengine
\ No newline at end of file
+} // namespace std
\ No newline at end of file
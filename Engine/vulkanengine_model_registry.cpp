@@ -0,0 +1,161 @@
+#include "vulkanengine_model_registry.hpp"
+
+#include "vulkanengine_utils.hpp"
+
+// std
+#include <cstring>
+
+namespace vulkanengine
+{
+	template <typename T>
+	static void AppendBytes(std::string& key, const T& value)
+	{
+		char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		key.append(bytes, sizeof(T));
+	}
+
+	VulkanEngineModelRegistry::VulkanEngineModelRegistry(VulkanEngineDevice& device)
+		: vulkanengine_device_{ device }
+	{
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineModelRegistry::Load(const std::string& filepath)
+	{
+		return Load(filepath, VulkanEngineModel::LoadOptions{});
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineModelRegistry::Load(
+		const std::string& filepath,
+		const VulkanEngineModel::LoadOptions& options)
+	{
+		++stats_.request_count;
+
+		std::string key = BuildKey(filepath, options);
+		if (auto model = FindByKey(key))
+		{
+			return model;
+		}
+		return Insert(key, VulkanEngineModel::LoadBuilderFromFile(filepath, options));
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineModelRegistry::CreateFromBuilder(
+		const std::string& filepath,
+		const VulkanEngineModel::LoadOptions& options,
+		const VulkanEngineModel::Builder& builder)
+	{
+		++stats_.request_count;
+
+		std::string key = BuildKey(filepath, options);
+		if (auto model = FindByKey(key))
+		{
+			return model;
+		}
+		return Insert(key, builder);
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineModelRegistry::FindByKey(const std::string& key)
+	{
+		auto it = models_by_key_.find(key);
+		if (it == models_by_key_.end())
+		{
+			return nullptr;
+		}
+
+		auto model = it->second.lock();
+		if (!model)
+		{
+			models_by_key_.erase(it);
+			return nullptr;
+		}
+		++stats_.path_hit_count;
+		RecordHit(*model);
+		return model;
+	}
+
+	std::shared_ptr<VulkanEngineModel> VulkanEngineModelRegistry::Insert(const std::string& key, const VulkanEngineModel::Builder& builder)
+	{
+		uint64_t content_hash = 0;
+		if (content_deduplication_)
+		{
+			content_hash = HashContent(builder);
+			// expired entries are dropped on the way, so evicted models don't pile up
+			auto range = models_by_content_.equal_range(content_hash);
+			for (auto content_it = range.first; content_it != range.second;)
+			{
+				auto model = content_it->second.lock();
+				if (!model)
+				{
+					content_it = models_by_content_.erase(content_it);
+					continue;
+				}
+				if (model->HasSameGeometry(builder))
+				{
+					++stats_.content_hit_count;
+					RecordHit(*model);
+					models_by_key_[key] = model;
+					return model;
+				}
+				++content_it;
+			}
+		}
+
+		auto model = std::make_shared<VulkanEngineModel>(vulkanengine_device_, builder);
+		++stats_.load_count;
+		models_by_key_[key] = model;
+		if (content_deduplication_)
+		{
+			models_by_content_.emplace(content_hash, model);
+		}
+		return model;
+	}
+
+	size_t VulkanEngineModelRegistry::GetLiveModelCount()
+	{
+		for (auto it = models_by_key_.begin(); it != models_by_key_.end();)
+		{
+			it = it->second.expired() ? models_by_key_.erase(it) : std::next(it);
+		}
+		for (auto it = models_by_content_.begin(); it != models_by_content_.end();)
+		{
+			it = it->second.expired() ? models_by_content_.erase(it) : std::next(it);
+		}
+
+		// several paths may share one model, the content map has each model once
+		if (content_deduplication_)
+		{
+			return models_by_content_.size();
+		}
+		return models_by_key_.size();
+	}
+
+	std::string VulkanEngineModelRegistry::BuildKey(const std::string& filepath, const VulkanEngineModel::LoadOptions& options)
+	{
+		std::string key = filepath;
+		key.push_back('\0');
+		AppendBytes(key, options.vertex_format.GetKey());
+		AppendBytes(key, options.optimize);
+		AppendBytes(key, options.overdraw_threshold);
+		AppendBytes(key, options.lod_count);
+		AppendBytes(key, options.lod_max_error);
+		AppendBytes(key, options.build_meshlets);
+		return key;
+	}
+
+	// Everything the GPU buffers are made of; meshlets are derived from these and not hashed separately
+	uint64_t VulkanEngineModelRegistry::HashContent(const VulkanEngineModel::Builder& builder)
+	{
+		uint32_t format_key = builder.vertex_format.GetKey();
+		uint64_t hash = HashBytes(&format_key, sizeof(format_key));
+		hash = HashBytes(builder.vertices.data(), sizeof(VulkanEngineModel::Vertex) * builder.vertices.size(), hash);
+		hash = HashBytes(builder.indices.data(), sizeof(uint32_t) * builder.indices.size(), hash);
+		hash = HashBytes(builder.lods.data(), sizeof(VulkanEngineModel::Lod) * builder.lods.size(), hash);
+		bool has_meshlets = !builder.meshlets.IsEmpty();
+		return HashBytes(&has_meshlets, sizeof(has_meshlets), hash);
+	}
+
+	void VulkanEngineModelRegistry::RecordHit(const VulkanEngineModel& model)
+	{
+		stats_.bytes_saved += model.GetMemoryStats().GetTotalBytes();
+	}
+}  // namespace vulkanengine
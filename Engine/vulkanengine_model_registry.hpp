@@ -0,0 +1,66 @@
+#pragma once
+
+#include "vulkanengine_device.hpp"
+#include "vulkanengine_model.hpp"
+
+// std
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace vulkanengine
+{
+	// Hands out shared models instead of loading a file once per placement. Entries are weak, so a model
+	// is freed as soon as the last object using it lets go, and loading it again afterwards reads the file again.
+	// A path is only loaded once per set of LoadOptions. With content deduplication, a file whose processed
+	// vertices and indices match a live model (e.g. a copy under another name) shares that model's buffers
+	// as well; the file still has to be parsed to find out. Content is matched by hash first, then confirmed
+	// against the live model's own buffers (see VulkanEngineModel::HasSameGeometry). Main thread only
+	class VulkanEngineModelRegistry
+	{
+	public:
+		struct Stats
+		{
+			uint32_t request_count = 0;
+			uint32_t path_hit_count = 0;		// same path and options as a live model
+			uint32_t content_hit_count = 0;		// different path, identical geometry
+			uint32_t load_count = 0;			// models actually created
+			VkDeviceSize bytes_saved = 0;		// GPU memory the hits would have taken as separate models
+		};
+
+		VulkanEngineModelRegistry(VulkanEngineDevice& device);
+
+		VulkanEngineModelRegistry(const VulkanEngineModelRegistry&) = delete;
+		VulkanEngineModelRegistry& operator=(const VulkanEngineModelRegistry&) = delete;
+
+		std::shared_ptr<VulkanEngineModel> Load(const std::string& filepath);
+		std::shared_ptr<VulkanEngineModel> Load(const std::string& filepath, const VulkanEngineModel::LoadOptions& options);
+		// For builders loaded elsewhere (see VulkanEngineAssetManager); [builder] must come from
+		// VulkanEngineModel::LoadBuilderFromFile(filepath, options)
+		std::shared_ptr<VulkanEngineModel> CreateFromBuilder(
+			const std::string& filepath,
+			const VulkanEngineModel::LoadOptions& options,
+			const VulkanEngineModel::Builder& builder);
+
+		void SetContentDeduplication(bool enabled) { content_deduplication_ = enabled; }
+
+		// Models still referenced from outside the registry; expired entries are dropped along the way
+		size_t GetLiveModelCount();
+		const Stats& GetStats() const { return stats_; }
+
+	private:
+		static std::string BuildKey(const std::string& filepath, const VulkanEngineModel::LoadOptions& options);
+		static uint64_t HashContent(const VulkanEngineModel::Builder& builder);
+		std::shared_ptr<VulkanEngineModel> FindByKey(const std::string& key);
+		std::shared_ptr<VulkanEngineModel> Insert(const std::string& key, const VulkanEngineModel::Builder& builder);
+		void RecordHit(const VulkanEngineModel& model);
+
+		VulkanEngineDevice& vulkanengine_device_;
+		bool content_deduplication_ = true;
+
+		std::unordered_map<std::string, std::weak_ptr<VulkanEngineModel>> models_by_key_;
+		// several models per hash only after a collision
+		std::unordered_multimap<uint64_t, std::weak_ptr<VulkanEngineModel>> models_by_content_;
+		Stats stats_{};
+	};
+}  // namespace vulkanengine
@@ -0,0 +1,421 @@
+#include "vulkanengine_occlusion_culler.hpp"
+
+#include "vulkanengine_pipeline.hpp"
+#include "vulkanengine_shader_reflection.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	// Mirrors the push constants of hiz_downsample.comp
+	struct PyramidPushConstants
+	{
+		glm::ivec2 source_size;
+		glm::ivec2 destination_size;
+	};
+
+	// candidates, drawn early, drawn late, and one spare to keep slices 16 bytes apart
+	static constexpr uint32_t kStatsWords = 4;
+
+	VulkanEngineOcclusionCuller::VulkanEngineOcclusionCuller(
+		VulkanEngineDevice& device,
+		VulkanEngineRingBuffer& ring_buffer,
+		uint32_t frame_count,
+		VulkanEngineBindlessSet* bindless_set)
+		: vulkanengine_device_{ device }, ring_buffer_{ ring_buffer }, frame_count_{ frame_count }, bindless_set_{ bindless_set }
+	{
+		assert(frame_count > 0 && "Occlusion culler needs at least one frame");
+		CreateBuffers();
+		CreatePipelines();
+
+		VkSamplerCreateInfo sampler_info{};
+		sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler_info.magFilter = VK_FILTER_NEAREST;
+		sampler_info.minFilter = VK_FILTER_NEAREST;
+		sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+		if (vkCreateSampler(vulkanengine_device_.Device(), &sampler_info, nullptr, &sampler_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create occlusion culling sampler!");
+		}
+
+		// one set per pyramid level and the culling set
+		descriptor_pool_ = VulkanEngineDescriptorPool::Builder(vulkanengine_device_)
+			.SetMaxSets(kMaxPyramidMipLevels + 1)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxPyramidMipLevels + 1)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kMaxPyramidMipLevels)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3)
+			.Build();
+	}
+
+	VulkanEngineOcclusionCuller::~VulkanEngineOcclusionCuller()
+	{
+		if (pyramid_image_index_ != VulkanEngineBindlessSet::kInvalidIndex)
+		{
+			bindless_set_->ReleaseImage(pyramid_image_index_);
+		}
+		DestroyPyramidViews();
+		vkDestroySampler(vulkanengine_device_.Device(), sampler_, nullptr);
+		vkDestroyPipeline(vulkanengine_device_.Device(), cull_pipeline_, nullptr);
+		vkDestroyPipeline(vulkanengine_device_.Device(), pyramid_pipeline_, nullptr);
+		vkDestroyPipelineLayout(vulkanengine_device_.Device(), cull_pipeline_layout_, nullptr);
+		vkDestroyPipelineLayout(vulkanengine_device_.Device(), pyramid_pipeline_layout_, nullptr);
+	}
+
+	bool VulkanEngineOcclusionCuller::IsSupported(VulkanEngineDevice& device, VkFormat depth_format)
+	{
+		return device.SupportsFormatFeatures(depth_format, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+	}
+
+	VkExtent2D VulkanEngineOcclusionCuller::GetPyramidExtent(VkExtent2D depth_extent)
+	{
+		auto previous_power_of_two = [](uint32_t value) {
+			uint32_t result = 1;
+			while (result * 2 <= value)
+			{
+				result *= 2;
+			}
+			return result;
+		};
+		return { previous_power_of_two(depth_extent.width), previous_power_of_two(depth_extent.height) };
+	}
+
+	uint32_t VulkanEngineOcclusionCuller::GetPyramidMipLevels(VkExtent2D pyramid_extent)
+	{
+		uint32_t levels = 1;
+		uint32_t size = std::max(pyramid_extent.width, pyramid_extent.height);
+		while (size > 1 && levels < kMaxPyramidMipLevels)
+		{
+			size /= 2;
+			++levels;
+		}
+		return levels;
+	}
+
+	void VulkanEngineOcclusionCuller::CreateBuffers()
+	{
+		// Nothing was visible before the first frame: the early phase draws nothing and the late phase,
+		// testing against an empty pyramid, everything
+		visibility_buffer_ = std::make_unique<VulkanEngineBuffer>(
+			vulkanengine_device_,
+			sizeof(uint32_t),
+			kVisibilitySlotCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VkCommandBuffer command_buffer = vulkanengine_device_.BeginSingleTimeCommands();
+		vkCmdFillBuffer(command_buffer, visibility_buffer_->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+		vulkanengine_device_.EndSingleTimeCommands(command_buffer);
+
+		// read back a frame in flight later, like the GPU profiler's queries
+		stats_buffer_ = std::make_unique<VulkanEngineBuffer>(
+			vulkanengine_device_,
+			sizeof(uint32_t) * kStatsWords,
+			frame_count_,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (stats_buffer_->Map() != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map occlusion culling stats buffer!");
+		}
+		memset(stats_buffer_->GetMappedMemory(), 0, static_cast<size_t>(stats_buffer_->GetBufferSize()));
+		stats_pending_.assign(frame_count_, false);
+	}
+
+	void VulkanEngineOcclusionCuller::CreatePipelines()
+	{
+		const std::string cull_filepath = bindless_set_ ? "Shaders/occlusion_cull_bindless.comp.spv" : "Shaders/occlusion_cull.comp.spv";
+		auto cull_reflection = VulkanEngineShaderReflection::FromFile(cull_filepath);
+		VulkanEngineShaderReflection::VerifyBlock(
+			cull_reflection.GetPushConstantBlock(),
+			{
+				offsetof(CullPushConstants, projection),
+				offsetof(CullPushConstants, pyramid_size),
+				offsetof(CullPushConstants, near_plane),
+				offsetof(CullPushConstants, pyramid_levels),
+				offsetof(CullPushConstants, late_phase),
+				offsetof(CullPushConstants, candidate_offset),
+				offsetof(CullPushConstants, candidate_count),
+				offsetof(CullPushConstants, command_offset),
+				offsetof(CullPushConstants, command_count),
+				offsetof(CullPushConstants, stats_offset),
+				offsetof(CullPushConstants, pyramid_image)
+			},
+			sizeof(CullPushConstants));
+		auto pyramid_reflection = VulkanEngineShaderReflection::FromFile("Shaders/hiz_downsample.comp.spv");
+		VulkanEngineShaderReflection::VerifyBlock(
+			pyramid_reflection.GetPushConstantBlock(),
+			{
+				offsetof(PyramidPushConstants, source_size),
+				offsetof(PyramidPushConstants, destination_size)
+			},
+			sizeof(PyramidPushConstants));
+
+		cull_set_layout_ = cull_reflection.SetLayoutBuilder(vulkanengine_device_, 0).Build();
+		pyramid_set_layout_ = pyramid_reflection.SetLayoutBuilder(vulkanengine_device_, 0).Build();
+
+		auto create_layout = [this](const std::vector<VkDescriptorSetLayout>& set_layouts, const VkPushConstantRange& push_constant_range) {
+			VkPipelineLayoutCreateInfo pipeline_layout_info{};
+			pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+			pipeline_layout_info.pSetLayouts = set_layouts.data();
+			pipeline_layout_info.pushConstantRangeCount = 1;
+			pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+			VkPipelineLayout pipeline_layout;
+			if (vkCreatePipelineLayout(vulkanengine_device_.Device(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create occlusion culling pipeline layout!");
+			}
+			return pipeline_layout;
+		};
+		std::vector<VkDescriptorSetLayout> cull_set_layouts{ cull_set_layout_->GetDescriptorSetLayout() };
+		if (bindless_set_)
+		{
+			static_assert(VulkanEngineBindlessSet::kSet == 1, "The bindless set follows the culling set");
+			cull_set_layouts.push_back(bindless_set_->GetDescriptorSetLayout());
+		}
+		cull_pipeline_layout_ = create_layout(cull_set_layouts, cull_reflection.GetPushConstantRange());
+		pyramid_pipeline_layout_ = create_layout({ pyramid_set_layout_->GetDescriptorSetLayout() }, pyramid_reflection.GetPushConstantRange());
+
+		cull_pipeline_ = CreateComputePipeline(cull_filepath, cull_pipeline_layout_);
+		pyramid_pipeline_ = CreateComputePipeline("Shaders/hiz_downsample.comp.spv", pyramid_pipeline_layout_);
+	}
+
+	VkPipeline VulkanEngineOcclusionCuller::CreateComputePipeline(const std::string& filepath, VkPipelineLayout pipeline_layout)
+	{
+		VkShaderModule shader_module;
+		VulkanEnginePipeline::CreateShaderModule(vulkanengine_device_, VulkanEnginePipeline::ReadFile(filepath), &shader_module);
+
+		VkComputePipelineCreateInfo pipeline_info{};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_info.stage.module = shader_module;
+		pipeline_info.stage.pName = "main";
+		pipeline_info.layout = pipeline_layout;
+
+		VkPipeline pipeline;
+		VkResult result = vkCreateComputePipelines(vulkanengine_device_.Device(), vulkanengine_device_.PipelineCache(), 1, &pipeline_info, nullptr, &pipeline);
+		vkDestroyShaderModule(vulkanengine_device_.Device(), shader_module, nullptr);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create compute pipeline " + filepath + "!");
+		}
+		return pipeline;
+	}
+
+	void VulkanEngineOcclusionCuller::DestroyPyramidViews()
+	{
+		for (VkImageView view : pyramid_mip_views_)
+		{
+			vkDestroyImageView(vulkanengine_device_.Device(), view, nullptr);
+		}
+		pyramid_mip_views_.clear();
+	}
+
+	void VulkanEngineOcclusionCuller::SetTargets(VkImageView depth_view, VkExtent2D depth_extent, VkImage pyramid, VkImageView pyramid_view)
+	{
+		DestroyPyramidViews();
+		descriptor_pool_->ResetPool();
+		pyramid_sets_.clear();
+
+		pyramid_ = pyramid;
+		depth_extent_ = depth_extent;
+		pyramid_extent_ = GetPyramidExtent(depth_extent);
+		pyramid_mip_levels_ = GetPyramidMipLevels(pyramid_extent_);
+
+		for (uint32_t level = 0; level < pyramid_mip_levels_; ++level)
+		{
+			VkImageViewCreateInfo view_info{};
+			view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			view_info.image = pyramid_;
+			view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			view_info.format = kPyramidFormat;
+			view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			view_info.subresourceRange.baseMipLevel = level;
+			view_info.subresourceRange.levelCount = 1;
+			view_info.subresourceRange.baseArrayLayer = 0;
+			view_info.subresourceRange.layerCount = 1;
+			VkImageView view;
+			if (vkCreateImageView(vulkanengine_device_.Device(), &view_info, nullptr, &view) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create depth pyramid view!");
+			}
+			pyramid_mip_views_.push_back(view);
+		}
+
+		// level 0 reads the depth buffer, every other level the one above it, which the same pass just wrote
+		for (uint32_t level = 0; level < pyramid_mip_levels_; ++level)
+		{
+			VkDescriptorImageInfo source_info{
+				sampler_,
+				level == 0 ? depth_view : pyramid_mip_views_[level - 1],
+				level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL };
+			VkDescriptorImageInfo destination_info{ VK_NULL_HANDLE, pyramid_mip_views_[level], VK_IMAGE_LAYOUT_GENERAL };
+			VkDescriptorSet set;
+			if (!VulkanEngineDescriptorWriter(*pyramid_set_layout_, *descriptor_pool_)
+				.WriteImage(0, &source_info)
+				.WriteImage(1, &destination_info)
+				.Build(set))
+			{
+				throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+			}
+			pyramid_sets_.push_back(set);
+		}
+
+		// the candidates and commands move every frame, so the whole ring buffer is bound and the push
+		// constants point into it
+		VkDescriptorBufferInfo ring_info{ ring_buffer_.GetBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo visibility_info = visibility_buffer_->DescriptorInfo();
+		VkDescriptorBufferInfo stats_info = stats_buffer_->DescriptorInfo();
+		VkDescriptorImageInfo pyramid_info{ sampler_, pyramid_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VulkanEngineDescriptorWriter writer{ *cull_set_layout_, *descriptor_pool_ };
+		writer.WriteBuffer(0, &ring_info)
+			.WriteBuffer(1, &visibility_info)
+			.WriteBuffer(2, &stats_info);
+		if (bindless_set_)
+		{
+			// the device is idle, so the slot can be rewritten in place
+			if (pyramid_image_index_ == VulkanEngineBindlessSet::kInvalidIndex)
+			{
+				pyramid_image_index_ = bindless_set_->RegisterImage(pyramid_info);
+			}
+			else
+			{
+				bindless_set_->UpdateImage(pyramid_image_index_, pyramid_info);
+			}
+		}
+		else
+		{
+			writer.WriteImage(3, &pyramid_info);
+		}
+		if (!writer.Build(cull_set_))
+		{
+			throw std::runtime_error("failed to allocate occlusion culling descriptor set!");
+		}
+	}
+
+	void VulkanEngineOcclusionCuller::BeginFrame(int frame_index)
+	{
+		assert(frame_index >= 0 && static_cast<uint32_t>(frame_index) < frame_count_ && "Frame index out of range");
+		frame_index_ = frame_index;
+		cull_push_.candidate_count = 0;
+
+		uint32_t* counters = static_cast<uint32_t*>(stats_buffer_->GetMappedMemory()) + frame_index * kStatsWords;
+		if (stats_pending_[frame_index])
+		{
+			stats_.candidate_count = counters[0];
+			stats_.early_draw_count = counters[1];
+			stats_.late_draw_count = counters[2];
+			stats_pending_[frame_index] = false;
+		}
+		memset(counters, 0, sizeof(uint32_t) * kStatsWords);
+	}
+
+	void VulkanEngineOcclusionCuller::SetCandidates(
+		const VulkanEngineCamera& camera,
+		uint32_t candidate_offset,
+		uint32_t candidate_count,
+		uint32_t command_offset,
+		uint32_t command_count)
+	{
+		assert(candidate_offset % sizeof(uint32_t) == 0 && command_offset % sizeof(uint32_t) == 0 && "Ring buffer allocations are word aligned");
+
+		const glm::mat4& projection = camera.GetProjection();
+		// the sphere projection only holds for perspective projections (w = view space z)
+		bool perspective = projection[2][3] != 0.f;
+		cull_push_.projection = { projection[0][0], projection[1][1], projection[2][2], projection[3][2] };
+		cull_push_.pyramid_size = { static_cast<float>(pyramid_extent_.width), static_cast<float>(pyramid_extent_.height) };
+		cull_push_.near_plane = perspective ? -projection[3][2] / projection[2][2] : 0.f;
+		cull_push_.pyramid_levels = perspective ? pyramid_mip_levels_ : 0;
+		cull_push_.candidate_offset = candidate_offset / sizeof(uint32_t);
+		cull_push_.candidate_count = candidate_count;
+		cull_push_.command_offset = command_offset / sizeof(uint32_t);
+		cull_push_.command_count = command_count;
+		cull_push_.stats_offset = static_cast<uint32_t>(frame_index_) * kStatsWords;
+		cull_push_.pyramid_image = pyramid_image_index_;
+	}
+
+	void VulkanEngineOcclusionCuller::Cull(VkCommandBuffer command_buffer, Phase phase)
+	{
+		assert(cull_set_ != VK_NULL_HANDLE && "SetTargets has to be called before culling");
+		if (cull_push_.candidate_count == 0)
+		{
+			return;
+		}
+
+		cull_push_.late_phase = phase == Phase::kLate ? 1 : 0;
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_);
+		std::array<VkDescriptorSet, 2> sets{ cull_set_, bindless_set_ ? bindless_set_->GetDescriptorSet() : VK_NULL_HANDLE };
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout_, 0, bindless_set_ ? 2 : 1, sets.data(), 0, nullptr);
+		vkCmdPushConstants(command_buffer, cull_pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &cull_push_);
+		vkCmdDispatch(command_buffer, (cull_push_.candidate_count + OCCLUSION_WORKGROUP_SIZE - 1) / OCCLUSION_WORKGROUP_SIZE, 1, 1);
+
+		if (phase == Phase::kLate)
+		{
+			// the counters are read on the CPU once this frame's fence comes around again
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			stats_pending_[frame_index_] = true;
+		}
+	}
+
+	void VulkanEngineOcclusionCuller::BuildPyramid(VkCommandBuffer command_buffer)
+	{
+		assert(!pyramid_sets_.empty() && "SetTargets has to be called before building the pyramid");
+
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid_pipeline_);
+		VkExtent2D source_extent = depth_extent_;
+		VkExtent2D level_extent = pyramid_extent_;
+		for (uint32_t level = 0; level < pyramid_mip_levels_; ++level)
+		{
+			if (level > 0)
+			{
+				// the level above is complete before this one reads it
+				VkImageMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = pyramid_;
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1 };
+				vkCmdPipelineBarrier(
+					command_buffer,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0,
+					0, nullptr,
+					0, nullptr,
+					1, &barrier);
+			}
+
+			PyramidPushConstants push{};
+			push.source_size = { static_cast<int32_t>(source_extent.width), static_cast<int32_t>(source_extent.height) };
+			push.destination_size = { static_cast<int32_t>(level_extent.width), static_cast<int32_t>(level_extent.height) };
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid_pipeline_layout_, 0, 1, &pyramid_sets_[level], 0, nullptr);
+			vkCmdPushConstants(command_buffer, pyramid_pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidPushConstants), &push);
+			vkCmdDispatch(
+				command_buffer,
+				(level_extent.width + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE,
+				(level_extent.height + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE,
+				1);
+
+			source_extent = level_extent;
+			level_extent = { std::max(level_extent.width / 2, 1u), std::max(level_extent.height / 2, 1u) };
+		}
+	}
+}  // namespace vulkanengine
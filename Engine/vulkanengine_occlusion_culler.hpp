@@ -0,0 +1,169 @@
+#pragma once
+
+#include "vulkanengine_bindless.hpp"
+#include "vulkanengine_buffer.hpp"
+#include "vulkanengine_camera.hpp"
+#include "vulkanengine_descriptors.hpp"
+#include "vulkanengine_device.hpp"
+#include "vulkanengine_ring_buffer.hpp"
+#include "Shaders/shader_shared.h"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Two phase occlusion culling against a hierarchical depth buffer (HiZ). A render system hands over the
+	// objects that survived its CPU culling as candidates. Each has a view space bounding sphere and a range of
+	// indirect draw commands in the frame's ring buffer, stored twice: an early copy, then a late copy. The
+	// compute passes only write the commands' instance counts, so the CPU never waits for a result:
+	//   Cull(kEarly)	outside a render pass; the early copy draws what was visible last frame
+	//   (early render pass)
+	//   BuildPyramid	the farthest depth per texel, level by level, from the early pass's depth buffer
+	//   Cull(kLate)	tests every candidate against the pyramid; the late copy draws what turned visible,
+	//					and the visibility is kept for the next frame
+	//   (late render pass, loading what the early pass drew)
+	// The pyramid lives in the frame's render graph, see GetPyramidExtent and GetPyramidMipLevels
+	class VulkanEngineOcclusionCuller
+	{
+	public:
+		enum class Phase
+		{
+			kEarly,
+			kLate,
+		};
+
+		static constexpr VkFormat kPyramidFormat = VK_FORMAT_R32_SFLOAT;
+		static constexpr uint32_t kMaxPyramidMipLevels = 16;
+		// Visibility is kept per game object id below this; other objects are always drawn early
+		static constexpr uint32_t kVisibilitySlotCount = 1u << 16;
+		static constexpr uint32_t kNoVisibilitySlot = OCCLUSION_NO_VISIBILITY_SLOT;
+
+		// Mirrors the candidate layout occlusion_cull.comp reads
+		struct Candidate
+		{
+			glm::vec4 view_sphere;		// view space center, radius
+			uint32_t first_command;		// into each copy of the commands
+			uint32_t command_count;
+			uint32_t visibility_slot;
+			uint32_t padding = 0;
+		};
+
+		// Of the latest frame whose results came back, a few frames behind the one being recorded
+		struct Stats
+		{
+			uint32_t candidate_count = 0;
+			uint32_t early_draw_count = 0;	// visible last frame
+			uint32_t late_draw_count = 0;	// turned visible
+			uint32_t GetOccludedCount() const { return candidate_count - early_draw_count - late_draw_count; }
+		};
+
+		// [ring_buffer] holds the candidates and commands and needs STORAGE_BUFFER and INDIRECT_BUFFER usage.
+		// With a [bindless_set], the culling shader samples the pyramid as one of its images
+		VulkanEngineOcclusionCuller(
+			VulkanEngineDevice& device,
+			VulkanEngineRingBuffer& ring_buffer,
+			uint32_t frame_count,
+			VulkanEngineBindlessSet* bindless_set = nullptr);
+		~VulkanEngineOcclusionCuller();
+
+		VulkanEngineOcclusionCuller(const VulkanEngineOcclusionCuller&) = delete;
+		VulkanEngineOcclusionCuller& operator=(const VulkanEngineOcclusionCuller&) = delete;
+
+		// The pyramid is built from the depth buffer by sampling it
+		static bool IsSupported(VulkanEngineDevice& device, VkFormat depth_format);
+		// Level 0 is the largest power of two extent that fits in the depth buffer, so every level below halves it
+		static VkExtent2D GetPyramidExtent(VkExtent2D depth_extent);
+		static uint32_t GetPyramidMipLevels(VkExtent2D pyramid_extent);
+
+		// Once the render graph is compiled, with the device idle. The depth buffer is sampled in
+		// SHADER_READ_ONLY_OPTIMAL; BuildPyramid finds [pyramid] in GENERAL and Cull(kLate) in
+		// SHADER_READ_ONLY_OPTIMAL, which [pyramid_view] (every level) is read through
+		void SetTargets(VkImageView depth_view, VkExtent2D depth_extent, VkImage pyramid, VkImageView pyramid_view);
+
+		// Reads the counts the previous user of [frame_index] left, once its fence was waited on
+		void BeginFrame(int frame_index);
+		// This frame's candidates and commands, already written to the ring buffer. [command_count] is the
+		// size of one copy; the late copy directly follows the early one
+		void SetCandidates(
+			const VulkanEngineCamera& camera,
+			uint32_t candidate_offset,
+			uint32_t candidate_count,
+			uint32_t command_offset,
+			uint32_t command_count);
+
+		// Both outside a render pass
+		void Cull(VkCommandBuffer command_buffer, Phase phase);
+		void BuildPyramid(VkCommandBuffer command_buffer);
+
+		// Read by the early phase and written by the late one, for the render graph to import
+		VkBuffer GetVisibilityBuffer() const { return visibility_buffer_->GetBuffer(); }
+		VkDeviceSize GetVisibilityBufferSize() const { return visibility_buffer_->GetBufferSize(); }
+		const Stats& GetStats() const { return stats_; }
+
+	private:
+		// Mirrors the push constants of occlusion_cull.comp
+		struct CullPushConstants
+		{
+			glm::vec4 projection;
+			glm::vec2 pyramid_size;
+			float near_plane;
+			uint32_t pyramid_levels;
+			uint32_t late_phase;
+			uint32_t candidate_offset;
+			uint32_t candidate_count;
+			uint32_t command_offset;
+			uint32_t command_count;
+			uint32_t stats_offset;
+			uint32_t pyramid_image;
+		};
+
+		void CreateBuffers();
+		// Set layouts and push constant ranges come from the shaders
+		void CreatePipelines();
+		VkPipeline CreateComputePipeline(const std::string& filepath, VkPipelineLayout pipeline_layout);
+		void DestroyPyramidViews();
+
+		VulkanEngineDevice& vulkanengine_device_;
+		VulkanEngineRingBuffer& ring_buffer_;
+		uint32_t frame_count_;
+		VulkanEngineBindlessSet* bindless_set_;
+		uint32_t pyramid_image_index_ = VulkanEngineBindlessSet::kInvalidIndex;
+		int frame_index_ = 0;
+
+		std::unique_ptr<VulkanEngineBuffer> visibility_buffer_;
+		// host visible, one slice of counters per frame in flight
+		std::unique_ptr<VulkanEngineBuffer> stats_buffer_;
+		std::vector<bool> stats_pending_;
+		Stats stats_{};
+
+		std::unique_ptr<VulkanEngineDescriptorSetLayout> cull_set_layout_;
+		std::unique_ptr<VulkanEngineDescriptorSetLayout> pyramid_set_layout_;
+		std::unique_ptr<VulkanEngineDescriptorPool> descriptor_pool_;
+		VkPipelineLayout cull_pipeline_layout_ = VK_NULL_HANDLE;
+		VkPipelineLayout pyramid_pipeline_layout_ = VK_NULL_HANDLE;
+		VkPipeline cull_pipeline_ = VK_NULL_HANDLE;
+		VkPipeline pyramid_pipeline_ = VK_NULL_HANDLE;
+		VkSampler sampler_ = VK_NULL_HANDLE;
+
+		// from SetTargets
+		VkImage pyramid_ = VK_NULL_HANDLE;
+		VkExtent2D depth_extent_{};
+		VkExtent2D pyramid_extent_{};
+		uint32_t pyramid_mip_levels_ = 0;
+		std::vector<VkImageView> pyramid_mip_views_;	// one level each
+		std::vector<VkDescriptorSet> pyramid_sets_;		// per level: its source and the level itself
+		VkDescriptorSet cull_set_ = VK_NULL_HANDLE;
+
+		// of the frame being recorded
+		CullPushConstants cull_push_{};
+	};
+}  // namespace vulkanengine
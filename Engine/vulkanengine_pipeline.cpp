@@ -3,9 +3,11 @@
 
 // std
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 
 namespace vulkanengine
 {
@@ -18,12 +20,26 @@ namespace vulkanengine
 		CreateGraphicsPipeline(vert_filepath, frag_filepath, config_info);
 	}
 
+	VulkanEnginePipeline::VulkanEnginePipeline(
+		VulkanEngineDevice& device, VkShaderModule vert_shader_module,
+		VkShaderModule frag_shader_module, const PipelineConfigInfo& config_info)
+		: vulkanengine_device_{ device },
+		vert_shader_module_{ vert_shader_module },
+		frag_shader_module_{ frag_shader_module },
+		owns_shader_modules_{ false }
+	{
+		CreateGraphicsPipeline(config_info);
+	}
+
 	VulkanEnginePipeline::~VulkanEnginePipeline()
 	{
-		vkDestroyShaderModule(vulkanengine_device_.Device(), vert_shader_module_,
-			nullptr);
-		vkDestroyShaderModule(vulkanengine_device_.Device(), frag_shader_module_,
-			nullptr);
+		if (owns_shader_modules_)
+		{
+			vkDestroyShaderModule(vulkanengine_device_.Device(), vert_shader_module_,
+				nullptr);
+			vkDestroyShaderModule(vulkanengine_device_.Device(), frag_shader_module_,
+				nullptr);
+		}
 		vkDestroyPipeline(vulkanengine_device_.Device(), graphics_pipeline_, nullptr);
 	}
 
@@ -32,6 +48,15 @@ namespace vulkanengine
 		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_);
 	}
 
+	void VulkanEnginePipeline::Swap(VulkanEnginePipeline& other)
+	{
+		assert(&vulkanengine_device_ == &other.vulkanengine_device_ && "Cannot swap pipelines of different devices");
+		std::swap(graphics_pipeline_, other.graphics_pipeline_);
+		std::swap(vert_shader_module_, other.vert_shader_module_);
+		std::swap(frag_shader_module_, other.frag_shader_module_);
+		std::swap(owns_shader_modules_, other.owns_shader_modules_);
+	}
+
 	void VulkanEnginePipeline::DefaultPipelineConfigInfo(PipelineConfigInfo& config_info)
 	{
 		config_info.input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -123,6 +148,39 @@ namespace vulkanengine
 		config_info.depth_stencil_info.depthWriteEnable = VK_FALSE;	// may want to remove this once we have order-independent transparency
 	}
 
+	void VulkanEnginePipeline::SetRenderTarget(PipelineConfigInfo& config_info, const RenderTargetInfo& render_target)
+	{
+		config_info.render_pass = render_target.render_pass;
+		config_info.subpass = 0;
+		config_info.color_attachment_format = render_target.color_format;
+		config_info.depth_attachment_format = render_target.depth_format;
+	}
+
+	void VulkanEnginePipeline::CopyPipelineConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination)
+	{
+		destination.binding_descriptions = source.binding_descriptions;
+		destination.attribute_descriptions = source.attribute_descriptions;
+		destination.viewport_info = source.viewport_info;
+		destination.input_assembly_info = source.input_assembly_info;
+		destination.rasterization_info = source.rasterization_info;
+		destination.multisample_info = source.multisample_info;
+		destination.color_blend_attachment = source.color_blend_attachment;
+		destination.color_blend_info = source.color_blend_info;
+		destination.depth_stencil_info = source.depth_stencil_info;
+		destination.dynamic_state_enables = source.dynamic_state_enables;
+		destination.dynamic_state_info = source.dynamic_state_info;
+		destination.pipeline_layout = source.pipeline_layout;
+		destination.render_pass = source.render_pass;
+		destination.subpass = source.subpass;
+		destination.color_attachment_format = source.color_attachment_format;
+		destination.depth_attachment_format = source.depth_attachment_format;
+		destination.specialization_entries = source.specialization_entries;
+		destination.specialization_data = source.specialization_data;
+
+		destination.color_blend_info.pAttachments = &destination.color_blend_attachment;
+		destination.dynamic_state_info.pDynamicStates = destination.dynamic_state_enables.data();
+	}
+
 	std::vector<char> VulkanEnginePipeline::ReadFile(const std::string& filepath)
 	{
 		std::ifstream file{filepath, std::ios::ate | std::ios::binary};
@@ -150,14 +208,38 @@ namespace vulkanengine
 		assert(config_info.pipeline_layout != VK_NULL_HANDLE &&
 			"Cannot create graphics pipeline: no pipeline_layout provided in "
 			"config_info");
-		assert(config_info.render_pass != VK_NULL_HANDLE &&
-			"Cannot create graphics pipeline: no render_pass provided in "
+		assert((config_info.render_pass != VK_NULL_HANDLE ||
+			config_info.color_attachment_format != VK_FORMAT_UNDEFINED ||
+			config_info.depth_attachment_format != VK_FORMAT_UNDEFINED) &&
+			"Cannot create graphics pipeline: no render_pass or attachment formats provided in "
 			"config_info");
 		auto vert_code = ReadFile(vert_filepath);
 		auto frag_code = ReadFile(frag_filepath);
 
-		CreateShaderModule(vert_code, &vert_shader_module_);
-		CreateShaderModule(frag_code, &frag_shader_module_);
+		CreateShaderModule(vulkanengine_device_, vert_code, &vert_shader_module_);
+		CreateShaderModule(vulkanengine_device_, frag_code, &frag_shader_module_);
+
+		CreateGraphicsPipeline(config_info);
+	}
+
+	void VulkanEnginePipeline::CreateGraphicsPipeline(const PipelineConfigInfo& config_info)
+	{
+		assert(config_info.pipeline_layout != VK_NULL_HANDLE &&
+			"Cannot create graphics pipeline: no pipeline_layout provided in "
+			"config_info");
+		assert((config_info.render_pass != VK_NULL_HANDLE ||
+			config_info.color_attachment_format != VK_FORMAT_UNDEFINED ||
+			config_info.depth_attachment_format != VK_FORMAT_UNDEFINED) &&
+			"Cannot create graphics pipeline: no render_pass or attachment formats provided in "
+			"config_info");
+
+		VkSpecializationInfo specialization_info{};
+		specialization_info.mapEntryCount = static_cast<uint32_t>(config_info.specialization_entries.size());
+		specialization_info.pMapEntries = config_info.specialization_entries.data();
+		specialization_info.dataSize = config_info.specialization_data.size();
+		specialization_info.pData = config_info.specialization_data.data();
+		const VkSpecializationInfo* stage_specialization_info =
+			config_info.specialization_entries.empty() ? nullptr : &specialization_info;
 
 		VkPipelineShaderStageCreateInfo shader_stages[2];
 
@@ -167,7 +249,7 @@ namespace vulkanengine
 		shader_stages[0].pName = "main";
 		shader_stages[0].flags = 0;
 		shader_stages[0].pNext = nullptr;
-		shader_stages[0].pSpecializationInfo = nullptr;
+		shader_stages[0].pSpecializationInfo = stage_specialization_info;
 
 		shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -175,7 +257,7 @@ namespace vulkanengine
 		shader_stages[1].pName = "main";
 		shader_stages[1].flags = 0;
 		shader_stages[1].pNext = nullptr;
-		shader_stages[1].pSpecializationInfo = nullptr;
+		shader_stages[1].pSpecializationInfo = stage_specialization_info;
 
 		auto& attribute_descriptions = config_info.attribute_descriptions;
 		auto& binding_descriptions = config_info.binding_descriptions;
@@ -203,18 +285,35 @@ namespace vulkanengine
 		pipeline_info.renderPass = config_info.render_pass;
 		pipeline_info.subpass = config_info.subpass;
 
+		VkPipelineRenderingCreateInfoKHR rendering_info{};
+		if (config_info.render_pass == VK_NULL_HANDLE)
+		{
+			rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+			rendering_info.colorAttachmentCount = config_info.color_attachment_format != VK_FORMAT_UNDEFINED ? 1 : 0;
+			rendering_info.pColorAttachmentFormats = &config_info.color_attachment_format;
+			rendering_info.depthAttachmentFormat = config_info.depth_attachment_format;
+			pipeline_info.pNext = &rendering_info;
+		}
+
 		pipeline_info.basePipelineIndex = -1;
 		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(vulkanengine_device_.Device(), VK_NULL_HANDLE,
+		auto start_time = std::chrono::high_resolution_clock::now();
+		if (vkCreateGraphicsPipelines(vulkanengine_device_.Device(), vulkanengine_device_.PipelineCache(),
 			1, &pipeline_info, nullptr,
 			&graphics_pipeline_) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create graphics pipeline");
 		}
+		double milliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - start_time).count();
+		vulkanengine_device_.RecordPipelineCreation(milliseconds);
+		std::cout << "pipeline created in " << milliseconds << " ms ("
+			<< (vulkanengine_device_.IsPipelineCacheWarm() ? "warm" : "cold") << " cache)" << std::endl;
 	}
 
-	void VulkanEnginePipeline::CreateShaderModule(const std::vector<char>& code,
+	void VulkanEnginePipeline::CreateShaderModule(VulkanEngineDevice& device,
+		const std::vector<char>& code,
 		VkShaderModule* shader_module)
 	{
 		VkShaderModuleCreateInfo create_info{};
@@ -224,7 +323,7 @@ namespace vulkanengine
 			code.data());  // This works due to the code being std::vector, otherwise
 		// we'll have mem size conversion problems
 
-		if (vkCreateShaderModule(vulkanengine_device_.Device(), &create_info, nullptr,
+		if (vkCreateShaderModule(device.Device(), &create_info, nullptr,
 			shader_module) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create shader module");
@@ -3,11 +3,21 @@
 #include "vulkanengine_device.hpp"
 
 // std
+#include <cassert>
+#include <cstring>
 #include <string>
 #include <vector>
 
 namespace vulkanengine
 {
+	// What a pipeline draws into. Pipelines built for a render pass only work inside compatible render
+	// passes; with dynamic rendering render_pass stays null and any target with the same formats will do
+	struct RenderTargetInfo
+	{
+		VkRenderPass render_pass = VK_NULL_HANDLE;
+		VkFormat color_format = VK_FORMAT_UNDEFINED;
+		VkFormat depth_format = VK_FORMAT_UNDEFINED;
+	};
 
 	struct PipelineConfigInfo
 	{
@@ -29,6 +39,13 @@ namespace vulkanengine
 		VkPipelineLayout pipeline_layout = nullptr;
 		VkRenderPass render_pass = nullptr;
 		uint32_t subpass = 0;
+		// Used instead of render_pass and subpass when render_pass is null (dynamic rendering)
+		VkFormat color_attachment_format = VK_FORMAT_UNDEFINED;
+		VkFormat depth_attachment_format = VK_FORMAT_UNDEFINED;
+
+		// Turned into a VkSpecializationInfo for both shader stages at creation; ids a stage doesn't declare are ignored
+		std::vector<VkSpecializationMapEntry> specialization_entries{};
+		std::vector<uint8_t> specialization_data{};
 	};
 
 	class VulkanEnginePipeline
@@ -39,6 +56,11 @@ namespace vulkanengine
 			const std::string& vert_filepath,
 			const std::string& frag_filepath,
 			const PipelineConfigInfo& config_info);
+		// Uses shader modules owned by someone else (e.g. VulkanEnginePipelineRegistry); they are not destroyed with the pipeline
+		VulkanEnginePipeline(VulkanEngineDevice& device,
+			VkShaderModule vert_shader_module,
+			VkShaderModule frag_shader_module,
+			const PipelineConfigInfo& config_info);
 
 		~VulkanEnginePipeline();
 
@@ -46,23 +68,54 @@ namespace vulkanengine
 		VulkanEnginePipeline& operator=(const VulkanEnginePipeline&) = delete;
 
 		void Bind(VkCommandBuffer command_buffer);
+		// Exchanges the underlying Vulkan objects, so everyone holding this pipeline picks up a rebuilt one.
+		// [other] ends up owning the old objects and must outlive any command buffer still using them
+		void Swap(VulkanEnginePipeline& other);
 
 		static void DefaultPipelineConfigInfo(PipelineConfigInfo& config_info);
 		static void EnableAlphaBlending(PipelineConfigInfo& config_info);
+		static void SetRenderTarget(PipelineConfigInfo& config_info, const RenderTargetInfo& render_target);
+		// Sets layout(constant_id = [constant_id]) to [value]; T must match the GLSL type (int32_t, uint32_t, float, VkBool32)
+		template <typename T>
+		static void SetSpecializationConstant(PipelineConfigInfo& config_info, uint32_t constant_id, const T& value)
+		{
+			for (auto& entry : config_info.specialization_entries)
+			{
+				if (entry.constantID == constant_id)
+				{
+					assert(entry.size == sizeof(T) && "Specialization constant set again with a different size");
+					memcpy(config_info.specialization_data.data() + entry.offset, &value, sizeof(T));
+					return;
+				}
+			}
+
+			VkSpecializationMapEntry entry{};
+			entry.constantID = constant_id;
+			entry.offset = static_cast<uint32_t>(config_info.specialization_data.size());
+			entry.size = sizeof(T);
+			config_info.specialization_entries.push_back(entry);
+			config_info.specialization_data.resize(entry.offset + sizeof(T));
+			memcpy(config_info.specialization_data.data() + entry.offset, &value, sizeof(T));
+		}
+
+		// PipelineConfigInfo points into itself, so a plain copy would leave dangling pointers
+		static void CopyPipelineConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination);
 
-	private:
 		static std::vector<char> ReadFile(const std::string& filepath);
+		static void CreateShaderModule(VulkanEngineDevice& device,
+			const std::vector<char>& code,
+			VkShaderModule* shader_module);
 
+	private:
 		void CreateGraphicsPipeline(const std::string& vert_filepath,
 			const std::string& frag_filepath,
 			const PipelineConfigInfo& config_info);
-
-		void CreateShaderModule(const std::vector<char>& code,
-			VkShaderModule* shader_module);
+		void CreateGraphicsPipeline(const PipelineConfigInfo& config_info);
 
 		VulkanEngineDevice& vulkanengine_device_;
 		VkPipeline graphics_pipeline_;
 		VkShaderModule vert_shader_module_;
 		VkShaderModule frag_shader_module_;
+		bool owns_shader_modules_ = true;
 	};
 }  // namespace vulkanengine
\ No newline at end of file
@@ -0,0 +1,491 @@
+#include "vulkanengine_pipeline_registry.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	template <typename T>
+	static void AppendBytes(std::string& key, const T& value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	// *************** Variant Builder *********************
+
+	VulkanEnginePipelineRegistry::VariantBuilder::VariantBuilder(
+		VulkanEnginePipelineRegistry& registry,
+		const std::string& vert_filepath,
+		const std::string& frag_filepath,
+		const PipelineConfigInfo& base_config_info)
+		: registry_{ registry }, vert_filepath_{ vert_filepath }, frag_filepath_{ frag_filepath }
+	{
+		VulkanEnginePipeline::CopyPipelineConfigInfo(base_config_info, config_info_);
+	}
+
+	VulkanEnginePipelineRegistry::VariantBuilder::VariantBuilder(VariantBuilder&& other)
+		: registry_{ other.registry_ }, vert_filepath_{ std::move(other.vert_filepath_) }, frag_filepath_{ std::move(other.frag_filepath_) }
+	{
+		VulkanEnginePipeline::CopyPipelineConfigInfo(other.config_info_, config_info_);
+	}
+
+	VulkanEnginePipelineRegistry::VariantBuilder& VulkanEnginePipelineRegistry::VariantBuilder::SetVertexInput(
+		const std::vector<VkVertexInputBindingDescription>& binding_descriptions,
+		const std::vector<VkVertexInputAttributeDescription>& attribute_descriptions)
+	{
+		config_info_.binding_descriptions = binding_descriptions;
+		config_info_.attribute_descriptions = attribute_descriptions;
+		return *this;
+	}
+
+	std::shared_ptr<VulkanEnginePipeline> VulkanEnginePipelineRegistry::VariantBuilder::Build()
+	{
+		return registry_.GetOrCreate(vert_filepath_, frag_filepath_, config_info_);
+	}
+
+	VulkanEnginePipelineRegistry::PipelineFuture VulkanEnginePipelineRegistry::VariantBuilder::BuildAsync()
+	{
+		return registry_.RequestAsync(vert_filepath_, frag_filepath_, config_info_);
+	}
+
+	// *************** Pipeline Registry *********************
+
+	VulkanEnginePipelineRegistry::VulkanEnginePipelineRegistry(VulkanEngineDevice& device, uint32_t worker_count)
+		: vulkanengine_device_{ device }
+	{
+		if (worker_count == 0)
+		{
+			worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+		for (uint32_t i = 0; i < worker_count; i++)
+		{
+			workers_.emplace_back(&VulkanEnginePipelineRegistry::WorkerLoop, this);
+		}
+	}
+
+	VulkanEnginePipelineRegistry::~VulkanEnginePipelineRegistry()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ queue_mutex_ };
+			stopping_ = true;
+		}
+		queue_condition_.notify_all();
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+
+		// Anything still queued never started; fail it so nobody waits forever
+		for (auto& job : queue_)
+		{
+			if (job.promise)
+			{
+				job.promise->set_exception(std::make_exception_ptr(
+					std::runtime_error("pipeline registry destroyed before compiling pipeline!")));
+			}
+		}
+
+		pending_swaps_.clear();
+		retired_.clear();
+		pipelines_.clear();
+		shader_modules_.clear();
+	}
+
+	std::shared_ptr<VulkanEnginePipeline> VulkanEnginePipelineRegistry::GetOrCreate(
+		const std::string& vert_filepath,
+		const std::string& frag_filepath,
+		const PipelineConfigInfo& config_info)
+	{
+		CompileJob job{};
+		job.key = BuildKey(vert_filepath, frag_filepath, config_info);
+		job.vert_filepath = vert_filepath;
+		job.frag_filepath = frag_filepath;
+		auto config_copy = std::make_shared<PipelineConfigInfo>();
+		VulkanEnginePipeline::CopyPipelineConfigInfo(config_info, *config_copy);
+		job.config_info = config_copy;
+
+		PipelineFuture future;
+		if (!FindOrReserve(job, future))
+		{
+			Compile(job);
+		}
+		return future.get();
+	}
+
+	VulkanEnginePipelineRegistry::PipelineFuture VulkanEnginePipelineRegistry::RequestAsync(
+		const std::string& vert_filepath,
+		const std::string& frag_filepath,
+		const PipelineConfigInfo& config_info)
+	{
+		CompileJob job{};
+		job.key = BuildKey(vert_filepath, frag_filepath, config_info);
+		job.vert_filepath = vert_filepath;
+		job.frag_filepath = frag_filepath;
+		auto config_copy = std::make_shared<PipelineConfigInfo>();
+		VulkanEnginePipeline::CopyPipelineConfigInfo(config_info, *config_copy);
+		job.config_info = config_copy;
+
+		PipelineFuture future;
+		if (!FindOrReserve(job, future))
+		{
+			Enqueue(std::move(job));
+		}
+		return future;
+	}
+
+	void VulkanEnginePipelineRegistry::ReloadShaders(const std::vector<std::string>& spv_filepaths)
+	{
+		// Files are matched by identity rather than by spelling: the watcher and the systems may
+		// refer to the same .spv as "Shaders/x.spv" and "Shaders\x.spv"
+		auto same_file = [](const std::string& a, const std::string& b)
+		{
+			std::error_code error;
+			return a == b || std::filesystem::equivalent(a, b, error);
+		};
+
+		std::vector<std::string> reloaded_filepaths{};
+		for (auto& spv_filepath : spv_filepaths)
+		{
+			std::lock_guard<std::mutex> lock{ shader_modules_mutex_ };
+			for (auto& kv : shader_modules_)
+			{
+				if (!same_file(kv.first, spv_filepath))
+				{
+					continue;
+				}
+
+				VkShaderModule shader_module;
+				try
+				{
+					VulkanEnginePipeline::CreateShaderModule(vulkanengine_device_, VulkanEnginePipeline::ReadFile(kv.first), &shader_module);
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << "shader reload: " << e.what() << std::endl;
+					continue;
+				}
+
+				// builds still holding the old module keep it alive until they finish
+				kv.second = std::make_shared<const ShaderModule>(vulkanengine_device_.Device(), shader_module);
+				reloaded_filepaths.push_back(kv.first);
+			}
+		}
+
+		std::vector<CompileJob> jobs{};
+		{
+			std::lock_guard<std::mutex> lock{ pipelines_mutex_ };
+			for (auto& kv : pipelines_)
+			{
+				const Entry& entry = kv.second;
+				bool affected = std::any_of(reloaded_filepaths.begin(), reloaded_filepaths.end(),
+					[&entry](const std::string& filepath) { return filepath == entry.vert_filepath || filepath == entry.frag_filepath; });
+
+				// Pipelines still compiling may have loaded the old module already; Compile notices and
+				// requeues them once they are done, since there is no pipeline to swap into yet
+				if (!affected || entry.pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				{
+					continue;
+				}
+
+				CompileJob job{};
+				job.key = kv.first;
+				job.vert_filepath = entry.vert_filepath;
+				job.frag_filepath = entry.frag_filepath;
+				job.config_info = entry.config_info;
+				job.swap_target = entry.pipeline.get();
+				jobs.push_back(std::move(job));
+			}
+		}
+
+		std::cout << "shader reload: " << reloaded_filepaths.size() << " modules, " << jobs.size() << " pipelines queued" << std::endl;
+		for (auto& job : jobs)
+		{
+			Enqueue(std::move(job));
+		}
+	}
+
+	void VulkanEnginePipelineRegistry::BeginFrame()
+	{
+		std::lock_guard<std::mutex> lock{ swap_mutex_ };
+
+		for (auto it = retired_.begin(); it != retired_.end();)
+		{
+			if (--it->frames_left > 0)
+			{
+				++it;
+				continue;
+			}
+			it = retired_.erase(it);
+		}
+
+		// The rebuilt object now holds the old VkPipeline, which frames in flight may still reference
+		for (auto& swap : pending_swaps_)
+		{
+			swap.target->Swap(*swap.rebuilt);
+			retired_.push_back({ std::move(swap.rebuilt), kRetireFrameCount });
+		}
+		pending_swaps_.clear();
+	}
+
+	size_t VulkanEnginePipelineRegistry::GetPipelineCount()
+	{
+		std::lock_guard<std::mutex> lock{ pipelines_mutex_ };
+		return pipelines_.size();
+	}
+
+	size_t VulkanEnginePipelineRegistry::GetShaderModuleCount()
+	{
+		std::lock_guard<std::mutex> lock{ shader_modules_mutex_ };
+		return shader_modules_.size();
+	}
+
+	// Serializes exactly the state CreateGraphicsPipeline consumes, field by field: the Vulkan structs carry
+	// pointers (pNext, pAttachments, ...) and padding that must not leak into the key.
+	// Render passes are compared by handle, which is stricter than render pass compatibility but never wrong
+	std::string VulkanEnginePipelineRegistry::BuildKey(
+		const std::string& vert_filepath,
+		const std::string& frag_filepath,
+		const PipelineConfigInfo& config_info)
+	{
+		std::string key{};
+		key.reserve(512);
+
+		key.append(vert_filepath);
+		key.push_back('\0');
+		key.append(frag_filepath);
+		key.push_back('\0');
+
+		AppendBytes(key, config_info.binding_descriptions.size());
+		for (auto& binding : config_info.binding_descriptions)
+		{
+			AppendBytes(key, binding.binding);
+			AppendBytes(key, binding.stride);
+			AppendBytes(key, binding.inputRate);
+		}
+		AppendBytes(key, config_info.attribute_descriptions.size());
+		for (auto& attribute : config_info.attribute_descriptions)
+		{
+			AppendBytes(key, attribute.location);
+			AppendBytes(key, attribute.binding);
+			AppendBytes(key, attribute.format);
+			AppendBytes(key, attribute.offset);
+		}
+
+		AppendBytes(key, config_info.input_assembly_info.topology);
+		AppendBytes(key, config_info.input_assembly_info.primitiveRestartEnable);
+
+		AppendBytes(key, config_info.viewport_info.viewportCount);
+		AppendBytes(key, config_info.viewport_info.scissorCount);
+
+		const auto& rasterization = config_info.rasterization_info;
+		AppendBytes(key, rasterization.depthClampEnable);
+		AppendBytes(key, rasterization.rasterizerDiscardEnable);
+		AppendBytes(key, rasterization.polygonMode);
+		AppendBytes(key, rasterization.cullMode);
+		AppendBytes(key, rasterization.frontFace);
+		AppendBytes(key, rasterization.depthBiasEnable);
+		AppendBytes(key, rasterization.depthBiasConstantFactor);
+		AppendBytes(key, rasterization.depthBiasClamp);
+		AppendBytes(key, rasterization.depthBiasSlopeFactor);
+		AppendBytes(key, rasterization.lineWidth);
+
+		const auto& multisample = config_info.multisample_info;
+		AppendBytes(key, multisample.rasterizationSamples);
+		AppendBytes(key, multisample.sampleShadingEnable);
+		AppendBytes(key, multisample.minSampleShading);
+		AppendBytes(key, multisample.alphaToCoverageEnable);
+		AppendBytes(key, multisample.alphaToOneEnable);
+
+		const auto& blend_attachment = config_info.color_blend_attachment;
+		AppendBytes(key, blend_attachment.blendEnable);
+		AppendBytes(key, blend_attachment.srcColorBlendFactor);
+		AppendBytes(key, blend_attachment.dstColorBlendFactor);
+		AppendBytes(key, blend_attachment.colorBlendOp);
+		AppendBytes(key, blend_attachment.srcAlphaBlendFactor);
+		AppendBytes(key, blend_attachment.dstAlphaBlendFactor);
+		AppendBytes(key, blend_attachment.alphaBlendOp);
+		AppendBytes(key, blend_attachment.colorWriteMask);
+
+		const auto& color_blend = config_info.color_blend_info;
+		AppendBytes(key, color_blend.logicOpEnable);
+		AppendBytes(key, color_blend.logicOp);
+		AppendBytes(key, color_blend.attachmentCount);
+		AppendBytes(key, color_blend.blendConstants);
+
+		const auto& depth_stencil = config_info.depth_stencil_info;
+		AppendBytes(key, depth_stencil.depthTestEnable);
+		AppendBytes(key, depth_stencil.depthWriteEnable);
+		AppendBytes(key, depth_stencil.depthCompareOp);
+		AppendBytes(key, depth_stencil.depthBoundsTestEnable);
+		AppendBytes(key, depth_stencil.minDepthBounds);
+		AppendBytes(key, depth_stencil.maxDepthBounds);
+		AppendBytes(key, depth_stencil.stencilTestEnable);
+		if (depth_stencil.stencilTestEnable)
+		{
+			AppendBytes(key, depth_stencil.front);
+			AppendBytes(key, depth_stencil.back);
+		}
+
+		AppendBytes(key, config_info.dynamic_state_enables.size());
+		for (auto dynamic_state : config_info.dynamic_state_enables)
+		{
+			AppendBytes(key, dynamic_state);
+		}
+
+		AppendBytes(key, config_info.specialization_entries.size());
+		for (auto& entry : config_info.specialization_entries)
+		{
+			AppendBytes(key, entry.constantID);
+			AppendBytes(key, entry.offset);
+			AppendBytes(key, entry.size);
+		}
+		key.append(config_info.specialization_data.begin(), config_info.specialization_data.end());
+
+		AppendBytes(key, config_info.pipeline_layout);
+		AppendBytes(key, config_info.render_pass);
+		AppendBytes(key, config_info.subpass);
+		AppendBytes(key, config_info.color_attachment_format);
+		AppendBytes(key, config_info.depth_attachment_format);
+		return key;
+	}
+
+	bool VulkanEnginePipelineRegistry::FindOrReserve(CompileJob& job, PipelineFuture& future)
+	{
+		std::lock_guard<std::mutex> lock{ pipelines_mutex_ };
+		auto it = pipelines_.find(job.key);
+		if (it != pipelines_.end())
+		{
+			hit_count_++;
+			future = it->second.pipeline;
+			return true;
+		}
+
+		job.promise = std::make_shared<std::promise<std::shared_ptr<VulkanEnginePipeline>>>();
+		future = job.promise->get_future().share();
+		pipelines_.emplace(job.key, Entry{ future, job.vert_filepath, job.frag_filepath, job.config_info });
+		return false;
+	}
+
+	void VulkanEnginePipelineRegistry::Compile(CompileJob& job)
+	{
+		std::shared_ptr<VulkanEnginePipeline> pipeline;
+		std::shared_ptr<const ShaderModule> vert_shader_module;
+		std::shared_ptr<const ShaderModule> frag_shader_module;
+		try
+		{
+			vert_shader_module = GetShaderModule(job.vert_filepath);
+			frag_shader_module = GetShaderModule(job.frag_filepath);
+			pipeline = std::make_shared<VulkanEnginePipeline>(
+				vulkanengine_device_, vert_shader_module->handle, frag_shader_module->handle, *job.config_info);
+		}
+		catch (const std::exception& e)
+		{
+			if (job.swap_target)
+			{
+				// Keep drawing with the previous pipeline until the shader is fixed
+				std::cerr << "shader reload: failed to rebuild pipeline: " << e.what() << std::endl;
+				return;
+			}
+
+			// Forget the failed entry so a later request can retry (e.g. after fixing the shader)
+			{
+				std::lock_guard<std::mutex> lock{ pipelines_mutex_ };
+				pipelines_.erase(job.key);
+			}
+			job.promise->set_exception(std::current_exception());
+			return;
+		}
+
+		// ReloadShaders only rebuilds pipelines that are ready when it scans pipelines_, so checking the modules
+		// and publishing the pipeline under the same lock leaves no window for a reload to go unnoticed
+		bool stale = false;
+		{
+			std::lock_guard<std::mutex> lock{ pipelines_mutex_ };
+			stale = !IsCurrentShaderModule(job.vert_filepath, vert_shader_module) ||
+				!IsCurrentShaderModule(job.frag_filepath, frag_shader_module);
+			if (!job.swap_target)
+			{
+				job.promise->set_value(pipeline);
+			}
+		}
+
+		if (!stale)
+		{
+			if (job.swap_target)
+			{
+				std::lock_guard<std::mutex> lock{ swap_mutex_ };
+				pending_swaps_.push_back({ job.swap_target, std::move(pipeline) });
+			}
+			return;
+		}
+
+		// Built from a module a reload has replaced meanwhile: rebuild it with the new one. A first build was
+		// handed out all the same, so nobody waits on the rebuild
+		CompileJob rebuild{};
+		rebuild.key = job.key;
+		rebuild.vert_filepath = job.vert_filepath;
+		rebuild.frag_filepath = job.frag_filepath;
+		rebuild.config_info = job.config_info;
+		rebuild.swap_target = job.swap_target ? job.swap_target : pipeline;
+		Enqueue(std::move(rebuild));
+	}
+
+	void VulkanEnginePipelineRegistry::Enqueue(CompileJob&& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ queue_mutex_ };
+			queue_.push_back(std::move(job));
+		}
+		queue_condition_.notify_one();
+	}
+
+	std::shared_ptr<const VulkanEnginePipelineRegistry::ShaderModule> VulkanEnginePipelineRegistry::GetShaderModule(
+		const std::string& filepath)
+	{
+		std::lock_guard<std::mutex> lock{ shader_modules_mutex_ };
+		auto it = shader_modules_.find(filepath);
+		if (it != shader_modules_.end())
+		{
+			return it->second;
+		}
+
+		VkShaderModule shader_module;
+		VulkanEnginePipeline::CreateShaderModule(vulkanengine_device_, VulkanEnginePipeline::ReadFile(filepath), &shader_module);
+		auto shared_module = std::make_shared<const ShaderModule>(vulkanengine_device_.Device(), shader_module);
+		shader_modules_.emplace(filepath, shared_module);
+		return shared_module;
+	}
+
+	bool VulkanEnginePipelineRegistry::IsCurrentShaderModule(
+		const std::string& filepath,
+		const std::shared_ptr<const ShaderModule>& shader_module)
+	{
+		std::lock_guard<std::mutex> lock{ shader_modules_mutex_ };
+		auto it = shader_modules_.find(filepath);
+		return it != shader_modules_.end() && it->second == shader_module;
+	}
+
+	void VulkanEnginePipelineRegistry::WorkerLoop()
+	{
+		while (true)
+		{
+			CompileJob job{};
+			{
+				std::unique_lock<std::mutex> lock{ queue_mutex_ };
+				queue_condition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+				if (stopping_)
+				{
+					return;
+				}
+				job = std::move(queue_.front());
+				queue_.pop_front();
+			}
+			Compile(job);
+		}
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "vulkanengine_device.hpp"
+#include "vulkanengine_pipeline.hpp"
+#include "vulkanengine_swap_chain.hpp"
+
+// std
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Shares pipelines between systems. A pipeline is keyed by its shader paths and every field of
+	// PipelineConfigInfo that ends up in VkGraphicsPipelineCreateInfo, so two requests with equal state
+	// get the same VulkanEnginePipeline. Shader modules are loaded once per path and shared as well.
+	// RequestAsync hands compilation to worker threads so new variants don't stall the render loop.
+	// ReloadShaders rebuilds every pipeline using the given .spv files in the background, and BeginFrame
+	// swaps the results in place, so systems keep their shared_ptr and simply bind the new pipeline
+	class VulkanEnginePipelineRegistry
+	{
+	public:
+		using PipelineFuture = std::shared_future<std::shared_ptr<VulkanEnginePipeline>>;
+
+		// Specializes a base configuration per variant. Each distinct set of constants is a separate
+		// pipeline in the registry, so asking for the same variant twice returns the cached one
+		class VariantBuilder
+		{
+		public:
+			VariantBuilder(
+				VulkanEnginePipelineRegistry& registry,
+				const std::string& vert_filepath,
+				const std::string& frag_filepath,
+				const PipelineConfigInfo& base_config_info);
+			VariantBuilder(VariantBuilder&& other);
+
+			template <typename T>
+			VariantBuilder& SetConstant(uint32_t constant_id, const T& value)
+			{
+				VulkanEnginePipeline::SetSpecializationConstant(config_info_, constant_id, value);
+				return *this;
+			}
+			VariantBuilder& SetConstant(uint32_t constant_id, bool value)
+			{
+				return SetConstant<VkBool32>(constant_id, value ? VK_TRUE : VK_FALSE);
+			}
+			VariantBuilder& SetVertexInput(
+				const std::vector<VkVertexInputBindingDescription>& binding_descriptions,
+				const std::vector<VkVertexInputAttributeDescription>& attribute_descriptions);
+
+			std::shared_ptr<VulkanEnginePipeline> Build();
+			PipelineFuture BuildAsync();
+
+		private:
+			VulkanEnginePipelineRegistry& registry_;
+			std::string vert_filepath_;
+			std::string frag_filepath_;
+			PipelineConfigInfo config_info_{};
+		};
+
+		// Replaced pipelines may still be referenced by frames in flight
+		static constexpr uint32_t kRetireFrameCount = VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+		// worker_count of 0 picks hardware_concurrency - 1 (at least one)
+		VulkanEnginePipelineRegistry(VulkanEngineDevice& device, uint32_t worker_count = 0);
+		~VulkanEnginePipelineRegistry();
+
+		VulkanEnginePipelineRegistry(const VulkanEnginePipelineRegistry&) = delete;
+		VulkanEnginePipelineRegistry& operator=(const VulkanEnginePipelineRegistry&) = delete;
+
+		// Blocks until the pipeline exists, compiling on the calling thread if nobody has requested it yet
+		std::shared_ptr<VulkanEnginePipeline> GetOrCreate(
+			const std::string& vert_filepath,
+			const std::string& frag_filepath,
+			const PipelineConfigInfo& config_info);
+
+		// Returns immediately; poll the future with wait_for(0) and keep drawing with a fallback until it is ready
+		PipelineFuture RequestAsync(
+			const std::string& vert_filepath,
+			const std::string& frag_filepath,
+			const PipelineConfigInfo& config_info);
+
+		// Thread-safe. Recreates the shader modules of these files and queues rebuilds of the affected pipelines.
+		// Builds already running with an old module are requeued once they finish, see Compile
+		void ReloadShaders(const std::vector<std::string>& spv_filepaths);
+		// Call once per frame after the frame's fence has been waited on
+		void BeginFrame();
+
+		size_t GetPipelineCount();
+		size_t GetShaderModuleCount();
+		uint32_t GetHitCount() const { return hit_count_; }
+
+	private:
+		struct Entry
+		{
+			PipelineFuture pipeline;
+			std::string vert_filepath;
+			std::string frag_filepath;
+			std::shared_ptr<const PipelineConfigInfo> config_info;
+		};
+
+		struct CompileJob
+		{
+			std::string key;
+			std::string vert_filepath;
+			std::string frag_filepath;
+			std::shared_ptr<const PipelineConfigInfo> config_info;
+			std::shared_ptr<std::promise<std::shared_ptr<VulkanEnginePipeline>>> promise;	// null for rebuilds
+			std::shared_ptr<VulkanEnginePipeline> swap_target;								// null for first builds
+		};
+
+		struct PendingSwap
+		{
+			std::shared_ptr<VulkanEnginePipeline> target;
+			std::shared_ptr<VulkanEnginePipeline> rebuilt;
+		};
+
+		struct Retired
+		{
+			std::shared_ptr<VulkanEnginePipeline> pipeline;
+			uint32_t frames_left;
+		};
+
+		// Pipelines don't reference their modules once created, so a module only has to outlive the builds
+		// using it: every build holds a reference, and a reloaded module goes away with the last one
+		struct ShaderModule
+		{
+			ShaderModule(VkDevice device, VkShaderModule handle) : device{ device }, handle{ handle } {}
+			~ShaderModule() { vkDestroyShaderModule(device, handle, nullptr); }
+
+			ShaderModule(const ShaderModule&) = delete;
+			ShaderModule& operator=(const ShaderModule&) = delete;
+
+			VkDevice device;
+			VkShaderModule handle;
+		};
+
+		static std::string BuildKey(
+			const std::string& vert_filepath,
+			const std::string& frag_filepath,
+			const PipelineConfigInfo& config_info);
+
+		// Returns true and fills [future] if the job's key is known; otherwise registers the job's promise under it
+		bool FindOrReserve(CompileJob& job, PipelineFuture& future);
+		void Compile(CompileJob& job);
+		void Enqueue(CompileJob&& job);
+		std::shared_ptr<const ShaderModule> GetShaderModule(const std::string& filepath);
+		// False once ReloadShaders replaced the module of [filepath]
+		bool IsCurrentShaderModule(const std::string& filepath, const std::shared_ptr<const ShaderModule>& shader_module);
+		void WorkerLoop();
+
+		VulkanEngineDevice& vulkanengine_device_;
+
+		// When both are held, pipelines_mutex_ is locked first
+		std::mutex pipelines_mutex_;
+		std::unordered_map<std::string, Entry> pipelines_;
+		uint32_t hit_count_ = 0;
+
+		std::mutex shader_modules_mutex_;
+		std::unordered_map<std::string, std::shared_ptr<const ShaderModule>> shader_modules_;
+
+		std::mutex swap_mutex_;
+		std::vector<PendingSwap> pending_swaps_;
+		std::vector<Retired> retired_;
+
+		std::mutex queue_mutex_;
+		std::condition_variable queue_condition_;
+		std::deque<CompileJob> queue_;
+		bool stopping_ = false;
+		std::vector<std::thread> workers_;
+	};
+}  // namespace vulkanengine
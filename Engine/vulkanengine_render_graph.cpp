@@ -0,0 +1,1128 @@
+#include "vulkanengine_render_graph.hpp"
+
+#include "vulkanengine_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	static constexpr VkAccessFlags kWriteAccessMask =
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT |
+		VK_ACCESS_MEMORY_WRITE_BIT;
+
+	// PassBuilder
+
+	VulkanEngineRenderGraph::PassBuilder& VulkanEngineRenderGraph::PassBuilder::Read(ResourceId resource, Access access)
+	{
+		graph_.AddAccess(pass_, resource, access, false);
+		return *this;
+	}
+
+	VulkanEngineRenderGraph::PassBuilder& VulkanEngineRenderGraph::PassBuilder::Write(ResourceId resource, Access access)
+	{
+		graph_.AddAccess(pass_, resource, access, true);
+		return *this;
+	}
+
+	VulkanEngineRenderGraph::PassBuilder& VulkanEngineRenderGraph::PassBuilder::ClearColor(ResourceId resource, const VkClearColorValue& value)
+	{
+		ResourceUse& use = graph_.FindUse(pass_, resource);
+		assert(use.attachment && "Only attachments can be cleared");
+		use.clear = true;
+		use.clear_value.color = value;
+		return *this;
+	}
+
+	VulkanEngineRenderGraph::PassBuilder& VulkanEngineRenderGraph::PassBuilder::ClearDepth(ResourceId resource, float depth)
+	{
+		ResourceUse& use = graph_.FindUse(pass_, resource);
+		assert(use.attachment && "Only attachments can be cleared");
+		use.clear = true;
+		use.clear_value.depthStencil = { depth, 0 };
+		return *this;
+	}
+
+	VulkanEngineRenderGraph::PassBuilder& VulkanEngineRenderGraph::PassBuilder::SetSideEffects()
+	{
+		graph_.passes_[pass_].side_effects = true;
+		return *this;
+	}
+
+	// VulkanEngineRenderGraph
+
+	VulkanEngineRenderGraph::VulkanEngineRenderGraph(VulkanEngineDevice& device, bool dynamic_rendering)
+		: vulkanengine_device_{ device }, dynamic_rendering_{ dynamic_rendering }
+	{
+		assert((!dynamic_rendering || device.SupportsDynamicRendering()) && "Device has no dynamic rendering");
+	}
+
+	VulkanEngineRenderGraph::~VulkanEngineRenderGraph()
+	{
+		DestroyCompiledState();
+	}
+
+	void VulkanEngineRenderGraph::Reset()
+	{
+		DestroyCompiledState();
+		resources_.clear();
+		passes_.clear();
+		stats_ = {};
+	}
+
+	VulkanEngineRenderGraph::ResourceId VulkanEngineRenderGraph::ImportImage(
+		const std::string& name,
+		const ImageDesc& desc,
+		VkImageLayout initial_layout,
+		VkImageLayout final_layout)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.imported = true;
+		resource.image_desc = desc;
+		resource.initial_layout = initial_layout;
+		resource.final_layout = final_layout;
+		resources_.push_back(std::move(resource));
+		return static_cast<ResourceId>(resources_.size() - 1);
+	}
+
+	VulkanEngineRenderGraph::ResourceId VulkanEngineRenderGraph::ImportBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.is_image = false;
+		resource.imported = true;
+		resource.buffer_desc.size = size;
+		resource.buffer = buffer;
+		resources_.push_back(std::move(resource));
+		return static_cast<ResourceId>(resources_.size() - 1);
+	}
+
+	void VulkanEngineRenderGraph::SetImportedImage(ResourceId resource, VkImage image, VkImageView view)
+	{
+		assert(resources_[resource].imported && resources_[resource].is_image && "Only imported images can be set");
+		resources_[resource].image = image;
+		resources_[resource].view = view;
+	}
+
+	VulkanEngineRenderGraph::ResourceId VulkanEngineRenderGraph::CreateImage(const std::string& name, const ImageDesc& desc)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.image_desc = desc;
+		resources_.push_back(std::move(resource));
+		return static_cast<ResourceId>(resources_.size() - 1);
+	}
+
+	VulkanEngineRenderGraph::ResourceId VulkanEngineRenderGraph::CreateBuffer(const std::string& name, const BufferDesc& desc)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.is_image = false;
+		resource.buffer_desc = desc;
+		resources_.push_back(std::move(resource));
+		return static_cast<ResourceId>(resources_.size() - 1);
+	}
+
+	VulkanEngineRenderGraph::PassId VulkanEngineRenderGraph::AddPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute)
+	{
+		assert(!compiled_ && "Passes cannot be added to a compiled graph, Reset it first");
+
+		Pass pass{};
+		pass.name = name;
+		pass.execute = std::move(execute);
+		passes_.push_back(std::move(pass));
+
+		PassId pass_id = static_cast<PassId>(passes_.size() - 1);
+		PassBuilder builder{ *this, pass_id };
+		setup(builder);
+		return pass_id;
+	}
+
+	VulkanEngineRenderGraph::AccessInfo VulkanEngineRenderGraph::GetAccessInfo(Access access)
+	{
+		constexpr VkPipelineStageFlags kFragmentTests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		switch (access)
+		{
+		case Access::kColorAttachment:
+			return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0 };
+		case Access::kDepthAttachment:
+			return { kFragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 };
+		case Access::kDepthAttachmentRead:
+			return { kFragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 };
+		case Access::kFragmentSampled:
+			return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, 0 };
+		case Access::kComputeSampled:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, 0 };
+		case Access::kComputeStorageRead:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+		case Access::kComputeStorageWrite:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+		case Access::kTransferSrc:
+			return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT };
+		case Access::kTransferDst:
+			return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT };
+		case Access::kVertexBuffer:
+			return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT };
+		case Access::kIndexBuffer:
+			return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_INDEX_BUFFER_BIT };
+		case Access::kIndirectBuffer:
+			return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT };
+		case Access::kVertexShaderRead:
+			return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+		case Access::kFragmentShaderRead:
+			return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+		}
+		throw std::runtime_error("unknown render graph access!");
+	}
+
+	bool VulkanEngineRenderGraph::IsAttachment(Access access)
+	{
+		return access == Access::kColorAttachment || access == Access::kDepthAttachment || access == Access::kDepthAttachmentRead;
+	}
+
+	bool VulkanEngineRenderGraph::IsDepthFormat(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+			format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	VkImageAspectFlags VulkanEngineRenderGraph::GetBarrierAspect(VkFormat format)
+	{
+		if (!IsDepthFormat(format))
+		{
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+		// layout transitions of combined formats have to name both aspects
+		bool has_stencil = format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+		return VK_IMAGE_ASPECT_DEPTH_BIT | (has_stencil ? VkImageAspectFlags{ VK_IMAGE_ASPECT_STENCIL_BIT } : VkImageAspectFlags{ 0 });
+	}
+
+	void VulkanEngineRenderGraph::AddAccess(PassId pass_id, ResourceId resource, Access access, bool write)
+	{
+		assert(resource < resources_.size() && "Unknown render graph resource");
+		assert(((access != Access::kColorAttachment && access != Access::kDepthAttachment) || write) && "Writable attachments are declared with Write");
+		Pass& pass = passes_[pass_id];
+		AccessInfo info = GetAccessInfo(access);
+		bool is_image = resources_[resource].is_image;
+		if (is_image ? info.layout == VK_IMAGE_LAYOUT_UNDEFINED : info.buffer_usage == 0)
+		{
+			throw std::runtime_error("render graph pass " + pass.name + " accesses " + resources_[resource].name + " in a way its type does not allow!");
+		}
+		if (!is_image)
+		{
+			info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			info.image_usage = 0;
+		}
+
+		auto existing = std::find_if(pass.uses.begin(), pass.uses.end(), [resource](const ResourceUse& use) { return use.resource == resource; });
+		if (existing == pass.uses.end())
+		{
+			ResourceUse use{};
+			use.resource = resource;
+			use.info = info;
+			pass.uses.push_back(use);
+			existing = pass.uses.end() - 1;
+		}
+		else
+		{
+			if (existing->info.layout != info.layout)
+			{
+				throw std::runtime_error("render graph pass " + pass.name + " uses " + resources_[resource].name + " in two layouts!");
+			}
+			existing->info.stages |= info.stages;
+			existing->info.access |= info.access;
+			existing->info.image_usage |= info.image_usage;
+			existing->info.buffer_usage |= info.buffer_usage;
+		}
+		(write ? existing->write : existing->read) = true;
+
+		if (IsAttachment(access) && !existing->attachment)
+		{
+			existing->attachment = true;
+			uint32_t use_index = static_cast<uint32_t>(existing - pass.uses.begin());
+			bool depth = access != Access::kColorAttachment;
+			if (depth)
+			{
+				pass.attachments.push_back(use_index);
+			}
+			else
+			{
+				// color attachments go before the depth attachment, if there is one already
+				auto position = std::find_if(pass.attachments.begin(), pass.attachments.end(), [&pass](uint32_t index) {
+					return pass.uses[index].info.layout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				});
+				pass.attachments.insert(position, use_index);
+			}
+		}
+	}
+
+	VulkanEngineRenderGraph::ResourceUse& VulkanEngineRenderGraph::FindUse(PassId pass_id, ResourceId resource)
+	{
+		for (auto& use : passes_[pass_id].uses)
+		{
+			if (use.resource == resource)
+			{
+				return use;
+			}
+		}
+		throw std::runtime_error("render graph pass " + passes_[pass_id].name + " does not use " + resources_[resource].name + "!");
+	}
+
+	void VulkanEngineRenderGraph::Compile()
+	{
+		VULKANENGINE_PROFILE_FUNCTION();
+		DestroyCompiledState();
+
+		CullPasses();
+		SchedulePasses();
+		CreateTransientResources();
+		AliasTransientMemory();
+		ComputeBarriers();
+		CreateRenderPasses();
+
+		stats_.pass_count = static_cast<uint32_t>(passes_.size());
+		stats_.culled_pass_count = stats_.pass_count - static_cast<uint32_t>(execution_order_.size());
+		compiled_ = true;
+	}
+
+	// Walks the passes backwards, tracking which resources a later surviving pass still needs. A pass
+	// survives if it writes something needed or has side effects; what it then reads becomes needed
+	void VulkanEngineRenderGraph::CullPasses()
+	{
+		std::vector<bool> needed(resources_.size());
+		for (size_t i = 0; i < resources_.size(); ++i)
+		{
+			needed[i] = resources_[i].imported;
+		}
+
+		for (size_t i = passes_.size(); i-- > 0;)
+		{
+			Pass& pass = passes_[i];
+			pass.culled = !pass.side_effects;
+			for (const auto& use : pass.uses)
+			{
+				if (use.write && needed[use.resource])
+				{
+					pass.culled = false;
+				}
+			}
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			for (const auto& use : pass.uses)
+			{
+				if (use.write)
+				{
+					needed[use.resource] = false;
+				}
+			}
+			for (const auto& use : pass.uses)
+			{
+				if (use.NeedsContents())
+				{
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+
+	// A pass's level is one past the deepest pass it depends on (read after write, write after read or
+	// write, or a layout change). Passes of a level don't depend on each other, so they are recorded
+	// together behind one merged barrier; within a level the declaration order is kept
+	void VulkanEngineRenderGraph::SchedulePasses()
+	{
+		struct ResourceState
+		{
+			int write_level = -1;
+			int read_level = -1;	// deepest reader since the last write
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool written = false;
+		};
+		std::vector<ResourceState> states(resources_.size());
+		for (size_t i = 0; i < resources_.size(); ++i)
+		{
+			states[i].layout = resources_[i].initial_layout;
+			// imported resources hold data from outside the frame
+			states[i].written = resources_[i].imported && (!resources_[i].is_image || resources_[i].initial_layout != VK_IMAGE_LAYOUT_UNDEFINED);
+		}
+
+		execution_order_.clear();
+		for (PassId id = 0; id < passes_.size(); ++id)
+		{
+			Pass& pass = passes_[id];
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			int level = 0;
+			for (const auto& use : pass.uses)
+			{
+				const ResourceState& state = states[use.resource];
+				if (use.NeedsContents() && !state.written && !use.write)
+				{
+					throw std::runtime_error("render graph pass " + pass.name + " reads " + resources_[use.resource].name + " before anything writes it!");
+				}
+				bool transition = resources_[use.resource].is_image && use.info.layout != state.layout;
+				level = std::max(level, state.write_level + 1);
+				if (use.write || transition)
+				{
+					level = std::max(level, state.read_level + 1);
+				}
+			}
+			pass.level = static_cast<uint32_t>(level);
+
+			for (const auto& use : pass.uses)
+			{
+				ResourceState& state = states[use.resource];
+				bool transition = resources_[use.resource].is_image && use.info.layout != state.layout;
+				if (use.write || transition)
+				{
+					// a layout transition is a write as far as later readers are concerned
+					state.write_level = level;
+					state.read_level = -1;
+				}
+				else
+				{
+					state.read_level = std::max(state.read_level, level);
+				}
+				state.layout = use.info.layout;
+				state.written = state.written || use.write;
+			}
+			execution_order_.push_back(id);
+		}
+
+		std::stable_sort(execution_order_.begin(), execution_order_.end(), [this](PassId a, PassId b) {
+			return passes_[a].level < passes_[b].level;
+		});
+
+		for (PassId id : execution_order_)
+		{
+			for (const auto& use : passes_[id].uses)
+			{
+				Resource& resource = resources_[use.resource];
+				resource.first_use = std::min(resource.first_use, passes_[id].level);
+				resource.last_use = std::max(resource.last_use, passes_[id].level);
+			}
+		}
+	}
+
+	void VulkanEngineRenderGraph::CreateTransientResources()
+	{
+		// usage is whatever the surviving passes need on top of the description
+		std::vector<VkImageUsageFlags> image_usages(resources_.size());
+		std::vector<VkBufferUsageFlags> buffer_usages(resources_.size());
+		for (PassId id : execution_order_)
+		{
+			for (const auto& use : passes_[id].uses)
+			{
+				image_usages[use.resource] |= use.info.image_usage;
+				buffer_usages[use.resource] |= use.info.buffer_usage;
+			}
+		}
+
+		for (size_t i = 0; i < resources_.size(); ++i)
+		{
+			Resource& resource = resources_[i];
+			if (resource.imported || resource.first_use == ~0u)
+			{
+				continue;
+			}
+
+			if (resource.is_image)
+			{
+				VkImageCreateInfo image_info{};
+				image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+				image_info.imageType = VK_IMAGE_TYPE_2D;
+				image_info.extent = { resource.image_desc.extent.width, resource.image_desc.extent.height, 1 };
+				image_info.mipLevels = resource.image_desc.mip_levels;
+				image_info.arrayLayers = 1;
+				image_info.format = resource.image_desc.format;
+				image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+				image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				image_info.usage = resource.image_desc.usage | image_usages[i];
+				image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+				image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				if (vkCreateImage(vulkanengine_device_.Device(), &image_info, nullptr, &resource.image) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create render graph image " + resource.name + "!");
+				}
+				vkGetImageMemoryRequirements(vulkanengine_device_.Device(), resource.image, &resource.memory_requirements);
+				++stats_.transient_image_count;
+			}
+			else
+			{
+				VkBufferCreateInfo buffer_info{};
+				buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+				buffer_info.size = resource.buffer_desc.size;
+				buffer_info.usage = resource.buffer_desc.usage | buffer_usages[i];
+				buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				if (vkCreateBuffer(vulkanengine_device_.Device(), &buffer_info, nullptr, &resource.buffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create render graph buffer " + resource.name + "!");
+				}
+				vkGetBufferMemoryRequirements(vulkanengine_device_.Device(), resource.buffer, &resource.memory_requirements);
+				++stats_.transient_buffer_count;
+			}
+			stats_.unaliased_bytes += resource.memory_requirements.size;
+		}
+	}
+
+	// Largest first, each resource joins the first block of its kind whose occupants are all dead before
+	// it is first used or only used after it is dead. Every occupant is bound at offset 0, so the block is
+	// as large as its first (largest) occupant. Images and buffers never share a block, which keeps
+	// bufferImageGranularity out of the picture
+	void VulkanEngineRenderGraph::AliasTransientMemory()
+	{
+		std::vector<ResourceId> transients{};
+		for (ResourceId id = 0; id < resources_.size(); ++id)
+		{
+			if (!resources_[id].imported && resources_[id].first_use != ~0u)
+			{
+				transients.push_back(id);
+			}
+		}
+		std::stable_sort(transients.begin(), transients.end(), [this](ResourceId a, ResourceId b) {
+			return resources_[a].memory_requirements.size > resources_[b].memory_requirements.size;
+		});
+
+		for (ResourceId id : transients)
+		{
+			Resource& resource = resources_[id];
+			const VkMemoryRequirements& requirements = resource.memory_requirements;
+			for (uint32_t block_index = 0; block_index < memory_blocks_.size() && resource.memory_block == ~0u; ++block_index)
+			{
+				MemoryBlock& block = memory_blocks_[block_index];
+				if (resources_[block.resources.front()].is_image != resource.is_image ||
+					(block.memory_type_bits & requirements.memoryTypeBits) == 0 ||
+					requirements.size > block.size)
+				{
+					continue;
+				}
+				bool overlaps = std::any_of(block.resources.begin(), block.resources.end(), [this, &resource](ResourceId other) {
+					return resources_[other].first_use <= resource.last_use && resource.first_use <= resources_[other].last_use;
+				});
+				if (!overlaps)
+				{
+					block.memory_type_bits &= requirements.memoryTypeBits;
+					block.resources.push_back(id);
+					resource.memory_block = block_index;
+				}
+			}
+
+			if (resource.memory_block == ~0u)
+			{
+				MemoryBlock block{};
+				block.size = requirements.size;
+				block.memory_type_bits = requirements.memoryTypeBits;
+				block.resources.push_back(id);
+				resource.memory_block = static_cast<uint32_t>(memory_blocks_.size());
+				memory_blocks_.push_back(std::move(block));
+			}
+		}
+
+		// every resource's union of stages and writes, for the barriers at the start of its lifetime
+		std::vector<VkPipelineStageFlags> stages(resources_.size());
+		std::vector<VkAccessFlags> writes(resources_.size());
+		for (PassId pass_id : execution_order_)
+		{
+			for (const auto& use : passes_[pass_id].uses)
+			{
+				stages[use.resource] |= use.info.stages;
+				writes[use.resource] |= use.info.access & kWriteAccessMask;
+			}
+		}
+
+		for (auto& block : memory_blocks_)
+		{
+			VkMemoryAllocateInfo alloc_info{};
+			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			alloc_info.allocationSize = block.size;
+			alloc_info.memoryTypeIndex = vulkanengine_device_.FindMemoryType(block.memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (vkAllocateMemory(vulkanengine_device_.Device(), &alloc_info, nullptr, &block.memory) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate render graph memory!");
+			}
+			stats_.transient_bytes += block.size;
+
+			std::sort(block.resources.begin(), block.resources.end(), [this](ResourceId a, ResourceId b) {
+				return resources_[a].first_use < resources_[b].first_use;
+			});
+			for (size_t i = 0; i < block.resources.size(); ++i)
+			{
+				Resource& resource = resources_[block.resources[i]];
+				// the previous occupant, or the last one of the previous frame for the first
+				ResourceId previous = block.resources[(i + block.resources.size() - 1) % block.resources.size()];
+				resource.wrap_stages = stages[previous];
+				resource.wrap_access = writes[previous];
+
+				if (resource.is_image)
+				{
+					if (vkBindImageMemory(vulkanengine_device_.Device(), resource.image, block.memory, 0) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to bind render graph image memory!");
+					}
+
+					VkImageViewCreateInfo view_info{};
+					view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+					view_info.image = resource.image;
+					view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+					view_info.format = resource.image_desc.format;
+					view_info.subresourceRange.aspectMask = IsDepthFormat(resource.image_desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+					view_info.subresourceRange.baseMipLevel = 0;
+					view_info.subresourceRange.levelCount = resource.image_desc.mip_levels;
+					view_info.subresourceRange.baseArrayLayer = 0;
+					view_info.subresourceRange.layerCount = 1;
+					if (vkCreateImageView(vulkanengine_device_.Device(), &view_info, nullptr, &resource.view) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to create render graph image view!");
+					}
+				}
+				else if (vkBindBufferMemory(vulkanengine_device_.Device(), resource.buffer, block.memory, 0) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to bind render graph buffer memory!");
+				}
+			}
+		}
+		stats_.memory_block_count = static_cast<uint32_t>(memory_blocks_.size());
+	}
+
+	// Tracks every resource through the execution order. A read only waits for the last write, and only
+	// in stages that have not waited for it yet; a write or layout change waits for the last write and
+	// every read since. Resources that start the frame undefined are transitioned from UNDEFINED
+	void VulkanEngineRenderGraph::ComputeBarriers()
+	{
+		struct ResourceState
+		{
+			VkImageLayout layout;
+			VkPipelineStageFlags write_stages;
+			VkAccessFlags write_access;
+			VkPipelineStageFlags read_stages = 0;		// since the last write
+			VkPipelineStageFlags visible_stages = 0;	// that waited for the last write
+			bool has_contents;
+		};
+		std::vector<ResourceState> states(resources_.size());
+		for (size_t i = 0; i < resources_.size(); ++i)
+		{
+			const Resource& resource = resources_[i];
+			ResourceState& state = states[i];
+			if (resource.imported)
+			{
+				// whatever happened before the frame, including the wait on the acquired image
+				state.layout = resource.initial_layout;
+				state.write_stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+				state.write_access = VK_ACCESS_MEMORY_WRITE_BIT;
+				state.has_contents = !resource.is_image || resource.initial_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+			else
+			{
+				state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				state.write_stages = resource.wrap_stages;
+				state.write_access = resource.wrap_access;
+				state.has_contents = false;
+			}
+		}
+
+		Pass* level_pass = nullptr;		// first pass of the current level, holding its barriers
+		for (PassId pass_id : execution_order_)
+		{
+			Pass& pass = passes_[pass_id];
+			if (level_pass == nullptr || level_pass->level != pass.level)
+			{
+				level_pass = &pass;
+			}
+
+			for (const auto& use : pass.uses)
+			{
+				const Resource& resource = resources_[use.resource];
+				ResourceState& state = states[use.resource];
+				bool transition = resource.is_image && use.info.layout != state.layout;
+				bool needs_barrier = use.write || transition || (use.info.stages & ~state.visible_stages) != 0;
+				if (needs_barrier)
+				{
+					Barrier barrier{};
+					barrier.resource = use.resource;
+					barrier.src_stages = state.write_stages;
+					barrier.src_access = state.write_access;
+					if (use.write || transition)
+					{
+						barrier.src_stages |= state.read_stages;
+					}
+					barrier.dst_stages = use.info.stages;
+					barrier.dst_access = use.info.access;
+					// contents nobody needs are discarded, which spares the transition
+					bool keep_contents = state.has_contents && (use.NeedsContents() || !use.attachment);
+					barrier.old_layout = keep_contents ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+					barrier.new_layout = resource.is_image ? use.info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+					// merge with a barrier of another pass of the same level on the same resource
+					auto merged = std::find_if(level_pass->barriers.begin(), level_pass->barriers.end(), [&barrier](const Barrier& other) {
+						return other.resource == barrier.resource && other.new_layout == barrier.new_layout;
+					});
+					if (merged != level_pass->barriers.end())
+					{
+						merged->src_stages |= barrier.src_stages;
+						merged->src_access |= barrier.src_access;
+						merged->dst_stages |= barrier.dst_stages;
+						merged->dst_access |= barrier.dst_access;
+					}
+					else
+					{
+						level_pass->barriers.push_back(barrier);
+					}
+				}
+
+				if (use.write || transition)
+				{
+					state.write_stages = use.info.stages;
+					state.write_access = use.write ? use.info.access & kWriteAccessMask : 0;
+					state.read_stages = use.write ? 0 : use.info.stages;
+					state.visible_stages = use.info.stages;
+				}
+				else
+				{
+					state.read_stages |= use.info.stages;
+					state.visible_stages |= use.info.stages;
+				}
+				state.layout = resource.is_image ? use.info.layout : state.layout;
+				state.has_contents = state.has_contents || use.write;
+			}
+		}
+
+		final_barriers_.clear();
+		for (ResourceId id = 0; id < resources_.size(); ++id)
+		{
+			const Resource& resource = resources_[id];
+			const ResourceState& state = states[id];
+			if (!resource.imported || !resource.is_image ||
+				resource.final_layout == VK_IMAGE_LAYOUT_UNDEFINED || resource.final_layout == state.layout)
+			{
+				continue;
+			}
+			// whatever consumes the image after the frame waits on the submission, e.g. present
+			Barrier barrier{};
+			barrier.resource = id;
+			barrier.src_stages = state.write_stages | state.read_stages;
+			barrier.src_access = state.write_access;
+			barrier.dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			barrier.dst_access = 0;
+			barrier.old_layout = state.layout;
+			barrier.new_layout = resource.final_layout;
+			final_barriers_.push_back(barrier);
+		}
+	}
+
+	// Attachments load only what an earlier pass (or the frame's caller) left for them and store only
+	// what a later pass (or the caller) reads. Layout transitions all happen in the graph's barriers,
+	// so every attachment starts and ends its render pass in the layout the pass uses it in.
+	// With dynamic rendering only the load and store operations are needed, Execute passes them on
+	void VulkanEngineRenderGraph::CreateRenderPasses()
+	{
+		for (size_t order = 0; order < execution_order_.size(); ++order)
+		{
+			Pass& pass = passes_[execution_order_[order]];
+			if (pass.attachments.empty())
+			{
+				continue;
+			}
+
+			std::vector<VkAttachmentDescription> descriptions{};
+			std::vector<VkAttachmentReference> color_references{};
+			VkAttachmentReference depth_reference{};
+			bool has_depth = false;
+			std::string key{};
+			pass.extent = resources_[pass.uses[pass.attachments.front()].resource].image_desc.extent;
+
+			for (uint32_t use_index : pass.attachments)
+			{
+				ResourceUse& use = pass.uses[use_index];
+				const Resource& resource = resources_[use.resource];
+				if (resource.image_desc.extent.width != pass.extent.width || resource.image_desc.extent.height != pass.extent.height)
+				{
+					throw std::runtime_error("render graph pass " + pass.name + " has attachments of different sizes!");
+				}
+
+				// was anything written before this pass, in the frame or outside of it
+				bool has_contents = resource.imported && resource.initial_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+				for (size_t earlier = 0; earlier < order && !has_contents; ++earlier)
+				{
+					for (const auto& other : passes_[execution_order_[earlier]].uses)
+					{
+						has_contents = has_contents || (other.resource == use.resource && other.write);
+					}
+				}
+				use.load_op = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (has_contents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+
+				// is it read before being overwritten, in the frame or outside of it
+				bool read_later = resource.imported && resource.final_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+				bool decided = false;
+				for (size_t later = order + 1; later < execution_order_.size() && !decided; ++later)
+				{
+					for (const auto& other : passes_[execution_order_[later]].uses)
+					{
+						if (other.resource == use.resource)
+						{
+							read_later = other.NeedsContents();
+							decided = true;
+						}
+					}
+				}
+				use.store_op = read_later || !use.write ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				VkAttachmentDescription description{};
+				description.format = resource.image_desc.format;
+				description.samples = VK_SAMPLE_COUNT_1_BIT;
+				description.loadOp = use.load_op;
+				description.storeOp = use.store_op;
+				description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				description.initialLayout = use.info.layout;
+				description.finalLayout = use.info.layout;
+
+				VkAttachmentReference reference{ static_cast<uint32_t>(descriptions.size()), use.info.layout };
+				if (use.info.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+				{
+					color_references.push_back(reference);
+				}
+				else
+				{
+					if (has_depth)
+					{
+						throw std::runtime_error("render graph pass " + pass.name + " has more than one depth attachment!");
+					}
+					depth_reference = reference;
+					has_depth = true;
+				}
+				descriptions.push_back(description);
+				key += std::to_string(description.format) + "," + std::to_string(description.loadOp) + "," +
+					std::to_string(description.storeOp) + "," + std::to_string(description.initialLayout) + ";";
+			}
+
+			++stats_.render_pass_count;
+			if (dynamic_rendering_)
+			{
+				continue;
+			}
+			auto cached = render_pass_cache_.find(key);
+			if (cached != render_pass_cache_.end())
+			{
+				pass.render_pass = cached->second;
+				continue;
+			}
+
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = static_cast<uint32_t>(color_references.size());
+			subpass.pColorAttachments = color_references.data();
+			subpass.pDepthStencilAttachment = has_depth ? &depth_reference : nullptr;
+
+			VkRenderPassCreateInfo render_pass_info{};
+			render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			render_pass_info.attachmentCount = static_cast<uint32_t>(descriptions.size());
+			render_pass_info.pAttachments = descriptions.data();
+			render_pass_info.subpassCount = 1;
+			render_pass_info.pSubpasses = &subpass;
+			if (vkCreateRenderPass(vulkanengine_device_.Device(), &render_pass_info, nullptr, &pass.render_pass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass for render graph pass " + pass.name + "!");
+			}
+			render_pass_cache_.emplace(key, pass.render_pass);
+		}
+	}
+
+	RenderTargetInfo VulkanEngineRenderGraph::GetRenderTarget(PassId pass_id) const
+	{
+		const Pass& pass = passes_[pass_id];
+		RenderTargetInfo render_target{};
+		render_target.render_pass = pass.render_pass;
+		for (uint32_t use_index : pass.attachments)
+		{
+			const ResourceUse& use = pass.uses[use_index];
+			VkFormat format = resources_[use.resource].image_desc.format;
+			if (use.info.layout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+			{
+				render_target.depth_format = format;
+			}
+			else if (render_target.color_format == VK_FORMAT_UNDEFINED)
+			{
+				render_target.color_format = format;
+			}
+		}
+		return render_target;
+	}
+
+	VkFramebuffer VulkanEngineRenderGraph::GetFramebuffer(Pass& pass)
+	{
+		attachment_views_.clear();
+		for (uint32_t use_index : pass.attachments)
+		{
+			VkImageView view = resources_[pass.uses[use_index].resource].view;
+			assert(view != VK_NULL_HANDLE && "Imported attachment has no image, see SetImportedImage");
+			attachment_views_.push_back(view);
+		}
+
+		for (const auto& framebuffer : pass.framebuffers)
+		{
+			if (framebuffer.first == attachment_views_)
+			{
+				return framebuffer.second;
+			}
+		}
+
+		VkFramebufferCreateInfo framebuffer_info{};
+		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebuffer_info.renderPass = pass.render_pass;
+		framebuffer_info.attachmentCount = static_cast<uint32_t>(attachment_views_.size());
+		framebuffer_info.pAttachments = attachment_views_.data();
+		framebuffer_info.width = pass.extent.width;
+		framebuffer_info.height = pass.extent.height;
+		framebuffer_info.layers = 1;
+
+		VkFramebuffer framebuffer;
+		if (vkCreateFramebuffer(vulkanengine_device_.Device(), &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create framebuffer for render graph pass " + pass.name + "!");
+		}
+		pass.framebuffers.emplace_back(attachment_views_, framebuffer);
+		return framebuffer;
+	}
+
+	void VulkanEngineRenderGraph::RecordBarriers(VkCommandBuffer command_buffer, const std::vector<Barrier>& barriers)
+	{
+		if (barriers.empty())
+		{
+			return;
+		}
+
+		image_barriers_.clear();
+		buffer_barriers_.clear();
+		VkPipelineStageFlags src_stages = 0;
+		VkPipelineStageFlags dst_stages = 0;
+		for (const auto& barrier : barriers)
+		{
+			const Resource& resource = resources_[barrier.resource];
+			src_stages |= barrier.src_stages;
+			dst_stages |= barrier.dst_stages;
+			if (resource.is_image)
+			{
+				assert(resource.image != VK_NULL_HANDLE && "Imported image has no image, see SetImportedImage");
+				VkImageMemoryBarrier image_barrier{};
+				image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				image_barrier.srcAccessMask = barrier.src_access;
+				image_barrier.dstAccessMask = barrier.dst_access;
+				image_barrier.oldLayout = barrier.old_layout;
+				image_barrier.newLayout = barrier.new_layout;
+				image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.image = resource.image;
+				image_barrier.subresourceRange = { GetBarrierAspect(resource.image_desc.format), 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+				image_barriers_.push_back(image_barrier);
+			}
+			else
+			{
+				VkBufferMemoryBarrier buffer_barrier{};
+				buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				buffer_barrier.srcAccessMask = barrier.src_access;
+				buffer_barrier.dstAccessMask = barrier.dst_access;
+				buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				buffer_barrier.buffer = resource.buffer;
+				buffer_barrier.offset = 0;
+				buffer_barrier.size = VK_WHOLE_SIZE;
+				buffer_barriers_.push_back(buffer_barrier);
+			}
+		}
+
+		vkCmdPipelineBarrier(
+			command_buffer,
+			src_stages,
+			dst_stages,
+			0,
+			0,
+			nullptr,
+			static_cast<uint32_t>(buffer_barriers_.size()),
+			buffer_barriers_.data(),
+			static_cast<uint32_t>(image_barriers_.size()),
+			image_barriers_.data());
+		stats_.barrier_count += static_cast<uint32_t>(barriers.size());
+	}
+
+	void VulkanEngineRenderGraph::Execute(FrameInfo& frame_info)
+	{
+		VULKANENGINE_PROFILE_FUNCTION();
+		assert(compiled_ && "Render graph has to be compiled before it is executed");
+
+		VkCommandBuffer command_buffer = frame_info.command_buffer;
+		stats_.barrier_count = 0;
+		for (PassId pass_id : execution_order_)
+		{
+			Pass& pass = passes_[pass_id];
+			RecordBarriers(command_buffer, pass.barriers);
+
+			// timed only: a statistics query here would keep the passes' draw scopes from having their own
+			VulkanEngineGpuProfiler::Scope gpu_scope{ frame_info.gpu_profiler, command_buffer, pass.name.c_str(), false };
+			if (pass.attachments.empty())
+			{
+				pass.execute(frame_info);
+				continue;
+			}
+
+			if (dynamic_rendering_)
+			{
+				BeginRendering(command_buffer, pass);
+			}
+			else
+			{
+				clear_values_.clear();
+				for (uint32_t use_index : pass.attachments)
+				{
+					clear_values_.push_back(pass.uses[use_index].clear_value);
+				}
+
+				VkRenderPassBeginInfo render_pass_info{};
+				render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				render_pass_info.renderPass = pass.render_pass;
+				render_pass_info.framebuffer = GetFramebuffer(pass);
+				render_pass_info.renderArea.offset = { 0, 0 };
+				render_pass_info.renderArea.extent = pass.extent;
+				render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values_.size());
+				render_pass_info.pClearValues = clear_values_.data();
+				vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+			}
+
+			VkViewport viewport{};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = static_cast<float>(pass.extent.width);
+			viewport.height = static_cast<float>(pass.extent.height);
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			VkRect2D scissor{ {0, 0}, pass.extent };
+			vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+			vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+			pass.execute(frame_info);
+			if (dynamic_rendering_)
+			{
+				vulkanengine_device_.CmdEndRendering(command_buffer);
+			}
+			else
+			{
+				vkCmdEndRenderPass(command_buffer);
+			}
+		}
+		RecordBarriers(command_buffer, final_barriers_);
+	}
+
+	void VulkanEngineRenderGraph::BeginRendering(VkCommandBuffer command_buffer, const Pass& pass)
+	{
+		color_attachment_infos_.clear();
+		VkRenderingAttachmentInfoKHR depth_attachment_info{};
+		bool has_depth = false;
+		for (uint32_t use_index : pass.attachments)
+		{
+			const ResourceUse& use = pass.uses[use_index];
+			VkImageView view = resources_[use.resource].view;
+			assert(view != VK_NULL_HANDLE && "Imported attachment has no image, see SetImportedImage");
+
+			VkRenderingAttachmentInfoKHR attachment_info{};
+			attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			attachment_info.imageView = view;
+			attachment_info.imageLayout = use.info.layout;
+			attachment_info.loadOp = use.load_op;
+			attachment_info.storeOp = use.store_op;
+			attachment_info.clearValue = use.clear_value;
+			if (use.info.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+			{
+				color_attachment_infos_.push_back(attachment_info);
+			}
+			else
+			{
+				depth_attachment_info = attachment_info;
+				has_depth = true;
+			}
+		}
+
+		VkRenderingInfoKHR rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		rendering_info.renderArea = { {0, 0}, pass.extent };
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = static_cast<uint32_t>(color_attachment_infos_.size());
+		rendering_info.pColorAttachments = color_attachment_infos_.data();
+		rendering_info.pDepthAttachment = has_depth ? &depth_attachment_info : nullptr;
+		vulkanengine_device_.CmdBeginRendering(command_buffer, rendering_info);
+	}
+
+	void VulkanEngineRenderGraph::DestroyCompiledState()
+	{
+		VkDevice device = vulkanengine_device_.Device();
+		for (auto& pass : passes_)
+		{
+			for (auto& framebuffer : pass.framebuffers)
+			{
+				vkDestroyFramebuffer(device, framebuffer.second, nullptr);
+			}
+			pass.framebuffers.clear();
+			pass.barriers.clear();
+			pass.render_pass = VK_NULL_HANDLE;
+			pass.culled = false;
+			pass.level = 0;
+		}
+		for (auto& render_pass : render_pass_cache_)
+		{
+			vkDestroyRenderPass(device, render_pass.second, nullptr);
+		}
+		render_pass_cache_.clear();
+
+		for (auto& resource : resources_)
+		{
+			resource.first_use = ~0u;
+			resource.last_use = 0;
+			resource.memory_block = ~0u;
+			resource.wrap_stages = 0;
+			resource.wrap_access = 0;
+			if (resource.imported)
+			{
+				continue;
+			}
+			vkDestroyImageView(device, resource.view, nullptr);
+			vkDestroyImage(device, resource.image, nullptr);
+			vkDestroyBuffer(device, resource.buffer, nullptr);
+			resource.view = VK_NULL_HANDLE;
+			resource.image = VK_NULL_HANDLE;
+			resource.buffer = VK_NULL_HANDLE;
+		}
+		for (auto& block : memory_blocks_)
+		{
+			vkFreeMemory(device, block.memory, nullptr);
+		}
+		memory_blocks_.clear();
+
+		execution_order_.clear();
+		final_barriers_.clear();
+		compiled_ = false;
+		stats_ = {};
+	}
+}  // namespace vulkanengine
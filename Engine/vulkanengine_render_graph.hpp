@@ -0,0 +1,283 @@
+#pragma once
+
+#include "vulkanengine_device.hpp"
+#include "vulkanengine_frame_info.hpp"
+#include "vulkanengine_pipeline.hpp"
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Describes a frame as passes that declare which images and buffers they read and write.
+	// Compile culls passes whose results nobody uses, orders the rest by dependency, derives every
+	// pipeline barrier and layout transition from the declared accesses, and places transient resources
+	// whose lifetimes don't overlap in the same memory. Execute then records the frame: barriers, render
+	// pass begin/end (or dynamic rendering) for passes with attachments, and the pass callbacks in between.
+	// The graph is built once and compiled again only when its setup changes (e.g. the swap chain was
+	// recreated); imported resources may point at different images every frame through SetImportedImage
+	class VulkanEngineRenderGraph
+	{
+	public:
+		using ResourceId = uint32_t;
+		using PassId = uint32_t;
+		static constexpr ResourceId kInvalidResource = ~0u;
+
+		// How a pass uses a resource; the graph derives stages, access masks and image layouts from it
+		enum class Access
+		{
+			kColorAttachment,		// write
+			kDepthAttachment,		// depth test and write
+			kDepthAttachmentRead,	// depth test only, the image stays readable by shaders
+			kFragmentSampled,
+			kComputeSampled,
+			kComputeStorageRead,
+			kComputeStorageWrite,	// write
+			kTransferSrc,
+			kTransferDst,			// write
+			kVertexBuffer,
+			kIndexBuffer,
+			kIndirectBuffer,
+			kVertexShaderRead,		// uniform or storage buffer
+			kFragmentShaderRead,	// uniform or storage buffer
+		};
+
+		struct ImageDesc
+		{
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent{};
+			uint32_t mip_levels = 1;
+			VkImageUsageFlags usage = 0;	// on top of what the declared accesses need
+		};
+
+		struct BufferDesc
+		{
+			VkDeviceSize size = 0;
+			VkBufferUsageFlags usage = 0;	// on top of what the declared accesses need
+		};
+
+		class PassBuilder
+		{
+		public:
+			PassBuilder& Read(ResourceId resource, Access access);
+			PassBuilder& Write(ResourceId resource, Access access);
+			// Attachments without a clear value load their previous contents, or don't care on first use
+			PassBuilder& ClearColor(ResourceId resource, const VkClearColorValue& value);
+			PassBuilder& ClearDepth(ResourceId resource, float depth);
+			// Keeps the pass even if nothing reads what it writes, e.g. for readbacks or queries
+			PassBuilder& SetSideEffects();
+
+		private:
+			friend class VulkanEngineRenderGraph;
+			PassBuilder(VulkanEngineRenderGraph& graph, PassId pass) : graph_{ graph }, pass_{ pass } {}
+
+			VulkanEngineRenderGraph& graph_;
+			PassId pass_;
+		};
+
+		using SetupFunction = std::function<void(PassBuilder&)>;
+		// Runs inside the pass's render pass when it has attachments, with the viewport and scissor covering them
+		using ExecuteFunction = std::function<void(FrameInfo&)>;
+
+		// Filled by Compile, barrier_count by Execute
+		struct Stats
+		{
+			uint32_t pass_count = 0;
+			uint32_t culled_pass_count = 0;
+			uint32_t render_pass_count = 0;			// passes with attachments
+			uint32_t barrier_count = 0;				// image and buffer barriers of the last Execute
+			uint32_t transient_image_count = 0;
+			uint32_t transient_buffer_count = 0;
+			uint32_t memory_block_count = 0;
+			VkDeviceSize transient_bytes = 0;		// allocated for transient resources
+			VkDeviceSize unaliased_bytes = 0;		// what they would take with a block each
+		};
+
+		// With [dynamic_rendering] passes with attachments are begun with vkCmdBeginRenderingKHR, and no
+		// render passes or framebuffers are created; their pipelines must be built for dynamic rendering too
+		explicit VulkanEngineRenderGraph(VulkanEngineDevice& device, bool dynamic_rendering = false);
+		~VulkanEngineRenderGraph();
+
+		VulkanEngineRenderGraph(const VulkanEngineRenderGraph&) = delete;
+		VulkanEngineRenderGraph& operator=(const VulkanEngineRenderGraph&) = delete;
+
+		// Drops all passes and resources, e.g. before building the graph for a new swap chain.
+		// The device must be idle, as transient memory is freed
+		void Reset();
+
+		// An image owned elsewhere. It is expected in [initial_layout] when the frame starts (UNDEFINED
+		// discards its contents) and left in [final_layout] (UNDEFINED leaves it in its last layout).
+		// The last pass writing an imported resource is never culled
+		ResourceId ImportImage(
+			const std::string& name,
+			const ImageDesc& desc,
+			VkImageLayout initial_layout,
+			VkImageLayout final_layout);
+		ResourceId ImportBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size);
+		// Images of imported resources may change every frame, e.g. the acquired swap chain image
+		void SetImportedImage(ResourceId resource, VkImage image, VkImageView view);
+		// Created by Compile and only valid during the frame; contents don't survive between frames
+		ResourceId CreateImage(const std::string& name, const ImageDesc& desc);
+		ResourceId CreateBuffer(const std::string& name, const BufferDesc& desc);
+
+		// [setup] runs immediately and declares the pass's resource accesses
+		PassId AddPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+		// Throws std::runtime_error on a read of a resource nothing wrote, or on mismatched attachments
+		void Compile();
+		// Records every pass that survived culling into frame_info.command_buffer
+		void Execute(FrameInfo& frame_info);
+
+		bool IsCompiled() const { return compiled_; }
+		bool IsPassCulled(PassId pass) const { return passes_[pass].culled; }
+		// Valid after Compile; compatible with every pipeline built for the same attachment formats.
+		// Always VK_NULL_HANDLE with dynamic rendering
+		VkRenderPass GetRenderPass(PassId pass) const { return passes_[pass].render_pass; }
+		// What pipelines drawing in [pass] are built for: its render pass, first color and depth formats
+		RenderTargetInfo GetRenderTarget(PassId pass) const;
+		VkImage GetImage(ResourceId resource) const { return resources_[resource].image; }
+		VkImageView GetImageView(ResourceId resource) const { return resources_[resource].view; }
+		VkBuffer GetBuffer(ResourceId resource) const { return resources_[resource].buffer; }
+		const Stats& GetStats() const { return stats_; }
+
+		// The aspects a layout transition of a [format] image has to name: both of combined depth stencil formats
+		static VkImageAspectFlags GetBarrierAspect(VkFormat format);
+
+	private:
+		struct Resource
+		{
+			std::string name;
+			bool is_image = true;
+			bool imported = false;
+			ImageDesc image_desc{};
+			BufferDesc buffer_desc{};
+			VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+
+			// from Compile
+			// levels of the first and last pass using it; barriers are recorded per level, so lifetimes
+			// that only touch at a level boundary still get a barrier between them
+			uint32_t first_use = ~0u;
+			uint32_t last_use = 0;
+			uint32_t memory_block = ~0u;	// transient only
+			VkMemoryRequirements memory_requirements{};
+			// what the frame's first barrier on this resource waits for: the accesses of the resource that
+			// used its memory last, which for a resource with a block of its own is itself a frame earlier
+			VkPipelineStageFlags wrap_stages = 0;
+			VkAccessFlags wrap_access = 0;
+		};
+
+		struct AccessInfo
+		{
+			VkPipelineStageFlags stages;
+			VkAccessFlags access;
+			VkImageLayout layout;			// UNDEFINED for buffer accesses
+			VkImageUsageFlags image_usage;
+			VkBufferUsageFlags buffer_usage;
+		};
+
+		// Every access of one resource by one pass, merged
+		struct ResourceUse
+		{
+			ResourceId resource;
+			AccessInfo info;
+			bool read = false;
+			bool write = false;
+			bool attachment = false;
+			bool clear = false;
+			VkClearValue clear_value{};
+			// from Compile, attachments only
+			VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+
+			// attachments load what is there unless they clear it
+			bool NeedsContents() const { return read || (attachment && !clear); }
+		};
+
+		// One resource's transition before a pass, handles are looked up at Execute
+		struct Barrier
+		{
+			ResourceId resource;
+			VkPipelineStageFlags src_stages;
+			VkAccessFlags src_access;
+			VkPipelineStageFlags dst_stages;
+			VkAccessFlags dst_access;
+			VkImageLayout old_layout;
+			VkImageLayout new_layout;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			ExecuteFunction execute;
+			std::vector<ResourceUse> uses;
+			std::vector<uint32_t> attachments;	// into uses, color first, then depth
+			bool side_effects = false;
+
+			// from Compile
+			bool culled = false;
+			uint32_t level = 0;			// longest dependency chain leading to the pass
+			// the barriers of every pass of a level are merged into one, recorded before its first pass
+			std::vector<Barrier> barriers;
+			VkRenderPass render_pass = VK_NULL_HANDLE;
+			VkExtent2D extent{};
+			// a handful of imported image combinations at most, so a linear search is enough
+			std::vector<std::pair<std::vector<VkImageView>, VkFramebuffer>> framebuffers;
+		};
+
+		struct MemoryBlock
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t memory_type_bits = 0;
+			std::vector<ResourceId> resources;	// by first use
+		};
+
+		static AccessInfo GetAccessInfo(Access access);
+		static bool IsAttachment(Access access);
+		static bool IsDepthFormat(VkFormat format);
+
+		void AddAccess(PassId pass, ResourceId resource, Access access, bool write);
+		ResourceUse& FindUse(PassId pass, ResourceId resource);
+		void CullPasses();
+		void SchedulePasses();
+		void CreateTransientResources();
+		void AliasTransientMemory();
+		void ComputeBarriers();
+		void CreateRenderPasses();
+		VkFramebuffer GetFramebuffer(Pass& pass);
+		void BeginRendering(VkCommandBuffer command_buffer, const Pass& pass);
+		void RecordBarriers(VkCommandBuffer command_buffer, const std::vector<Barrier>& barriers);
+		void DestroyCompiledState();
+
+		VulkanEngineDevice& vulkanengine_device_;
+		const bool dynamic_rendering_;
+		std::vector<Resource> resources_;
+		std::vector<Pass> passes_;
+		std::vector<PassId> execution_order_;		// surviving passes
+		std::vector<Barrier> final_barriers_;		// imported resources to their final layouts
+		std::vector<MemoryBlock> memory_blocks_;
+		// shared by passes with the same attachment formats, operations and layouts
+		std::unordered_map<std::string, VkRenderPass> render_pass_cache_;
+		bool compiled_ = false;
+		Stats stats_{};
+
+		// reused by Execute to avoid per frame allocations
+		std::vector<VkImageMemoryBarrier> image_barriers_;
+		std::vector<VkBufferMemoryBarrier> buffer_barriers_;
+		std::vector<VkClearValue> clear_values_;
+		std::vector<VkImageView> attachment_views_;
+		std::vector<VkRenderingAttachmentInfoKHR> color_attachment_infos_;
+	};
+}  // namespace vulkanengine
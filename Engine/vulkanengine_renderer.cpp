@@ -1,15 +1,24 @@
 #include "vulkanengine_renderer.hpp"
 
+#include "vulkanengine_cpu_profiler.hpp"
+#include "vulkanengine_render_graph.hpp"
+
 // std
 #include <stdexcept>
 #include <cassert>
 #include <array>
+#include <iostream>
 
 namespace vulkanengine
 {
-	VulkanEngineRenderer::VulkanEngineRenderer(VulkanEngineWindow& window, VulkanEngineDevice& device)
-		: vulkanengine_window_{window}, vulkanengine_device_{device}
+	VulkanEngineRenderer::VulkanEngineRenderer(VulkanEngineWindow& window, VulkanEngineDevice& device, bool dynamic_rendering, bool swap_chain_pass)
+		: vulkanengine_window_{window}, vulkanengine_device_{device}, swap_chain_pass_{swap_chain_pass}
 	{
+		dynamic_rendering_ = dynamic_rendering && device.SupportsDynamicRendering();
+		if (dynamic_rendering && !dynamic_rendering_)
+		{
+			std::cout << "renderer: dynamic rendering unsupported, using render passes" << std::endl;
+		}
 		RecreateSwapChain();
 		CreateCommandBuffers();
 	}
@@ -32,18 +41,19 @@ namespace vulkanengine
 
 		if (vulkanengine_swap_chain_ == nullptr)
 		{
-			vulkanengine_swap_chain_ = std::make_unique<VulkanEngineSwapChain>(vulkanengine_device_, extent);
+			vulkanengine_swap_chain_ = std::make_unique<VulkanEngineSwapChain>(vulkanengine_device_, extent, dynamic_rendering_, swap_chain_pass_);
 		}
 		else
 		{
 			std::shared_ptr<VulkanEngineSwapChain> old_swap_chain = std::move(vulkanengine_swap_chain_);
-			vulkanengine_swap_chain_ = std::make_unique<VulkanEngineSwapChain>(vulkanengine_device_, extent, old_swap_chain);
+			vulkanengine_swap_chain_ = std::make_unique<VulkanEngineSwapChain>(vulkanengine_device_, extent, old_swap_chain, dynamic_rendering_, swap_chain_pass_);
 
 			if (!old_swap_chain->CompareSwapFormats(*vulkanengine_swap_chain_.get()))
 			{
 				throw std::runtime_error("Swap chain image or depth format has changed!");
 			}
 		}
+		++swap_chain_generation_;
 
 		// CreatePipeline();
 	}
@@ -76,6 +86,7 @@ namespace vulkanengine
 
 	VkCommandBuffer VulkanEngineRenderer::BeginFrame()
 	{
+		VULKANENGINE_PROFILE_FUNCTION();
 		assert(!is_frame_started_ && "Can't call BeginFrame while frame is already in progress");
 
 		auto result = vulkanengine_swap_chain_->AcquireNextImage(&current_image_index_);
@@ -106,6 +117,7 @@ namespace vulkanengine
 
 	void VulkanEngineRenderer::EndFrame()
 	{
+		VULKANENGINE_PROFILE_FUNCTION();
 		assert(is_frame_started_ && "Can't call EndFrame while frame is not in progress");
 		auto command_buffer = GetCurrentCommandBuffer();
 		if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
@@ -132,23 +144,32 @@ namespace vulkanengine
 	void VulkanEngineRenderer::BeginSwapChainRenderPass(VkCommandBuffer command_buffer)
 	{
 		assert(is_frame_started_ && "Can't call BeginSwapChainRenderPass while frame is not in progress");
+		assert(swap_chain_pass_ && "Can't call BeginSwapChainRenderPass on a renderer created without a swap chain pass");
 		assert(command_buffer && GetCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
 
-		VkRenderPassBeginInfo render_pass_info{};
-		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_info.renderPass = vulkanengine_swap_chain_->GetRenderPass();
-		render_pass_info.framebuffer = vulkanengine_swap_chain_->GetFrameBuffer(current_image_index_);
-
-		render_pass_info.renderArea.offset = { 0, 0 };
-		render_pass_info.renderArea.extent = vulkanengine_swap_chain_->GetSwapChainExtent();
-
 		std::array<VkClearValue, 2> clear_values{};
 		clear_values[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };	// index 0 is the color attachment
 		clear_values[1].depthStencil = { 1.0f, 0 };			// index 1 is the depth attachment
-		render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-		render_pass_info.pClearValues = clear_values.data();
 
-		vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+		if (dynamic_rendering_)
+		{
+			BeginSwapChainRendering(command_buffer, clear_values[0], clear_values[1]);
+		}
+		else
+		{
+			VkRenderPassBeginInfo render_pass_info{};
+			render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			render_pass_info.renderPass = vulkanengine_swap_chain_->GetRenderPass();
+			render_pass_info.framebuffer = vulkanengine_swap_chain_->GetFrameBuffer(current_image_index_);
+
+			render_pass_info.renderArea.offset = { 0, 0 };
+			render_pass_info.renderArea.extent = vulkanengine_swap_chain_->GetSwapChainExtent();
+
+			render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+			render_pass_info.pClearValues = clear_values.data();
+
+			vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+		}
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -167,7 +188,100 @@ namespace vulkanengine
 		assert(is_frame_started_ && "Can't call EndSwapChainRenderPass while frame is not in progress");
 		assert(command_buffer && GetCurrentCommandBuffer() && "Can't end render pass on command buffer from a different frame");
 
-		vkCmdEndRenderPass(command_buffer);
+		if (dynamic_rendering_)
+		{
+			EndSwapChainRendering(command_buffer);
+		}
+		else
+		{
+			vkCmdEndRenderPass(command_buffer);
+		}
+	}
+
+	// Does what the swap chain render pass does through its attachment layouts and subpass dependency:
+	// both images start out UNDEFINED (their contents are cleared anyway), the color image waits for the
+	// acquire semaphore at COLOR_ATTACHMENT_OUTPUT, and the depth image for the previous frame using it
+	void VulkanEngineRenderer::BeginSwapChainRendering(
+		VkCommandBuffer command_buffer, const VkClearValue& clear_color, const VkClearValue& clear_depth)
+	{
+		std::array<VkImageMemoryBarrier, 2> barriers{};
+		barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[0].srcAccessMask = 0;
+		barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].image = vulkanengine_swap_chain_->GetImage(current_image_index_);
+		barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		barriers[1] = barriers[0];
+		barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		barriers[1].image = vulkanengine_swap_chain_->GetDepthImage(current_image_index_);
+		barriers[1].subresourceRange.aspectMask = VulkanEngineRenderGraph::GetBarrierAspect(vulkanengine_swap_chain_->GetSwapChainDepthFormat());
+
+		vkCmdPipelineBarrier(
+			command_buffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+
+		VkRenderingAttachmentInfoKHR color_attachment{};
+		color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		color_attachment.imageView = vulkanengine_swap_chain_->GetImageView(current_image_index_);
+		color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.clearValue = clear_color;
+
+		VkRenderingAttachmentInfoKHR depth_attachment{};
+		depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		depth_attachment.imageView = vulkanengine_swap_chain_->GetDepthImageView(current_image_index_);
+		depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depth_attachment.clearValue = clear_depth;
+
+		VkRenderingInfoKHR rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		rendering_info.renderArea = { {0, 0}, vulkanengine_swap_chain_->GetSwapChainExtent() };
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &color_attachment;
+		rendering_info.pDepthAttachment = &depth_attachment;
+
+		vulkanengine_device_.CmdBeginRendering(command_buffer, rendering_info);
+	}
+
+	void VulkanEngineRenderer::EndSwapChainRendering(VkCommandBuffer command_buffer)
+	{
+		vulkanengine_device_.CmdEndRendering(command_buffer);
+
+		// presentation waits on the render finished semaphore, so nothing to make available beyond the layout change
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.newLayout = GetSwapChainPresentLayout();
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = vulkanengine_swap_chain_->GetImage(current_image_index_);
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		vkCmdPipelineBarrier(
+			command_buffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
 	}
 
 }  // namespace vulkanengine
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vulkanengine_device.hpp"
+#include "vulkanengine_pipeline.hpp"
 #include "vulkanengine_swap_chain.hpp"
 #include "vulkanengine_window.hpp"
 
@@ -14,21 +15,57 @@ namespace vulkanengine
 	class VulkanEngineRenderer
 	{
 	public:
-		VulkanEngineRenderer(VulkanEngineWindow& window, VulkanEngineDevice& device);
+		// [dynamic_rendering] renders into the swap chain with VK_KHR_dynamic_rendering instead of a render pass
+		// and framebuffers; ignored, with a message, on devices without it.
+		// Without [swap_chain_pass] the swap chain gets no depth images or framebuffers and
+		// BeginSwapChainRenderPass can't be used, for apps whose render graph owns the attachments
+		VulkanEngineRenderer(VulkanEngineWindow& window, VulkanEngineDevice& device, bool dynamic_rendering = false, bool swap_chain_pass = true);
 		~VulkanEngineRenderer();
 
 		VulkanEngineRenderer(const VulkanEngineRenderer&) = delete;
 		VulkanEngineRenderer& operator=(const VulkanEngineRenderer&) = delete;
 
+		// VK_NULL_HANDLE with dynamic rendering, see GetSwapChainRenderTarget
 		VkRenderPass GetSwapChainRenderPass() const { return vulkanengine_swap_chain_->GetRenderPass(); }
+		bool UsesDynamicRendering() const { return dynamic_rendering_; }
+		// For pipelines drawing into the swap chain, with either render pass or dynamic rendering
+		RenderTargetInfo GetSwapChainRenderTarget() const
+		{
+			return { GetSwapChainRenderPass(), GetSwapChainImageFormat(), GetSwapChainDepthFormat() };
+		}
 		float GetAspectRatio() const { return vulkanengine_swap_chain_->ExtentAspectRatio(); }
+		VkExtent2D GetSwapChainExtent() const { return vulkanengine_swap_chain_->GetSwapChainExtent(); }
+		VkFormat GetSwapChainImageFormat() const { return vulkanengine_swap_chain_->GetSwapChainImageFormat(); }
+		VkFormat GetSwapChainDepthFormat() const { return vulkanengine_swap_chain_->GetSwapChainDepthFormat(); }
+		// The layout swap chain images have to be in when the frame is submitted
+		VkImageLayout GetSwapChainPresentLayout() const
+		{
+			return vulkanengine_device_.IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		}
+		// Changes whenever the swap chain is recreated, which invalidates anything built from its images
+		uint32_t GetSwapChainGeneration() const { return swap_chain_generation_; }
 		bool IsFrameInProgress() const { return is_frame_started_; }
+		// Of the latest frame, see VulkanEngineSwapChain::GetFenceWaitMilliseconds
+		float GetFenceWaitMilliseconds() const { return vulkanengine_swap_chain_->GetFenceWaitMilliseconds(); }
 
 		VkCommandBuffer GetCurrentCommandBuffer() const {
 			assert(is_frame_started_ && "Cannot get command buffer when frame is not in progress");
 			return command_buffers_[current_frame_index_];
 		}
 
+		// The image acquired for the frame in progress, for rendering outside the swap chain's render pass
+		VkImage GetSwapChainImage() const
+		{
+			assert(is_frame_started_ && "Cannot get swap chain image when frame is not in progress");
+			return vulkanengine_swap_chain_->GetImage(current_image_index_);
+		}
+
+		VkImageView GetSwapChainImageView() const
+		{
+			assert(is_frame_started_ && "Cannot get swap chain image view when frame is not in progress");
+			return vulkanengine_swap_chain_->GetImageView(current_image_index_);
+		}
+
 		int GetFrameIndex() const
 		{
 			assert(is_frame_started_ && "Cannot get frame index when frame is not in progress");
@@ -44,6 +81,8 @@ namespace vulkanengine
 		void CreateCommandBuffers();
 		void FreeCommandBuffers();
 		void RecreateSwapChain();
+		void BeginSwapChainRendering(VkCommandBuffer command_buffer, const VkClearValue& clear_color, const VkClearValue& clear_depth);
+		void EndSwapChainRendering(VkCommandBuffer command_buffer);
 
 		VulkanEngineWindow& vulkanengine_window_;
 		VulkanEngineDevice& vulkanengine_device_;
@@ -52,6 +91,9 @@ namespace vulkanengine
 
 		uint32_t current_image_index_;
 		int current_frame_index_{ 0 };
+		uint32_t swap_chain_generation_{ 0 };
 		bool is_frame_started_{ false };
+		bool dynamic_rendering_{ false };
+		bool swap_chain_pass_{ true };
 	};
 }  // namespace vulkanengine
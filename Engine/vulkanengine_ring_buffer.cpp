@@ -0,0 +1,109 @@
+#include "vulkanengine_ring_buffer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	// Rounds [size] up to a multiple of [alignment], a power of two
+	static VkDeviceSize Align(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		if (alignment > 0)
+		{
+			return (size + alignment - 1) & ~(alignment - 1);
+		}
+		return size;
+	}
+
+	VulkanEngineRingBuffer::VulkanEngineRingBuffer(
+		VulkanEngineDevice& device,
+		VkDeviceSize frame_capacity,
+		uint32_t frame_count,
+		VkBufferUsageFlags usage_flags)
+		: vulkanengine_device_{ device }, frame_count_{ frame_count }
+	{
+		assert(frame_count > 0 && "Ring buffer needs at least one frame partition");
+
+		const VkPhysicalDeviceLimits& limits = device.properties_.limits;
+
+		// Every chunk has to be a legal dynamic offset for each descriptor type the buffer can back
+		alignment_ = 1;
+		if (usage_flags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+		{
+			alignment_ = std::max(alignment_, limits.minUniformBufferOffsetAlignment);
+		}
+		if (usage_flags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+		{
+			alignment_ = std::max(alignment_, limits.minStorageBufferOffsetAlignment);
+		}
+
+		// Partitions are flushed independently, so they have to start on a nonCoherentAtomSize boundary
+		flush_alignment_ = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+		partition_size_ = Align(frame_capacity, std::max(alignment_, flush_alignment_));
+
+		buffer_ = std::make_unique<VulkanEngineBuffer>(
+			vulkanengine_device_,
+			partition_size_,
+			frame_count_,
+			usage_flags,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+		// Stays mapped for the lifetime of the ring buffer
+		if (buffer_->Map() != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map ring buffer!");
+		}
+	}
+
+	VulkanEngineRingBuffer::~VulkanEngineRingBuffer() {}
+
+	// Must only be called once the fence for frame_index has been waited on, as the partition is reused
+	void VulkanEngineRingBuffer::BeginFrame(int frame_index)
+	{
+		assert(frame_index >= 0 && static_cast<uint32_t>(frame_index) < frame_count_ && "Frame index out of range");
+		partition_begin_ = partition_size_ * frame_index;
+		head_ = partition_begin_;
+	}
+
+	VulkanEngineRingBuffer::Allocation VulkanEngineRingBuffer::Allocate(VkDeviceSize size)
+	{
+		VkDeviceSize offset = Align(head_, alignment_);
+		if (offset + size > partition_begin_ + partition_size_)
+		{
+			throw std::runtime_error("ring buffer frame partition exhausted!");
+		}
+		head_ = offset + size;
+
+		Allocation allocation{};
+		allocation.data = static_cast<char*>(buffer_->GetMappedMemory()) + offset;
+		allocation.offset = static_cast<uint32_t>(offset);
+		allocation.size = size;
+		return allocation;
+	}
+
+	// Makes everything written to the current partition visible to the device. Call before submitting the frame
+	VkResult VulkanEngineRingBuffer::Flush()
+	{
+		VkDeviceSize used = Align(head_ - partition_begin_, flush_alignment_);
+		if (used == 0)
+		{
+			return VK_SUCCESS;
+		}
+		return buffer_->Flush(used, partition_begin_);
+	}
+
+	const void* VulkanEngineRingBuffer::Read(VkDeviceSize offset, VkDeviceSize size)
+	{
+		assert(offset + size <= partition_size_ * frame_count_ && "Ring buffer read out of range");
+		// Invalidated ranges have the same nonCoherentAtomSize granularity as flushed ones
+		VkDeviceSize begin = offset / flush_alignment_ * flush_alignment_;
+		VkDeviceSize end = std::min(Align(offset + size, flush_alignment_), partition_size_ * frame_count_);
+		if (buffer_->Invalidate(end - begin, begin) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to invalidate ring buffer!");
+		}
+		return static_cast<const char*>(buffer_->GetMappedMemory()) + offset;
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "vulkanengine_buffer.hpp"
+#include "vulkanengine_device.hpp"
+
+// std
+#include <cstring>
+#include <memory>
+
+namespace vulkanengine
+{
+	// Persistently mapped buffer split into one partition per frame in flight.
+	// Systems sub-allocate aligned chunks from the current frame's partition and bind them
+	// through UNIFORM_BUFFER_DYNAMIC / STORAGE_BUFFER_DYNAMIC offsets, so per-draw or per-pass
+	// data never needs its own VkBuffer or descriptor set
+	class VulkanEngineRingBuffer
+	{
+	public:
+		struct Allocation
+		{
+			void* data = nullptr;
+			uint32_t offset = 0;	// dynamic offset to hand to vkCmdBindDescriptorSets
+			VkDeviceSize size = 0;
+		};
+
+		VulkanEngineRingBuffer(
+			VulkanEngineDevice& device,
+			VkDeviceSize frame_capacity,
+			uint32_t frame_count,
+			VkBufferUsageFlags usage_flags);
+		~VulkanEngineRingBuffer();
+
+		VulkanEngineRingBuffer(const VulkanEngineRingBuffer&) = delete;
+		VulkanEngineRingBuffer& operator=(const VulkanEngineRingBuffer&) = delete;
+
+		void BeginFrame(int frame_index);
+		Allocation Allocate(VkDeviceSize size);
+		VkResult Flush();
+		// Makes what the device wrote to [offset, offset + size) visible to the host and returns it;
+		// the frame that wrote it has to be complete and its partition not begun again
+		const void* Read(VkDeviceSize offset, VkDeviceSize size);
+
+		template <typename T>
+		uint32_t Push(const T& data)
+		{
+			Allocation allocation = Allocate(sizeof(T));
+			memcpy(allocation.data, &data, sizeof(T));
+			return allocation.offset;
+		}
+
+		// Descriptor covering a single chunk of [range] bytes; the dynamic offset selects which one
+		VkDescriptorBufferInfo DescriptorInfo(VkDeviceSize range) const { return VkDescriptorBufferInfo{ buffer_->GetBuffer(), 0, range }; }
+
+		VkBuffer GetBuffer() const { return buffer_->GetBuffer(); }
+		VkDeviceSize GetAlignment() const { return alignment_; }
+		VkDeviceSize GetFrameCapacity() const { return partition_size_; }
+		VkDeviceSize GetBytesUsed() const { return head_ - partition_begin_; }
+
+	private:
+		VulkanEngineDevice& vulkanengine_device_;
+		std::unique_ptr<VulkanEngineBuffer> buffer_;
+
+		VkDeviceSize alignment_;
+		VkDeviceSize flush_alignment_;
+		VkDeviceSize partition_size_;
+		VkDeviceSize partition_begin_ = 0;
+		VkDeviceSize head_ = 0;
+		uint32_t frame_count_;
+	};
+}  // namespace vulkanengine
@@ -0,0 +1,331 @@
+#include "vulkanengine_shader_hot_reload.hpp"
+
+#ifdef VULKANENGINE_SHADER_HOT_RELOAD
+// libs
+#include <shaderc/shaderc.h>
+#endif
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace vulkanengine
+{
+#ifdef VULKANENGINE_SHADER_HOT_RELOAD
+	// #include "..." resolution matching compile.bat: next to the including file first, then the watched directory
+	struct IncludeResult
+	{
+		shaderc_include_result result;
+		std::string source_name;
+		std::string content;
+	};
+
+	static shaderc_include_result* ResolveInclude(
+		void* user_data, const char* requested_source, int /*type*/, const char* requesting_source, size_t /*include_depth*/)
+	{
+		const std::string& include_directory = *static_cast<const std::string*>(user_data);
+
+		auto* include = new IncludeResult{};
+		for (const auto& candidate : {
+			std::filesystem::path(requesting_source).parent_path() / requested_source,
+			std::filesystem::path(include_directory) / requested_source })
+		{
+			std::ifstream file{ candidate, std::ios::binary };
+			if (file.is_open())
+			{
+				include->source_name = candidate.string();
+				include->content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				break;
+			}
+		}
+
+		// An empty source name tells shaderc the include failed; content then holds the error message
+		if (include->source_name.empty())
+		{
+			include->content = std::string("cannot find include ") + requested_source;
+		}
+		include->result.source_name = include->source_name.c_str();
+		include->result.source_name_length = include->source_name.size();
+		include->result.content = include->content.c_str();
+		include->result.content_length = include->content.size();
+		include->result.user_data = include;
+		return &include->result;
+	}
+
+	static void ReleaseInclude(void* /*user_data*/, shaderc_include_result* result)
+	{
+		delete static_cast<IncludeResult*>(result->user_data);
+	}
+#endif
+
+	VulkanEngineShaderHotReload::VulkanEngineShaderHotReload(
+		VulkanEnginePipelineRegistry& pipeline_registry,
+		const std::string& watch_directory,
+		std::chrono::milliseconds poll_interval)
+		: pipeline_registry_{ pipeline_registry }, watch_directory_{ watch_directory }, poll_interval_{ poll_interval }
+	{
+		// Record the current timestamps so startup doesn't count as an edit
+		Poll(true);
+		watcher_ = std::thread(&VulkanEngineShaderHotReload::WatchLoop, this);
+
+		std::cout << "shader hot reload: watching " << watch_directory_
+			<< (IsCompilerAvailable() ? " (GLSL + SPIR-V)" : " (SPIR-V only, run compile.bat)") << std::endl;
+	}
+
+	VulkanEngineShaderHotReload::~VulkanEngineShaderHotReload()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ stop_mutex_ };
+			stopping_ = true;
+		}
+		stop_condition_.notify_all();
+		watcher_.join();
+	}
+
+	bool VulkanEngineShaderHotReload::IsCompilerAvailable()
+	{
+#ifdef VULKANENGINE_SHADER_HOT_RELOAD
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void VulkanEngineShaderHotReload::WatchLoop()
+	{
+		std::unique_lock<std::mutex> lock{ stop_mutex_ };
+		while (!stop_condition_.wait_for(lock, poll_interval_, [this]() { return stopping_; }))
+		{
+			lock.unlock();
+			Poll(false);
+			lock.lock();
+		}
+	}
+
+	void VulkanEngineShaderHotReload::Poll(bool initial_scan)
+	{
+		std::vector<std::filesystem::path> changed{};
+
+		std::error_code error;
+		for (auto it = std::filesystem::directory_iterator(watch_directory_, error);
+			!error && it != std::filesystem::directory_iterator(); it.increment(error))
+		{
+			const std::filesystem::path& path = it->path();
+			std::error_code file_error;
+			if (!it->is_regular_file(file_error) ||
+				(path.extension() != ".spv" && !IsShaderStage(path) && !IsShaderInclude(path)))
+			{
+				continue;
+			}
+
+			auto write_time = std::filesystem::last_write_time(path, file_error);
+			if (file_error)
+			{
+				continue;
+			}
+
+			auto& file = files_[path.string()];
+			if (initial_scan)
+			{
+				file.last_write_time = write_time;
+			}
+			else if (write_time != file.last_write_time)
+			{
+				// Editors often save in several steps, wait one more poll for the file to settle
+				file.last_write_time = write_time;
+				file.pending = true;
+			}
+			else if (file.pending)
+			{
+				file.pending = false;
+				changed.push_back(path);
+			}
+		}
+
+		std::vector<std::string> spv_filepaths{};
+		std::vector<std::filesystem::path> sources{};
+		auto add_source = [&sources](const std::filesystem::path& path)
+		{
+			if (std::find(sources.begin(), sources.end(), path) == sources.end())
+			{
+				sources.push_back(path);
+			}
+		};
+		for (auto& path : changed)
+		{
+			if (path.extension() == ".spv")
+			{
+				spv_filepaths.push_back(path.string());
+			}
+			else if (IsShaderStage(path))
+			{
+				add_source(path);
+			}
+			else
+			{
+				for (auto& kv : files_)
+				{
+					std::filesystem::path source_path{ kv.first };
+					if (IsShaderStage(source_path) && IncludesFile(source_path, path))
+					{
+						add_source(source_path);
+					}
+				}
+			}
+		}
+
+		for (auto& path : sources)
+		{
+			if (!IsCompilerAvailable())
+			{
+				std::cout << "shader hot reload: " << path.string() << " changed, run compile.bat to reload it" << std::endl;
+				continue;
+			}
+
+			std::filesystem::path bindless_spv_path = path.parent_path() /
+				(path.stem().string() + "_bindless" + path.extension().string() + ".spv");
+			std::vector<std::pair<std::string, bool>> outputs{ { path.string() + ".spv", false } };
+			std::error_code exists_error;
+			if (std::filesystem::exists(bindless_spv_path, exists_error))
+			{
+				outputs.emplace_back(bindless_spv_path.string(), true);
+			}
+
+			for (const auto& output : outputs)
+			{
+				if (!CompileSource(path, output.first, output.second))
+				{
+					continue;
+				}
+				// We wrote it ourselves, don't reload it a second time when the watcher notices
+				std::error_code spv_error;
+				files_[output.first].last_write_time = std::filesystem::last_write_time(output.first, spv_error);
+				files_[output.first].pending = false;
+				spv_filepaths.push_back(output.first);
+			}
+		}
+
+		if (!spv_filepaths.empty())
+		{
+			pipeline_registry_.ReloadShaders(spv_filepaths);
+		}
+	}
+
+	bool VulkanEngineShaderHotReload::CompileSource(
+		[[maybe_unused]] const std::filesystem::path& source_path, [[maybe_unused]] const std::string& spv_filepath, [[maybe_unused]] bool bindless)
+	{
+#ifdef VULKANENGINE_SHADER_HOT_RELOAD
+		std::ifstream file{ source_path, std::ios::binary };
+		if (!file.is_open())
+		{
+			std::cerr << "shader hot reload: failed to open " << source_path.string() << std::endl;
+			return false;
+		}
+		std::string source{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+		shaderc_shader_kind kind = source_path.extension() == ".frag" ? shaderc_glsl_fragment_shader : shaderc_glsl_vertex_shader;
+
+		shaderc_compiler_t compiler = shaderc_compiler_initialize();
+		shaderc_compile_options_t options = shaderc_compile_options_initialize();
+		shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+		shaderc_compile_options_set_include_callbacks(options, ResolveInclude, ReleaseInclude, &watch_directory_);
+		if (bindless)
+		{
+			shaderc_compile_options_add_macro_definition(options, "BINDLESS", 8, nullptr, 0);
+		}
+
+		shaderc_compilation_result_t result = shaderc_compile_into_spv(
+			compiler,
+			source.data(),
+			source.size(),
+			kind,
+			source_path.string().c_str(),
+			"main",
+			options);
+
+		bool written = false;
+		if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
+		{
+			// Keep the old .spv (and pipeline) around until the shader compiles again
+			std::cerr << "shader hot reload: " << shaderc_result_get_error_message(result) << std::endl;
+		}
+		else
+		{
+			std::ofstream spv_file{ spv_filepath, std::ios::binary | std::ios::trunc };
+			spv_file.write(shaderc_result_get_bytes(result), shaderc_result_get_length(result));
+			written = static_cast<bool>(spv_file);
+			if (!written)
+			{
+				std::cerr << "shader hot reload: failed to write " << spv_filepath << std::endl;
+			}
+		}
+
+		shaderc_result_release(result);
+		shaderc_compile_options_release(options);
+		shaderc_compiler_release(compiler);
+		return written;
+#else
+		return false;
+#endif
+	}
+
+	bool VulkanEngineShaderHotReload::IsShaderInclude(const std::filesystem::path& path)
+	{
+		return path.extension() == ".h" || path.extension() == ".glsl";
+	}
+
+	// Compute shaders are left out: the occlusion culler builds its pipelines directly, not through the registry
+	bool VulkanEngineShaderHotReload::IsShaderStage(const std::filesystem::path& path)
+	{
+		return path.extension() == ".vert" || path.extension() == ".frag";
+	}
+
+	// Include guards make cycles harmless to the compiler, the depth limit does the same here
+	bool VulkanEngineShaderHotReload::IncludesFile(
+		const std::filesystem::path& source_path, const std::filesystem::path& include_path, uint32_t depth) const
+	{
+		constexpr uint32_t kMaxIncludeDepth = 16;
+		std::ifstream file{ source_path };
+		if (depth > kMaxIncludeDepth || !file.is_open())
+		{
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t directive = line.find_first_not_of(" \t");
+			if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+			{
+				continue;
+			}
+			size_t open = line.find('"', directive);
+			size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+			if (close == std::string::npos)
+			{
+				continue;
+			}
+
+			// same resolution order as ResolveInclude
+			std::string requested = line.substr(open + 1, close - open - 1);
+			for (const auto& candidate : {
+				source_path.parent_path() / requested,
+				std::filesystem::path(watch_directory_) / requested })
+			{
+				std::error_code error;
+				if (!std::filesystem::exists(candidate, error))
+				{
+					continue;
+				}
+				if (std::filesystem::equivalent(candidate, include_path, error) || IncludesFile(candidate, include_path, depth + 1))
+				{
+					return true;
+				}
+				break;
+			}
+		}
+		return false;
+	}
+}  // namespace vulkanengine
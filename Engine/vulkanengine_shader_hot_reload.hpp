@@ -0,0 +1,69 @@
+#pragma once
+
+#include "vulkanengine_pipeline_registry.hpp"
+
+// std
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Polls a shader directory on a background thread.
+	// With VULKANENGINE_SHADER_HOT_RELOAD defined, edited GLSL sources (.vert/.frag) are compiled
+	// in-process with shaderc and written next to the source as <name>.spv, like compile.bat does; sources
+	// compile.bat also builds with -DBINDLESS get their <stem>_bindless<ext>.spv rebuilt as well.
+	// Edited includes (.h/.glsl) recompile every source that includes them, directly or not.
+	// Compute shaders are not reloaded, the occlusion culler builds its pipelines outside the registry.
+	// Without it, only .spv changes are picked up, so run compile.bat by hand.
+	// Either way the registry rebuilds the affected pipelines off the render thread and swaps them in
+	// at its next BeginFrame
+	class VulkanEngineShaderHotReload
+	{
+	public:
+		VulkanEngineShaderHotReload(
+			VulkanEnginePipelineRegistry& pipeline_registry,
+			const std::string& watch_directory,
+			std::chrono::milliseconds poll_interval = std::chrono::milliseconds(250));
+		~VulkanEngineShaderHotReload();
+
+		VulkanEngineShaderHotReload(const VulkanEngineShaderHotReload&) = delete;
+		VulkanEngineShaderHotReload& operator=(const VulkanEngineShaderHotReload&) = delete;
+
+		static bool IsCompilerAvailable();
+
+	private:
+		struct WatchedFile
+		{
+			std::filesystem::file_time_type last_write_time;
+			bool pending = false;	// changed on the previous poll, handled once the timestamp settles
+		};
+
+		void WatchLoop();
+		void Poll(bool initial_scan);
+		// Writes [spv_filepath], with BINDLESS defined if [bindless]. Returns false on failure
+		bool CompileSource(const std::filesystem::path& source_path, const std::string& spv_filepath, bool bindless);
+
+		// Includes any source may pull in
+		static bool IsShaderInclude(const std::filesystem::path& path);
+		// Compiled on their own, one .spv each
+		static bool IsShaderStage(const std::filesystem::path& path);
+		// Follows #include "..." lines the way the compiler resolves them
+		bool IncludesFile(const std::filesystem::path& source_path, const std::filesystem::path& include_path, uint32_t depth = 0) const;
+
+		VulkanEnginePipelineRegistry& pipeline_registry_;
+		std::string watch_directory_;
+		std::chrono::milliseconds poll_interval_;
+		std::unordered_map<std::string, WatchedFile> files_;
+
+		std::mutex stop_mutex_;
+		std::condition_variable stop_condition_;
+		bool stopping_ = false;
+		std::thread watcher_;
+	};
+}  // namespace vulkanengine
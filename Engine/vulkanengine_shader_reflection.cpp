@@ -0,0 +1,428 @@
+#include "vulkanengine_shader_reflection.hpp"
+#include "vulkanengine_pipeline.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vulkanengine
+{
+	// The handful of SPIR-V opcodes, storage classes and decorations we care about (SPIR-V spec, section 3)
+	namespace spirv
+	{
+		constexpr uint32_t kMagic = 0x07230203;
+		constexpr uint32_t kHeaderWords = 5;
+
+		constexpr uint32_t kOpName = 5;
+		constexpr uint32_t kOpMemberName = 6;
+		constexpr uint32_t kOpEntryPoint = 15;
+		constexpr uint32_t kOpTypeBool = 20;
+		constexpr uint32_t kOpTypeInt = 21;
+		constexpr uint32_t kOpTypeFloat = 22;
+		constexpr uint32_t kOpTypeVector = 23;
+		constexpr uint32_t kOpTypeMatrix = 24;
+		constexpr uint32_t kOpTypeImage = 25;
+		constexpr uint32_t kOpTypeSampler = 26;
+		constexpr uint32_t kOpTypeSampledImage = 27;
+		constexpr uint32_t kOpTypeArray = 28;
+		constexpr uint32_t kOpTypeRuntimeArray = 29;
+		constexpr uint32_t kOpTypeStruct = 30;
+		constexpr uint32_t kOpTypePointer = 32;
+		constexpr uint32_t kOpConstant = 43;
+		constexpr uint32_t kOpSpecConstant = 50;
+		constexpr uint32_t kOpVariable = 59;
+		constexpr uint32_t kOpDecorate = 71;
+		constexpr uint32_t kOpMemberDecorate = 72;
+
+		constexpr uint32_t kExecutionModelVertex = 0;
+		constexpr uint32_t kExecutionModelFragment = 4;
+		constexpr uint32_t kExecutionModelGLCompute = 5;
+
+		constexpr uint32_t kStorageClassUniformConstant = 0;
+		constexpr uint32_t kStorageClassUniform = 2;
+		constexpr uint32_t kStorageClassPushConstant = 9;
+		constexpr uint32_t kStorageClassStorageBuffer = 12;
+
+		constexpr uint32_t kDecorationBlock = 2;
+		constexpr uint32_t kDecorationBufferBlock = 3;
+		constexpr uint32_t kDecorationArrayStride = 6;
+		constexpr uint32_t kDecorationMatrixStride = 7;
+		constexpr uint32_t kDecorationBinding = 33;
+		constexpr uint32_t kDecorationDescriptorSet = 34;
+		constexpr uint32_t kDecorationOffset = 35;
+
+		constexpr uint32_t kImageSampled = 1;
+		constexpr uint32_t kImageStorage = 2;
+
+		// Literal strings are nul-terminated and packed four chars per word
+		std::string ReadString(const uint32_t* words, uint32_t word_count)
+		{
+			const char* chars = reinterpret_cast<const char*>(words);
+			return std::string(chars, strnlen(chars, word_count * sizeof(uint32_t)));
+		}
+	}  // namespace spirv
+
+	VulkanEngineShaderReflection::VulkanEngineShaderReflection(const std::vector<char>& spirv)
+	{
+		if (spirv.size() < spirv::kHeaderWords * sizeof(uint32_t) || spirv.size() % sizeof(uint32_t) != 0)
+		{
+			throw std::runtime_error("failed to reflect shader: not a SPIR-V module!");
+		}
+		std::vector<uint32_t> words(spirv.size() / sizeof(uint32_t));
+		memcpy(words.data(), spirv.data(), spirv.size());
+		if (words[0] != spirv::kMagic)
+		{
+			throw std::runtime_error("failed to reflect shader: bad SPIR-V magic number!");
+		}
+
+		Parse(words);
+
+		types_.clear();
+		constants_.clear();
+		names_.clear();
+		member_names_.clear();
+		decorations_.clear();
+	}
+
+	VulkanEngineShaderReflection VulkanEngineShaderReflection::FromFile(const std::string& filepath)
+	{
+		return VulkanEngineShaderReflection{ VulkanEnginePipeline::ReadFile(filepath) };
+	}
+
+	void VulkanEngineShaderReflection::Parse(const std::vector<uint32_t>& words)
+	{
+		struct Variable
+		{
+			uint32_t id;
+			uint32_t pointer_type;
+			uint32_t storage_class;
+		};
+		std::vector<Variable> variables{};
+
+		size_t position = spirv::kHeaderWords;
+		while (position < words.size())
+		{
+			const uint32_t opcode = words[position] & 0xFFFF;
+			const uint32_t word_count = words[position] >> 16;
+			if (word_count == 0 || position + word_count > words.size())
+			{
+				throw std::runtime_error("failed to reflect shader: truncated SPIR-V instruction!");
+			}
+			const uint32_t* operands = &words[position + 1];
+			const uint32_t operand_count = word_count - 1;
+
+			switch (opcode)
+			{
+			case spirv::kOpName:
+				names_[operands[0]] = spirv::ReadString(operands + 1, operand_count - 1);
+				break;
+			case spirv::kOpMemberName:
+				member_names_[operands[0]][operands[1]] = spirv::ReadString(operands + 2, operand_count - 2);
+				break;
+			case spirv::kOpEntryPoint:
+				if (operands[0] == spirv::kExecutionModelVertex) stage_flags_ |= VK_SHADER_STAGE_VERTEX_BIT;
+				else if (operands[0] == spirv::kExecutionModelFragment) stage_flags_ |= VK_SHADER_STAGE_FRAGMENT_BIT;
+				else if (operands[0] == spirv::kExecutionModelGLCompute) stage_flags_ |= VK_SHADER_STAGE_COMPUTE_BIT;
+				break;
+			case spirv::kOpTypeBool:
+			case spirv::kOpTypeInt:
+			case spirv::kOpTypeFloat:
+			case spirv::kOpTypeVector:
+			case spirv::kOpTypeMatrix:
+			case spirv::kOpTypeImage:
+			case spirv::kOpTypeSampler:
+			case spirv::kOpTypeSampledImage:
+			case spirv::kOpTypeArray:
+			case spirv::kOpTypeRuntimeArray:
+			case spirv::kOpTypeStruct:
+			case spirv::kOpTypePointer:
+				types_[operands[0]] = TypeInfo{ opcode, std::vector<uint32_t>(operands + 1, operands + operand_count) };
+				break;
+			case spirv::kOpConstant:
+			case spirv::kOpSpecConstant:
+				// Only 32-bit integer constants matter here (array lengths)
+				constants_[operands[1]] = operands[2];
+				break;
+			case spirv::kOpVariable:
+				variables.push_back({ operands[1], operands[0], operands[2] });
+				break;
+			case spirv::kOpDecorate:
+			{
+				auto& decorations = decorations_[operands[0]];
+				switch (operands[1])
+				{
+				case spirv::kDecorationBlock: decorations.block = true; break;
+				case spirv::kDecorationBufferBlock: decorations.buffer_block = true; break;
+				case spirv::kDecorationArrayStride: decorations.array_stride = operands[2]; break;
+				case spirv::kDecorationBinding: decorations.binding = operands[2]; break;
+				case spirv::kDecorationDescriptorSet: decorations.set = operands[2]; break;
+				}
+				break;
+			}
+			case spirv::kOpMemberDecorate:
+				if (operands[2] == spirv::kDecorationOffset)
+				{
+					decorations_[operands[0]].member_offsets[operands[1]] = operands[3];
+				}
+				else if (operands[2] == spirv::kDecorationMatrixStride)
+				{
+					decorations_[operands[0]].member_matrix_strides[operands[1]] = operands[3];
+				}
+				break;
+			}
+
+			position += word_count;
+		}
+
+		for (auto& variable : variables)
+		{
+			if (variable.storage_class != spirv::kStorageClassUniformConstant &&
+				variable.storage_class != spirv::kStorageClassUniform &&
+				variable.storage_class != spirv::kStorageClassStorageBuffer &&
+				variable.storage_class != spirv::kStorageClassPushConstant)
+			{
+				continue;
+			}
+
+			// Peel the pointer, then any array, to get at the resource type
+			uint32_t type_id = types_.at(variable.pointer_type).operands[1];
+			uint32_t count = 1;
+			const TypeInfo* type = &types_.at(type_id);
+			if (type->opcode == spirv::kOpTypeArray || type->opcode == spirv::kOpTypeRuntimeArray)
+			{
+				count = type->opcode == spirv::kOpTypeArray ? ArrayLength(type_id) : 0;
+				type_id = type->operands[0];
+				type = &types_.at(type_id);
+			}
+
+			if (variable.storage_class == spirv::kStorageClassPushConstant)
+			{
+				push_constant_block_ = ReflectBlock(type_id);
+				push_constant_stages_ = stage_flags_;
+				continue;
+			}
+
+			DescriptorBinding binding{};
+			const auto& decorations = decorations_[variable.id];
+			binding.set = decorations.set;
+			binding.binding = decorations.binding;
+			binding.count = count;
+			binding.stage_flags = stage_flags_;
+
+			if (type->opcode == spirv::kOpTypeStruct)
+			{
+				const auto& struct_decorations = decorations_[type_id];
+				bool storage = variable.storage_class == spirv::kStorageClassStorageBuffer || struct_decorations.buffer_block;
+				binding.descriptor_type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				binding.block = ReflectBlock(type_id);
+			}
+			else if (type->opcode == spirv::kOpTypeSampledImage)
+			{
+				binding.descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			}
+			else if (type->opcode == spirv::kOpTypeImage)
+			{
+				// operands: sampled type, dim, depth, arrayed, ms, sampled, format
+				binding.descriptor_type = type->operands[5] == spirv::kImageStorage ?
+					VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+			else if (type->opcode == spirv::kOpTypeSampler)
+			{
+				binding.descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+			}
+			else
+			{
+				continue;
+			}
+			bindings_.push_back(binding);
+		}
+	}
+
+	uint32_t VulkanEngineShaderReflection::ArrayLength(uint32_t type_id) const
+	{
+		auto it = constants_.find(types_.at(type_id).operands[1]);
+		if (it == constants_.end())
+		{
+			throw std::runtime_error("failed to reflect shader: array length is not a constant!");
+		}
+		return it->second;
+	}
+
+	uint32_t VulkanEngineShaderReflection::TypeSize(uint32_t type_id, uint32_t matrix_stride) const
+	{
+		const TypeInfo& type = types_.at(type_id);
+		switch (type.opcode)
+		{
+		case spirv::kOpTypeBool:
+			return 4;
+		case spirv::kOpTypeInt:
+		case spirv::kOpTypeFloat:
+			return type.operands[0] / 8;
+		case spirv::kOpTypeVector:
+			return TypeSize(type.operands[0], 0) * type.operands[1];
+		case spirv::kOpTypeMatrix:
+			// Column-major: [count] columns, each [matrix_stride] bytes apart
+			return (matrix_stride != 0 ? matrix_stride : TypeSize(type.operands[0], 0)) * type.operands[1];
+		case spirv::kOpTypeArray:
+		{
+			auto it = decorations_.find(type_id);
+			uint32_t stride = it != decorations_.end() && it->second.array_stride != 0 ?
+				it->second.array_stride : TypeSize(type.operands[0], matrix_stride);
+			return stride * ArrayLength(type_id);
+		}
+		case spirv::kOpTypeRuntimeArray:
+			return 0;
+		case spirv::kOpTypeStruct:
+			return ReflectBlock(type_id).size;
+		}
+		return 0;
+	}
+
+	VulkanEngineShaderReflection::Block VulkanEngineShaderReflection::ReflectBlock(uint32_t struct_id) const
+	{
+		Block block{};
+		auto name = names_.find(struct_id);
+		if (name != names_.end())
+		{
+			block.name = name->second;
+		}
+
+		const TypeInfo& type = types_.at(struct_id);
+		auto decorations = decorations_.find(struct_id);
+		auto member_names = member_names_.find(struct_id);
+		for (uint32_t i = 0; i < type.operands.size(); i++)
+		{
+			BlockMember member{};
+			if (member_names != member_names_.end() && member_names->second.count(i))
+			{
+				member.name = member_names->second.at(i);
+			}
+
+			uint32_t matrix_stride = 0;
+			if (decorations != decorations_.end())
+			{
+				auto offset = decorations->second.member_offsets.find(i);
+				member.offset = offset != decorations->second.member_offsets.end() ? offset->second : 0;
+				auto stride = decorations->second.member_matrix_strides.find(i);
+				matrix_stride = stride != decorations->second.member_matrix_strides.end() ? stride->second : 0;
+			}
+			member.size = TypeSize(type.operands[i], matrix_stride);
+
+			block.size = std::max(block.size, member.offset + member.size);
+			block.members.push_back(member);
+		}
+		return block;
+	}
+
+	void VulkanEngineShaderReflection::VerifyBlock(const Block& block, const std::vector<size_t>& cpp_offsets, size_t cpp_size)
+	{
+		if (cpp_offsets.size() != block.members.size())
+		{
+			throw std::runtime_error("shader block " + block.name + " has " + std::to_string(block.members.size()) +
+				" members, C++ mirror has " + std::to_string(cpp_offsets.size()) + "!");
+		}
+		for (size_t i = 0; i < cpp_offsets.size(); i++)
+		{
+			if (cpp_offsets[i] != block.members[i].offset)
+			{
+				throw std::runtime_error("shader block " + block.name + "." + block.members[i].name + " is at offset " +
+					std::to_string(block.members[i].offset) + ", C++ mirror puts it at " + std::to_string(cpp_offsets[i]) + "!");
+			}
+		}
+		if (cpp_size < block.size)
+		{
+			throw std::runtime_error("shader block " + block.name + " is " + std::to_string(block.size) +
+				" bytes, C++ mirror is only " + std::to_string(cpp_size) + "!");
+		}
+	}
+
+	void VulkanEngineShaderReflection::Merge(const VulkanEngineShaderReflection& other)
+	{
+		stage_flags_ |= other.stage_flags_;
+
+		for (auto& other_binding : other.bindings_)
+		{
+			auto it = std::find_if(bindings_.begin(), bindings_.end(), [&other_binding](const DescriptorBinding& binding)
+				{
+					return binding.set == other_binding.set && binding.binding == other_binding.binding;
+				});
+			if (it == bindings_.end())
+			{
+				bindings_.push_back(other_binding);
+				continue;
+			}
+			if (it->descriptor_type != other_binding.descriptor_type || it->count != other_binding.count)
+			{
+				throw std::runtime_error("shader stages disagree on set " + std::to_string(other_binding.set) +
+					" binding " + std::to_string(other_binding.binding) + "!");
+			}
+			it->stage_flags |= other_binding.stage_flags;
+			if (other_binding.block.size > it->block.size)
+			{
+				it->block = other_binding.block;
+			}
+		}
+
+		if (other.push_constant_stages_ != 0)
+		{
+			push_constant_stages_ |= other.push_constant_stages_;
+			if (other.push_constant_block_.size > push_constant_block_.size)
+			{
+				push_constant_block_ = other.push_constant_block_;
+			}
+		}
+	}
+
+	const VulkanEngineShaderReflection::DescriptorBinding& VulkanEngineShaderReflection::GetBinding(uint32_t set, uint32_t binding) const
+	{
+		for (auto& descriptor_binding : bindings_)
+		{
+			if (descriptor_binding.set == set && descriptor_binding.binding == binding)
+			{
+				return descriptor_binding;
+			}
+		}
+		throw std::runtime_error("shader does not declare set " + std::to_string(set) + " binding " + std::to_string(binding) + "!");
+	}
+
+	// One range covering the largest block across stages, visible to every stage that declares it
+	VkPushConstantRange VulkanEngineShaderReflection::GetPushConstantRange() const
+	{
+		VkPushConstantRange range{};
+		range.stageFlags = push_constant_stages_;
+		range.offset = 0;
+		range.size = push_constant_block_.size;
+		return range;
+	}
+
+	VulkanEngineDescriptorSetLayout::Builder VulkanEngineShaderReflection::SetLayoutBuilder(
+		VulkanEngineDevice& device,
+		uint32_t set,
+		const std::vector<uint32_t>& dynamic_bindings) const
+	{
+		VulkanEngineDescriptorSetLayout::Builder builder{ device };
+		for (auto& binding : bindings_)
+		{
+			if (binding.set != set)
+			{
+				continue;
+			}
+
+			VkDescriptorType descriptor_type = binding.descriptor_type;
+			if (std::find(dynamic_bindings.begin(), dynamic_bindings.end(), binding.binding) != dynamic_bindings.end())
+			{
+				if (descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+				{
+					descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+				}
+				else if (descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+				{
+					descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+				}
+			}
+			builder.AddBinding(binding.binding, descriptor_type, binding.stage_flags, std::max(binding.count, 1u));
+		}
+		return builder;
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "vulkanengine_descriptors.hpp"
+#include "vulkanengine_device.hpp"
+
+// std
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Minimal SPIR-V reflection: descriptor bindings, push constant blocks and the member offsets the
+	// compiler actually assigned (std140/std430). Used to derive layouts and push constant ranges from
+	// the shaders and to verify that C++ structs mirroring shader blocks still line up
+	class VulkanEngineShaderReflection
+	{
+	public:
+		struct BlockMember
+		{
+			std::string name;
+			uint32_t offset;
+			uint32_t size;
+		};
+
+		struct Block
+		{
+			std::string name;
+			uint32_t size = 0;
+			std::vector<BlockMember> members;
+		};
+
+		struct DescriptorBinding
+		{
+			uint32_t set;
+			uint32_t binding;
+			VkDescriptorType descriptor_type;
+			uint32_t count;		// 0 for runtime-sized arrays
+			VkShaderStageFlags stage_flags;
+			Block block;		// uniform / storage buffers only
+		};
+
+		VulkanEngineShaderReflection() = default;
+		explicit VulkanEngineShaderReflection(const std::vector<char>& spirv);
+
+		static VulkanEngineShaderReflection FromFile(const std::string& filepath);
+		// Verifies that the C++ mirror of [block] has the same member offsets and is large enough to fill it.
+		// Throws with the offending member named, since a silent mismatch shows up as garbage on screen
+		static void VerifyBlock(const Block& block, const std::vector<size_t>& cpp_offsets, size_t cpp_size);
+
+		// Combines the reflection of another stage of the same pipeline
+		void Merge(const VulkanEngineShaderReflection& other);
+
+		VkShaderStageFlags GetStageFlags() const { return stage_flags_; }
+		const std::vector<DescriptorBinding>& GetBindings() const { return bindings_; }
+		const DescriptorBinding& GetBinding(uint32_t set, uint32_t binding) const;
+		bool HasPushConstants() const { return push_constant_stages_ != 0; }
+		const Block& GetPushConstantBlock() const { return push_constant_block_; }
+		VkPushConstantRange GetPushConstantRange() const;
+
+		// Buffer bindings listed in [dynamic_bindings] become UNIFORM/STORAGE_BUFFER_DYNAMIC, which SPIR-V cannot express
+		VulkanEngineDescriptorSetLayout::Builder SetLayoutBuilder(
+			VulkanEngineDevice& device,
+			uint32_t set,
+			const std::vector<uint32_t>& dynamic_bindings = {}) const;
+
+	private:
+		struct TypeInfo
+		{
+			uint32_t opcode = 0;
+			std::vector<uint32_t> operands;		// everything after the result id
+		};
+
+		struct Decorations
+		{
+			uint32_t set = 0;
+			uint32_t binding = 0;
+			uint32_t array_stride = 0;
+			bool block = false;
+			bool buffer_block = false;
+			std::unordered_map<uint32_t, uint32_t> member_offsets;
+			std::unordered_map<uint32_t, uint32_t> member_matrix_strides;
+		};
+
+		void Parse(const std::vector<uint32_t>& words);
+		uint32_t TypeSize(uint32_t type_id, uint32_t matrix_stride) const;
+		Block ReflectBlock(uint32_t struct_id) const;
+		uint32_t ArrayLength(uint32_t type_id) const;
+
+		VkShaderStageFlags stage_flags_ = 0;
+		std::vector<DescriptorBinding> bindings_;
+		Block push_constant_block_;
+		VkShaderStageFlags push_constant_stages_ = 0;
+
+		// Parse state, only meaningful while reflecting a single module
+		std::unordered_map<uint32_t, TypeInfo> types_;
+		std::unordered_map<uint32_t, uint32_t> constants_;
+		std::unordered_map<uint32_t, std::string> names_;
+		std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::string>> member_names_;
+		std::unordered_map<uint32_t, Decorations> decorations_;
+	};
+}  // namespace vulkanengine
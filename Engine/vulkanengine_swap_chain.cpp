@@ -1,7 +1,10 @@
 #include "vulkanengine_swap_chain.hpp"
 
+#include "vulkanengine_cpu_profiler.hpp"
+
 // std
 #include <array>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -12,14 +15,19 @@
 namespace vulkanengine
 {
 
-	VulkanEngineSwapChain::VulkanEngineSwapChain(VulkanEngineDevice& deviceRef, VkExtent2D extent)
-		: device_{ deviceRef }, window_extent_{ extent }
+	VulkanEngineSwapChain::VulkanEngineSwapChain(VulkanEngineDevice& deviceRef, VkExtent2D extent, bool dynamic_rendering, bool swap_chain_pass)
+		: dynamic_rendering_{ dynamic_rendering }, swap_chain_pass_{ swap_chain_pass }, device_{ deviceRef }, window_extent_{ extent }
 	{
 		Init();
 	}
 
-	VulkanEngineSwapChain::VulkanEngineSwapChain(VulkanEngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<VulkanEngineSwapChain> previous)
-		: device_{ deviceRef }, window_extent_{ extent }, old_swap_chain_{previous}
+	VulkanEngineSwapChain::VulkanEngineSwapChain(
+		VulkanEngineDevice& deviceRef,
+		VkExtent2D extent,
+		std::shared_ptr<VulkanEngineSwapChain> previous,
+		bool dynamic_rendering,
+		bool swap_chain_pass)
+		: dynamic_rendering_{ dynamic_rendering }, swap_chain_pass_{ swap_chain_pass }, device_{ deviceRef }, window_extent_{ extent }, old_swap_chain_{previous}
 	{
 		Init();
 
@@ -29,11 +37,28 @@ namespace vulkanengine
 
 	void VulkanEngineSwapChain::Init()
 	{
-		CreateSwapChain();
+		if (device_.IsHeadless())
+		{
+			CreateHeadlessImages();
+		}
+		else
+		{
+			CreateSwapChain();
+		}
 		CreateImageViews();
-		CreateRenderPass();
-		CreateDepthResources();
-		CreateFramebuffers();
+		swap_chain_depth_format_ = FindDepthFormat();
+		if (swap_chain_pass_)
+		{
+			CreateDepthResources();
+		}
+		if (!dynamic_rendering_)
+		{
+			CreateRenderPass();
+			if (swap_chain_pass_)
+			{
+				CreateFramebuffers();
+			}
+		}
 		CreateSyncObjects();
 	}
 
@@ -51,7 +76,13 @@ namespace vulkanengine
 			swap_chain_ = nullptr;
 		}
 
-		for (int i = 0; i < depth_images_.size(); i++)
+		for (size_t i = 0; i < headless_image_memorys_.size(); i++)
+		{
+			vkDestroyImage(device_.Device(), swap_chain_images_[i], nullptr);
+			vkFreeMemory(device_.Device(), headless_image_memorys_[i], nullptr);
+		}
+
+		for (size_t i = 0; i < depth_images_.size(); i++)
 		{
 			vkDestroyImageView(device_.Device(), depth_image_views_[i], nullptr);
 			vkDestroyImage(device_.Device(), depth_images_[i], nullptr);
@@ -63,7 +94,10 @@ namespace vulkanengine
 			vkDestroyFramebuffer(device_.Device(), framebuffer, nullptr);
 		}
 
-		vkDestroyRenderPass(device_.Device(), render_pass_, nullptr);
+		if (render_pass_ != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass(device_.Device(), render_pass_, nullptr);
+		}
 
 		// cleanup synchronization objects
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
@@ -76,13 +110,27 @@ namespace vulkanengine
 
 	VkResult VulkanEngineSwapChain::AcquireNextImage(uint32_t* imageIndex)
 	{
-		vkWaitForFences(
-			device_.Device(),
-			1,
-			&in_flight_fences_[current_frame_],
-			VK_TRUE,
-			std::numeric_limits<uint64_t>::max());
+		{
+			VULKANENGINE_PROFILE_SCOPE("wait for frame fence");
+			auto wait_start = std::chrono::high_resolution_clock::now();
+			vkWaitForFences(
+				device_.Device(),
+				1,
+				&in_flight_fences_[current_frame_],
+				VK_TRUE,
+				std::numeric_limits<uint64_t>::max());
+			fence_wait_milliseconds_ = std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - wait_start).count();
+		}
 
+		if (device_.IsHeadless())
+		{
+			*imageIndex = headless_image_index_;
+			headless_image_index_ = (headless_image_index_ + 1) % static_cast<uint32_t>(ImageCount());
+			return VK_SUCCESS;
+		}
+
+		VULKANENGINE_PROFILE_SCOPE("acquire image");
 		VkResult result = vkAcquireNextImageKHR(
 			device_.Device(),
 			swap_chain_,
@@ -99,16 +147,22 @@ namespace vulkanengine
 	{
 		if (images_in_flight_[*imageIndex] != VK_NULL_HANDLE)
 		{
+			VULKANENGINE_PROFILE_SCOPE("wait for image fence");
+			auto wait_start = std::chrono::high_resolution_clock::now();
 			vkWaitForFences(device_.Device(), 1, &images_in_flight_[*imageIndex], VK_TRUE, UINT64_MAX);
+			fence_wait_milliseconds_ += std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - wait_start).count();
 		}
 		images_in_flight_[*imageIndex] = in_flight_fences_[current_frame_];
 
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+		// headless frames are not acquired or presented, the fence alone paces them
+		uint32_t semaphoreCount = device_.IsHeadless() ? 0 : 1;
 		VkSemaphore waitSemaphores[] = { image_available_semaphores_[current_frame_] };
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = semaphoreCount;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 
@@ -116,14 +170,23 @@ namespace vulkanengine
 		submitInfo.pCommandBuffers = buffers;
 
 		VkSemaphore signalSemaphores[] = { render_finished_semaphores_[current_frame_] };
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = semaphoreCount;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
 		vkResetFences(device_.Device(), 1, &in_flight_fences_[current_frame_]);
-		if (vkQueueSubmit(device_.GraphicsQueue(), 1, &submitInfo, in_flight_fences_[current_frame_]) !=
-			VK_SUCCESS)
 		{
-			throw std::runtime_error("failed to submit draw command buffer!");
+			VULKANENGINE_PROFILE_SCOPE("queue submit");
+			if (vkQueueSubmit(device_.GraphicsQueue(), 1, &submitInfo, in_flight_fences_[current_frame_]) !=
+				VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to submit draw command buffer!");
+			}
+		}
+
+		if (device_.IsHeadless())
+		{
+			current_frame_ = (current_frame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+			return VK_SUCCESS;
 		}
 
 		VkPresentInfoKHR presentInfo = {};
@@ -138,7 +201,11 @@ namespace vulkanengine
 
 		presentInfo.pImageIndices = imageIndex;
 
-		auto result = vkQueuePresentKHR(device_.PresentQueue(), &presentInfo);
+		VkResult result;
+		{
+			VULKANENGINE_PROFILE_SCOPE("queue present");
+			result = vkQueuePresentKHR(device_.PresentQueue(), &presentInfo);
+		}
 
 		current_frame_ = (current_frame_ + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -212,6 +279,42 @@ namespace vulkanengine
 		swap_chain_extent_ = extent;
 	}
 
+	// Stand-in for the swap chain images when there is no surface; same format and count as a typical
+	// swap chain so the pipelines and frame pacing match the windowed path
+	void VulkanEngineSwapChain::CreateHeadlessImages()
+	{
+		uint32_t imageCount = MAX_FRAMES_IN_FLIGHT + 1;
+		swap_chain_image_format_ = VK_FORMAT_B8G8R8A8_SRGB;
+		swap_chain_extent_ = window_extent_;
+		swap_chain_images_.resize(imageCount);
+		headless_image_memorys_.resize(imageCount);
+
+		for (uint32_t i = 0; i < imageCount; i++)
+		{
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent.width = swap_chain_extent_.width;
+			imageInfo.extent.height = swap_chain_extent_.height;
+			imageInfo.extent.depth = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = swap_chain_image_format_;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.flags = 0;
+
+			device_.CreateImageWithInfo(
+				imageInfo,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				swap_chain_images_[i],
+				headless_image_memorys_[i]);
+		}
+	}
+
 	void VulkanEngineSwapChain::CreateImageViews()
 	{
 		swap_chain_image_views_.resize(swap_chain_images_.size());
@@ -239,7 +342,7 @@ namespace vulkanengine
 	void VulkanEngineSwapChain::CreateRenderPass()
 	{
 		VkAttachmentDescription depthAttachment{};
-		depthAttachment.format = FindDepthFormat();
+		depthAttachment.format = swap_chain_depth_format_;
 		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -260,7 +363,7 @@ namespace vulkanengine
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = device_.IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
@@ -326,15 +429,14 @@ namespace vulkanengine
 
 	void VulkanEngineSwapChain::CreateDepthResources()
 	{
-		VkFormat depthFormat = FindDepthFormat();
-		swap_chain_depth_format_ = depthFormat;
+		VkFormat depthFormat = swap_chain_depth_format_;
 		VkExtent2D swapChainExtent = GetSwapChainExtent();
 
 		depth_images_.resize(ImageCount());
 		depth_image_memorys_.resize(ImageCount());
 		depth_image_views_.resize(ImageCount());
 
-		for (int i = 0; i < depth_images_.size(); i++)
+		for (size_t i = 0; i < depth_images_.size(); i++)
 		{
 			VkImageCreateInfo imageInfo{};
 			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -18,18 +18,38 @@ namespace vulkanengine
 	public:
 		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-		VulkanEngineSwapChain(VulkanEngineDevice& device_ref, VkExtent2D window_extent);
-		VulkanEngineSwapChain(VulkanEngineDevice& device_ref, VkExtent2D window_extent, std::shared_ptr<VulkanEngineSwapChain> previous);
+		// With [dynamic_rendering] no render pass or framebuffers are created; the renderer begins rendering
+		// from the image views directly and transitions the images itself.
+		// Without [swap_chain_pass] there are no depth images or framebuffers either, for callers rendering
+		// through a render graph that owns its attachments; the render pass stays, for pipelines to be compatible with
+		VulkanEngineSwapChain(
+			VulkanEngineDevice& device_ref,
+			VkExtent2D window_extent,
+			bool dynamic_rendering = false,
+			bool swap_chain_pass = true);
+		VulkanEngineSwapChain(
+			VulkanEngineDevice& device_ref,
+			VkExtent2D window_extent,
+			std::shared_ptr<VulkanEngineSwapChain> previous,
+			bool dynamic_rendering = false,
+			bool swap_chain_pass = true);
 		~VulkanEngineSwapChain();
 
 		VulkanEngineSwapChain(const VulkanEngineSwapChain&) = delete;
 		VulkanEngineSwapChain& operator=(const VulkanEngineSwapChain&) = delete;
 
 		VkFramebuffer GetFrameBuffer(int index) { return swap_chain_framebuffers_[index]; }
+		// VK_NULL_HANDLE with dynamic rendering
 		VkRenderPass GetRenderPass() { return render_pass_; }
+		bool UsesDynamicRendering() const { return dynamic_rendering_; }
+		VkImage GetImage(int index) { return swap_chain_images_[index]; }
 		VkImageView GetImageView(int index) { return swap_chain_image_views_[index]; }
+		// Only with a swap chain pass
+		VkImage GetDepthImage(int index) { return depth_images_[index]; }
+		VkImageView GetDepthImageView(int index) { return depth_image_views_[index]; }
 		size_t ImageCount() { return swap_chain_images_.size(); }
 		VkFormat GetSwapChainImageFormat() { return swap_chain_image_format_; }
+		VkFormat GetSwapChainDepthFormat() { return swap_chain_depth_format_; }
 		VkExtent2D GetSwapChainExtent() { return swap_chain_extent_; }
 		uint32_t Width() { return swap_chain_extent_.width; }
 		uint32_t Height() { return swap_chain_extent_.height; }
@@ -42,6 +62,8 @@ namespace vulkanengine
 
 		VkResult AcquireNextImage(uint32_t* image_index);
 		VkResult SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* image_index);
+		// CPU time spent blocked on fences since the last AcquireNextImage, i.e. waiting for the GPU
+		float GetFenceWaitMilliseconds() const { return fence_wait_milliseconds_; }
 
 		bool CompareSwapFormats(const VulkanEngineSwapChain& swap_chain) const
 		{
@@ -52,6 +74,7 @@ namespace vulkanengine
 	private:
 		void Init();
 		void CreateSwapChain();
+		void CreateHeadlessImages();
 		void CreateImageViews();
 		void CreateDepthResources();
 		void CreateRenderPass();
@@ -70,18 +93,23 @@ namespace vulkanengine
 		VkExtent2D swap_chain_extent_;
 
 		std::vector<VkFramebuffer> swap_chain_framebuffers_;
-		VkRenderPass render_pass_;
+		VkRenderPass render_pass_ = VK_NULL_HANDLE;
+		bool dynamic_rendering_ = false;
+		bool swap_chain_pass_ = true;
 
 		std::vector<VkImage> depth_images_;
 		std::vector<VkDeviceMemory> depth_image_memorys_;
 		std::vector<VkImageView> depth_image_views_;
 		std::vector<VkImage> swap_chain_images_;
 		std::vector<VkImageView> swap_chain_image_views_;
+		// headless only: the swap chain owns its images, nothing is acquired or presented
+		std::vector<VkDeviceMemory> headless_image_memorys_;
+		uint32_t headless_image_index_ = 0;
 
 		VulkanEngineDevice& device_;
 		VkExtent2D window_extent_;
 
-		VkSwapchainKHR swap_chain_;
+		VkSwapchainKHR swap_chain_ = VK_NULL_HANDLE;
 		std::shared_ptr<VulkanEngineSwapChain> old_swap_chain_;
 
 		std::vector<VkSemaphore> image_available_semaphores_;
@@ -89,6 +117,7 @@ namespace vulkanengine
 		std::vector<VkFence> in_flight_fences_;
 		std::vector<VkFence> images_in_flight_;
 		size_t current_frame_ = 0;
+		float fence_wait_milliseconds_ = 0.f;
 	};
 
 }  // namespace vulkanengine
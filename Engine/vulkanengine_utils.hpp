@@ -1,6 +1,8 @@
 #pragma once
 
 // std
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 namespace vulkanengine
@@ -11,4 +13,16 @@ namespace vulkanengine
 		seed ^= std::hash<T>{}(v)+0x9e3779b9 + (seed << 6) + (seed >> 2);
 		(HashCombine(seed, rest), ...);
 	};
+
+	// FNV-1a over raw bytes; stable across runs, so usable for keys that end up in files
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "vulkanengine_vertex_format.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+// std
+#include <cmath>
+#include <cstring>
+
+namespace vulkanengine
+{
+	// Attribute locations, shared by every format (see simple_shader.vert)
+	static constexpr uint32_t kPositionLocation = 0;
+	static constexpr uint32_t kColorLocation = 1;
+	static constexpr uint32_t kNormalLocation = 2;
+	static constexpr uint32_t kUvLocation = 3;
+
+	static uint32_t PositionSize(PositionEncoding encoding)
+	{
+		return encoding == PositionEncoding::kFloat32 ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+	}
+
+	static uint32_t ColorSize(ColorEncoding encoding)
+	{
+		return encoding == ColorEncoding::kFloat32 ? 3 * sizeof(float) : 4 * sizeof(uint8_t);
+	}
+
+	static uint32_t NormalSize(NormalEncoding encoding)
+	{
+		return encoding == NormalEncoding::kFloat32 ? 3 * sizeof(float) : 2 * sizeof(uint16_t);
+	}
+
+	static uint32_t UvSize(UvEncoding encoding)
+	{
+		return encoding == UvEncoding::kFloat32 ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+	}
+
+	static VkFormat PositionVkFormat(PositionEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case PositionEncoding::kFloat16: return VK_FORMAT_R16G16B16A16_SFLOAT;	// 3 component 16 bit formats are rarely supported for vertex fetch
+		case PositionEncoding::kSnorm16: return VK_FORMAT_R16G16B16A16_SNORM;
+		default: return VK_FORMAT_R32G32B32_SFLOAT;
+		}
+	}
+
+	static VkFormat ColorVkFormat(ColorEncoding encoding)
+	{
+		return encoding == ColorEncoding::kFloat32 ? VK_FORMAT_R32G32B32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	static VkFormat NormalVkFormat(NormalEncoding encoding)
+	{
+		return encoding == NormalEncoding::kFloat32 ? VK_FORMAT_R32G32B32_SFLOAT : VK_FORMAT_R16G16_SNORM;
+	}
+
+	static VkFormat UvVkFormat(UvEncoding encoding)
+	{
+		return encoding == UvEncoding::kFloat32 ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R16G16_SFLOAT;
+	}
+
+	static void GetBoundsTransform(const glm::vec3& bounds_min, const glm::vec3& bounds_max, glm::vec3& center, glm::vec3& half_extent)
+	{
+		center = (bounds_min + bounds_max) * .5f;
+		half_extent = (bounds_max - bounds_min) * .5f;
+		for (int i = 0; i < 3; ++i)
+		{
+			// flat along this axis (e.g. a quad), every vertex encodes to 0
+			if (half_extent[i] <= 0.f)
+			{
+				half_extent[i] = 1.f;
+			}
+		}
+	}
+
+	// Octahedral mapping: project onto the |x| + |y| + |z| = 1 octahedron and fold the lower half over the upper one.
+	// Every encoding decodes to a unit direction, so a zero normal (an OBJ without normals) comes back as (0, 0, 1)
+	// and is lit as if facing +Z. kFloat32 passes the zero through, which the shader's normalize leaves undefined
+	static glm::vec2 OctahedralEncode(const glm::vec3& normal)
+	{
+		float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (length == 0.f)
+		{
+			return glm::vec2{ 0.f };
+		}
+
+		glm::vec3 n = normal / length;
+		if (n.z >= 0.f)
+		{
+			return glm::vec2{ n.x, n.y };
+		}
+		return glm::vec2{
+			(1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f),
+			(1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f) };
+	}
+
+	// Mirrors OctahedralDecode in simple_shader.vert
+	static glm::vec3 OctahedralDecode(const glm::vec2& encoded)
+	{
+		glm::vec3 n{ encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y) };
+		float t = std::max(-n.z, 0.f);
+		n.x += n.x >= 0.f ? -t : t;
+		n.y += n.y >= 0.f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	template <typename T>
+	static void Store(uint8_t*& destination, T value)
+	{
+		std::memcpy(destination, &value, sizeof(T));
+		destination += sizeof(T);
+	}
+
+	template <typename T>
+	static T Load(const uint8_t*& source)
+	{
+		T value;
+		std::memcpy(&value, source, sizeof(T));
+		source += sizeof(T);
+		return value;
+	}
+
+	uint32_t VertexFormat::GetPositionStride() const
+	{
+		return PositionSize(position);
+	}
+
+	uint32_t VertexFormat::GetAttributeStride() const
+	{
+		return ColorSize(color) + NormalSize(normal) + UvSize(uv);
+	}
+
+	uint32_t VertexFormat::GetKey() const
+	{
+		return static_cast<uint32_t>(position)
+			| static_cast<uint32_t>(normal) << 8
+			| static_cast<uint32_t>(color) << 16
+			| static_cast<uint32_t>(uv) << 24;
+	}
+
+	std::vector<VkVertexInputBindingDescription> VertexFormat::GetBindingDescriptions() const
+	{
+		std::vector<VkVertexInputBindingDescription> binding_descriptions = GetPositionBindingDescriptions();
+		binding_descriptions.push_back({ kAttributeBinding, GetAttributeStride(), VK_VERTEX_INPUT_RATE_VERTEX });
+		return binding_descriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> VertexFormat::GetAttributeDescriptions() const
+	{
+		std::vector<VkVertexInputAttributeDescription> attribute_descriptions = GetPositionAttributeDescriptions();
+
+		uint32_t offset = 0;
+		attribute_descriptions.push_back({ kColorLocation, kAttributeBinding, ColorVkFormat(color), offset });
+		offset += ColorSize(color);
+		attribute_descriptions.push_back({ kNormalLocation, kAttributeBinding, NormalVkFormat(normal), offset });
+		offset += NormalSize(normal);
+		attribute_descriptions.push_back({ kUvLocation, kAttributeBinding, UvVkFormat(uv), offset });
+
+		return attribute_descriptions;
+	}
+
+	std::vector<VkVertexInputBindingDescription> VertexFormat::GetPositionBindingDescriptions() const
+	{
+		return { { kPositionBinding, GetPositionStride(), VK_VERTEX_INPUT_RATE_VERTEX } };
+	}
+
+	std::vector<VkVertexInputAttributeDescription> VertexFormat::GetPositionAttributeDescriptions() const
+	{
+		return { { kPositionLocation, kPositionBinding, PositionVkFormat(position), 0 } };
+	}
+
+	void VertexFormat::EncodePosition(const glm::vec3& value, const glm::vec3& bounds_min, const glm::vec3& bounds_max, uint8_t* destination) const
+	{
+		switch (position)
+		{
+		case PositionEncoding::kFloat32:
+			for (int i = 0; i < 3; ++i)
+			{
+				Store(destination, value[i]);
+			}
+			break;
+		case PositionEncoding::kFloat16:
+			for (int i = 0; i < 3; ++i)
+			{
+				Store(destination, glm::packHalf1x16(value[i]));
+			}
+			Store(destination, glm::packHalf1x16(1.f));
+			break;
+		case PositionEncoding::kSnorm16:
+		{
+			glm::vec3 center, half_extent;
+			GetBoundsTransform(bounds_min, bounds_max, center, half_extent);
+			glm::vec3 normalized = (value - center) / half_extent;
+			for (int i = 0; i < 3; ++i)
+			{
+				Store(destination, glm::packSnorm1x16(normalized[i]));
+			}
+			Store(destination, glm::packSnorm1x16(1.f));
+			break;
+		}
+		}
+	}
+
+	void VertexFormat::EncodeAttributes(const glm::vec3& color_value, const glm::vec3& normal_value, const glm::vec2& uv_value, uint8_t* destination) const
+	{
+		if (color == ColorEncoding::kFloat32)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				Store(destination, color_value[i]);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				Store(destination, glm::packUnorm1x8(color_value[i]));
+			}
+			Store(destination, glm::packUnorm1x8(1.f));
+		}
+
+		if (normal == NormalEncoding::kFloat32)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				Store(destination, normal_value[i]);
+			}
+		}
+		else
+		{
+			glm::vec2 encoded = OctahedralEncode(normal_value);
+			Store(destination, glm::packSnorm1x16(encoded.x));
+			Store(destination, glm::packSnorm1x16(encoded.y));
+		}
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (uv == UvEncoding::kFloat32)
+			{
+				Store(destination, uv_value[i]);
+			}
+			else
+			{
+				Store(destination, glm::packHalf1x16(uv_value[i]));
+			}
+		}
+	}
+
+	glm::vec3 VertexFormat::DecodePosition(const uint8_t* source, const glm::vec3& bounds_min, const glm::vec3& bounds_max) const
+	{
+		glm::vec3 value{};
+		switch (position)
+		{
+		case PositionEncoding::kFloat32:
+			for (int i = 0; i < 3; ++i)
+			{
+				value[i] = Load<float>(source);
+			}
+			return value;
+		case PositionEncoding::kFloat16:
+			for (int i = 0; i < 3; ++i)
+			{
+				value[i] = glm::unpackHalf1x16(Load<uint16_t>(source));
+			}
+			return value;
+		case PositionEncoding::kSnorm16:
+		{
+			glm::vec3 center, half_extent;
+			GetBoundsTransform(bounds_min, bounds_max, center, half_extent);
+			for (int i = 0; i < 3; ++i)
+			{
+				value[i] = glm::unpackSnorm1x16(Load<uint16_t>(source));
+			}
+			return center + value * half_extent;
+		}
+		}
+		return value;
+	}
+
+	void VertexFormat::DecodeAttributes(const uint8_t* source, glm::vec3& color_value, glm::vec3& normal_value, glm::vec2& uv_value) const
+	{
+		if (color == ColorEncoding::kFloat32)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				color_value[i] = Load<float>(source);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				color_value[i] = glm::unpackUnorm1x8(Load<uint8_t>(source));
+			}
+			source += sizeof(uint8_t);
+		}
+
+		if (normal == NormalEncoding::kFloat32)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				normal_value[i] = Load<float>(source);
+			}
+		}
+		else
+		{
+			glm::vec2 encoded{};
+			encoded.x = glm::unpackSnorm1x16(Load<uint16_t>(source));
+			encoded.y = glm::unpackSnorm1x16(Load<uint16_t>(source));
+			normal_value = OctahedralDecode(encoded);
+		}
+
+		for (int i = 0; i < 2; ++i)
+		{
+			uv_value[i] = uv == UvEncoding::kFloat32 ? Load<float>(source) : glm::unpackHalf1x16(Load<uint16_t>(source));
+		}
+	}
+
+	glm::mat4 VertexFormat::GetPositionDequantization(const glm::vec3& bounds_min, const glm::vec3& bounds_max) const
+	{
+		if (position != PositionEncoding::kSnorm16)
+		{
+			return glm::mat4{ 1.f };
+		}
+
+		glm::vec3 center, half_extent;
+		GetBoundsTransform(bounds_min, bounds_max, center, half_extent);
+		return glm::scale(glm::translate(glm::mat4{ 1.f }, center), half_extent);
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,115 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vulkanengine
+{
+	enum class PositionEncoding : uint8_t
+	{
+		kFloat32,	// 12 bytes
+		kFloat16,	// 8 bytes, raw object space coordinates
+		kSnorm16,	// 8 bytes, normalized to the mesh bounds; the model's dequantization matrix undoes it
+	};
+
+	enum class NormalEncoding : uint8_t
+	{
+		kFloat32,			// 12 bytes
+		kOctahedralSnorm16,	// 4 bytes, decoded in simple_shader.vert (OCTAHEDRAL_NORMALS); zero normals decode as +Z
+	};
+
+	enum class ColorEncoding : uint8_t
+	{
+		kFloat32,	// 12 bytes
+		kUnorm8,	// 4 bytes, clamped to [0, 1]
+	};
+
+	enum class UvEncoding : uint8_t
+	{
+		kFloat32,	// 8 bytes
+		kFloat16,	// 4 bytes
+	};
+
+	// GPU layout of a model's vertices, chosen per model at load time.
+	// Positions always live in their own stream (binding 0) so depth-only passes fetch nothing else;
+	// color, normal and uv are interleaved in binding 1. Attribute locations are the same for every
+	// format, the formats only differ in VkFormat and offsets, so the shaders stay untouched
+	struct VertexFormat
+	{
+		static constexpr uint32_t kPositionBinding = 0;
+		static constexpr uint32_t kAttributeBinding = 1;
+		// Largest strides of any format (all kFloat32)
+		static constexpr uint32_t kMaxPositionStride = 12;
+		static constexpr uint32_t kMaxAttributeStride = 32;
+
+		PositionEncoding position = PositionEncoding::kFloat32;
+		NormalEncoding normal = NormalEncoding::kFloat32;
+		ColorEncoding color = ColorEncoding::kFloat32;
+		UvEncoding uv = UvEncoding::kFloat32;
+
+		static VertexFormat Full() { return VertexFormat{}; }
+		// 20 bytes per vertex instead of 44
+		static VertexFormat Compact()
+		{
+			return VertexFormat{ PositionEncoding::kSnorm16, NormalEncoding::kOctahedralSnorm16, ColorEncoding::kUnorm8, UvEncoding::kFloat16 };
+		}
+
+		uint32_t GetPositionStride() const;
+		uint32_t GetAttributeStride() const;
+		uint32_t GetVertexSize() const { return GetPositionStride() + GetAttributeStride(); }
+		// Compact identifier, e.g. for pipeline lookups
+		uint32_t GetKey() const;
+
+		std::vector<VkVertexInputBindingDescription> GetBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() const;
+		// Position stream only, for depth and shadow pipelines
+		std::vector<VkVertexInputBindingDescription> GetPositionBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> GetPositionAttributeDescriptions() const;
+
+		// Write one vertex into its stream; [bounds_min]/[bounds_max] are only used by kSnorm16
+		void EncodePosition(const glm::vec3& position, const glm::vec3& bounds_min, const glm::vec3& bounds_max, uint8_t* destination) const;
+		void EncodeAttributes(const glm::vec3& color, const glm::vec3& normal, const glm::vec2& uv, uint8_t* destination) const;
+
+		// Inverse of the encoders as the vertex shader sees it, used for the quantization report
+		glm::vec3 DecodePosition(const uint8_t* source, const glm::vec3& bounds_min, const glm::vec3& bounds_max) const;
+		void DecodeAttributes(const uint8_t* source, glm::vec3& color, glm::vec3& normal, glm::vec2& uv) const;
+
+		// Maps decoded kSnorm16 positions in [-1, 1] back to the mesh bounds; identity for the other encodings
+		glm::mat4 GetPositionDequantization(const glm::vec3& bounds_min, const glm::vec3& bounds_max) const;
+
+		bool operator==(const VertexFormat& other) const { return GetKey() == other.GetKey(); }
+		bool operator!=(const VertexFormat& other) const { return !(*this == other); }
+	};
+
+	// Largest and mean deviation of the decoded vertices from the source data
+	struct QuantizationReport
+	{
+		float max_position_error = 0.f;		// object space units
+		float mean_position_error = 0.f;
+		float max_normal_error_degrees = 0.f;
+		float max_color_error = 0.f;
+		float max_uv_error = 0.f;
+	};
+
+	struct VertexMemoryStats
+	{
+		uint32_t vertex_count = 0;
+		uint32_t index_count = 0;
+		VkDeviceSize position_bytes = 0;
+		VkDeviceSize attribute_bytes = 0;
+		VkDeviceSize index_bytes = 0;
+		VkDeviceSize uncompressed_vertex_bytes = 0;	// the same vertices as 44 byte VulkanEngineModel::Vertex
+		VkDeviceSize staging_bytes = 0;				// host memory used for the upload, 0 when written in place
+
+		// Also the lower bound on what one draw reads, assuming every vertex is fetched once
+		VkDeviceSize GetTotalBytes() const { return position_bytes + attribute_bytes + index_bytes; }
+		VkDeviceSize GetDepthPassBytes() const { return position_bytes + index_bytes; }
+	};
+}  // namespace vulkanengine
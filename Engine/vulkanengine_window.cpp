@@ -11,20 +11,48 @@ namespace vulkanengine
 		InitWindow();
 	}
 
+	VulkanEngineWindow::VulkanEngineWindow(int width, int height)
+		: width_{ width }, height_{ height }, window_name_{ "headless" }
+	{
+	}
+
+	std::unique_ptr<VulkanEngineWindow> VulkanEngineWindow::CreateHeadless(int width, int height)
+	{
+		return std::unique_ptr<VulkanEngineWindow>(new VulkanEngineWindow(width, height));
+	}
+
 	VulkanEngineWindow::~VulkanEngineWindow()
 	{
+		if (window_ == nullptr)
+		{
+			return;
+		}
 		glfwDestroyWindow(window_);
 		glfwTerminate();  // Disable GLFW
 	}
 
 	void VulkanEngineWindow::CreateWindowSurface(VkInstance instance, VkSurfaceKHR* surface)
 	{
+		if (window_ == nullptr)
+		{
+			throw std::runtime_error("headless windows have no surface");
+		}
 		if (glfwCreateWindowSurface(instance, window_, nullptr, surface) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create window surface");
 		}
 	}
 
+	void VulkanEngineWindow::SetTitleStatus(const std::string& status)
+	{
+		if (window_ == nullptr)
+		{
+			return;
+		}
+		std::string title = status.empty() ? window_name_ : window_name_ + " | " + status;
+		glfwSetWindowTitle(window_, title.c_str());
+	}
+
 	void VulkanEngineWindow::FrameBufferResizeCallback(GLFWwindow* window, int width, int height)
 	{
 		auto vulkanengine_window = reinterpret_cast<VulkanEngineWindow*>(glfwGetWindowUserPointer(window));
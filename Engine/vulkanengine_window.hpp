@@ -3,6 +3,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <memory>
 #include <string>
 
 namespace vulkanengine
@@ -12,21 +13,27 @@ namespace vulkanengine
 	{
 	public:
 		VulkanEngineWindow(int width, int height, std::string window_name);
+		// A headless window has no GLFW window or surface, only the extent; the device then renders offscreen
+		static std::unique_ptr<VulkanEngineWindow> CreateHeadless(int width, int height);
 		~VulkanEngineWindow();
 
 		VulkanEngineWindow(const VulkanEngineWindow&) = delete;
 		VulkanEngineWindow& operator=(const VulkanEngineWindow&) = delete;
 
-		bool ShouldClose() { return glfwWindowShouldClose(window_); }
+		bool ShouldClose() { return window_ != nullptr && glfwWindowShouldClose(window_); }
+		bool IsHeadless() const { return window_ == nullptr; }
 		VkExtent2D GetExtent() { return { static_cast<uint32_t>(width_), static_cast<uint32_t>(height_) }; }
 		bool WasWindowResized() { return frame_buffer_resized_; }
 		void ResetWindowResizedFlag() { frame_buffer_resized_ = false; }
 		GLFWwindow* GetGLFWwindow() const { return window_; }
+		// Appends [status] to the window name, e.g. for live frame statistics
+		void SetTitleStatus(const std::string& status);
 
 		void CreateWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
 	private:
 		static void FrameBufferResizeCallback(GLFWwindow* window, int width, int height);
+		VulkanEngineWindow(int width, int height);
 		void InitWindow();
 
 		int width_;
@@ -34,7 +41,7 @@ namespace vulkanengine
 		bool frame_buffer_resized_ = false;
 
 		std::string window_name_;
-		GLFWwindow* window_;
+		GLFWwindow* window_ = nullptr;
 	};
 
 }  // namespace vulkanengine
\ No newline at end of file
@@ -0,0 +1,5 @@
+#version 450
+
+// depth only, the color attachment is masked off
+void main() {
+}
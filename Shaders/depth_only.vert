@@ -0,0 +1,19 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+// SimpleRenderSystem's depth prepass: only the position stream is bound
+layout(location = 0) in vec3 position;
+
+#include "global_ubo.glsl"
+#include "object_data.glsl"
+
+// the shading pass tests against this depth with EQUAL, so both shaders must compute it bit for bit alike
+invariant gl_Position;
+
+void main() {
+	vec4 position_worldspace = ModelMatrix() * vec4(position, 1.0);
+	gl_Position = ubo.projection_matrix * ubo.view_matrix * position_worldspace;
+}
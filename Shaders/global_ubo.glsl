@@ -0,0 +1,18 @@
+// GlobalUbo as seen by every shader. Its C++ mirror is GlobalUbo in vulkanengine_frame_info.hpp;
+// FirstApp checks the two against each other through SPIR-V reflection at startup
+#include "shader_shared.h"
+
+struct PointLight
+{
+	vec4 position;
+	vec4 color; // w is intensity
+};
+
+layout(set = GLOBAL_SET, binding = GLOBAL_UBO_BINDING) uniform GlobalUbo {
+	mat4 projection_matrix;
+	mat4 view_matrix;
+	mat4 inverse_view_matrix;
+	vec4 ambient_light_color; // w is intensity
+	PointLight point_lights[MAX_LIGHTS];
+	int num_lights;
+} ubo;
@@ -0,0 +1,42 @@
+// Per draw transforms of simple_shader.vert and depth_only.vert, see SimpleRenderSystem.
+// compile.bat also builds both with -DBINDLESS: the matrices then come from an ObjectData array in one of
+// VulkanEngineBindlessSet's storage buffers, and the push constants only say where
+#include "shader_shared.h"
+
+#ifdef BINDLESS
+struct ObjectData {
+	mat4 model_matrix;
+	mat4 normal_matrix;
+};
+
+layout(set = BINDLESS_SET, binding = BINDLESS_STORAGE_BUFFER_BINDING) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+} object_buffers[];
+
+layout(push_constant) uniform Push {
+	uint object_buffer;	// bindless storage buffer index
+	uint object_index;
+} push;
+
+mat4 ModelMatrix() {
+	return object_buffers[push.object_buffer].objects[push.object_index].model_matrix;
+}
+
+mat4 NormalMatrix() {
+	return object_buffers[push.object_buffer].objects[push.object_index].normal_matrix;
+}
+#else
+// due to limitations on some GPUs, we can only store 128 bytes (= 2 4x4 matrices) for push constants
+layout(push_constant) uniform Push {
+	mat4 model_matrix;
+	mat4 normal_matrix;
+} push;
+
+mat4 ModelMatrix() {
+	return push.model_matrix;
+}
+
+mat4 NormalMatrix() {
+	return push.normal_matrix;
+}
+#endif
@@ -1,23 +1,11 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec2 frag_offset;
 
 layout(location = 0) out vec4 out_color;
 
-struct PointLight
-{
-	vec4 position;
-	vec4 color; // w is intensity
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-	mat4 projection_matrix;
-	mat4 view_matrix;
-	mat4 inverse_view_matrix;
-	vec4 ambient_light_color; // w is intensity
-	PointLight point_lights[10]; // value of vulkanengine_frame_info.hpp->MAX_LIGHTS
-	int num_lights;
-} ubo;
+#include "global_ubo.glsl"
 
 layout(push_constant) uniform Push {
 	vec4 position;
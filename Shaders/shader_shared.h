@@ -0,0 +1,32 @@
+// Constants shared by the C++ engine and the GLSL shaders.
+// Included from both languages, so keep it to #defines and comments
+#ifndef VULKANENGINE_SHADER_SHARED_H
+#define VULKANENGINE_SHADER_SHARED_H
+
+#define MAX_LIGHTS 10
+
+// global descriptor set (GlobalUbo, see global_ubo.glsl / vulkanengine_frame_info.hpp)
+#define GLOBAL_SET 0
+#define GLOBAL_UBO_BINDING 0
+
+// simple_shader.frag specialization constant ids
+#define SPEC_ID_LIGHT_BUDGET 0
+#define SPEC_ID_SPECULAR_EXPONENT 1
+#define SPEC_ID_SHADING_MODEL 2
+#define SPEC_ID_SPECULAR_ENABLED 3
+
+// simple_shader.vert specialization constant ids, set from the model's VertexFormat
+#define SPEC_ID_OCTAHEDRAL_NORMALS 4
+
+// VulkanEngineBindlessSet, used by the shader variants compile.bat builds with -DBINDLESS
+#define BINDLESS_SET 1
+#define BINDLESS_STORAGE_BUFFER_BINDING 0
+#define BINDLESS_IMAGE_BINDING 1
+
+// occlusion culling compute shaders (see VulkanEngineOcclusionCuller)
+#define OCCLUSION_WORKGROUP_SIZE 64
+#define HIZ_WORKGROUP_SIZE 8
+// candidates without a slot keep no visibility between frames and are always drawn early
+#define OCCLUSION_NO_VISIBILITY_SLOT 0xffffffffu
+
+#endif
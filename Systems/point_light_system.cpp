@@ -1,5 +1,8 @@
 #include "point_light_system.hpp"
 
+#include "Engine/vulkanengine_cpu_profiler.hpp"
+#include "Engine/vulkanengine_shader_reflection.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -9,6 +12,7 @@
 // std
 #include <array>
 #include <cassert>
+#include <cstddef>
 #include <map>
 #include <stdexcept>
 
@@ -21,11 +25,15 @@ namespace vulkanengine
 		float radius;
 	};
 
-	PointLightSystem::PointLightSystem(VulkanEngineDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout)
+	PointLightSystem::PointLightSystem(
+		VulkanEngineDevice& device,
+		VulkanEnginePipelineRegistry& pipeline_registry,
+		const RenderTargetInfo& render_target,
+		VkDescriptorSetLayout global_set_layout)
 		: vulkanengine_device_{ device }
 	{
 		CreatePipelineLayout(global_set_layout);
-		CreatePipeline(render_pass);
+		CreatePipeline(pipeline_registry, render_target);
 	}
 
 	PointLightSystem::~PointLightSystem()
@@ -35,10 +43,20 @@ namespace vulkanengine
 
 	void PointLightSystem::CreatePipelineLayout(VkDescriptorSetLayout global_set_layout)
 	{
-		VkPushConstantRange push_constant_range{};
-		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		push_constant_range.offset = 0;
-		push_constant_range.size = sizeof(PointLightPushConstants);
+		// The push constant range comes from the shaders themselves; the C++ mirror is checked against it
+		auto reflection = VulkanEngineShaderReflection::FromFile("Shaders/point_light.vert.spv");
+		reflection.Merge(VulkanEngineShaderReflection::FromFile("Shaders/point_light.frag.spv"));
+		VulkanEngineShaderReflection::VerifyBlock(
+			reflection.GetPushConstantBlock(),
+			{
+				offsetof(PointLightPushConstants, position),
+				offsetof(PointLightPushConstants, color),
+				offsetof(PointLightPushConstants, radius)
+			},
+			sizeof(PointLightPushConstants));
+
+		VkPushConstantRange push_constant_range = reflection.GetPushConstantRange();
+		push_constant_stages_ = push_constant_range.stageFlags;
 
 		std::vector<VkDescriptorSetLayout> descriptor_set_layouts{global_set_layout};
 
@@ -56,7 +74,7 @@ namespace vulkanengine
 		}
 	}
 
-	void PointLightSystem::CreatePipeline(VkRenderPass render_pass)
+	void PointLightSystem::CreatePipeline(VulkanEnginePipelineRegistry& pipeline_registry, const RenderTargetInfo& render_target)
 	{
 		assert(pipeline_layout_ != nullptr && "Cannot create pipeline before pipeline layout");
 
@@ -65,25 +83,29 @@ namespace vulkanengine
 		VulkanEnginePipeline::EnableAlphaBlending(pipeline_config);
 		pipeline_config.attribute_descriptions.clear();
 		pipeline_config.binding_descriptions.clear();
-		pipeline_config.render_pass = render_pass;
+		VulkanEnginePipeline::SetRenderTarget(pipeline_config, render_target);
 		pipeline_config.pipeline_layout = pipeline_layout_;
 
-		vulkanengine_pipeline_ = std::make_unique<VulkanEnginePipeline>(
-			vulkanengine_device_,
+		vulkanengine_pipeline_ = pipeline_registry.GetOrCreate(
 			"Shaders/point_light.vert.spv",
 			"Shaders/point_light.frag.spv",
 			pipeline_config);
 	}
 
 	void PointLightSystem::Update(FrameInfo& frame_info, GlobalUbo& ubo)
+	{
+		GatherLights(frame_info.frame_time, frame_info.game_objects, ubo);
+	}
+
+	void PointLightSystem::GatherLights(float frame_time, VulkanEngineGameObject::Map& game_objects, GlobalUbo& ubo)
 	{
 		auto rotate_light = glm::rotate(
 			glm::mat4(1.f),
-			frame_info.frame_time,
+			frame_time,
 			{ 0.f, -1.f, 0.f });
 
 		int light_index = 0;
-		for (auto& kv : frame_info.game_objects)
+		for (auto& kv : game_objects)
 		{
 			auto& object = kv.second;
 			if (object.point_light_ == nullptr)
@@ -106,6 +128,9 @@ namespace vulkanengine
 
 	void PointLightSystem::Render(FrameInfo& frame_info)
 	{
+		VULKANENGINE_PROFILE_FUNCTION();
+		VulkanEngineGpuProfiler::Scope gpu_scope{ frame_info.gpu_profiler, frame_info.command_buffer, "point lights" };
+
 		std::map<float, VulkanEngineGameObject::id_t> sorted_objects;
 		for (auto& kv : frame_info.game_objects)
 		{
@@ -126,8 +151,15 @@ namespace vulkanengine
 			0,
 			1,
 			&frame_info.global_descriptor_set,
-			0,
-			nullptr);
+			1,
+			&frame_info.global_ubo_offset);
+
+		VulkanEngineCommandCapture* capture = frame_info.command_capture;
+		if (capture != nullptr)
+		{
+			capture->BindPipeline(VulkanEngineCommandCapture::PipelineSource::kPointLightSystem, {});
+			capture->BindGlobalSet();
+		}
 
 		for (auto it = sorted_objects.rbegin(); it != sorted_objects.rend(); ++it)
 		{
@@ -141,12 +173,29 @@ namespace vulkanengine
 			vkCmdPushConstants(
 				frame_info.command_buffer,
 				pipeline_layout_,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				push_constant_stages_,
 				0,
 				sizeof(PointLightPushConstants),
 				&push);
 
 			vkCmdDraw(frame_info.command_buffer, 6, 1, 0, 0);
+			if (capture != nullptr)
+			{
+				capture->PushConstants(push_constant_stages_, 0, sizeof(PointLightPushConstants), &push);
+				capture->Draw(6, 1, 0, 0);
+			}
+		}
+
+		if (frame_info.metrics != nullptr)
+		{
+			// each light is a camera facing quad
+			uint32_t light_count = static_cast<uint32_t>(sorted_objects.size());
+			VulkanEngineMetrics& metrics = *frame_info.metrics;
+			metrics.GetCounter(metric::kDrawCalls).Add(light_count);
+			metrics.GetCounter(metric::kTriangles).Add(2 * light_count);
+			metrics.GetCounter(metric::kPipelineBinds).Add(1);
+			metrics.GetCounter(metric::kDescriptorBinds).Add(1);
+			metrics.GetCounter(metric::kPushConstantBytes).Add(sizeof(PointLightPushConstants) * light_count);
 		}
 	}
 
@@ -5,6 +5,7 @@
 #include "Engine/vulkanengine_frame_info.hpp"
 #include "Engine/vulkanengine_game_object.hpp"
 #include "Engine/vulkanengine_pipeline.hpp"
+#include "Engine/vulkanengine_pipeline_registry.hpp"
 
 // std
 #include <memory>
@@ -15,22 +16,31 @@ namespace vulkanengine
 	class PointLightSystem
 	{
 	public:
-		PointLightSystem(VulkanEngineDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
+		PointLightSystem(
+			VulkanEngineDevice& device,
+			VulkanEnginePipelineRegistry& pipeline_registry,
+			const RenderTargetInfo& render_target,
+			VkDescriptorSetLayout global_set_layout);
 		~PointLightSystem();
 
 		PointLightSystem(const PointLightSystem&) = delete;
 		PointLightSystem& operator=(const PointLightSystem&) = delete;
 
 		void Update(FrameInfo& frame_info, GlobalUbo& ubo);
+		// The CPU half of Update: advances the lights by [frame_time] and copies them into [ubo]. Needs no device
+		static void GatherLights(float frame_time, VulkanEngineGameObject::Map& game_objects, GlobalUbo& ubo);
 		void Render(FrameInfo& frame_info);
+		// The pipeline behind a capture's kPointLightSystem binds, for replays
+		VulkanEngineCommandReplay::ReplayPipeline ResolveCapturedPipeline() const { return { vulkanengine_pipeline_, pipeline_layout_ }; }
 
 	private:
 		void CreatePipelineLayout(VkDescriptorSetLayout global_set_layout);
-		void CreatePipeline(VkRenderPass render_pass);
+		void CreatePipeline(VulkanEnginePipelineRegistry& pipeline_registry, const RenderTargetInfo& render_target);
 
 		VulkanEngineDevice& vulkanengine_device_;
 
-		std::unique_ptr<VulkanEnginePipeline> vulkanengine_pipeline_;
+		std::shared_ptr<VulkanEnginePipeline> vulkanengine_pipeline_;	// owned by the registry, shared with other systems
 		VkPipelineLayout pipeline_layout_;
+		VkShaderStageFlags push_constant_stages_ = 0;	// reflected from the shaders, must match vkCmdPushConstants
 	};
 }  // namespace vulkanengine
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "simple_render_system.hpp"
 
+#include "Engine/vulkanengine_cpu_profiler.hpp"
+#include "Engine/vulkanengine_shader_reflection.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -9,37 +12,102 @@
 // std
 #include <stdexcept>
 #include <cassert>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <numeric>
 
 namespace vulkanengine
 {
-
 	struct SimplePushConstantData
 	{
 		glm::mat4 model_matrix{1.f};
 		glm::mat4 normal_matrix{1.f};
 	};
 
-	SimpleRenderSystem::SimpleRenderSystem(VulkanEngineDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout)
-		: vulkanengine_device_{device}
+	// The -DBINDLESS vertex shaders' push constants; the matrices above live in the object buffer instead
+	struct BindlessPushConstantData
+	{
+		uint32_t object_buffer;
+		uint32_t object_index;
+	};
+
+	// What a captured pipeline is rebuilt from: the vertex format, the shading variant it was drawn with
+	// and its part in the depth prepass
+	struct CapturedPipelineDescription
 	{
+		uint8_t position;
+		uint8_t normal;
+		uint8_t color;
+		uint8_t uv;
+		uint32_t light_budget;
+		float specular_exponent;
+		int32_t shading_model;
+		uint32_t specular;
+		uint32_t depth_pass;
+	};
+
+	SimpleRenderSystem::SimpleRenderSystem(
+		VulkanEngineDevice& device,
+		VulkanEnginePipelineRegistry& pipeline_registry,
+		const RenderTargetInfo& render_target,
+		VkDescriptorSetLayout global_set_layout,
+		VulkanEngineBindlessSet* bindless_set)
+		: vulkanengine_device_{device}, pipeline_registry_{pipeline_registry}, bindless_set_{bindless_set}
+	{
+		vert_filepath_ = bindless_set_ ? "Shaders/simple_shader_bindless.vert.spv" : "Shaders/simple_shader.vert.spv";
+		depth_vert_filepath_ = bindless_set_ ? "Shaders/depth_only_bindless.vert.spv" : "Shaders/depth_only.vert.spv";
 		CreatePipelineLayout(global_set_layout);
-		CreatePipeline(render_pass);
+		CreatePipeline(render_target);
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem()
 	{
+		if (object_buffer_index_ != VulkanEngineBindlessSet::kInvalidIndex)
+		{
+			bindless_set_->ReleaseStorageBuffer(object_buffer_index_);
+		}
 		vkDestroyPipelineLayout(vulkanengine_device_.Device(), pipeline_layout_, nullptr);
 	}
 
 	void SimpleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout global_set_layout)
 	{
-		VkPushConstantRange push_constant_range{};
-		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		push_constant_range.offset = 0;
-		push_constant_range.size = sizeof(SimplePushConstantData);
+		// The push constant range comes from the shaders themselves; the C++ mirror is checked against it
+		auto reflection = VulkanEngineShaderReflection::FromFile(vert_filepath_);
+		reflection.Merge(VulkanEngineShaderReflection::FromFile("Shaders/simple_shader.frag.spv"));
+		if (bindless_set_)
+		{
+			VulkanEngineShaderReflection::VerifyBlock(
+				reflection.GetPushConstantBlock(),
+				{
+					offsetof(BindlessPushConstantData, object_buffer),
+					offsetof(BindlessPushConstantData, object_index)
+				},
+				sizeof(BindlessPushConstantData));
+		}
+		else
+		{
+			VulkanEngineShaderReflection::VerifyBlock(
+				reflection.GetPushConstantBlock(),
+				{
+					offsetof(SimplePushConstantData, model_matrix),
+					offsetof(SimplePushConstantData, normal_matrix)
+				},
+				sizeof(SimplePushConstantData));
+		}
+
+		VkPushConstantRange push_constant_range = reflection.GetPushConstantRange();
+		push_constant_stages_ = push_constant_range.stageFlags;
 
 		std::vector<VkDescriptorSetLayout> descriptor_set_layouts{global_set_layout};
+		if (bindless_set_)
+		{
+			static_assert(VulkanEngineBindlessSet::kSet == GLOBAL_SET + 1, "The bindless set follows the global set");
+			descriptor_set_layouts.push_back(bindless_set_->GetDescriptorSetLayout());
+		}
 
 		VkPipelineLayoutCreateInfo pipeline_layout_info{};
 		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -55,60 +123,700 @@ namespace vulkanengine
 		}
 	}
 
-	void SimpleRenderSystem::CreatePipeline(VkRenderPass render_pass)
+	void SimpleRenderSystem::CreatePipeline(const RenderTargetInfo& render_target)
 	{
 		assert(pipeline_layout_ != nullptr && "Cannot create pipeline before pipeline layout");
 
-		PipelineConfigInfo pipeline_config{};
-		VulkanEnginePipeline::DefaultPipelineConfigInfo(pipeline_config);
-		pipeline_config.render_pass = render_pass;
-		pipeline_config.pipeline_layout = pipeline_layout_;
+		VulkanEnginePipeline::DefaultPipelineConfigInfo(base_pipeline_config_);
+		VulkanEnginePipeline::SetRenderTarget(base_pipeline_config_, render_target);
+		base_pipeline_config_.pipeline_layout = pipeline_layout_;
 
-		vulkanengine_pipeline_ = std::make_unique<VulkanEnginePipeline>(
-			vulkanengine_device_,
-			"Shaders/simple_shader.vert.spv",
+		// the depth test passes exactly where the prepass left this fragment's own depth
+		VulkanEnginePipeline::CopyPipelineConfigInfo(base_pipeline_config_, after_prepass_pipeline_config_);
+		after_prepass_pipeline_config_.depth_stencil_info.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		after_prepass_pipeline_config_.depth_stencil_info.depthWriteEnable = VK_FALSE;
+
+		// same target, so both passes fit in one render pass; the color attachment is simply not written
+		VulkanEnginePipeline::CopyPipelineConfigInfo(base_pipeline_config_, depth_pipeline_config_);
+		depth_pipeline_config_.color_blend_attachment.colorWriteMask = 0;
+
+		GetPipeline(VertexFormat::Full());
+	}
+
+	VulkanEnginePipelineRegistry::VariantBuilder SimpleRenderSystem::MakeVariantBuilder(
+		const ShadingVariant& variant,
+		const VertexFormat& vertex_format,
+		DepthPass depth_pass) const
+	{
+		assert(variant.light_budget <= MAX_LIGHTS && "Light budget exceeds the GlobalUbo light array");
+		assert(depth_pass != DepthPass::kPrepass && "Depth prepass pipelines come from MakeDepthBuilder");
+
+		VulkanEnginePipelineRegistry::VariantBuilder builder{
+			pipeline_registry_,
+			vert_filepath_,
 			"Shaders/simple_shader.frag.spv",
-			pipeline_config);
+			depth_pass == DepthPass::kAfterPrepass ? after_prepass_pipeline_config_ : base_pipeline_config_ };
+		builder
+			.SetConstant(SPEC_ID_LIGHT_BUDGET, static_cast<int32_t>(variant.light_budget))
+			.SetConstant(SPEC_ID_SPECULAR_EXPONENT, variant.specular_exponent)
+			.SetConstant(SPEC_ID_SHADING_MODEL, static_cast<int32_t>(variant.shading_model))
+			.SetConstant(SPEC_ID_SPECULAR_ENABLED, variant.specular)
+			.SetConstant(SPEC_ID_OCTAHEDRAL_NORMALS, vertex_format.normal == NormalEncoding::kOctahedralSnorm16)
+			.SetVertexInput(vertex_format.GetBindingDescriptions(), vertex_format.GetAttributeDescriptions());
+		return builder;
 	}
 
-	void SimpleRenderSystem::RenderGameObjects(FrameInfo& frame_info)
+	VulkanEnginePipelineRegistry::VariantBuilder SimpleRenderSystem::MakeDepthBuilder(const VertexFormat& vertex_format) const
 	{
-		vulkanengine_pipeline_->Bind(frame_info.command_buffer);
+		VulkanEnginePipelineRegistry::VariantBuilder builder{
+			pipeline_registry_,
+			depth_vert_filepath_,
+			"Shaders/depth_only.frag.spv",
+			depth_pipeline_config_ };
+		builder.SetVertexInput(vertex_format.GetPositionBindingDescriptions(), vertex_format.GetPositionAttributeDescriptions());
+		return builder;
+	}
 
-		vkCmdBindDescriptorSets(
-			frame_info.command_buffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			pipeline_layout_,
-			0,
-			1,
-			&frame_info.global_descriptor_set,
-			0,
-			nullptr);
+	VulkanEnginePipeline& SimpleRenderSystem::GetPipeline(const VertexFormat& vertex_format)
+	{
+		for (auto& pipeline : pipelines_)
+		{
+			if (pipeline.first == vertex_format)
+			{
+				return *pipeline.second;
+			}
+		}
+
+		DepthPass depth_pass = depth_prepass_ ? DepthPass::kAfterPrepass : DepthPass::kNone;
+		pipelines_.emplace_back(vertex_format, MakeVariantBuilder(shading_variant_, vertex_format, depth_pass).Build());
+		return *pipelines_.back().second;
+	}
+
+	VulkanEnginePipeline& SimpleRenderSystem::GetDepthPipeline(const VertexFormat& vertex_format)
+	{
+		for (auto& pipeline : depth_pipelines_)
+		{
+			if (pipeline.first == vertex_format)
+			{
+				return *pipeline.second;
+			}
+		}
+
+		depth_pipelines_.emplace_back(vertex_format, MakeDepthBuilder(vertex_format).Build());
+		return *depth_pipelines_.back().second;
+	}
+
+	std::vector<uint8_t> SimpleRenderSystem::DescribePipeline(const VertexFormat& vertex_format, DepthPass depth_pass) const
+	{
+		CapturedPipelineDescription description{};
+		description.position = static_cast<uint8_t>(vertex_format.position);
+		description.normal = static_cast<uint8_t>(vertex_format.normal);
+		description.color = static_cast<uint8_t>(vertex_format.color);
+		description.uv = static_cast<uint8_t>(vertex_format.uv);
+		description.light_budget = shading_variant_.light_budget;
+		description.specular_exponent = shading_variant_.specular_exponent;
+		description.shading_model = static_cast<int32_t>(shading_variant_.shading_model);
+		description.specular = shading_variant_.specular ? 1 : 0;
+		description.depth_pass = static_cast<uint32_t>(depth_pass);
+
+		std::vector<uint8_t> bytes(sizeof(CapturedPipelineDescription));
+		memcpy(bytes.data(), &description, sizeof(CapturedPipelineDescription));
+		return bytes;
+	}
+
+	VulkanEngineCommandReplay::ReplayPipeline SimpleRenderSystem::ResolveCapturedPipeline(const std::vector<uint8_t>& description)
+	{
+		assert(bindless_set_ == nullptr && "Captured push constants hold the transforms, which bindless pipelines don't read");
+		if (description.size() != sizeof(CapturedPipelineDescription))
+		{
+			throw std::runtime_error("invalid captured pipeline description!");
+		}
+		CapturedPipelineDescription captured{};
+		memcpy(&captured, description.data(), sizeof(CapturedPipelineDescription));
+		if (captured.light_budget > MAX_LIGHTS || captured.depth_pass > static_cast<uint32_t>(DepthPass::kAfterPrepass))
+		{
+			throw std::runtime_error("invalid captured pipeline description!");
+		}
+
+		VertexFormat vertex_format{};
+		vertex_format.position = static_cast<PositionEncoding>(captured.position);
+		vertex_format.normal = static_cast<NormalEncoding>(captured.normal);
+		vertex_format.color = static_cast<ColorEncoding>(captured.color);
+		vertex_format.uv = static_cast<UvEncoding>(captured.uv);
+
+		ShadingVariant variant{};
+		variant.light_budget = captured.light_budget;
+		variant.specular_exponent = captured.specular_exponent;
+		variant.shading_model = static_cast<ShadingModel>(captured.shading_model);
+		variant.specular = captured.specular != 0;
+
+		DepthPass depth_pass = static_cast<DepthPass>(captured.depth_pass);
+		if (depth_pass == DepthPass::kPrepass)
+		{
+			return { MakeDepthBuilder(vertex_format).Build(), pipeline_layout_ };
+		}
+		return { MakeVariantBuilder(variant, vertex_format, depth_pass).Build(), pipeline_layout_ };
+	}
+
+	void SimpleRenderSystem::RequestVariant(const ShadingVariant& variant)
+	{
+		// keeps a depth prepass toggle that is still compiling
+		RequestPipelines(variant, pending_pipelines_.empty() ? depth_prepass_ : pending_depth_prepass_);
+	}
+
+	void SimpleRenderSystem::SetDepthPrepass(bool enabled)
+	{
+		bool pending = !pending_pipelines_.empty();
+		if (enabled == (pending ? pending_depth_prepass_ : depth_prepass_))
+		{
+			return;
+		}
+
+		// the shading pipelines' depth state changes; the registry keeps both sets, so toggling back is cheap
+		RequestPipelines(pending ? pending_variant_ : shading_variant_, enabled);
+	}
+
+	void SimpleRenderSystem::FinishPendingVariant()
+	{
+		for (auto& pending : pending_pipelines_)
+		{
+			pending.second.wait();
+		}
+		for (auto& pending : pending_depth_pipelines_)
+		{
+			pending.second.wait();
+		}
+		if (!pending_pipelines_.empty())
+		{
+			ApplyPendingVariant();
+		}
+	}
+
+	void SimpleRenderSystem::RequestPipelines(const ShadingVariant& variant, bool depth_prepass)
+	{
+		pending_variant_ = variant;
+		pending_depth_prepass_ = depth_prepass;
+		pending_pipelines_.clear();
+		pending_depth_pipelines_.clear();
+
+		DepthPass depth_pass = depth_prepass ? DepthPass::kAfterPrepass : DepthPass::kNone;
+		for (auto& pipeline : pipelines_)
+		{
+			pending_pipelines_.emplace_back(pipeline.first, MakeVariantBuilder(variant, pipeline.first, depth_pass).BuildAsync());
+
+			bool has_depth_pipeline = std::any_of(depth_pipelines_.begin(), depth_pipelines_.end(),
+				[&pipeline](const auto& depth_pipeline) { return depth_pipeline.first == pipeline.first; });
+			if (depth_prepass && !has_depth_pipeline)
+			{
+				pending_depth_pipelines_.emplace_back(pipeline.first, MakeDepthBuilder(pipeline.first).BuildAsync());
+			}
+		}
+	}
+
+	// Swaps everything in at once, so a frame never mixes pipelines of two requests
+	void SimpleRenderSystem::ApplyPendingVariant()
+	{
+		auto is_ready = [](const auto& pending) { return pending.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+		if (!std::all_of(pending_pipelines_.begin(), pending_pipelines_.end(), is_ready) ||
+			!std::all_of(pending_depth_pipelines_.begin(), pending_depth_pipelines_.end(), is_ready))
+		{
+			return;
+		}
+
+		try
+		{
+			std::vector<std::pair<VertexFormat, std::shared_ptr<VulkanEnginePipeline>>> pipelines;
+			for (auto& pending : pending_pipelines_)
+			{
+				pipelines.emplace_back(pending.first, pending.second.get());
+			}
+			std::vector<std::pair<VertexFormat, std::shared_ptr<VulkanEnginePipeline>>> depth_pipelines;
+			for (auto& pending : pending_depth_pipelines_)
+			{
+				depth_pipelines.emplace_back(pending.first, pending.second.get());
+			}
+			pipelines_ = std::move(pipelines);
+			depth_pipelines_.insert(depth_pipelines_.end(), depth_pipelines.begin(), depth_pipelines.end());
+			shading_variant_ = pending_variant_;
+			depth_prepass_ = pending_depth_prepass_;
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "failed to build shading variant: " << e.what() << std::endl;
+		}
+		pending_pipelines_.clear();
+		pending_depth_pipelines_.clear();
+	}
+
+	// Worst case per draw: its transforms, both copies of its commands and its occlusion candidate. The overhead
+	// covers rounding each of the system's allocations up to the largest offset alignment Vulkan allows, and
+	// aligning the object array to its stride
+	static constexpr VkDeviceSize kFrameBytesPerDraw =
+		sizeof(SimplePushConstantData) +
+		2 * SimpleRenderSystem::kMaxCommandsPerDraw * sizeof(VkDrawIndexedIndirectCommand) +
+		sizeof(VulkanEngineOcclusionCuller::Candidate);
+	static constexpr VkDeviceSize kFrameOverheadBytes = 4 * 256 + sizeof(SimplePushConstantData);
+
+	VkDeviceSize SimpleRenderSystem::GetFrameRingBufferBytes(uint32_t max_draw_count)
+	{
+		return kFrameBytesPerDraw * max_draw_count + kFrameOverheadBytes;
+	}
+
+	void SimpleRenderSystem::CullMeshlets(FrameInfo& frame_info, DrawItem& draw)
+	{
+		// cones are tested in object space, where they were built
+		glm::vec3 camera_position = glm::vec3(glm::inverse(draw.model_matrix) * glm::vec4(frame_info.camera.GetPosition(), 1.f));
+
+		MeshletCullingStats& stats = render_stats_.meshlets;
+		uint64_t triangles_before = stats.triangle_count;
+		size_t first_command = draw_commands_.size();
+		draw.model->GetMeshlets().Cull(draw.model_matrix, camera_position, frustum_planes_, meshlet_cone_culling_, draw_commands_, stats);
+
+		draw.indirect = true;
+		draw.first_command = static_cast<uint32_t>(first_command);
+		draw.command_count = static_cast<uint32_t>(draw_commands_.size() - first_command);
+		draw.triangle_count = static_cast<uint32_t>(stats.triangle_count - triangles_before);
+
+		// too fragmented to fit the frame budget, see GetFrameRingBufferBytes
+		if (draw.command_count > kMaxCommandsPerDraw)
+		{
+			const VulkanEngineModel::Lod& lod = draw.model->GetLod(0);
+			draw_commands_.resize(first_command);
+			draw_commands_.push_back({ lod.index_count, 1, lod.first_index, 0, 0 });
+			draw.command_count = 1;
+			draw.triangle_count = draw.model->GetTriangleCount(0);
+			stats.triangle_count = triangles_before + draw.triangle_count;
+		}
+	}
+
+	void SimpleRenderSystem::UploadDrawCommands(FrameInfo& frame_info)
+	{
+		if (draw_commands_.empty())
+		{
+			return;
+		}
+
+		VkDeviceSize commands_size = sizeof(VkDrawIndexedIndirectCommand) * draw_commands_.size();
+		VulkanEngineRingBuffer::Allocation allocation = frame_info.ring_buffer.Allocate(commands_size);
+		memcpy(allocation.data, draw_commands_.data(), static_cast<size_t>(commands_size));
+		for (DrawItem& draw : draws_)
+		{
+			draw.indirect_offset = allocation.offset + sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(draw.first_command);
+		}
+	}
+
+	void SimpleRenderSystem::UploadObjectData(FrameInfo& frame_info)
+	{
+		if (!bindless_set_ || draws_.empty())
+		{
+			return;
+		}
+
+		// registered once as a whole; the object index picks this frame's transforms out of it
+		if (object_buffer_ != frame_info.ring_buffer.GetBuffer())
+		{
+			if (object_buffer_index_ != VulkanEngineBindlessSet::kInvalidIndex)
+			{
+				bindless_set_->ReleaseStorageBuffer(object_buffer_index_);
+			}
+			object_buffer_ = frame_info.ring_buffer.GetBuffer();
+			object_buffer_index_ = bindless_set_->RegisterStorageBuffer({ object_buffer_, 0, VK_WHOLE_SIZE });
+		}
+
+		// objects[] is indexed from the start of the buffer, so the array starts on a multiple of its stride
+		constexpr VkDeviceSize stride = sizeof(SimplePushConstantData);
+		VulkanEngineRingBuffer::Allocation allocation = frame_info.ring_buffer.Allocate(stride * draws_.size() + stride - 1);
+		VkDeviceSize first_index = (allocation.offset + stride - 1) / stride;
+		auto* objects = reinterpret_cast<SimplePushConstantData*>(static_cast<uint8_t*>(allocation.data) + (first_index * stride - allocation.offset));
+		for (size_t i = 0; i < draws_.size(); ++i)
+		{
+			objects[i].model_matrix = draws_[i].model_matrix * draws_[i].model->GetPositionDequantization();
+			objects[i].normal_matrix = draws_[i].normal_matrix;
+			draws_[i].object_index = static_cast<uint32_t>(first_index + i);
+		}
+	}
+
+	void SimpleRenderSystem::CollectDraws(FrameInfo& frame_info)
+	{
+		VULKANENGINE_PROFILE_FUNCTION();
+		draws_.clear();
+		draw_commands_.clear();
+		glm::vec3 camera_position = frame_info.camera.GetPosition();
+
+		VkDeviceSize ring_bytes_free = frame_info.ring_buffer.GetFrameCapacity() - frame_info.ring_buffer.GetBytesUsed();
+		size_t max_draw_count = ring_bytes_free > kFrameOverheadBytes
+			? static_cast<size_t>((ring_bytes_free - kFrameOverheadBytes) / kFrameBytesPerDraw)
+			: 0;
 
 		for (auto& kv : frame_info.game_objects)
 		{
 			auto& obj = kv.second;
 
-			if (obj.model_ == nullptr)
+			glm::mat4 model_matrix = obj.transform_.Mat4();
+			// bounds and LOD errors scale with the largest axis, so neither is ever underestimated
+			float max_scale = glm::max(glm::abs(obj.transform_.scale.x), glm::max(glm::abs(obj.transform_.scale.y), glm::abs(obj.transform_.scale.z)));
+
+			// streamed models are null while loading; the placeholder that stands in is never culled
+			bool streamed = obj.model_handle_ != kInvalidModelHandle && frame_info.asset_manager != nullptr;
+			std::shared_ptr<VulkanEngineModel> model = streamed ? frame_info.asset_manager->PeekModel(obj.model_handle_) : obj.model_;
+			if (model != nullptr && VulkanEngineCamera::IsSphereOutsideFrustum(
+				frustum_planes_,
+				glm::vec3(model_matrix * glm::vec4(model->GetBoundingSphereCenter(), 1.f)),
+				model->GetBoundingSphereRadius() * max_scale))
+			{
+				++render_stats_.culled_object_count;
+				continue;
+			}
+
+			// only drawn objects count as used, so the asset manager evicts what has been out of view the longest
+			if (streamed)
+			{
+				model = frame_info.asset_manager->GetModel(obj.model_handle_);
+			}
+			if (model == nullptr)
+			{
+				continue;
+			}
+
+			if (draws_.size() == max_draw_count)
 			{
+				++render_stats_.ring_limited_object_count;
 				continue;
 			}
 
+			glm::vec3 center_world = glm::vec3(model_matrix * glm::vec4(model->GetBoundingSphereCenter(), 1.f));
+			DrawItem draw{};
+			draw.model = std::move(model);
+			draw.model_matrix = model_matrix;
+			draw.normal_matrix = obj.transform_.NormalMatrix();
+			draw.center_world = center_world;
+			draw.radius = draw.model->GetBoundingSphereRadius() * max_scale;
+			draw.distance = glm::length(center_world - camera_position) - draw.radius;
+			draw.object_id = kv.first;
+
+			if (lod_screen_error_ > 0.f && draw.model->GetLodCount() > 1)
+			{
+				draw.lod = draw.model->SelectLod(frame_info.camera.GetProjectedScale(center_world) * max_scale, lod_screen_error_);
+			}
+			render_stats_.full_detail_triangle_count += draw.model->GetTriangleCount();
+
+			if (draw.lod == 0 && meshlet_culling_ && draw.model->HasMeshlets())
+			{
+				CullMeshlets(frame_info, draw);
+				if (draw.command_count == 0)
+				{
+					continue;
+				}
+			}
+			else
+			{
+				draw.triangle_count = draw.model->GetTriangleCount(draw.lod);
+			}
+			draws_.push_back(std::move(draw));
+		}
+
+		if (render_stats_.ring_limited_object_count > 0 && !ring_limit_reported_)
+		{
+			std::cerr << "simple render system: frame ring buffer full, skipped " << render_stats_.ring_limited_object_count
+				<< " objects; size it with GetFrameRingBufferBytes" << std::endl;
+			ring_limit_reported_ = true;
+		}
+
+		// front to back, so early depth testing rejects as many hidden fragments as possible
+		depth_order_.resize(draws_.size());
+		std::iota(depth_order_.begin(), depth_order_.end(), 0u);
+		std::sort(depth_order_.begin(), depth_order_.end(), [this](uint32_t a, uint32_t b) {
+			return draws_[a].distance < draws_[b].distance;
+		});
+
+		shading_order_ = depth_order_;
+		if (depth_prepass_)
+		{
+			// the prepass already hides everything but the visible surface, order only matters for pipeline binds
+			std::stable_sort(shading_order_.begin(), shading_order_.end(), [this](uint32_t a, uint32_t b) {
+				return draws_[a].model->GetVertexFormat().GetKey() < draws_[b].model->GetVertexFormat().GetKey();
+			});
+		}
+	}
+
+	void SimpleRenderSystem::RecordDraws(
+		FrameInfo& frame_info,
+		const std::vector<uint32_t>& order,
+		DepthPass depth_pass,
+		VkDeviceSize command_copy_offset,
+		bool indirect_only)
+	{
+		bool depth_only = depth_pass == DepthPass::kPrepass;
+		VulkanEnginePipeline* bound_pipeline = nullptr;
+		for (uint32_t index : order)
+		{
+			const DrawItem& draw = draws_[index];
+			if (indirect_only && !draw.indirect)
+			{
+				continue;
+			}
+			VulkanEngineModel& model = *draw.model;
+
+			VulkanEnginePipeline& pipeline = depth_only ? GetDepthPipeline(model.GetVertexFormat()) : GetPipeline(model.GetVertexFormat());
+			if (&pipeline != bound_pipeline)
+			{
+				pipeline.Bind(frame_info.command_buffer);
+				bound_pipeline = &pipeline;
+				++render_stats_.pipeline_bind_count;
+				if (frame_info.command_capture != nullptr)
+				{
+					frame_info.command_capture->BindPipeline(
+						VulkanEngineCommandCapture::PipelineSource::kSimpleRenderSystem,
+						DescribePipeline(model.GetVertexFormat(), depth_pass));
+				}
+			}
+
 			SimplePushConstantData push{};
-			push.model_matrix = obj.transform_.Mat4();
-			push.normal_matrix = obj.transform_.NormalMatrix();
+			push.model_matrix = draw.model_matrix * model.GetPositionDequantization();
+			push.normal_matrix = draw.normal_matrix;
 
-			vkCmdPushConstants(
+			if (bindless_set_)
+			{
+				BindlessPushConstantData bindless_push{ object_buffer_index_, draw.object_index };
+				vkCmdPushConstants(
+					frame_info.command_buffer,
+					pipeline_layout_,
+					push_constant_stages_,
+					0,
+					sizeof(BindlessPushConstantData),
+					&bindless_push);
+				render_stats_.push_constant_bytes += sizeof(BindlessPushConstantData);
+			}
+			else
+			{
+				vkCmdPushConstants(
+					frame_info.command_buffer,
+					pipeline_layout_,
+					push_constant_stages_,
+					0,
+					sizeof(SimplePushConstantData),
+					&push);
+				render_stats_.push_constant_bytes += sizeof(SimplePushConstantData);
+			}
+			// captures hold the matrices either way, replays have no bindless set
+			if (frame_info.command_capture != nullptr)
+			{
+				frame_info.command_capture->PushConstants(push_constant_stages_, 0, sizeof(SimplePushConstantData), &push);
+			}
+
+			if (depth_only)
+			{
+				model.BindPositions(frame_info.command_buffer);
+			}
+			else
+			{
+				model.Bind(frame_info.command_buffer);
+			}
+			if (frame_info.command_capture != nullptr)
+			{
+				frame_info.command_capture->BindGeometry(model);
+			}
+
+			uint32_t draw_count = 1;
+			if (draw.indirect)
+			{
+				draw_count = draw.command_count;
+				model.DrawIndirect(frame_info.command_buffer, frame_info.ring_buffer.GetBuffer(), draw.indirect_offset + command_copy_offset, draw_count);
+				if (frame_info.command_capture != nullptr)
+				{
+					frame_info.command_capture->DrawIndexedIndirect(frame_info.ring_buffer, draw.indirect_offset + command_copy_offset, draw_count);
+				}
+			}
+			else
+			{
+				model.Draw(frame_info.command_buffer, draw.lod);
+				if (frame_info.command_capture != nullptr)
+				{
+					frame_info.command_capture->DrawModel(model, draw.lod);
+				}
+			}
+
+			// a late copy of the commands only draws what the early one skipped, counted there already
+			if (command_copy_offset != 0)
+			{
+				continue;
+			}
+			if (depth_only)
+			{
+				render_stats_.depth_prepass_draw_count += draw_count;
+				render_stats_.depth_prepass_triangle_count += draw.triangle_count;
+			}
+			else
+			{
+				render_stats_.draw_count += draw_count;
+				render_stats_.triangle_count += draw.triangle_count;
+			}
+		}
+	}
+
+	void SimpleRenderSystem::RecordPasses(FrameInfo& frame_info, VkDeviceSize command_copy_offset, bool indirect_only)
+	{
+		// the global set stays bound across pipeline changes and both passes, as every pipeline shares pipeline_layout_
+		vkCmdBindDescriptorSets(
+			frame_info.command_buffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipeline_layout_,
+			0,
+			1,
+			&frame_info.global_descriptor_set,
+			1,
+			&frame_info.global_ubo_offset);
+		if (frame_info.command_capture != nullptr)
+		{
+			frame_info.command_capture->BindGlobalSet();
+		}
+		++render_stats_.descriptor_bind_count;
+		if (bindless_set_)
+		{
+			VkDescriptorSet bindless_descriptor_set = bindless_set_->GetDescriptorSet();
+			vkCmdBindDescriptorSets(
 				frame_info.command_buffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				pipeline_layout_,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				VulkanEngineBindlessSet::kSet,
+				1,
+				&bindless_descriptor_set,
 				0,
-				sizeof(SimplePushConstantData),
-				&push);
-			obj.model_->Bind(frame_info.command_buffer);
-			obj.model_->Draw(frame_info.command_buffer);
+				nullptr);
+			++render_stats_.descriptor_bind_count;
+		}
+
+		if (depth_prepass_)
+		{
+			VulkanEngineGpuProfiler::Scope gpu_scope{ frame_info.gpu_profiler, frame_info.command_buffer, "depth prepass" };
+			RecordDraws(frame_info, depth_order_, DepthPass::kPrepass, command_copy_offset, indirect_only);
+		}
+		{
+			VulkanEngineGpuProfiler::Scope gpu_scope{ frame_info.gpu_profiler, frame_info.command_buffer, "game objects" };
+			RecordDraws(frame_info, shading_order_, depth_prepass_ ? DepthPass::kAfterPrepass : DepthPass::kNone, command_copy_offset, indirect_only);
+		}
+	}
+
+	void SimpleRenderSystem::ReportMetrics(FrameInfo& frame_info)
+	{
+		if (frame_info.metrics != nullptr)
+		{
+			VulkanEngineMetrics& metrics = *frame_info.metrics;
+			metrics.GetCounter(metric::kDrawCalls).Add(render_stats_.draw_count + render_stats_.depth_prepass_draw_count);
+			metrics.GetCounter(metric::kTriangles).Add(render_stats_.triangle_count + render_stats_.depth_prepass_triangle_count);
+			metrics.GetCounter(metric::kCulledObjects).Add(render_stats_.culled_object_count);
+			metrics.GetCounter(metric::kPipelineBinds).Add(render_stats_.pipeline_bind_count);
+			metrics.GetCounter(metric::kDescriptorBinds).Add(render_stats_.descriptor_bind_count);
+			metrics.GetCounter(metric::kPushConstantBytes).Add(render_stats_.push_constant_bytes);
+		}
+	}
+
+	void SimpleRenderSystem::RenderGameObjects(FrameInfo& frame_info)
+	{
+		VULKANENGINE_PROFILE_FUNCTION();
+
+		if (!pending_pipelines_.empty())
+		{
+			ApplyPendingVariant();
 		}
 
+		render_stats_ = {};
+		frustum_planes_ = frame_info.camera.GetFrustumPlanes();
+		CollectDraws(frame_info);
+		UploadDrawCommands(frame_info);
+		UploadObjectData(frame_info);
+		RecordPasses(frame_info, 0, false);
+		ReportMetrics(frame_info);
+	}
+
+	void SimpleRenderSystem::PrepareGameObjects(FrameInfo& frame_info, VulkanEngineOcclusionCuller& culler)
+	{
+		VULKANENGINE_PROFILE_FUNCTION();
+
+		if (!pending_pipelines_.empty())
+		{
+			ApplyPendingVariant();
+		}
+
+		render_stats_ = {};
+		frustum_planes_ = frame_info.camera.GetFrustumPlanes();
+		CollectDraws(frame_info);
+		UploadObjectData(frame_info);
+
+		// the culler only sees indirect draws, so every indexed LOD becomes a single command of its own
+		occlusion_candidates_.clear();
+		const glm::mat4& view = frame_info.camera.GetView();
+		for (DrawItem& draw : draws_)
+		{
+			if (!draw.indirect)
+			{
+				if (!draw.model->HasIndexBuffer())
+				{
+					continue;
+				}
+				const VulkanEngineModel::Lod& lod = draw.model->GetLod(draw.lod);
+				draw.indirect = true;
+				draw.first_command = static_cast<uint32_t>(draw_commands_.size());
+				draw.command_count = 1;
+				draw_commands_.push_back({ lod.index_count, 1, lod.first_index, 0, 0 });
+			}
+
+			VulkanEngineOcclusionCuller::Candidate candidate{};
+			candidate.view_sphere = glm::vec4(glm::vec3(view * glm::vec4(draw.center_world, 1.f)), draw.radius);
+			candidate.first_command = draw.first_command;
+			candidate.command_count = draw.command_count;
+			candidate.visibility_slot = draw.object_id < VulkanEngineOcclusionCuller::kVisibilitySlotCount
+				? static_cast<uint32_t>(draw.object_id)
+				: VulkanEngineOcclusionCuller::kNoVisibilitySlot;
+			occlusion_candidates_.push_back(candidate);
+		}
+		render_stats_.occlusion_candidate_count = static_cast<uint32_t>(occlusion_candidates_.size());
+		if (occlusion_candidates_.empty())
+		{
+			late_command_offset_ = 0;
+			return;
+		}
+
+		// both copies in one allocation, the late one directly after the early one
+		VkDeviceSize commands_size = sizeof(VkDrawIndexedIndirectCommand) * draw_commands_.size();
+		VulkanEngineRingBuffer::Allocation commands = frame_info.ring_buffer.Allocate(commands_size * 2);
+		memcpy(commands.data, draw_commands_.data(), static_cast<size_t>(commands_size));
+		memcpy(static_cast<uint8_t*>(commands.data) + commands_size, draw_commands_.data(), static_cast<size_t>(commands_size));
+		for (DrawItem& draw : draws_)
+		{
+			draw.indirect_offset = commands.offset + sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(draw.first_command);
+		}
+		late_command_offset_ = commands_size;
+
+		VkDeviceSize candidates_size = sizeof(VulkanEngineOcclusionCuller::Candidate) * occlusion_candidates_.size();
+		VulkanEngineRingBuffer::Allocation candidates = frame_info.ring_buffer.Allocate(candidates_size);
+		memcpy(candidates.data, occlusion_candidates_.data(), static_cast<size_t>(candidates_size));
+
+		culler.SetCandidates(
+			frame_info.camera,
+			candidates.offset,
+			static_cast<uint32_t>(occlusion_candidates_.size()),
+			commands.offset,
+			static_cast<uint32_t>(draw_commands_.size()));
+	}
+
+	void SimpleRenderSystem::RenderGameObjects(FrameInfo& frame_info, VulkanEngineOcclusionCuller::Phase phase)
+	{
+		VULKANENGINE_PROFILE_FUNCTION();
+
+		if (phase == VulkanEngineOcclusionCuller::Phase::kEarly)
+		{
+			// non indexed models are never culled and drawn here only
+			RecordPasses(frame_info, 0, false);
+			return;
+		}
+
+		if (late_command_offset_ != 0)
+		{
+			// the same draws again, from the late copy
+			RecordPasses(frame_info, late_command_offset_, true);
+		}
+		ReportMetrics(frame_info);
 	}
 
 }  // namespace vulkanengine
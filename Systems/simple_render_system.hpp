@@ -1,13 +1,18 @@
 #pragma once
 
+#include "Engine/vulkanengine_bindless.hpp"
 #include "Engine/vulkanengine_camera.hpp"
 #include "Engine/vulkanengine_device.hpp"
 #include "Engine/vulkanengine_frame_info.hpp"
 #include "Engine/vulkanengine_game_object.hpp"
+#include "Engine/vulkanengine_occlusion_culler.hpp"
 #include "Engine/vulkanengine_pipeline.hpp"
+#include "Engine/vulkanengine_pipeline_registry.hpp"
 
 // std
+#include <array>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace vulkanengine
@@ -15,21 +20,194 @@ namespace vulkanengine
 	class SimpleRenderSystem
 	{
 	public:
-		SimpleRenderSystem(VulkanEngineDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
+		enum class ShadingModel : int32_t
+		{
+			kBlinnPhong = 0,
+			kLambert = 1,
+		};
+
+		// Baked into the fragment shader through specialization constants, one pipeline per distinct variant
+		struct ShadingVariant
+		{
+			uint32_t light_budget = MAX_LIGHTS;	// lights past the budget are ignored, must be <= MAX_LIGHTS
+			float specular_exponent = 512.f;
+			ShadingModel shading_model = ShadingModel::kBlinnPhong;
+			bool specular = true;
+		};
+
+		// Geometric error a LOD may show on screen, as a fraction of the viewport height (about a pixel at 720p)
+		static constexpr float kDefaultLodScreenError = 1.f / 720.f;
+
+		// Filled by RenderGameObjects, describes the last frame
+		struct RenderStats
+		{
+			uint32_t draw_count = 0;
+			uint32_t culled_object_count = 0;			// objects entirely outside the view frustum
+			uint64_t triangle_count = 0;
+			uint64_t full_detail_triangle_count = 0;	// what the same draws would have cost at LOD 0
+			uint32_t depth_prepass_draw_count = 0;		// on top of draw_count
+			uint64_t depth_prepass_triangle_count = 0;	// on top of triangle_count
+			uint32_t pipeline_bind_count = 0;
+			uint32_t descriptor_bind_count = 0;
+			uint64_t push_constant_bytes = 0;			// per draw transforms, unless they come from the bindless set
+			MeshletCullingStats meshlets{};				// models drawn at LOD 0 with meshlets only
+			uint32_t occlusion_candidate_count = 0;		// handed to the occlusion culler, see PrepareGameObjects
+			uint32_t ring_limited_object_count = 0;		// skipped, the frame ring buffer had no room for their draws
+		};
+
+		// Meshlet culling may leave at most this many ranges per draw, beyond that the whole LOD 0 is drawn
+		static constexpr uint32_t kMaxCommandsPerDraw = 64;
+
+		// Frame ring buffer bytes RenderGameObjects / PrepareGameObjects may use for [max_draw_count] draws, on top
+		// of what the frame pushes before them. With less room, the draws that don't fit are skipped
+		static VkDeviceSize GetFrameRingBufferBytes(uint32_t max_draw_count);
+
+		// With a [bindless_set], the per draw transforms are written to the frame's ring buffer, which is
+		// registered in the set, and draws only push their index. The ring buffer needs STORAGE_BUFFER usage
+		SimpleRenderSystem(
+			VulkanEngineDevice& device,
+			VulkanEnginePipelineRegistry& pipeline_registry,
+			const RenderTargetInfo& render_target,
+			VkDescriptorSetLayout global_set_layout,
+			VulkanEngineBindlessSet* bindless_set = nullptr);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
 		void RenderGameObjects(FrameInfo& frame_info);
+		// Occlusion culled rendering, in place of the call above. PrepareGameObjects collects the frame's draws
+		// outside a render pass, draws every indexed model indirectly and hands the draws to [culler]; each
+		// phase's render pass then records the same draws, with instance counts the culler writes on the GPU
+		void PrepareGameObjects(FrameInfo& frame_info, VulkanEngineOcclusionCuller& culler);
+		void RenderGameObjects(FrameInfo& frame_info, VulkanEngineOcclusionCuller::Phase phase);
+		// Compiles the variant for every vertex format in use in the background; the current pipelines are used until all are ready
+		void RequestVariant(const ShadingVariant& variant);
+		// Blocks until what RequestVariant and SetDepthPrepass asked for is built and applies it, for setup
+		// code that wants it from the first frame on
+		void FinishPendingVariant();
+
+		// 0 always draws LOD 0
+		void SetLodScreenError(float max_screen_error) { lod_screen_error_ = max_screen_error; }
+		// Models with meshlets are culled per meshlet when drawn at LOD 0. Cone (backface) culling is off by
+		// default: the pipelines draw both faces and the open vases show their inside
+		void SetMeshletCulling(bool enabled) { meshlet_culling_ = enabled; }
+		void SetMeshletConeCulling(bool enabled) { meshlet_cone_culling_ = enabled; }
+		// Lays down depth with position-only pipelines first; shading then runs with an EQUAL depth test and
+		// no depth writes, so every pixel is lit once however much the objects overlap. Off unless enabled
+		// (FirstApp turns it on): it pays for itself when fragments are expensive and the scene has real overdraw.
+		// Like a variant, the toggle is built in the background and applied at the start of a frame once ready
+		void SetDepthPrepass(bool enabled);
+		// What the frames are drawn with, which lags behind SetDepthPrepass until its pipelines are ready
+		bool IsDepthPrepassEnabled() const { return depth_prepass_; }
+		const RenderStats& GetRenderStats() const { return render_stats_; }
+
+		// Rebuilds a pipeline this system described to a VulkanEngineCommandCapture, for replays.
+		// Captures always describe the push constant path, so replays run on systems without a bindless set.
+		// Throws std::runtime_error on a description of another size
+		VulkanEngineCommandReplay::ReplayPipeline ResolveCapturedPipeline(const std::vector<uint8_t>& description);
 
 	private:
+		// How a pipeline treats depth, part of what a captured pipeline is rebuilt from
+		enum class DepthPass : uint32_t
+		{
+			kNone = 0,			// shading with the usual depth test and writes
+			kPrepass = 1,		// depth only
+			kAfterPrepass = 2,	// shading on top of the prepass depth
+		};
+
+		// A visible object of the frame being recorded; both passes draw exactly the same geometry
+		struct DrawItem
+		{
+			std::shared_ptr<VulkanEngineModel> model;
+			glm::mat4 model_matrix;
+			glm::mat4 normal_matrix;
+			uint32_t lod;
+			uint32_t triangle_count;
+			glm::vec3 center_world;				// bounding sphere
+			float radius;
+			float distance;						// from the camera to the near side of the bounding sphere
+			VulkanEngineGameObject::id_t object_id;
+			uint32_t object_index;				// into the bindless object buffer
+			bool indirect;						// drawn from the commands below: visible meshlets, or the LOD
+			uint32_t first_command;				// into draw_commands_
+			uint32_t command_count;
+			VkDeviceSize indirect_offset;		// of the same commands in the frame's ring buffer
+		};
+
 		void CreatePipelineLayout(VkDescriptorSetLayout global_set_layout);
-		void CreatePipeline(VkRenderPass render_pass);
+		void CreatePipeline(const RenderTargetInfo& render_target);
+		VulkanEnginePipelineRegistry::VariantBuilder MakeVariantBuilder(
+			const ShadingVariant& variant,
+			const VertexFormat& vertex_format,
+			DepthPass depth_pass) const;
+		VulkanEnginePipelineRegistry::VariantBuilder MakeDepthBuilder(const VertexFormat& vertex_format) const;
+		// Builds the pipeline for a vertex format the first time a model using it is drawn
+		VulkanEnginePipeline& GetPipeline(const VertexFormat& vertex_format);
+		VulkanEnginePipeline& GetDepthPipeline(const VertexFormat& vertex_format);
+		std::vector<uint8_t> DescribePipeline(const VertexFormat& vertex_format, DepthPass depth_pass) const;
+		// Requests every pipeline the frames will need with [variant] and [depth_prepass], replacing any pending request
+		void RequestPipelines(const ShadingVariant& variant, bool depth_prepass);
+		void ApplyPendingVariant();
+		// Culls, resolves streamed models, picks LODs and sorts what is left front to back into draws_
+		void CollectDraws(FrameInfo& frame_info);
+		// Culls the model's meshlets and appends the visible ranges to draw_commands_
+		void CullMeshlets(FrameInfo& frame_info, DrawItem& draw);
+		// Writes draw_commands_ to the frame's ring buffer in one allocation
+		void UploadDrawCommands(FrameInfo& frame_info);
+		// With a bindless set, writes every draw's transforms to the frame's ring buffer in one allocation
+		void UploadObjectData(FrameInfo& frame_info);
+		// [command_copy_offset] is added to every indirect offset; [indirect_only] skips the other draws
+		void RecordDraws(
+			FrameInfo& frame_info,
+			const std::vector<uint32_t>& order,
+			DepthPass depth_pass,
+			VkDeviceSize command_copy_offset = 0,
+			bool indirect_only = false);
+		// Binds the global set and records the depth prepass and shading passes
+		void RecordPasses(FrameInfo& frame_info, VkDeviceSize command_copy_offset, bool indirect_only);
+		void ReportMetrics(FrameInfo& frame_info);
 
 		VulkanEngineDevice& vulkanengine_device_;
+		VulkanEnginePipelineRegistry& pipeline_registry_;
+		PipelineConfigInfo base_pipeline_config_{};
+		PipelineConfigInfo depth_pipeline_config_{};		// depth only, position stream only
+		PipelineConfigInfo after_prepass_pipeline_config_{};	// EQUAL depth test, no depth writes
+
+		// One pipeline per vertex format, all of the current shading variant. Only a handful of formats
+		// exist, so a linear search beats hashing. Pipelines are owned by the registry, shared with other systems
+		ShadingVariant shading_variant_{};
+		std::vector<std::pair<VertexFormat, std::shared_ptr<VulkanEnginePipeline>>> pipelines_;
+		ShadingVariant pending_variant_{};
+		std::vector<std::pair<VertexFormat, VulkanEnginePipelineRegistry::PipelineFuture>> pending_pipelines_;
+		std::vector<std::pair<VertexFormat, std::shared_ptr<VulkanEnginePipeline>>> depth_pipelines_;
+		bool depth_prepass_ = false;
+		bool pending_depth_prepass_ = false;
+		std::vector<std::pair<VertexFormat, VulkanEnginePipelineRegistry::PipelineFuture>> pending_depth_pipelines_;
 
-		std::unique_ptr<VulkanEnginePipeline> vulkanengine_pipeline_;
 		VkPipelineLayout pipeline_layout_;
+		VkShaderStageFlags push_constant_stages_ = 0;	// reflected from the shaders, must match vkCmdPushConstants
+
+		// the -DBINDLESS vertex shaders when the transforms come from the bindless set
+		VulkanEngineBindlessSet* bindless_set_ = nullptr;
+		std::string vert_filepath_;
+		std::string depth_vert_filepath_;
+		VkBuffer object_buffer_ = VK_NULL_HANDLE;	// the ring buffer registered in the bindless set
+		uint32_t object_buffer_index_ = VulkanEngineBindlessSet::kInvalidIndex;
+
+		float lod_screen_error_ = kDefaultLodScreenError;
+		RenderStats render_stats_{};
+		bool ring_limit_reported_ = false;	// warn once, not every frame
+
+		bool meshlet_culling_ = true;
+		bool meshlet_cone_culling_ = false;
+		std::array<glm::vec4, 6> frustum_planes_{};				// of the frame being recorded
+		// of the frame being recorded, reused to avoid per frame allocations
+		std::vector<VkDrawIndexedIndirectCommand> draw_commands_;
+		std::vector<VulkanEngineOcclusionCuller::Candidate> occlusion_candidates_;
+		VkDeviceSize late_command_offset_ = 0;	// from the early copy of draw_commands_ to the late one
+		std::vector<DrawItem> draws_;
+		std::vector<uint32_t> depth_order_;		// front to back
+		std::vector<uint32_t> shading_order_;	// front to back, or by pipeline after a depth prepass
 	};
 }  // namespace vulkanengine
@@ -0,0 +1,444 @@
+#include "benchmark_app.hpp"
+
+#include "Engine/vulkanengine_command_capture.hpp"
+#include "Engine/vulkanengine_ring_buffer.hpp"
+#include "Engine/vulkanengine_shader_reflection.hpp"
+#include "Systems/simple_render_system.hpp"
+#include "Systems/point_light_system.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace vulkanengine
+{
+	// std::uniform_real_distribution is implementation defined; this is the same on every standard library
+	static float NextUnitFloat(std::mt19937& rng)
+	{
+		return static_cast<float>(rng() >> 8) * (1.f / 16777216.f);
+	}
+
+	static float ElapsedMilliseconds(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+	{
+		return std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+	}
+
+	static const char* GetCameraPathName(BenchmarkApp::CameraPath path)
+	{
+		switch (path)
+		{
+		case BenchmarkApp::CameraPath::kStatic: return "static";
+		case BenchmarkApp::CameraPath::kOrbit: return "orbit";
+		case BenchmarkApp::CameraPath::kDolly: return "dolly";
+		}
+		return "unknown";
+	}
+
+	static void WriteSummary(std::ofstream& file, const char* name, const VulkanEngineMetrics::Histogram& histogram)
+	{
+		file << "\"" << name << "\":{\"mean\":" << histogram.GetMean()
+			<< ",\"p50\":" << histogram.GetPercentile(50.0)
+			<< ",\"p95\":" << histogram.GetPercentile(95.0)
+			<< ",\"p99\":" << histogram.GetPercentile(99.0)
+			<< ",\"max\":" << histogram.GetMax() << "}";
+	}
+
+	BenchmarkApp::BenchmarkApp(const Config& config)
+		: config_{ config },
+		vulkanengine_window_{ CreateBenchmarkWindow(config) },
+		vulkanengine_device_{ *vulkanengine_window_ },
+		vulkanengine_renderer_{ *vulkanengine_window_, vulkanengine_device_, config.dynamic_rendering }
+	{
+		assert(config_.scene.frame_count > 0 && "A benchmark needs at least one reported frame");
+
+		descriptor_layout_cache_ = std::make_unique<VulkanEngineDescriptorLayoutCache>(vulkanengine_device_);
+		global_descriptor_allocator_ = VulkanEngineDescriptorAllocator::Builder(vulkanengine_device_)
+			.SetInitialSetsPerPool(8)
+			.AddPoolSizeRatio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+			.Build();
+		pipeline_registry_ = std::make_unique<VulkanEnginePipelineRegistry>(vulkanengine_device_);
+		model_registry_ = std::make_unique<VulkanEngineModelRegistry>(vulkanengine_device_);
+		gpu_profiler_ = std::make_unique<VulkanEngineGpuProfiler>(vulkanengine_device_, VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		// only for the systems' draw counters; the benchmark writes its own report
+		VulkanEngineMetrics::Config metrics_config{};
+		metrics_config.log_interval_seconds = 0.f;
+		metrics_ = std::make_unique<VulkanEngineMetrics>(metrics_config);
+		if (config_.replay_filepath.empty())
+		{
+			LoadScene();
+		}
+	}
+
+	BenchmarkApp::~BenchmarkApp() {}
+
+	std::unique_ptr<VulkanEngineWindow> BenchmarkApp::CreateBenchmarkWindow(const Config& config)
+	{
+		int width = static_cast<int>(config.width);
+		int height = static_cast<int>(config.height);
+		if (config.headless)
+		{
+			return VulkanEngineWindow::CreateHeadless(width, height);
+		}
+		return std::make_unique<VulkanEngineWindow>(width, height, "VulkanEngine benchmark");
+	}
+
+	void BenchmarkApp::Run()
+	{
+		// sized for the scene, so the benchmark never runs out of room whatever its object count
+		VulkanEngineRingBuffer frame_ring_buffer{
+			vulkanengine_device_,
+			sizeof(GlobalUbo) + SimpleRenderSystem::GetFrameRingBufferBytes(static_cast<uint32_t>(game_objects_.size())),
+			VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT };
+
+		auto shader_reflection = VulkanEngineShaderReflection::FromFile("Shaders/simple_shader.vert.spv");
+		shader_reflection.Merge(VulkanEngineShaderReflection::FromFile("Shaders/simple_shader.frag.spv"));
+		auto global_set_layout = shader_reflection.SetLayoutBuilder(vulkanengine_device_, GLOBAL_SET, { GLOBAL_UBO_BINDING })
+			.Build(*descriptor_layout_cache_);
+
+		VkDescriptorSet global_descriptor_set;
+		auto buffer_info = frame_ring_buffer.DescriptorInfo(sizeof(GlobalUbo));
+		VulkanEngineDescriptorWriter(*global_set_layout, *global_descriptor_allocator_)
+			.WriteBuffer(GLOBAL_UBO_BINDING, &buffer_info)
+			.Build(global_descriptor_set);
+
+		SimpleRenderSystem simple_render_system{
+			vulkanengine_device_,
+			*pipeline_registry_,
+			vulkanengine_renderer_.GetSwapChainRenderTarget(),
+			global_set_layout->GetDescriptorSetLayout() };
+		simple_render_system.SetDepthPrepass(config_.depth_prepass);
+		// measured frames must all run with the configured state
+		simple_render_system.FinishPendingVariant();
+
+		PointLightSystem point_light_system{
+			vulkanengine_device_,
+			*pipeline_registry_,
+			vulkanengine_renderer_.GetSwapChainRenderTarget(),
+			global_set_layout->GetDescriptorSetLayout() };
+
+		std::unique_ptr<VulkanEngineCommandReplay> replay{};
+		GlobalUbo replay_ubo{};
+		if (!config_.replay_filepath.empty())
+		{
+			replay = std::make_unique<VulkanEngineCommandReplay>(vulkanengine_device_, config_.replay_filepath);
+			if (replay->GetGlobalUniforms().size() != sizeof(GlobalUbo))
+			{
+				throw std::runtime_error("capture " + config_.replay_filepath + " has a different GlobalUbo layout!");
+			}
+			memcpy(&replay_ubo, replay->GetGlobalUniforms().data(), sizeof(GlobalUbo));
+			replay->ResolvePipelines([&](VulkanEngineCommandCapture::PipelineSource source, const std::vector<uint8_t>& description) {
+				if (source == VulkanEngineCommandCapture::PipelineSource::kPointLightSystem)
+				{
+					return point_light_system.ResolveCapturedPipeline();
+				}
+				return simple_render_system.ResolveCapturedPipeline(description);
+			});
+			std::cout << "benchmark: replaying " << replay->GetCommandCount() << " commands (" << replay->GetDrawCount()
+				<< " draws) from " << config_.replay_filepath << std::endl;
+		}
+
+		VulkanEngineCamera camera{};
+		const Scene& scene = config_.scene;
+		uint32_t total_frames = scene.warmup_frames + scene.frame_count;
+		std::vector<FrameTimings> timings(total_frames);
+		std::vector<float> gpu_milliseconds{};
+		gpu_milliseconds.reserve(total_frames);
+		uint64_t gpu_collected = 0;
+
+		std::cout << "benchmark: " << (replay ? "replay, " : "") << game_objects_.size() << " objects, " << scene.frame_count << " frames after "
+			<< scene.warmup_frames << " warmup frames, " << GetCameraPathName(scene.camera_path) << " camera"
+			<< (vulkanengine_device_.IsHeadless() ? ", headless" : "")
+			<< (vulkanengine_renderer_.UsesDynamicRendering() ? ", dynamic rendering" : "")
+			<< (config_.depth_prepass ? ", depth prepass" : "") << std::endl;
+
+		for (uint32_t frame = 0; frame < total_frames;)
+		{
+			if (!vulkanengine_device_.IsHeadless())
+			{
+				glfwPollEvents();
+			}
+
+			UpdateCamera(camera, frame);
+
+			auto command_buffer = vulkanengine_renderer_.BeginFrame();
+			if (command_buffer == nullptr)
+			{
+				// the swap chain was recreated, the frame is retried
+				continue;
+			}
+			auto record_start = std::chrono::high_resolution_clock::now();
+
+			int frame_index = vulkanengine_renderer_.GetFrameIndex();
+			gpu_profiler_->BeginFrame(command_buffer, frame_index);
+			CollectGpuTimes(gpu_milliseconds, gpu_collected);
+			frame_ring_buffer.BeginFrame(frame_index);
+			pipeline_registry_->BeginFrame();
+
+			FrameInfo frame_info{
+				frame_index,
+				scene.frame_time,
+				command_buffer,
+				camera,
+				global_descriptor_set,
+				0,
+				game_objects_,
+				frame_ring_buffer,
+				nullptr,
+				nullptr,
+				gpu_profiler_.get(),
+				metrics_.get(),
+				nullptr
+			};
+
+			if (replay)
+			{
+				// the captured frame, uniforms included, exactly as it was recorded
+				frame_info.global_ubo_offset = frame_ring_buffer.Push(replay_ubo);
+				vulkanengine_renderer_.BeginSwapChainRenderPass(command_buffer);
+				{
+					VulkanEngineGpuProfiler::Scope gpu_scope{ gpu_profiler_.get(), command_buffer, "replay" };
+					replay->Record(command_buffer, global_descriptor_set, frame_info.global_ubo_offset);
+				}
+				vulkanengine_renderer_.EndSwapChainRenderPass(command_buffer);
+				metrics_->GetCounter(metric::kDrawCalls).Add(replay->GetDrawCount());
+			}
+			else
+			{
+				GlobalUbo ubo{};
+				ubo.projection = camera.GetProjection();
+				ubo.view = camera.GetView();
+				ubo.inverse_view = camera.GetInverseView();
+				point_light_system.Update(frame_info, ubo);
+				frame_info.global_ubo_offset = frame_ring_buffer.Push(ubo);
+
+				vulkanengine_renderer_.BeginSwapChainRenderPass(command_buffer);
+				simple_render_system.RenderGameObjects(frame_info);
+				point_light_system.Render(frame_info);
+				vulkanengine_renderer_.EndSwapChainRenderPass(command_buffer);
+			}
+			frame_ring_buffer.Flush();
+			gpu_profiler_->EndFrame(command_buffer);
+
+			auto submit_start = std::chrono::high_resolution_clock::now();
+			vulkanengine_renderer_.EndFrame();
+			auto submit_end = std::chrono::high_resolution_clock::now();
+			metrics_->EndFrame(scene.frame_time);
+
+			FrameTimings& frame_timings = timings[frame];
+			frame_timings.cpu_record = ElapsedMilliseconds(record_start, submit_start);
+			frame_timings.submit = ElapsedMilliseconds(submit_start, submit_end);
+			frame_timings.fence_wait = vulkanengine_renderer_.GetFenceWaitMilliseconds();
+			frame_timings.draw_calls = metrics_->GetCounter(metric::kDrawCalls).last_frame;
+			frame_timings.triangles = metrics_->GetCounter(metric::kTriangles).last_frame;
+			++frame;
+		}
+
+		vkDeviceWaitIdle(vulkanengine_device_.Device());
+		gpu_profiler_->CollectPending();
+		CollectGpuTimes(gpu_milliseconds, gpu_collected);
+
+		// frame scopes resolve in submission order, one per frame
+		for (size_t i = 0; i < std::min(gpu_milliseconds.size(), timings.size()); ++i)
+		{
+			timings[i].gpu = gpu_milliseconds[i];
+		}
+
+		if (!WriteResults(timings))
+		{
+			throw std::runtime_error("failed to write benchmark results to " + config_.output_filepath + "!");
+		}
+		std::cout << "benchmark: results written to " << config_.output_filepath << std::endl;
+	}
+
+	void BenchmarkApp::LoadScene()
+	{
+		const Scene& scene = config_.scene;
+		assert(!scene.models.empty() && "A benchmark scene needs at least one model");
+
+		std::vector<std::shared_ptr<VulkanEngineModel>> models{};
+		for (const auto& filepath : scene.models)
+		{
+			models.push_back(model_registry_->Load(filepath, scene.model_options));
+		}
+
+		std::mt19937 rng{ scene.seed };
+		for (uint32_t i = 0; i < scene.object_count; ++i)
+		{
+			auto object = VulkanEngineGameObject::CreateGameObject();
+			object.model_ = models[i % models.size()];
+			object.transform_.translation = {
+				(NextUnitFloat(rng) - .5f) * scene.spread,
+				(NextUnitFloat(rng) - .5f) * scene.spread,
+				(NextUnitFloat(rng) - .5f) * scene.spread };
+			object.transform_.rotation.y = NextUnitFloat(rng) * glm::two_pi<float>();
+			float scale = .5f + NextUnitFloat(rng);
+			object.transform_.scale = { scale, scale, scale };
+			game_objects_.emplace(object.GetId(), std::move(object));
+		}
+
+		uint32_t light_count = std::min<uint32_t>(scene.light_count, MAX_LIGHTS);
+		for (uint32_t i = 0; i < light_count; ++i)
+		{
+			auto point_light = VulkanEngineGameObject::CreatePointLight(scene.spread * .1f);
+			point_light.color_ = { .2f + .8f * NextUnitFloat(rng), .2f + .8f * NextUnitFloat(rng), .2f + .8f * NextUnitFloat(rng) };
+			float angle = (i * glm::two_pi<float>()) / light_count;
+			point_light.transform_.translation = { std::cos(angle) * scene.spread * .5f, -1.f, std::sin(angle) * scene.spread * .5f };
+			game_objects_.emplace(point_light.GetId(), std::move(point_light));
+		}
+	}
+
+	void BenchmarkApp::UpdateCamera(VulkanEngineCamera& camera, uint32_t frame) const
+	{
+		const Scene& scene = config_.scene;
+		float time = frame * scene.frame_time;
+		float distance = scene.camera_distance;
+
+		switch (scene.camera_path)
+		{
+		case CameraPath::kStatic:
+			camera.SetViewTarget({ 0.f, -1.f, -distance }, glm::vec3{ 0.f });
+			break;
+		case CameraPath::kOrbit:
+		{
+			float angle = time / scene.orbit_seconds * glm::two_pi<float>();
+			camera.SetViewTarget({ std::sin(angle) * distance, -1.f, -std::cos(angle) * distance }, glm::vec3{ 0.f });
+			break;
+		}
+		case CameraPath::kDolly:
+		{
+			uint32_t total_frames = scene.warmup_frames + scene.frame_count;
+			float progress = total_frames > 1 ? static_cast<float>(frame) / (total_frames - 1) : 0.f;
+			camera.SetViewDirection({ 0.f, -1.f, (progress * 2.f - 1.f) * distance }, { 0.f, 0.f, 1.f });
+			break;
+		}
+		}
+
+		camera.SetPerspectiveProjection(glm::radians(50.f), vulkanengine_renderer_.GetAspectRatio(), .1f, 2.f * distance + scene.spread);
+	}
+
+	// Appends the frame scope results the profiler resolved since the last call, oldest first
+	void BenchmarkApp::CollectGpuTimes(std::vector<float>& gpu_milliseconds, uint64_t& collected) const
+	{
+		const VulkanEngineGpuProfiler::ScopeHistory* history = gpu_profiler_->FindHistory(VulkanEngineGpuProfiler::kFrameScopeName);
+		if (history == nullptr)
+		{
+			return;
+		}
+
+		uint64_t pending = history->total_count - collected;
+		assert(pending <= VulkanEngineGpuProfiler::kHistoryLength && "GPU results were overwritten before they were collected");
+		for (uint64_t age = pending; age > 0; --age)
+		{
+			gpu_milliseconds.push_back(history->GetRecent(static_cast<uint32_t>(age - 1)));
+		}
+		collected = history->total_count;
+	}
+
+	bool BenchmarkApp::WriteResults(const std::vector<FrameTimings>& timings) const
+	{
+		std::ofstream file{ config_.output_filepath, std::ios::trunc };
+		if (!file)
+		{
+			return false;
+		}
+
+		const Scene& scene = config_.scene;
+		VulkanEngineMetrics::Histogram cpu_record{ scene.frame_count };
+		VulkanEngineMetrics::Histogram submit{ scene.frame_count };
+		VulkanEngineMetrics::Histogram fence_wait{ scene.frame_count };
+		VulkanEngineMetrics::Histogram gpu{ scene.frame_count };
+
+		file << std::fixed << std::setprecision(4);
+		file << "{\n\"device\":\"" << vulkanengine_device_.properties_.deviceName << "\",\n";
+		file << "\"scene\":{\"objects\":" << scene.object_count
+			<< ",\"lights\":" << std::min<uint32_t>(scene.light_count, MAX_LIGHTS)
+			<< ",\"camera_path\":\"" << GetCameraPathName(scene.camera_path) << "\""
+			<< ",\"seed\":" << scene.seed
+			<< ",\"warmup_frames\":" << scene.warmup_frames
+			<< ",\"frames\":" << scene.frame_count
+			<< ",\"frame_time\":" << scene.frame_time
+			<< ",\"width\":" << vulkanengine_window_->GetExtent().width
+			<< ",\"height\":" << vulkanengine_window_->GetExtent().height
+			<< ",\"headless\":" << (vulkanengine_device_.IsHeadless() ? "true" : "false")
+			<< ",\"dynamic_rendering\":" << (vulkanengine_renderer_.UsesDynamicRendering() ? "true" : "false")
+			<< ",\"depth_prepass\":" << (config_.depth_prepass ? "true" : "false");
+		if (!config_.replay_filepath.empty())
+		{
+			file << ",\"replay\":\"" << config_.replay_filepath << "\"";
+		}
+		file << "},\n";
+
+		file << "\"frames\":[";
+		for (uint32_t i = scene.warmup_frames; i < timings.size(); ++i)
+		{
+			const FrameTimings& frame = timings[i];
+			cpu_record.Record(frame.cpu_record);
+			submit.Record(frame.submit);
+			fence_wait.Record(frame.fence_wait);
+			file << (i > scene.warmup_frames ? "," : "") << "\n{\"frame\":" << i - scene.warmup_frames
+				<< ",\"cpu_record_ms\":" << frame.cpu_record
+				<< ",\"submit_ms\":" << frame.submit
+				<< ",\"fence_wait_ms\":" << frame.fence_wait
+				<< ",\"gpu_ms\":";
+			if (frame.gpu >= 0.f)
+			{
+				gpu.Record(frame.gpu);
+				file << frame.gpu;
+			}
+			else
+			{
+				file << "null";
+			}
+			file << ",\"draw_calls\":" << frame.draw_calls << ",\"triangles\":" << frame.triangles << "}";
+		}
+		file << "\n],\n\"summary\":{";
+		WriteSummary(file, "cpu_record_ms", cpu_record);
+		file << ",";
+		WriteSummary(file, "submit_ms", submit);
+		file << ",";
+		WriteSummary(file, "fence_wait_ms", fence_wait);
+		if (gpu.GetSampleCount() > 0)
+		{
+			file << ",";
+			WriteSummary(file, "gpu_ms", gpu);
+		}
+		// overdraw of the last frame: fragment shader invocations per pixel of each pass that has statistics
+		VkExtent2D extent = vulkanengine_window_->GetExtent();
+		double pixel_count = static_cast<double>(extent.width) * extent.height;
+		const std::pair<const char*, const char*> overdraw_scopes[] = {
+			{ "depth prepass", "depth_prepass_fragments_per_pixel" },
+			{ "game objects", "shading_fragments_per_pixel" } };
+		for (const auto& scope : overdraw_scopes)
+		{
+			const VulkanEngineGpuProfiler::ScopeHistory* history = gpu_profiler_->FindHistory(scope.first);
+			if (history != nullptr && history->has_statistics && pixel_count > 0.0)
+			{
+				file << ",\"" << scope.second << "\":" << history->statistics.fragment_shader_invocations / pixel_count;
+			}
+		}
+		file << "}\n}\n";
+
+		std::cout << "benchmark: cpu record " << cpu_record.GetPercentile(50.0) << " ms (p99 " << cpu_record.GetPercentile(99.0)
+			<< "), submit " << submit.GetPercentile(50.0) << " ms, gpu " << gpu.GetPercentile(50.0) << " ms (p99 "
+			<< gpu.GetPercentile(99.0) << ")" << std::endl;
+		return static_cast<bool>(file);
+	}
+}  // namespace vulkanengine
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Engine/vulkanengine_camera.hpp"
+#include "Engine/vulkanengine_descriptors.hpp"
+#include "Engine/vulkanengine_device.hpp"
+#include "Engine/vulkanengine_game_object.hpp"
+#include "Engine/vulkanengine_gpu_profiler.hpp"
+#include "Engine/vulkanengine_metrics.hpp"
+#include "Engine/vulkanengine_model_registry.hpp"
+#include "Engine/vulkanengine_pipeline_registry.hpp"
+#include "Engine/vulkanengine_renderer.hpp"
+#include "Engine/vulkanengine_window.hpp"
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vulkanengine
+{
+	// Renders a scripted scene for a fixed number of frames and writes per frame timings as JSON. Everything
+	// that changes between frames is driven by the frame number (fixed frame time, seeded placement, scripted
+	// camera), so two runs of the same scene record the same command buffers and only the timings differ.
+	// Headless by default, which needs no display and runs on software rasterizers such as lavapipe.
+	// With a replay file, the frame captured there (F12 in FirstApp) is re-recorded every frame instead of the scene
+	class BenchmarkApp
+	{
+	public:
+		enum class CameraPath
+		{
+			kStatic,	// looks at the origin from -z
+			kOrbit,		// circles the origin at camera_distance
+			kDolly,		// flies along z through the scene, from -camera_distance to +camera_distance
+		};
+
+		struct Scene
+		{
+			uint32_t object_count = 1000;
+			uint32_t light_count = 6;			// clamped to MAX_LIGHTS
+			std::vector<std::string> models{ "Models/smooth_vase.obj", "Models/flat_vase.obj", "Models/colored_cube.obj" };
+			VulkanEngineModel::LoadOptions model_options{};
+			float spread = 20.f;				// objects are placed in a cube of this edge length around the origin
+			uint32_t seed = 1;
+			CameraPath camera_path = CameraPath::kOrbit;
+			float camera_distance = 25.f;
+			float orbit_seconds = 10.f;			// for a full circle
+			uint32_t warmup_frames = 60;		// rendered but not reported
+			uint32_t frame_count = 600;
+			float frame_time = 1.f / 60.f;		// seconds the scene advances per frame, independent of the real frame rate
+		};
+
+		struct Config
+		{
+			Scene scene{};
+			bool headless = true;
+			bool dynamic_rendering = false;	// VK_KHR_dynamic_rendering instead of a render pass, where available
+			bool depth_prepass = false;		// opaque objects lay down depth before they are shaded
+			uint32_t width = 1280;
+			uint32_t height = 720;
+			std::string output_filepath = "benchmark.json";
+			std::string replay_filepath{};	// a VulkanEngineCommandCapture file; the scene's objects are not loaded
+		};
+
+		explicit BenchmarkApp(const Config& config);
+		~BenchmarkApp();
+
+		BenchmarkApp(const BenchmarkApp&) = delete;
+		BenchmarkApp& operator=(const BenchmarkApp&) = delete;
+
+		void Run();
+
+	private:
+		// Milliseconds; gpu is negative when the profiler has no result for the frame
+		struct FrameTimings
+		{
+			float cpu_record = 0.f;		// from the acquired frame to the end of command recording
+			float submit = 0.f;			// vkEndCommandBuffer, submit and (windowed) present
+			float fence_wait = 0.f;		// blocked on frame and image fences, i.e. waiting for the GPU
+			float gpu = -1.f;
+			uint64_t draw_calls = 0;
+			uint64_t triangles = 0;
+		};
+
+		static std::unique_ptr<VulkanEngineWindow> CreateBenchmarkWindow(const Config& config);
+		void LoadScene();
+		void UpdateCamera(VulkanEngineCamera& camera, uint32_t frame) const;
+		void CollectGpuTimes(std::vector<float>& gpu_milliseconds, uint64_t& collected) const;
+		bool WriteResults(const std::vector<FrameTimings>& timings) const;
+
+		Config config_;
+		std::unique_ptr<VulkanEngineWindow> vulkanengine_window_;
+		VulkanEngineDevice vulkanengine_device_;
+		VulkanEngineRenderer vulkanengine_renderer_;
+
+		std::unique_ptr<VulkanEngineDescriptorLayoutCache> descriptor_layout_cache_{};
+		std::unique_ptr<VulkanEngineDescriptorAllocator> global_descriptor_allocator_{};
+		std::unique_ptr<VulkanEnginePipelineRegistry> pipeline_registry_{};
+		std::unique_ptr<VulkanEngineModelRegistry> model_registry_{};
+		std::unique_ptr<VulkanEngineGpuProfiler> gpu_profiler_{};
+		std::unique_ptr<VulkanEngineMetrics> metrics_{};
+		VulkanEngineGameObject::Map game_objects_;
+	};
+}  // namespace vulkanengine
@@ -1,4 +1,11 @@
-C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe Shaders\simple_shader.vert -o Shaders\simple_shader.vert.spv
-C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe Shaders\simple_shader.frag -o Shaders\simple_shader.frag.spv
-C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe Shaders\point_light.vert -o Shaders\point_light.vert.spv
-C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe Shaders\point_light.frag -o Shaders\point_light.frag.spv
\ No newline at end of file
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\simple_shader.vert -o Shaders\simple_shader.vert.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\simple_shader.frag -o Shaders\simple_shader.frag.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\point_light.vert -o Shaders\point_light.vert.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\point_light.frag -o Shaders\point_light.frag.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\depth_only.vert -o Shaders\depth_only.vert.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\depth_only.frag -o Shaders\depth_only.frag.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\hiz_downsample.comp -o Shaders\hiz_downsample.comp.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders Shaders\occlusion_cull.comp -o Shaders\occlusion_cull.comp.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders -DBINDLESS Shaders\simple_shader.vert -o Shaders\simple_shader_bindless.vert.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders -DBINDLESS Shaders\depth_only.vert -o Shaders\depth_only_bindless.vert.spv
+C:\Dev\SDKs\VulkanSDK\1.3.275.0\Bin\glslc.exe -I Shaders -DBINDLESS Shaders\occlusion_cull.comp -o Shaders\occlusion_cull_bindless.comp.spv
\ No newline at end of file
@@ -2,6 +2,13 @@
 
 #include "Engine/vulkanengine_buffer.hpp"
 #include "Engine/vulkanengine_camera.hpp"
+#include "Engine/vulkanengine_command_capture.hpp"
+#include "Engine/vulkanengine_cpu_profiler.hpp"
+#include "Engine/vulkanengine_occlusion_culler.hpp"
+#include "Engine/vulkanengine_render_graph.hpp"
+#include "Engine/vulkanengine_ring_buffer.hpp"
+#include "Engine/vulkanengine_shader_hot_reload.hpp"
+#include "Engine/vulkanengine_shader_reflection.hpp"
 #include "keyboard_movement_controller.hpp"
 #include "Systems/simple_render_system.hpp"
 #include "Systems/point_light_system.hpp"
@@ -16,16 +23,97 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
 
 namespace vulkanengine
 {
+	static void PrintModelStats(const std::string& filepath, const VulkanEngineModel& model)
+	{
+		const VertexMemoryStats& stats = model.GetMemoryStats();
+		const QuantizationReport& report = model.GetQuantizationReport();
+		std::cout << filepath << ": " << stats.vertex_count << " vertices, "
+			<< model.GetVertexFormat().GetVertexSize() << " bytes each, "
+			<< stats.GetTotalBytes() << " bytes per draw (" << stats.GetDepthPassBytes() << " depth only, "
+			<< stats.uncompressed_vertex_bytes + stats.index_bytes << " uncompressed"
+			<< (stats.staging_bytes > 0 ? ", staged" : ", written in place") << "); "
+			<< "max error: position " << report.max_position_error
+			<< " (mean " << report.mean_position_error << "), normal " << report.max_normal_error_degrees << " deg"
+			<< ", uv " << report.max_uv_error << ", color " << report.max_color_error << std::endl;
+
+		const MeshOptimizationReport& optimization = model.GetOptimizationReport();
+		std::cout << filepath << ": ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr
+			<< ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr
+			<< (optimization.overdraw_order_applied ? ", overdraw ordered" : "") << std::endl;
+
+		if (model.GetLodCount() > 1)
+		{
+			std::cout << filepath << ": " << model.GetLodCount() << " LODs built in " << model.GetLodBuildMilliseconds() << " ms:";
+			for (uint32_t lod = 0; lod < model.GetLodCount(); ++lod)
+			{
+				std::cout << " " << model.GetTriangleCount(lod) << " tris (error " << model.GetLod(lod).error << ")";
+			}
+			std::cout << std::endl;
+		}
+
+		if (model.HasMeshlets())
+		{
+			const VulkanEngineMeshlets& meshlets = model.GetMeshlets();
+			std::cout << filepath << ": " << meshlets.GetMeshletCount() << " meshlets, "
+				<< meshlets.GetAverageVertexCount() << " vertices / " << meshlets.GetAverageTriangleCount() << " triangles on average"
+				<< (model.AreMeshletsFromCache() ? " (cached)" : "") << std::endl;
+		}
+	}
+
+	// Shown in the window title
+	static std::string FormatHud(const VulkanEngineMetrics& metrics)
+	{
+		char hud[160];
+		const VulkanEngineMetrics::Histogram* frame_time = metrics.FindHistogram(metric::kFrameTime);
+		const VulkanEngineMetrics::Histogram* fence_wait = metrics.FindHistogram(metric::kFenceWait);
+		const VulkanEngineMetrics::Counter* draw_calls = metrics.FindCounter(metric::kDrawCalls);
+		const VulkanEngineMetrics::Counter* triangles = metrics.FindCounter(metric::kTriangles);
+		snprintf(hud, sizeof(hud), "%.2f ms (p95 %.2f, p99 %.2f, gpu wait %.2f) | %llu draws | %llu tris",
+			frame_time ? frame_time->GetPercentile(50.0) : 0.0,
+			frame_time ? frame_time->GetPercentile(95.0) : 0.0,
+			frame_time ? frame_time->GetPercentile(99.0) : 0.0,
+			fence_wait ? fence_wait->GetMean() : 0.0,
+			static_cast<unsigned long long>(draw_calls ? draw_calls->last_frame : 0),
+			static_cast<unsigned long long>(triangles ? triangles->last_frame : 0));
+		return hud;
+	}
+
 	FirstApp::FirstApp()
 	{
-		global_pool_ = VulkanEngineDescriptorPool::Builder(vulkanengine_device_)
-			.SetMaxSets(VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+		descriptor_layout_cache_ = std::make_unique<VulkanEngineDescriptorLayoutCache>(vulkanengine_device_);
+		global_descriptor_allocator_ = VulkanEngineDescriptorAllocator::Builder(vulkanengine_device_)
+			.SetInitialSetsPerPool(8)
+			.AddPoolSizeRatio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+			.AddPoolSizeRatio(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f)
 			.Build();
+		if (vulkanengine_device_.SupportsBindless())
+		{
+			bindless_set_ = std::make_unique<VulkanEngineBindlessSet>(
+				vulkanengine_device_,
+				kBindlessMaxStorageBuffers,
+				kBindlessMaxImages,
+				VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT);
+		}
+		pipeline_registry_ = std::make_unique<VulkanEnginePipelineRegistry>(vulkanengine_device_);
+
+		model_registry_ = std::make_unique<VulkanEngineModelRegistry>(vulkanengine_device_);
+		VulkanEngineAssetManager::Config asset_config{};
+		asset_config.gpu_budget_bytes = kModelMemoryBudget;
+		asset_config.registry = model_registry_.get();
+		asset_manager_ = std::make_unique<VulkanEngineAssetManager>(vulkanengine_device_, asset_config);
+		gpu_profiler_ = std::make_unique<VulkanEngineGpuProfiler>(vulkanengine_device_, VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT);
+		VulkanEngineMetrics::Config metrics_config{};
+		metrics_config.csv_filepath = "metrics.csv";
+		metrics_ = std::make_unique<VulkanEngineMetrics>(metrics_config);
 		LoadGameObjects();
 	}
 
@@ -33,42 +121,195 @@ namespace vulkanengine
 
 	void FirstApp::Run()
 	{
-		std::vector<std::unique_ptr<VulkanEngineBuffer>> ubo_buffers(VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < ubo_buffers.size(); ++i)
-		{
-			ubo_buffers[i] = std::make_unique<VulkanEngineBuffer>(
-				vulkanengine_device_,
-				sizeof(GlobalUbo),
-				1,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-			);
-			ubo_buffers[i]->Map();
-		}
+		// one partition per frame in flight; GlobalUbo, any per-draw data and indirect draw commands systems push live here.
+		// Sized for every object of the scene being drawn, so it grows with the scene
+		VulkanEngineRingBuffer frame_ring_buffer{
+			vulkanengine_device_,
+			sizeof(GlobalUbo) + SimpleRenderSystem::GetFrameRingBufferBytes(static_cast<uint32_t>(game_objects_.size())),
+			VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT };
 
-		auto global_set_layout = VulkanEngineDescriptorSetLayout::Builder(vulkanengine_device_)
-			.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-			.Build();
+		// The global set layout is derived from the shaders, and GlobalUbo is checked against the
+		// offsets glslc assigned to the block in global_ubo.glsl
+		auto shader_reflection = VulkanEngineShaderReflection::FromFile("Shaders/simple_shader.vert.spv");
+		shader_reflection.Merge(VulkanEngineShaderReflection::FromFile("Shaders/simple_shader.frag.spv"));
+		VulkanEngineShaderReflection::VerifyBlock(
+			shader_reflection.GetBinding(GLOBAL_SET, GLOBAL_UBO_BINDING).block,
+			{
+				offsetof(GlobalUbo, projection),
+				offsetof(GlobalUbo, view),
+				offsetof(GlobalUbo, inverse_view),
+				offsetof(GlobalUbo, ambient_light_color),
+				offsetof(GlobalUbo, point_lights),
+				offsetof(GlobalUbo, num_lights)
+			},
+			sizeof(GlobalUbo));
 
-		std::vector<VkDescriptorSet> global_descriptor_sets(VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < global_descriptor_sets.size(); ++i)
-		{
-			auto buffer_info = ubo_buffers[i]->DescriptorInfo();
-			VulkanEngineDescriptorWriter(*global_set_layout, *global_pool_)
-				.WriteBuffer(0, &buffer_info)
-				.Build(global_descriptor_sets[i]);
-		}
+		// Shared with the point light pipeline, which only reads a subset of the block
+		auto global_set_layout = shader_reflection.SetLayoutBuilder(vulkanengine_device_, GLOBAL_SET, { GLOBAL_UBO_BINDING })
+			.Build(*descriptor_layout_cache_);
+
+		// a single set is enough: the dynamic offset picks this frame's GlobalUbo out of the ring buffer
+		VkDescriptorSet global_descriptor_set;
+		auto buffer_info = frame_ring_buffer.DescriptorInfo(sizeof(GlobalUbo));
+		VulkanEngineDescriptorWriter(*global_set_layout, *global_descriptor_allocator_)
+			.WriteBuffer(GLOBAL_UBO_BINDING, &buffer_info)
+			.Build(global_descriptor_set);
 
 		SimpleRenderSystem simple_render_system{
 			vulkanengine_device_,
-			vulkanengine_renderer_.GetSwapChainRenderPass(),
-			global_set_layout->GetDescriptorSetLayout() };
+			*pipeline_registry_,
+			vulkanengine_renderer_.GetSwapChainRenderTarget(),
+			global_set_layout->GetDescriptorSetLayout(),
+			bindless_set_.get() };
+		simple_render_system.SetDepthPrepass(kDepthPrepass);
+		simple_render_system.FinishPendingVariant();
 
 		PointLightSystem point_light_system{
 			vulkanengine_device_,
-			vulkanengine_renderer_.GetSwapChainRenderPass(),
+			*pipeline_registry_,
+			vulkanengine_renderer_.GetSwapChainRenderTarget(),
 			global_set_layout->GetDescriptorSetLayout() };
 
+		// rebuilt pipelines are swapped in by pipeline_registry_->BeginFrame()
+		VulkanEngineShaderHotReload shader_hot_reload{ *pipeline_registry_, "Shaders" };
+
+		std::unique_ptr<VulkanEngineOcclusionCuller> occlusion_culler{};
+		if (kOcclusionCulling)
+		{
+			if (VulkanEngineOcclusionCuller::IsSupported(vulkanengine_device_, vulkanengine_renderer_.GetSwapChainDepthFormat()))
+			{
+				occlusion_culler = std::make_unique<VulkanEngineOcclusionCuller>(
+					vulkanengine_device_,
+					frame_ring_buffer,
+					VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT,
+					bindless_set_.get());
+			}
+			else
+			{
+				std::cout << "occlusion culler: the depth format can't be sampled, occlusion culling is off" << std::endl;
+			}
+		}
+
+		// The frame as a render graph, rebuilt with the swap chain. The forward pass renders to the same
+		// formats as the swap chain render target, so the systems' pipelines are compatible with it; its depth
+		// buffer is a graph transient nothing reads afterwards, which the graph never stores
+		VulkanEngineRenderGraph render_graph{ vulkanengine_device_, vulkanengine_renderer_.UsesDynamicRendering() };
+		VulkanEngineRenderGraph::ResourceId swap_chain_image = VulkanEngineRenderGraph::kInvalidResource;
+		uint32_t render_graph_generation = 0;
+		auto build_render_graph = [&]() {
+			// the old graph's pass names are still referenced by unresolved profiler scopes
+			vkDeviceWaitIdle(vulkanengine_device_.Device());
+			gpu_profiler_->CollectPending();
+			render_graph.Reset();
+
+			VkExtent2D extent = vulkanengine_renderer_.GetSwapChainExtent();
+			swap_chain_image = render_graph.ImportImage(
+				"swap chain",
+				{ vulkanengine_renderer_.GetSwapChainImageFormat(), extent },
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				vulkanengine_renderer_.GetSwapChainPresentLayout());
+			auto depth = render_graph.CreateImage("depth", { vulkanengine_renderer_.GetSwapChainDepthFormat(), extent });
+
+			if (!occlusion_culler)
+			{
+				render_graph.AddPass("forward",
+					[&](VulkanEngineRenderGraph::PassBuilder& pass) {
+						pass.Write(swap_chain_image, VulkanEngineRenderGraph::Access::kColorAttachment)
+							.ClearColor(swap_chain_image, { 0.01f, 0.01f, 0.01f, 1.0f })
+							.Write(depth, VulkanEngineRenderGraph::Access::kDepthAttachment)
+							.ClearDepth(depth, 1.0f);
+					},
+					[&](FrameInfo& frame_info) {
+						simple_render_system.RenderGameObjects(frame_info);
+						point_light_system.Render(frame_info);
+					});
+				render_graph.Compile();
+			}
+			else
+			{
+				// The forward pass splits around the depth pyramid: the early half draws what was visible last
+				// frame, the late half what the pyramid of the early half's depth shows turned visible. The
+				// culler rewrites the instance counts of the draw commands in the ring buffer in between
+				auto visibility = render_graph.ImportBuffer(
+					"occlusion visibility",
+					occlusion_culler->GetVisibilityBuffer(),
+					occlusion_culler->GetVisibilityBufferSize());
+				auto draw_commands = render_graph.ImportBuffer(
+					"frame ring buffer",
+					frame_ring_buffer.GetBuffer(),
+					frame_ring_buffer.GetFrameCapacity() * VulkanEngineSwapChain::MAX_FRAMES_IN_FLIGHT);
+				VkExtent2D pyramid_extent = VulkanEngineOcclusionCuller::GetPyramidExtent(extent);
+				VulkanEngineRenderGraph::ImageDesc pyramid_desc{ VulkanEngineOcclusionCuller::kPyramidFormat, pyramid_extent };
+				pyramid_desc.mip_levels = VulkanEngineOcclusionCuller::GetPyramidMipLevels(pyramid_extent);
+				auto depth_pyramid = render_graph.CreateImage("depth pyramid", pyramid_desc);
+
+				render_graph.AddPass("occlusion early",
+					[&](VulkanEngineRenderGraph::PassBuilder& pass) {
+						pass.Read(visibility, VulkanEngineRenderGraph::Access::kComputeStorageRead)
+							.Write(draw_commands, VulkanEngineRenderGraph::Access::kComputeStorageWrite);
+					},
+					[&](FrameInfo& frame_info) {
+						simple_render_system.PrepareGameObjects(frame_info, *occlusion_culler);
+						occlusion_culler->Cull(frame_info.command_buffer, VulkanEngineOcclusionCuller::Phase::kEarly);
+					});
+				render_graph.AddPass("forward early",
+					[&](VulkanEngineRenderGraph::PassBuilder& pass) {
+						pass.Read(draw_commands, VulkanEngineRenderGraph::Access::kIndirectBuffer)
+							.Write(swap_chain_image, VulkanEngineRenderGraph::Access::kColorAttachment)
+							.ClearColor(swap_chain_image, { 0.01f, 0.01f, 0.01f, 1.0f })
+							.Write(depth, VulkanEngineRenderGraph::Access::kDepthAttachment)
+							.ClearDepth(depth, 1.0f);
+					},
+					[&](FrameInfo& frame_info) {
+						simple_render_system.RenderGameObjects(frame_info, VulkanEngineOcclusionCuller::Phase::kEarly);
+					});
+				render_graph.AddPass("depth pyramid",
+					[&](VulkanEngineRenderGraph::PassBuilder& pass) {
+						pass.Read(depth, VulkanEngineRenderGraph::Access::kComputeSampled)
+							.Write(depth_pyramid, VulkanEngineRenderGraph::Access::kComputeStorageWrite);
+					},
+					[&](FrameInfo& frame_info) {
+						occlusion_culler->BuildPyramid(frame_info.command_buffer);
+					});
+				render_graph.AddPass("occlusion late",
+					[&](VulkanEngineRenderGraph::PassBuilder& pass) {
+						pass.Read(depth_pyramid, VulkanEngineRenderGraph::Access::kComputeSampled)
+							.Write(visibility, VulkanEngineRenderGraph::Access::kComputeStorageWrite)
+							.Write(draw_commands, VulkanEngineRenderGraph::Access::kComputeStorageWrite);
+					},
+					[&](FrameInfo& frame_info) {
+						occlusion_culler->Cull(frame_info.command_buffer, VulkanEngineOcclusionCuller::Phase::kLate);
+					});
+				// loads what the early half drew
+				render_graph.AddPass("forward late",
+					[&](VulkanEngineRenderGraph::PassBuilder& pass) {
+						pass.Read(draw_commands, VulkanEngineRenderGraph::Access::kIndirectBuffer)
+							.Write(swap_chain_image, VulkanEngineRenderGraph::Access::kColorAttachment)
+							.Write(depth, VulkanEngineRenderGraph::Access::kDepthAttachment);
+					},
+					[&](FrameInfo& frame_info) {
+						simple_render_system.RenderGameObjects(frame_info, VulkanEngineOcclusionCuller::Phase::kLate);
+						point_light_system.Render(frame_info);
+					});
+				render_graph.Compile();
+
+				// the graph's images are only created by Compile
+				occlusion_culler->SetTargets(
+					render_graph.GetImageView(depth),
+					extent,
+					render_graph.GetImage(depth_pyramid),
+					render_graph.GetImageView(depth_pyramid));
+			}
+			render_graph_generation = vulkanengine_renderer_.GetSwapChainGeneration();
+
+			const VulkanEngineRenderGraph::Stats& stats = render_graph.GetStats();
+			std::cout << "render graph: " << stats.pass_count - stats.culled_pass_count << " of " << stats.pass_count << " passes, "
+				<< stats.transient_image_count + stats.transient_buffer_count << " transient resources in " << stats.transient_bytes
+				<< " bytes (" << stats.unaliased_bytes << " without aliasing)" << std::endl;
+		};
+		build_render_graph();
+
 		VulkanEngineCamera camera{};
 
 		auto viewer_object = VulkanEngineGameObject::CreateGameObject();
@@ -76,15 +317,38 @@ namespace vulkanengine
 		KeyboardMovementController camera_controller{};
 
 		auto current_time = std::chrono::high_resolution_clock::now();
+		uint64_t frame_count = 0;
+		bool spike_trace_written = false;
+		float hud_timer = 0.f;
+		// F12 records the next frame's commands for offline replay (VulkanEngine --benchmark --replay)
+		bool capture_key_down = false;
+		std::unique_ptr<VulkanEngineCommandCapture> command_capture{};
 
+		VULKANENGINE_PROFILE_THREAD("main");
 		while (!vulkanengine_window_.ShouldClose())
 		{
+			VULKANENGINE_PROFILE_SCOPE("frame");
 			glfwPollEvents();
 
 			auto new_time = std::chrono::high_resolution_clock::now();
 			float frame_time = std::chrono::duration<float, std::chrono::seconds::period>(new_time - current_time).count();
 			current_time = new_time;
 
+			// the zones of the slow frame are the newest in the rings, keep the first one past startup
+			if (VulkanEngineCpuProfiler::IsEnabled() && !spike_trace_written &&
+				++frame_count > kProfilerWarmupFrames && frame_time * 1000.f > kFrameSpikeMilliseconds)
+			{
+				spike_trace_written = VulkanEngineCpuProfiler::WriteChromeTrace("cpu_trace_spike.json");
+				std::cout << "cpu profiler: " << frame_time * 1000.f << " ms frame, trace written to cpu_trace_spike.json" << std::endl;
+			}
+
+			bool capture_key_pressed = glfwGetKey(vulkanengine_window_.GetGLFWwindow(), GLFW_KEY_F12) == GLFW_PRESS;
+			if (capture_key_pressed && !capture_key_down)
+			{
+				command_capture = std::make_unique<VulkanEngineCommandCapture>(vulkanengine_device_);
+			}
+			capture_key_down = capture_key_pressed;
+
 			camera_controller.MoveInPlaneXZ(vulkanengine_window_.GetGLFWwindow(), frame_time, viewer_object);
 			camera.SetViewYXZ(viewer_object.transform_.translation, viewer_object.transform_.rotation);
 
@@ -94,56 +358,174 @@ namespace vulkanengine
 
 			if (auto command_buffer = vulkanengine_renderer_.BeginFrame())
 			{
+				if (vulkanengine_renderer_.GetSwapChainGeneration() != render_graph_generation)
+				{
+					build_render_graph();
+				}
+
 				int frame_index = vulkanengine_renderer_.GetFrameIndex();
+				gpu_profiler_->BeginFrame(command_buffer, frame_index);
+				frame_ring_buffer.BeginFrame(frame_index);
+				if (occlusion_culler)
+				{
+					occlusion_culler->BeginFrame(frame_index);
+					metrics_->GetCounter(metric::kOccludedObjects).Add(occlusion_culler->GetStats().GetOccludedCount());
+				}
+				pipeline_registry_->BeginFrame();
+				for (ModelHandle handle : asset_manager_->Update())
+				{
+					const VulkanEngineModel& model = *asset_manager_->PeekModel(handle);
+					PrintModelStats(asset_manager_->GetFilepath(handle), model);
+					// position and attribute streams, plus the index buffer
+					metrics_->GetCounter(metric::kBufferUploads).Add(model.GetMemoryStats().index_bytes > 0 ? 3 : 2);
+					metrics_->GetCounter(metric::kBufferUploadBytes).Add(model.GetMemoryStats().GetTotalBytes());
+				}
+				if (bindless_set_)
+				{
+					bindless_set_->BeginFrame(frame_index);
+				}
+
 				FrameInfo frame_info{
 					frame_index,
 					frame_time,
 					command_buffer,
 					camera,
-					global_descriptor_sets[frame_index],
-					game_objects_
+					global_descriptor_set,
+					0,
+					game_objects_,
+					frame_ring_buffer,
+					bindless_set_.get(),
+					asset_manager_.get(),
+					gpu_profiler_.get(),
+					metrics_.get(),
+					command_capture.get()
 				};
 
 				// update
-				GlobalUbo ubo{};
-				ubo.projection = camera.GetProjection();
-				ubo.view = camera.GetView();
-				ubo.inverse_view = camera.GetInverseView();
-				point_light_system.Update(frame_info, ubo);
-				ubo_buffers[frame_index]->WriteToBuffer(&ubo);
-				ubo_buffers[frame_index]->Flush();
+				{
+					VULKANENGINE_PROFILE_SCOPE("update");
+					GlobalUbo ubo{};
+					ubo.projection = camera.GetProjection();
+					ubo.view = camera.GetView();
+					ubo.inverse_view = camera.GetInverseView();
+					point_light_system.Update(frame_info, ubo);
+					frame_info.global_ubo_offset = frame_ring_buffer.Push(ubo);
+					if (command_capture)
+					{
+						command_capture->SetGlobalUniforms(&ubo, sizeof(GlobalUbo));
+					}
+				}
 
 				// render
-				vulkanengine_renderer_.BeginSwapChainRenderPass(command_buffer);
-				simple_render_system.RenderGameObjects(frame_info);
-				point_light_system.Render(frame_info);
-				vulkanengine_renderer_.EndSwapChainRenderPass(command_buffer);
+				{
+					VULKANENGINE_PROFILE_SCOPE("record");
+					render_graph.SetImportedImage(
+						swap_chain_image,
+						vulkanengine_renderer_.GetSwapChainImage(),
+						vulkanengine_renderer_.GetSwapChainImageView());
+					render_graph.Execute(frame_info);
+					frame_ring_buffer.Flush();
+					gpu_profiler_->EndFrame(command_buffer);
+				}
 				vulkanengine_renderer_.EndFrame();
+
+				if (command_capture)
+				{
+					if (command_capture->Save("frame_capture.vecc"))
+					{
+						std::cout << "command capture: " << command_capture->GetCommandCount() << " commands written to frame_capture.vecc" << std::endl;
+					}
+					else
+					{
+						std::cerr << "command capture: failed to write frame_capture.vecc" << std::endl;
+					}
+					command_capture.reset();
+				}
+
+				metrics_->GetHistogram(metric::kFrameTime).Record(frame_time * 1000.f);
+				metrics_->GetHistogram(metric::kFenceWait).Record(vulkanengine_renderer_.GetFenceWaitMilliseconds());
+				metrics_->GetGauge(metric::kRingBufferBytes).Set(static_cast<double>(frame_ring_buffer.GetBytesUsed()));
+				metrics_->GetGauge(metric::kResidentModelBytes).Set(static_cast<double>(asset_manager_->GetStats().resident_bytes));
+				metrics_->EndFrame(frame_time);
+
+				hud_timer += frame_time;
+				if (hud_timer >= kHudRefreshSeconds)
+				{
+					vulkanengine_window_.SetTitleStatus(FormatHud(*metrics_));
+					hud_timer = 0.f;
+				}
 			}
 		}
 
 		vkDeviceWaitIdle(vulkanengine_device_.Device());
+
+		if (VulkanEngineCpuProfiler::IsEnabled() && VulkanEngineCpuProfiler::WriteChromeTrace("cpu_trace.json"))
+		{
+			std::cout << "cpu profiler: trace of the last frames written to cpu_trace.json" << std::endl;
+		}
+
+		const VulkanEngineModelRegistry::Stats& registry_stats = model_registry_->GetStats();
+		const VulkanEngineAssetManager::Stats& asset_stats = asset_manager_->GetStats();
+		std::cout << "models: " << asset_stats.request_count << " streaming requests (" << asset_stats.deduplicated_request_count << " deduplicated, "
+			<< asset_stats.load_count << " loads, " << asset_stats.eviction_count << " evictions); registry: "
+			<< registry_stats.request_count << " requests, " << registry_stats.path_hit_count << " path hits, "
+			<< registry_stats.content_hit_count << " content hits, " << registry_stats.bytes_saved << " bytes saved" << std::endl;
+
+		if (occlusion_culler)
+		{
+			const VulkanEngineOcclusionCuller::Stats& occlusion_stats = occlusion_culler->GetStats();
+			std::cout << "occlusion culler: of " << occlusion_stats.candidate_count << " objects last frame, "
+				<< occlusion_stats.early_draw_count << " drawn early, " << occlusion_stats.late_draw_count << " drawn late, "
+				<< occlusion_stats.GetOccludedCount() << " occluded" << std::endl;
+		}
+
+		for (const auto& history : gpu_profiler_->GetHistories())
+		{
+			std::cout << "gpu " << history.name << ": " << history.GetAverage() << " ms average, " << history.GetMax()
+				<< " ms max over the last " << history.count << " frames";
+			if (history.has_statistics)
+			{
+				const GpuPipelineStatistics& statistics = history.statistics;
+				std::cout << "; " << statistics.input_assembly_primitives << " primitives, "
+					<< statistics.vertex_shader_invocations << " vertex / " << statistics.fragment_shader_invocations
+					<< " fragment invocations, " << statistics.clipping_primitives << " primitives after clipping";
+				// overdraw: with the depth prepass on, about one shading invocation per covered pixel is the goal
+				VkExtent2D extent = vulkanengine_renderer_.GetSwapChainExtent();
+				double pixel_count = static_cast<double>(extent.width) * extent.height;
+				if (pixel_count > 0.0)
+				{
+					std::cout << ", " << statistics.fragment_shader_invocations / pixel_count << " fragment invocations per pixel";
+				}
+			}
+			std::cout << std::endl;
+		}
 	}
 
 	void FirstApp::LoadGameObjects()
 	{
-		std::shared_ptr<VulkanEngineModel> vulkanengine_model = VulkanEngineModel::CreateModelFromFile(vulkanengine_device_, "Models/flat_vase.obj");
+		// the vases are dense enough to benefit from the compact format, LODs and meshlet culling, the floor is four vertices
+		VulkanEngineModel::LoadOptions compact_options{};
+		compact_options.vertex_format = VertexFormat::Compact();
+		compact_options.lod_count = 5;
+		compact_options.build_meshlets = true;
+
+		// models stream in on the asset manager's workers; the cube stands in until they are resident
+		asset_manager_->SetPlaceholder(model_registry_->Load("Models/cube.obj"));
+
 		auto flat_vase = VulkanEngineGameObject::CreateGameObject();
-		flat_vase.model_ = vulkanengine_model;
+		flat_vase.model_handle_ = asset_manager_->RequestModel("Models/flat_vase.obj", compact_options);
 		flat_vase.transform_.translation = { -.5f, .5f, 0.f };
 		flat_vase.transform_.scale = { 3.f, 1.5f, 3.f };
 		game_objects_.emplace(flat_vase.GetId(), std::move(flat_vase));
 
-		vulkanengine_model = VulkanEngineModel::CreateModelFromFile(vulkanengine_device_, "Models/smooth_vase.obj");
 		auto smooth_vase = VulkanEngineGameObject::CreateGameObject();
-		smooth_vase.model_ = vulkanengine_model;
+		smooth_vase.model_handle_ = asset_manager_->RequestModel("Models/smooth_vase.obj", compact_options);
 		smooth_vase.transform_.translation = { .5f, .5f, 0.f };
 		smooth_vase.transform_.scale = { 3.f, 1.5f, 3.f };
 		game_objects_.emplace(smooth_vase.GetId(), std::move(smooth_vase));
 
-		vulkanengine_model = VulkanEngineModel::CreateModelFromFile(vulkanengine_device_, "Models/quad.obj");
 		auto floor = VulkanEngineGameObject::CreateGameObject();
-		floor.model_ = vulkanengine_model;
+		floor.model_handle_ = asset_manager_->RequestModel("Models/quad.obj", VulkanEngineModel::LoadOptions{});
 		floor.transform_.translation = { 0.f, .5f, 0.f };
 		floor.transform_.scale = { 3.f, 1.5f, 3.f };
 		game_objects_.emplace(floor.GetId(), std::move(floor));
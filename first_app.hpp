@@ -1,8 +1,14 @@
 #pragma once
 
+#include "Engine/vulkanengine_asset_manager.hpp"
+#include "Engine/vulkanengine_bindless.hpp"
 #include "Engine/vulkanengine_descriptors.hpp"
 #include "Engine/vulkanengine_device.hpp"
 #include "Engine/vulkanengine_game_object.hpp"
+#include "Engine/vulkanengine_gpu_profiler.hpp"
+#include "Engine/vulkanengine_metrics.hpp"
+#include "Engine/vulkanengine_model_registry.hpp"
+#include "Engine/vulkanengine_pipeline_registry.hpp"
 #include "Engine/vulkanengine_renderer.hpp"
 #include "Engine/vulkanengine_window.hpp"
 
@@ -17,6 +23,20 @@ namespace vulkanengine
 	public:
 		static constexpr int kWidth = 800;
 		static constexpr int kHeight = 600;
+		static constexpr uint32_t kBindlessMaxStorageBuffers = 4096;
+		static constexpr uint32_t kBindlessMaxImages = 4096;
+		static constexpr VkDeviceSize kModelMemoryBudget = 256ull << 20;
+		// with VULKANENGINE_ENABLE_PROFILING, the first frame slower than this is saved as a CPU trace
+		static constexpr float kFrameSpikeMilliseconds = 50.f;
+		static constexpr uint64_t kProfilerWarmupFrames = 120;
+		static constexpr float kHudRefreshSeconds = .5f;
+		// VK_KHR_dynamic_rendering where available: no render pass or framebuffer objects, and pipelines only
+		// depend on attachment formats
+		static constexpr bool kDynamicRendering = true;
+		// opaque geometry lays down depth first, so the lighting shader runs about once per covered pixel
+		static constexpr bool kDepthPrepass = true;
+		// objects hidden behind what was drawn last frame are skipped on the GPU (two phase HiZ culling)
+		static constexpr bool kOcclusionCulling = true;
 
 		FirstApp();
 		~FirstApp();
@@ -31,11 +51,19 @@ namespace vulkanengine
 
 		VulkanEngineWindow vulkanengine_window_{ kWidth, kHeight, "Hello Vulkan!" };
 		VulkanEngineDevice vulkanengine_device_{ vulkanengine_window_ };
-		VulkanEngineRenderer vulkanengine_renderer_{ vulkanengine_window_, vulkanengine_device_ };
+		// the render graph owns depth and begins its own passes, so the swap chain needs neither
+		VulkanEngineRenderer vulkanengine_renderer_{ vulkanengine_window_, vulkanengine_device_, kDynamicRendering, false };
 
-		// note: descriptor pool needs to be declared AFTER the device,
-		// as we want the pool to be destroyed BEFORE the device upon shutdown
-		std::unique_ptr<VulkanEngineDescriptorPool> global_pool_{};
+		// note: descriptor pools and layouts need to be declared AFTER the device,
+		// as we want them to be destroyed BEFORE the device upon shutdown
+		std::unique_ptr<VulkanEngineDescriptorLayoutCache> descriptor_layout_cache_{};
+		std::unique_ptr<VulkanEngineDescriptorAllocator> global_descriptor_allocator_{};	// long-lived sets, never reset
+		std::unique_ptr<VulkanEngineBindlessSet> bindless_set_{};	// null when descriptor indexing is unsupported
+		std::unique_ptr<VulkanEnginePipelineRegistry> pipeline_registry_{};
+		std::unique_ptr<VulkanEngineModelRegistry> model_registry_{};	// synchronous loads
+		std::unique_ptr<VulkanEngineAssetManager> asset_manager_{};		// streamed loads
+		std::unique_ptr<VulkanEngineGpuProfiler> gpu_profiler_{};
+		std::unique_ptr<VulkanEngineMetrics> metrics_{};
 		VulkanEngineGameObject::Map game_objects_;
 	};
 }  // namespace vulkanengine
\ No newline at end of file
@@ -1,16 +1,133 @@
+#include "benchmark_app.hpp"
 #include "first_app.hpp"
+#include "microbenchmarks.hpp"
 
 // std
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main()
+static void PrintUsage()
 {
-	vulkanengine::FirstApp app{};
+	std::cout << "usage: VulkanEngine [--benchmark [--objects N] [--lights N] [--frames N] [--warmup N]\n"
+		"                     [--camera static|orbit|dolly] [--seed N] [--windowed] [--output FILE]\n"
+		"                     [--replay FILE.vecc] [--dynamic-rendering] [--depth-prepass]]\n"
+		"       VulkanEngine --microbench [FILTER] [--output FILE.csv]" << std::endl;
+}
 
+// Returns false on an unknown or incomplete option
+static bool ParseBenchmarkArgs(int argc, char** argv, vulkanengine::BenchmarkApp::Config& config)
+{
+	using CameraPath = vulkanengine::BenchmarkApp::CameraPath;
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (option == "--windowed")
+		{
+			config.headless = false;
+			continue;
+		}
+		if (option == "--dynamic-rendering")
+		{
+			config.dynamic_rendering = true;
+			continue;
+		}
+		if (option == "--depth-prepass")
+		{
+			config.depth_prepass = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (option == "--objects")
+		{
+			config.scene.object_count = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (option == "--lights")
+		{
+			config.scene.light_count = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (option == "--frames")
+		{
+			config.scene.frame_count = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (option == "--warmup")
+		{
+			config.scene.warmup_frames = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (option == "--seed")
+		{
+			config.scene.seed = static_cast<uint32_t>(std::stoul(value));
+		}
+		else if (option == "--camera")
+		{
+			if (value == "static") config.scene.camera_path = CameraPath::kStatic;
+			else if (value == "orbit") config.scene.camera_path = CameraPath::kOrbit;
+			else if (value == "dolly") config.scene.camera_path = CameraPath::kDolly;
+			else return false;
+		}
+		else if (option == "--output")
+		{
+			config.output_filepath = value;
+		}
+		else if (option == "--replay")
+		{
+			config.replay_filepath = value;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return config.scene.frame_count > 0;
+}
+
+int main(int argc, char** argv)
+{
 	try
 	{
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+		{
+			vulkanengine::BenchmarkApp::Config config{};
+			if (!ParseBenchmarkArgs(argc, argv, config))
+			{
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+			vulkanengine::BenchmarkApp benchmark{ config };
+			benchmark.Run();
+			return EXIT_SUCCESS;
+		}
+		if (argc > 1 && std::strcmp(argv[1], "--microbench") == 0)
+		{
+			std::string filter{};
+			std::string csv_filepath{};
+			for (int i = 2; i < argc; ++i)
+			{
+				if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+				{
+					csv_filepath = argv[++i];
+				}
+				else
+				{
+					filter = argv[i];
+				}
+			}
+			return vulkanengine::RunMicrobenchmarks(filter, csv_filepath);
+		}
+		if (argc > 1)
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		vulkanengine::FirstApp app{};
 		app.Run();
 
 	}
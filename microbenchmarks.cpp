@@ -0,0 +1,172 @@
+#include "microbenchmarks.hpp"
+
+#include "Engine/vulkanengine_camera.hpp"
+#include "Engine/vulkanengine_game_object.hpp"
+#include "Engine/vulkanengine_microbench.hpp"
+#include "Engine/vulkanengine_model.hpp"
+#include "Systems/point_light_system.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace vulkanengine
+{
+	static constexpr const char* kBenchmarkModel = "Models/smooth_vase.obj";
+	static constexpr uint32_t kTransformCount = 1024;
+
+	static std::vector<TransformComponent> CreateTransforms(uint32_t count)
+	{
+		std::mt19937 rng{ 1 };
+		auto next = [&rng]() { return static_cast<float>(rng() >> 8) * (1.f / 16777216.f); };
+
+		std::vector<TransformComponent> transforms(count);
+		for (auto& transform : transforms)
+		{
+			transform.translation = { next() * 20.f - 10.f, next() * 20.f - 10.f, next() * 20.f - 10.f };
+			transform.rotation = { next() * glm::two_pi<float>(), next() * glm::two_pi<float>(), next() * glm::two_pi<float>() };
+			transform.scale = { .5f + next(), .5f + next(), .5f + next() };
+		}
+		return transforms;
+	}
+
+	static void AddTransformBenchmarks(VulkanEngineMicrobench& microbench)
+	{
+		// one iteration is one transform, cycling through enough of them to keep the branch predictor honest
+		microbench.Add("TransformComponent::Mat4", [transforms = CreateTransforms(kTransformCount)](uint64_t iterations) mutable {
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				glm::mat4 matrix = transforms[i % kTransformCount].Mat4();
+				DoNotOptimize(matrix);
+			}
+		});
+
+		microbench.Add("TransformComponent::NormalMatrix", [transforms = CreateTransforms(kTransformCount)](uint64_t iterations) mutable {
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				glm::mat3 matrix = transforms[i % kTransformCount].NormalMatrix();
+				DoNotOptimize(matrix);
+			}
+		});
+	}
+
+	static void AddModelBenchmarks(VulkanEngineMicrobench& microbench)
+	{
+		microbench.Add("Builder::LoadModel (smooth_vase)", [](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				VulkanEngineModel::Builder builder{};
+				builder.LoadModel(kBenchmarkModel);
+				DoNotOptimize(builder.vertices.data());
+			}
+		});
+
+		// per vertex, over the welded vertices of the same model
+		VulkanEngineModel::Builder builder{};
+		builder.LoadModel(kBenchmarkModel);
+		microbench.Add("hash<Vertex>", [vertices = std::move(builder.vertices)](uint64_t iterations) {
+			std::hash<VulkanEngineModel::Vertex> hasher{};
+			size_t seed = 0;
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				seed ^= hasher(vertices[i % vertices.size()]);
+			}
+			DoNotOptimize(seed);
+		});
+	}
+
+	static void AddLightBenchmarks(VulkanEngineMicrobench& microbench)
+	{
+		// MAX_LIGHTS lights among as many plain objects as the benchmark scene draws by default, since the
+		// gather walks the whole map
+		auto game_objects = std::make_shared<VulkanEngineGameObject::Map>();
+		for (uint32_t i = 0; i < 1000; ++i)
+		{
+			auto object = VulkanEngineGameObject::CreateGameObject();
+			game_objects->emplace(object.GetId(), std::move(object));
+		}
+		for (uint32_t i = 0; i < MAX_LIGHTS; ++i)
+		{
+			auto point_light = VulkanEngineGameObject::CreatePointLight(.2f);
+			point_light.transform_.translation = { -1.f, -1.f, static_cast<float>(i) };
+			game_objects->emplace(point_light.GetId(), std::move(point_light));
+		}
+
+		microbench.Add("PointLightSystem::GatherLights", [game_objects](uint64_t iterations) {
+			GlobalUbo ubo{};
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				PointLightSystem::GatherLights(1.f / 60.f, *game_objects, ubo);
+				DoNotOptimize(ubo);
+			}
+		});
+	}
+
+	static void AddCameraBenchmarks(VulkanEngineMicrobench& microbench)
+	{
+		microbench.Add("VulkanEngineCamera::SetViewYXZ", [](uint64_t iterations) {
+			VulkanEngineCamera camera{};
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				float angle = static_cast<float>(i & 1023) * (glm::two_pi<float>() / 1024.f);
+				camera.SetViewYXZ({ 0.f, -1.f, -2.5f }, { .1f, angle, 0.f });
+				DoNotOptimize(camera.GetView());
+			}
+		});
+
+		microbench.Add("VulkanEngineCamera::SetPerspectiveProjection", [](uint64_t iterations) {
+			VulkanEngineCamera camera{};
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				float aspect = 1.f + static_cast<float>(i & 255) * (1.f / 256.f);
+				camera.SetPerspectiveProjection(glm::radians(50.f), aspect, .1f, 100.f);
+				DoNotOptimize(camera.GetProjection());
+			}
+		});
+	}
+
+	int RunMicrobenchmarks(const std::string& filter, const std::string& csv_filepath)
+	{
+		VulkanEngineMicrobench microbench{};
+		try
+		{
+			AddTransformBenchmarks(microbench);
+			AddModelBenchmarks(microbench);
+			AddLightBenchmarks(microbench);
+			AddCameraBenchmarks(microbench);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "microbench: setup failed: " << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::vector<VulkanEngineMicrobench::Result> results = microbench.Run(filter);
+		if (results.empty())
+		{
+			std::cerr << "microbench: no benchmark matches \"" << filter << "\"" << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (!csv_filepath.empty())
+		{
+			if (!VulkanEngineMicrobench::WriteCsv(csv_filepath, results))
+			{
+				std::cerr << "microbench: failed to write " << csv_filepath << std::endl;
+				return EXIT_FAILURE;
+			}
+			std::cout << "microbench: results written to " << csv_filepath << std::endl;
+		}
+		return EXIT_SUCCESS;
+	}
+}  // namespace vulkanengine
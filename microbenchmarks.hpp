@@ -0,0 +1,12 @@
+#pragma once
+
+// std
+#include <string>
+
+namespace vulkanengine
+{
+	// CPU hot paths of the engine, timed without a window or device so they run on any machine.
+	// [filter] selects benchmarks by name substring; with [csv_filepath] the results are also written there
+	// as a baseline to compare optimizations against. Returns a process exit code
+	int RunMicrobenchmarks(const std::string& filter, const std::string& csv_filepath);
+}  // namespace vulkanengine
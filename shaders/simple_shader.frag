@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "global_ubo.glsl"
 
 layout(location = 0) in vec3 frag_color;
 layout(location = 1) in vec3 frag_position_world;
@@ -6,26 +9,11 @@ layout(location = 2) in vec3 frag_normal_world;
 
 layout(location = 0) out vec4 out_color;
 
-struct PointLight
-{
-	vec4 position;
-	vec4 color; // w is intensity
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-	mat4 projection_matrix;
-	mat4 view_matrix;
-	mat4 inverse_view_matrix;
-	vec4 ambient_light_color; // w is intensity
-	PointLight point_lights[10]; // value of vulkanengine_frame_info.hpp->MAX_LIGHTS
-	int num_lights;
-} ubo;
-
-// due to limitations on some GPUs, we can only store 128 bytes (= 2 4x4 matrices) for push constants
-layout(push_constant) uniform Push {
-	mat4 model_matrix;
-	mat4 normal_matrix;
-} push;
+// set per pipeline variant by SimpleRenderSystem::ShadingVariant
+layout(constant_id = SPEC_ID_LIGHT_BUDGET) const int LIGHT_BUDGET = MAX_LIGHTS;
+layout(constant_id = SPEC_ID_SPECULAR_EXPONENT) const float SPECULAR_EXPONENT = 512.0;
+layout(constant_id = SPEC_ID_SHADING_MODEL) const int SHADING_MODEL = 0; // 0 = blinn-phong, 1 = lambert
+layout(constant_id = SPEC_ID_SPECULAR_ENABLED) const bool ENABLE_SPECULAR = true;
 
 void main() {
 	vec3 diffuse_light = ubo.ambient_light_color.xyz * ubo.ambient_light_color.w;
@@ -35,8 +23,14 @@ void main() {
 	vec3 camera_position_world = ubo.inverse_view_matrix[3].xyz;
 	vec3 view_direction = normalize(camera_position_world - frag_position_world);
 
-	for (int i = 0; i < ubo.num_lights; ++i)
+	// constant trip count so the compiler can unroll; the UBO count only trims it
+	for (int i = 0; i < LIGHT_BUDGET; ++i)
 	{
+		if (i >= ubo.num_lights)
+		{
+			break;
+		}
+
 		PointLight light = ubo.point_lights[i];
 		vec3 direction_to_light = light.position.xyz - frag_position_world;
 		float attenuation = 1.0 / dot(direction_to_light, direction_to_light);
@@ -48,11 +42,14 @@ void main() {
 		diffuse_light += intensity * cos_angle_incidence;
 
 		// specular term
-		vec3 half_angle = normalize(direction_to_light + view_direction);
-		float specular_term = dot(surface_normal, half_angle);
-		specular_term = clamp(specular_term, 0, 1);
-		specular_term = pow(specular_term, 512.0);
-		specular_light += light.color.xyz * attenuation * specular_term;
+		if (ENABLE_SPECULAR && SHADING_MODEL == 0)
+		{
+			vec3 half_angle = normalize(direction_to_light + view_direction);
+			float specular_term = dot(surface_normal, half_angle);
+			specular_term = clamp(specular_term, 0, 1);
+			specular_term = pow(specular_term, SPECULAR_EXPONENT);
+			specular_light += light.color.xyz * attenuation * specular_term;
+		}
 	}
 
 	out_color = vec4(diffuse_light * frag_color + specular_light * frag_color, 1.0);
@@ -1,40 +1,43 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+#include "shader_shared.h"
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec3 uv;
 
+// normals arrive as two snorm16 components (z reads as 0) when the model uses NormalEncoding::kOctahedralSnorm16
+layout(constant_id = SPEC_ID_OCTAHEDRAL_NORMALS) const bool OCTAHEDRAL_NORMALS = false;
+
 layout(location = 0) out vec3 frag_color;
 layout(location = 1) out vec3 frag_pos_world;
 layout(location = 2) out vec3 frag_normal_world;
 
-struct PointLight
-{
-	vec4 position;
-	vec4 color; // w is intensity
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-	mat4 projection_matrix;
-	mat4 view_matrix;
-	mat4 inverse_view_matrix;
-	vec4 ambient_light_color; // w is intensity
-	PointLight point_lights[10]; // value of vulkanengine_frame_info.hpp->MAX_LIGHTS
-	int num_lights;
-} ubo;
-
-// due to limitations on some GPUs, we can only store 128 bytes (= 2 4x4 matrices) for push constants
-layout(push_constant) uniform Push {
-	mat4 model_matrix;
-	mat4 normal_matrix;
-} push;
+#include "global_ubo.glsl"
+#include "object_data.glsl"
+
+// matches depth_only.vert, whose depth the shading pass tests with EQUAL after a depth prepass
+invariant gl_Position;
+
+vec3 OctahedralDecode(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main() {
-	vec4 position_worldspace = push.model_matrix * vec4(position, 1.0);
+	vec4 position_worldspace = ModelMatrix() * vec4(position, 1.0);
 	gl_Position = ubo.projection_matrix * ubo.view_matrix * position_worldspace;
 
-	frag_normal_world = normalize(mat3(push.normal_matrix) * normal);
+	vec3 object_normal = OCTAHEDRAL_NORMALS ? OctahedralDecode(normal.xy) : normal;
+	frag_normal_world = normalize(mat3(NormalMatrix()) * object_normal);
 	frag_pos_world = position_worldspace.xyz;
 	frag_color = color;
 }
\ No newline at end of file